@@ -0,0 +1,191 @@
+/*
+ * Copyright (c) 2023 McEndu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/*
+ * Benchmark comparing the game cycles of the built-in rulesets, which
+ * are specialized for themselves at compile time, with the same
+ * rulesets built to dispatch through the ruleset of the game.
+ */
+#include "generic.h"
+#include <quadus.h>
+#include <quadus/calls.h>
+#include <quadus/mode.h>
+#include <quadus/ruleset.h>
+#include <quadus/ruleset/utils.h>
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define CYCLES 2000000
+
+/* gravity given out by the benchmark gamemode */
+static int gravity;
+
+static void *modeInit(void)
+{
+	return malloc(1);
+}
+
+static int modeCall(qdsGame *restrict game, unsigned long call, void *argp)
+{
+	switch (call) {
+		case QDS_GETGRAVITY:
+			*(int *)argp = gravity;
+			return 0;
+		default:
+			return -ENOTTY;
+	}
+}
+
+static const qdsGamemode benchMode = {
+	.init = modeInit,
+	.destroy = free,
+	.call = modeCall,
+};
+
+/**
+ * Generate a pseudorandom input stream resembling actual play, with
+ * frequent movement and rotation and an occasional hard drop.
+ */
+static unsigned int nextInput(unsigned long *seed)
+{
+	*seed = *seed * 6364136223846793005ul + 1442695040888963407ul;
+	unsigned int r = *seed >> 33;
+	unsigned int input = 0;
+
+	switch (r % 8) {
+		case 0:
+		case 1:
+			input |= QDS_INPUT_LEFT;
+			break;
+		case 2:
+		case 3:
+			input |= QDS_INPUT_RIGHT;
+			break;
+		case 4:
+			input |= QDS_INPUT_SOFT_DROP;
+			break;
+	}
+	if (r / 8 % 4 == 0) input |= QDS_INPUT_ROTATE_C;
+	if (r / 32 % 64 == 0) input |= QDS_INPUT_HARD_DROP;
+	if (r / 2048 % 256 == 0) input |= QDS_INPUT_HOLD;
+	return input;
+}
+
+static void setupGame(qdsGame *game, const qdsRuleset *rs, unsigned int seed)
+{
+	qdsCleanupGame(game);
+	qdsInitGame(game);
+	qdsSetRuleset(game, rs);
+	qdsSetMode(game, &benchMode);
+	qdsCall(game, QDS_SETSEED, &seed);
+}
+
+/**
+ * Time a game cycle in ns. Games that end are started again with the
+ * next seed, so both builds of a ruleset play the same games; the hash
+ * of the final state is stored to check that.
+ */
+static double run(const qdsRuleset *rs, int g, uint64_t *hash)
+{
+	qdsGame *game = qdsNewGame();
+	if (!game) abort();
+	unsigned int gameSeed = 1;
+	setupGame(game, rs, gameSeed);
+	gravity = g;
+
+	unsigned long seed = 1;
+	struct timespec start, end;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (int i = 0; i < CYCLES; ++i) {
+		qdsRunCycle(game, nextInput(&seed));
+		/* baseState is the first element of every built-in ruleset */
+		qdsRulesetState *state = qdsGetRulesetData(game);
+		if (state->status == QDS_STATUS_GAMEOVER)
+			setupGame(game, rs, ++gameSeed);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	*hash = qdsGetStateHash(game);
+	qdsDestroyGame(game);
+
+	double ns = (end.tv_sec - start.tv_sec) * 1e9;
+	ns += end.tv_nsec - start.tv_nsec;
+	return ns / CYCLES;
+}
+
+int main(void)
+{
+	static const struct
+	{
+		const char *name;
+		const qdsRuleset *specialized;
+		const qdsRuleset *generic;
+	} rulesets[] = {
+		{ "Standard", &qdsRulesetStandard, &benchGenericStandard },
+		{ "TGM", &qdsRulesetTgm, &benchGenericTgm },
+		{ "Arcade", &qdsRulesetArcade, &benchGenericArcade },
+	};
+
+	static const struct
+	{
+		const char *name;
+		int gravity;
+	} speeds[] = {
+		{ "1/60G", 65536 / 60 },
+		{ "1G", 65536 },
+		{ "20G", 20 * 65536 },
+	};
+
+	int status = EXIT_SUCCESS;
+	printf("%-10s %-8s %12s %12s\n",
+		   "ruleset",
+		   "gravity",
+		   "generic",
+		   "specialized");
+	for (size_t i = 0; i < sizeof(rulesets) / sizeof(*rulesets); ++i) {
+		for (size_t j = 0; j < sizeof(speeds) / sizeof(*speeds); ++j) {
+			uint64_t genericHash, specializedHash;
+			double generic
+				= run(rulesets[i].generic, speeds[j].gravity, &genericHash);
+			double specialized = run(
+				rulesets[i].specialized, speeds[j].gravity, &specializedHash);
+			printf("%-10s %-8s %9.1f ns %9.1f ns\n",
+				   rulesets[i].name,
+				   speeds[j].name,
+				   generic,
+				   specialized);
+
+			if (genericHash != specializedHash) {
+				fprintf(stderr, "%s: the two builds played differently\n",
+						rulesets[i].name);
+				status = EXIT_FAILURE;
+			}
+		}
+	}
+
+	return status;
+}
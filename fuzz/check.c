@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2023 McEndu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "fuzz.h"
+#include "game.h"
+#include <quadus.h>
+#include <quadus/calls.h>
+#include <quadus/mode.h>
+#include <quadus/piece.h>
+#include <quadus/ruleset.h>
+#include <quadus/ruleset/utils.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define CHECK(cond) ((cond) ? (void)0 : fail(#cond, __LINE__))
+
+const struct fuzzSetup fuzzSetups[] = {
+	{ &qdsRulesetStandard, &qdsModeMarathon, 10, 20 },
+	{ &qdsRulesetStandard, &qdsModeSprint, 10, 20 },
+	{ &qdsRulesetStandard, &qdsModeMaster, 10, 20 },
+	{ &qdsRulesetStandard, &qdsModeVersus, 10, 20 },
+	{ &qdsRulesetArcade, &qdsModeMarathon, 10, 20 },
+	{ &qdsRulesetArcade, &qdsModeSprint, 10, 20 },
+	{ &qdsRulesetArcade, &qdsModeMaster, 10, 20 },
+	{ &qdsRulesetArcade, &qdsModeVersus, 10, 20 },
+	{ &qdsRulesetTgm, &qdsModeMarathon, 10, 20 },
+	{ &qdsRulesetTgm, &qdsModeSprint, 10, 20 },
+	{ &qdsRulesetTgm, &qdsModeMaster, 10, 20 },
+	{ &qdsRulesetTgm, &qdsModeVersus, 10, 20 },
+	{ &qdsRulesetStandard, &qdsModeMarathon, 4, 20 },
+	{ &qdsRulesetStandard, &qdsModeVersus, 4, 20 },
+	{ &qdsRulesetArcade, &qdsModeMaster, 7, 8 },
+	{ &qdsRulesetTgm, &qdsModeMaster, 16, 100 },
+};
+const size_t fuzzSetupCount = sizeof(fuzzSetups) / sizeof(*fuzzSetups);
+
+static _Noreturn void fail(const char *cond, int line)
+{
+	fprintf(stderr, "check.c:%d: invariant broken: %s\n", line, cond);
+	abort();
+}
+
+qdsGame *fuzzNewGame(const struct fuzzSetup *setup, unsigned int seed)
+{
+	qdsGame *game = qdsNewGameSized(setup->width, setup->height);
+	if (!game) abort();
+	qdsSetRuleset(game, setup->rs);
+	qdsSetMode(game, setup->mode);
+	setup->rs->call(game, QDS_SETSEED, &seed);
+	if (setup->mode->call) setup->mode->call(game, QDS_SETSEED, &seed);
+	return game;
+}
+
+/* the field hash of the same rows put in a fresh game */
+static uint64_t fieldHash(qdsGame *game)
+{
+	static qdsGame *scratch;
+	if (!scratch) {
+		scratch = qdsNewGame();
+		if (!scratch) abort();
+		qdsSetRuleset(scratch, &qdsRulesetStandard);
+	}
+
+	int height = qdsGetFieldRows(game) - QDS_HIDDEN_ROWS;
+	if (qdsGetFieldWidth(scratch) != qdsGetFieldWidth(game)
+		|| qdsGetFieldRows(scratch) != qdsGetFieldRows(game)) {
+		if (!qdsSetFieldSize(scratch, qdsGetFieldWidth(game), height))
+			abort();
+	}
+	qdsClearPlayfield(scratch);
+	qdsAddLines(scratch, game->playfield, game->height);
+	return qdsGetFieldHash(scratch);
+}
+
+void fuzzCheckGame(qdsGame *game)
+{
+	CHECK(game->height >= 0 && game->height <= game->rows);
+	for (int y = 0; y < game->rows; ++y) {
+		for (int x = 0; x < QDS_MAX_WIDTH; ++x) {
+			qdsTile tile = game->playfield[y][x];
+			CHECK(tile <= QDS_PIECE_GARBAGE);
+			if (x >= game->width || y >= game->height) CHECK(tile == 0);
+		}
+	}
+
+	for (int x = 0; x < game->width; ++x) {
+		int y = game->height;
+		while (y > 0 && game->playfield[y - 1][x] == 0) --y;
+		CHECK(game->columnHeight[x] == y);
+	}
+	CHECK(game->fieldHash == fieldHash(game));
+
+	CHECK(game->piece >= 0 && game->piece <= QDS_PIECE_Z);
+	CHECK(game->orientation < 4);
+	CHECK(game->hold >= 0 && game->hold <= QDS_PIECE_Z);
+
+	/* every built-in ruleset keeps its common state first */
+	const qdsRulesetState *state = game->rsData;
+	const struct qdsPendingLines *pending = &state->pendingLines;
+	CHECK(pending->lines <= sizeof(pending->h));
+	for (int i = 0; i < pending->lines; ++i) CHECK(pending->h[i] < game->rows);
+}
@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2023 McEndu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/*
+ * Runs a fuzz target where libFuzzer is not available.
+ *
+ * Each file named on the command line is passed to the target once,
+ * and "-" stands for standard input, which suits AFL++ runs. With no
+ * arguments, a fixed set of random inputs is passed instead, as a quick
+ * check that the target and the invariants it checks hold.
+ */
+#include "fuzz.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define SMOKE_RUNS 500
+#define SMOKE_MAX_SIZE 2048
+
+static int runFile(const char *path)
+{
+	FILE *f = path[0] == '-' && !path[1] ? stdin : fopen(path, "rb");
+	if (!f) {
+		perror(path);
+		return 1;
+	}
+
+	size_t size = 0, capacity = 4096;
+	uint8_t *data = malloc(capacity);
+	size_t n;
+	while (data && (n = fread(data + size, 1, capacity - size, f)) > 0) {
+		size += n;
+		if (size == capacity) data = realloc(data, capacity *= 2);
+	}
+	if (f != stdin) fclose(f);
+	if (!data) abort();
+
+	LLVMFuzzerTestOneInput(data, size);
+	free(data);
+	return 0;
+}
+
+static uint64_t next(uint64_t *state)
+{
+	*state ^= *state << 13;
+	*state ^= *state >> 7;
+	*state ^= *state << 17;
+	return *state;
+}
+
+static void runSmoke(void)
+{
+	uint64_t state = 0x9e3779b97f4a7c15;
+	uint8_t *data = malloc(SMOKE_MAX_SIZE);
+	if (!data) abort();
+
+	for (int i = 0; i < SMOKE_RUNS; ++i) {
+		/* mostly short inputs, which make fewer changes */
+		size_t size = next(&state) % SMOKE_MAX_SIZE >> next(&state) % 8;
+		for (size_t j = 0; j < size; ++j) data[j] = next(&state);
+		LLVMFuzzerTestOneInput(data, size);
+	}
+	free(data);
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 2) {
+		runSmoke();
+		return 0;
+	}
+
+	int status = 0;
+	for (int i = 1; i < argc; ++i) status |= runFile(argv[i]);
+	return status;
+}
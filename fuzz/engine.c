@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2023 McEndu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/*
+ * Fuzz target playing games on streams of input.
+ *
+ * The first byte picks a ruleset, mode and playfield size and the next
+ * four seed the random generators. Every byte after that is fed to
+ * qdsRunCycle() as an input bitmask, except 0xff, which takes two more
+ * bytes and pushes up 1 to 8 rows of garbage with the hole at the
+ * second byte mod the width plus one; the width itself leaves no hole.
+ * Garbage rows are always 16 tiles wide, to be cut to the playfield.
+ * Versus games are played in pairs, the second game getting each input
+ * with its halves swapped.
+ */
+#include "fuzz.h"
+#include <quadus.h>
+#include <quadus/piece.h>
+#include <quadus/ruleset.h>
+#include <quadus/versus.h>
+
+#include <string.h>
+
+#define OP_GARBAGE 0xff
+
+static void addGarbage(qdsGame *game, unsigned int count, unsigned int hole)
+{
+	qdsLine rows[8];
+	count = (count & 7) + 1;
+	hole %= qdsGetFieldWidth(game) + 1;
+
+	memset(rows, 0, sizeof(rows));
+	for (unsigned int y = 0; y < count; ++y) {
+		for (unsigned int x = 0; x < QDS_MAX_WIDTH; ++x) {
+			if (x != hole) rows[y][x] = QDS_PIECE_GARBAGE;
+		}
+	}
+	qdsAddLines(game, rows, count);
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+	if (size < 5) return 0;
+	const struct fuzzSetup *setup = &fuzzSetups[data[0] % fuzzSetupCount];
+	unsigned int seed = data[1] | data[2] << 8 | data[3] << 16
+						| (unsigned int)data[4] << 24;
+
+	qdsGame *games[2] = { fuzzNewGame(setup, seed), NULL };
+	int count = 1;
+	if (setup->mode == &qdsModeVersus) {
+		games[1] = fuzzNewGame(setup, seed);
+		qdsVersusPair(games[0], games[1], seed);
+		count = 2;
+	}
+
+	for (size_t i = 5; i < size; ++i) {
+		unsigned int op = data[i];
+		if (op == OP_GARBAGE && i + 2 < size) {
+			addGarbage(games[data[i + 1] >> 7 & (count - 1)],
+					   data[i + 1],
+					   data[i + 2]);
+			i += 2;
+		} else {
+			qdsRunCycle(games[0], op);
+			if (games[1]) qdsRunCycle(games[1], (op >> 4 | op << 4) & 0xff);
+		}
+
+		for (int j = 0; j < count; ++j) fuzzCheckGame(games[j]);
+	}
+
+	for (int j = 0; j < count; ++j) qdsDestroyGame(games[j]);
+	return 0;
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2023 McEndu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/*
+ * Shared parts of the fuzz targets.
+ */
+#ifndef FUZZ_FUZZ_H
+#define FUZZ_FUZZ_H
+
+#include <quadus.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* the entry point of every target, as libFuzzer and AFL++ expect */
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+/* the rulesets, modes and playfield sizes the targets play */
+struct fuzzSetup
+{
+	const qdsRuleset *rs;
+	const qdsGamemode *mode;
+	int width;
+	int height;
+};
+
+extern const struct fuzzSetup fuzzSetups[];
+extern const size_t fuzzSetupCount;
+
+/*
+ * Create a game from a setup, with its random generators restarted from
+ * seed so that an input always plays out the same.
+ */
+qdsGame *fuzzNewGame(const struct fuzzSetup *setup, unsigned int seed);
+
+/* abort unless the game is in a consistent state */
+void fuzzCheckGame(qdsGame *game);
+
+#endif /* !FUZZ_FUZZ_H */
@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2023 McEndu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/*
+ * Fuzz target for qdsLoadGame().
+ *
+ * Plays a game as the first three bytes say: a ruleset and mode, a
+ * seed, and a number of cycles of canned input. The game is saved, and
+ * the rest of the input is taken three bytes at a time as offsets into
+ * the snapshot and bytes to XOR there before loading it. A snapshot
+ * that loads must leave a consistent game which keeps playing, and
+ * must save and load again into the same state.
+ */
+#include "fuzz.h"
+#include <quadus.h>
+
+#include <stdlib.h>
+
+static const unsigned int inputs[] = {
+	0,
+	QDS_INPUT_LEFT,
+	QDS_INPUT_ROTATE_C,
+	QDS_INPUT_HARD_DROP,
+	QDS_INPUT_RIGHT | QDS_INPUT_SOFT_DROP,
+	QDS_INPUT_HOLD,
+	QDS_INPUT_ROTATE_CC,
+	QDS_INPUT_HARD_DROP,
+};
+#define INPUT(i) (inputs[(i) / 2 % (sizeof(inputs) / sizeof(*inputs))])
+
+static unsigned char *save(qdsGame *game, size_t *size)
+{
+	*size = qdsSaveGame(game, NULL, 0);
+	if (!*size) abort();
+	unsigned char *buf = malloc(*size);
+	if (!buf || qdsSaveGame(game, buf, *size) != *size) abort();
+	return buf;
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+	if (size < 3) return 0;
+	const struct fuzzSetup *setup = &fuzzSetups[data[0] % fuzzSetupCount];
+
+	qdsGame *game = fuzzNewGame(setup, data[1]);
+	for (int i = 0; i < data[2] * 4; ++i) qdsRunCycle(game, INPUT(i));
+
+	size_t snapSize;
+	unsigned char *snap = save(game, &snapSize);
+	for (size_t i = 3; i + 2 < size; i += 3)
+		snap[(data[i] | data[i + 1] << 8) % snapSize] ^= data[i + 2];
+
+	qdsGame *loaded = fuzzNewGame(setup, 0);
+	if (qdsLoadGame(loaded, snap, snapSize)) {
+		fuzzCheckGame(loaded);
+
+		size_t againSize;
+		unsigned char *again = save(loaded, &againSize);
+		qdsGame *reloaded = fuzzNewGame(setup, 0);
+		if (!qdsLoadGame(reloaded, again, againSize)) abort();
+		if (qdsGetStateHash(loaded) != qdsGetStateHash(reloaded)) abort();
+
+		for (int i = 0; i < 120; ++i) {
+			qdsRunCycle(loaded, INPUT(i));
+			fuzzCheckGame(loaded);
+		}
+
+		free(again);
+		qdsDestroyGame(reloaded);
+	}
+
+	free(snap);
+	qdsDestroyGame(loaded);
+	qdsDestroyGame(game);
+	return 0;
+}
@@ -29,6 +29,8 @@ extern "C" {
 
 #include <stdarg.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
 #include <quadus/qdsbuild.h>
 
@@ -63,6 +65,21 @@ extern "C" {
 #define QDS_HOLD_BLOCKED -1
 #define QDS_HOLD_TOPOUT 1
 
+/*
+ * Playfield dimensions. Above the visible height, a playfield keeps
+ * QDS_HIDDEN_ROWS more rows for pieces to spawn and stack into.
+ */
+
+#define QDS_DEFAULT_WIDTH 10
+#define QDS_DEFAULT_HEIGHT 20
+#define QDS_MIN_WIDTH 4
+#define QDS_MAX_WIDTH 16 /* tiles in a qdsLine */
+#define QDS_MIN_HEIGHT 4
+#define QDS_MAX_HEIGHT 100
+#define QDS_HIDDEN_ROWS 28
+#define QDS_DEFAULT_ROWS (QDS_DEFAULT_HEIGHT + QDS_HIDDEN_ROWS)
+#define QDS_MAX_ROWS (QDS_MAX_HEIGHT + QDS_HIDDEN_ROWS)
+
 /**
  * A tile on the playfield.
  */
@@ -184,19 +201,33 @@ typedef struct qdsEventTable
  * Allocate and initialize a game state.
  */
 QDS_API qdsGame *qdsNewGame();
+/**
+ * Allocate and initialize a game state with a playfield of the given
+ * width and visible height. Returns NULL if the size is out of range
+ * or memory runs out.
+ */
+QDS_API qdsGame *qdsNewGameSized(int width, int height);
 /**
  * Deallocate a game state.
  */
 QDS_API void qdsDestroyGame(qdsGame *);
 
 /**
- * Initialize the game state.
+ * Initialize the game state, with a playfield of the default size.
  */
 QDS_API void qdsInitGame(qdsGame *);
 /**
  * Clean up the game state.
  */
 QDS_API void qdsCleanupGame(qdsGame *);
+/**
+ * Resize the playfield to the given width and visible height, and
+ * clear it. Meant for games that have not started yet.
+ *
+ * Returns false, leaving the game as is, if the size is out of range
+ * or memory runs out.
+ */
+QDS_API bool qdsSetFieldSize(qdsGame *, int width, int height);
 
 /**
  * Advance the game state by one cycle.
@@ -244,6 +275,14 @@ QDS_API qdsLine *qdsGetPlayfield(qdsGame *);
  * Get the height of the stack.
  */
 QDS_API int qdsGetFieldHeight(const qdsGame *);
+/**
+ * Get the width of the playfield.
+ */
+QDS_API int qdsGetFieldWidth(const qdsGame *);
+/**
+ * Get the number of rows of the playfield, hidden rows included.
+ */
+QDS_API int qdsGetFieldRows(const qdsGame *);
 /**
  * Get a tile in the playfield. Effectively `qdsGetPlayfield(game)[y][x]`
  * with bounds checking.
@@ -291,6 +330,43 @@ QDS_API int qdsGetNextPiece(const qdsGame *, int pos);
  * Get the held piece.
  */
 QDS_API int qdsGetHeldPiece(const qdsGame *);
+/**
+ * Get a hash of the playfield.
+ *
+ * The hash is kept up to date as pieces lock and lines are cleared or
+ * added, so getting it costs next to nothing. Changes made directly to
+ * the array returned by qdsGetPlayfield() are not tracked.
+ */
+QDS_API uint64_t qdsGetFieldHash(const qdsGame *);
+/**
+ * Get a hash of the state of the game, for detecting desyncs between
+ * games run in lockstep.
+ *
+ * Covers the playfield, the active piece and its position, the held
+ * piece and the queue, and whatever the ruleset and gamemode include
+ * in reply to QDS_GETSTATEHASH, such as their random number generators
+ * and timers. Games in the same state hash the same on any machine.
+ */
+QDS_API uint64_t qdsGetStateHash(qdsGame *);
+/**
+ * Save the state of a game into buf.
+ *
+ * Saves the playfield, the active and held pieces, and whatever the
+ * ruleset and gamemode save in reply to QDS_SAVESTATE. The result is
+ * the same on any machine. Returns the size of the saved state, which
+ * may be more than size, in which case nothing past size is written;
+ * or 0 if the ruleset or gamemode cannot be saved.
+ */
+QDS_API size_t qdsSaveGame(qdsGame *, void *buf, size_t size);
+/**
+ * Restore the state of a game saved by qdsSaveGame().
+ *
+ * The game must have the same ruleset and gamemode as the saved game.
+ * Returns false, leaving the game untouched, if the saved state is
+ * damaged or does not match, or if the ruleset or gamemode cannot save
+ * its current state to fall back on.
+ */
+QDS_API bool qdsLoadGame(qdsGame *, const void *buf, size_t size);
 
 /**
  * Call a ruleset-defined function. Returns 0 on success and non-zero
@@ -304,6 +380,7 @@ QDS_API int qdsCall(qdsGame *, unsigned long req, void *argp);
 
 QDS_API extern const qdsRuleset qdsRulesetStandard;
 QDS_API extern const qdsRuleset qdsRulesetArcade;
+QDS_API extern const qdsRuleset qdsRulesetTgm;
 
 /*
  * Built-in gamemodes.
@@ -313,6 +390,7 @@ QDS_API extern const qdsGamemode qdsModeInvisible;
 QDS_API extern const qdsGamemode qdsModeMarathon;
 QDS_API extern const qdsGamemode qdsModeSprint;
 QDS_API extern const qdsGamemode qdsModeMaster;
+QDS_API extern const qdsGamemode qdsModeVersus;
 
 #ifdef __cplusplus
 }
@@ -59,6 +59,14 @@
 #define QDS_GETGRADE 24		  /* (int *) get grade */
 #define QDS_GETGRADETEXT 25	  /* (const char **) get grade as text */
 #define QDS_SHOWGHOST 26	  /* (_Bool *) get if ghost is visible */
+/* (uint_fast16_t[rows]) get visibility of every row of the playfield */
+#define QDS_GETFIELDVISIBILITY 27
+#define QDS_GETINCOMING 28  /* (int *) get lines of garbage about to rise */
+#define QDS_GETATTACK 29    /* (unsigned int *) get lines of garbage sent */
+#define QDS_GETSTATEHASH 30 /* (uint64_t *) get hash of internal state */
+#define QDS_SAVESTATE 31    /* (qdsSaveWriter *) save internal state */
+#define QDS_LOADSTATE 32    /* (qdsSaveReader *) restore internal state */
+#define QDS_SETSEED 33      /* (unsigned int *) reseed random generators */
 
 /* game control */
 #define QDS_PAUSE 256 /* (int *) pause for specified number of cycles */
@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2023 McEndu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/**
+ * Gamemodes described by a definition file.
+ *
+ * A mode definition is a text file with one directive per line. Blank
+ * lines and text after a '#' are ignored.
+ *
+ *     name Weekly Event
+ *     levels 20
+ *     next 5
+ *     gravity 1 1092
+ *     gravity 15 2097152
+ *     lock 1 30
+ *     lines 1 10
+ *
+ * `name`, `levels` and `next` take the name of the mode, the number of
+ * levels (up to QDS_MODEDEF_MAX_LEVELS) and the number of visible next
+ * pieces. The remaining directives are curves: they take a level
+ * (starting from 1) and a value, which applies from that level until
+ * the next point on the same curve. The curves are
+ *
+ *  - gravity: in units / cycle * 65536, like QDS_GETGRAVITY;
+ *  - das, arr, lock, linedelay, are, lineare: timings in cycles;
+ *  - lines: lines to clear to complete a level.
+ *
+ * A curve that is never given falls back to the ruleset's default,
+ * except `lines`, which defaults to 10 lines per level.
+ *
+ * Definitions are expanded into tables indexed by level when loaded,
+ * so the resulting gamemode never searches a curve.
+ */
+#ifndef QDS__MODEDEF_H
+#define QDS__MODEDEF_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <quadus.h>
+#include <quadus/mode.h>
+#include <stddef.h>
+
+/**
+ * Maximum number of levels in a mode definition.
+ */
+#define QDS_MODEDEF_MAX_LEVELS 1000
+
+typedef struct qdsModeDef qdsModeDef;
+
+/**
+ * Parse a mode definition from a string.
+ *
+ * Returns NULL and sets errno on failure. If the definition is
+ * malformed, errno is set to EINVAL and the number of the offending
+ * line is stored in line, if not NULL.
+ */
+QDS_API qdsModeDef *qdsParseModeDef(const char *src, size_t len, int *line);
+/**
+ * Load a mode definition from a file.
+ *
+ * Fails like qdsParseModeDef(), or with the errno of the failed read.
+ */
+QDS_API qdsModeDef *qdsLoadModeDef(const char *path, int *line);
+/**
+ * Deallocate a mode definition. No game may be using its gamemode.
+ */
+QDS_API void qdsFreeModeDef(qdsModeDef *);
+
+/**
+ * Get the name of the mode described by a definition.
+ */
+QDS_API const char *qdsGetModeDefName(const qdsModeDef *);
+/**
+ * Get the gamemode described by a definition, for use with
+ * qdsSetMode(). The gamemode is valid until the definition is freed.
+ */
+QDS_API const qdsGamemode *qdsGetModeDefMode(const qdsModeDef *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !QDS__MODEDEF_H */
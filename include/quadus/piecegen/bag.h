@@ -29,6 +29,7 @@ extern "C" {
 
 #include <quadus.h>
 #include <quadus/ruleset/rand.h>
+#include <quadus/ruleset/save.h>
 
 /**
  * State for the standard "7-bag" piece generator.
@@ -45,6 +46,8 @@ struct qdsBag
 QDS_API void qdsBagInit(struct qdsBag *q, unsigned seed);
 QDS_API int qdsBagPeek(const struct qdsBag *q, int pos);
 QDS_API int qdsBagDraw(struct qdsBag *q);
+QDS_API void qdsBagSave(const struct qdsBag *q, qdsSaveWriter *w);
+QDS_API void qdsBagLoad(struct qdsBag *q, qdsSaveReader *r);
 
 #ifdef __cplusplus
 }
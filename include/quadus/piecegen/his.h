@@ -25,6 +25,7 @@
 
 #include <quadus.h>
 #include <quadus/ruleset/rand.h>
+#include <quadus/ruleset/save.h>
 
 /**
  * Draw a piece while performing history checking.
@@ -51,5 +52,7 @@ struct qdsHis
 QDS_API void qdsHisInit(struct qdsHis *q, unsigned seed);
 QDS_API int qdsHisPeek(const struct qdsHis *q, int pos);
 QDS_API int qdsHisDraw(struct qdsHis *q);
+QDS_API void qdsHisSave(const struct qdsHis *q, qdsSaveWriter *w);
+QDS_API void qdsHisLoad(struct qdsHis *q, qdsSaveReader *r);
 
 #endif /* !QDS__PIECEGEN_HIS_H */
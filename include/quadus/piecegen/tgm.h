@@ -25,6 +25,7 @@
 
 #include <quadus.h>
 #include <quadus/ruleset/rand.h>
+#include <quadus/ruleset/save.h>
 
 #include <stdalign.h>
 
@@ -46,5 +47,7 @@ struct qdsTgmGen
 QDS_API void qdsTgmGenInit(struct qdsTgmGen *q, unsigned seed);
 QDS_API int qdsTgmGenPeek(const struct qdsTgmGen *q, unsigned pos);
 QDS_API int qdsTgmGenDraw(struct qdsTgmGen *q);
+QDS_API void qdsTgmGenSave(const struct qdsTgmGen *q, qdsSaveWriter *w);
+QDS_API void qdsTgmGenLoad(struct qdsTgmGen *q, qdsSaveReader *r);
 
 #endif
@@ -0,0 +1,212 @@
+/*
+ * Copyright (c) 2023 McEndu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/**
+ * Lightweight game positions for search.
+ *
+ * A position is a plain copy of the state that matters for placing
+ * pieces: the playfield as row bitmasks, the active and held pieces,
+ * a window of the piece queue, and back-to-back and combo status.
+ * Positions can be copied with assignment, and the functions operating
+ * on them neither allocate memory nor emit events.
+ */
+#ifndef QDS__POSITION_H
+#define QDS__POSITION_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <quadus.h>
+#include <quadus/ruleset.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Number of upcoming pieces a position keeps.
+ */
+#define QDS_POSITION_QUEUE 8
+
+/**
+ * Bitmask of a filled row in a position.
+ */
+#define QDS_POSITION_FULL_ROW 0x03ff
+
+/**
+ * Maximum number of placements qdsFindPlacements() finds.
+ */
+#define QDS_MAX_PLACEMENTS 256
+
+typedef struct qdsPosition
+{
+	/**
+	 * The playfield, from bottom up. Bit n of a row is set if tile n
+	 * is filled.
+	 */
+	uint_least16_t rows[48];
+	/**
+	 * Number of rows up to and including the topmost filled row.
+	 */
+	unsigned char height;
+
+	signed char x;
+	signed char y;
+	unsigned char piece;
+	unsigned char orientation;
+	signed char spawnX;
+	signed char spawnY;
+
+	unsigned char hold;
+	bool held;
+
+	unsigned char queue[QDS_POSITION_QUEUE];
+	unsigned char queueLength;
+
+	/**
+	 * Result of the last successful rotation, or 0 if the piece moved
+	 * since.
+	 */
+	unsigned char twist;
+	bool b2b;
+	short combo;
+} qdsPosition;
+
+/**
+ * Where a piece ends up when it locks.
+ */
+typedef struct qdsPlacement
+{
+	signed char x;
+	signed char y;
+	unsigned char piece;
+	unsigned char orientation;
+	/**
+	 * Result of the rotation that brought the piece here, or 0.
+	 */
+	unsigned char twist;
+	/**
+	 * Whether the piece is swapped in by holding first.
+	 */
+	bool hold;
+} qdsPlacement;
+
+/**
+ * Capture the position of a game. Positions model the default
+ * playfield, so this returns false, leaving the position as is, if the
+ * game has a playfield of any other size.
+ *
+ * Back-to-back status is private to rulesets and starts cleared. The
+ * combo is taken from QDS_GETCOMBO when available.
+ */
+QDS_API bool qdsPositionFromGame(qdsPosition *pos, qdsGame *game);
+/**
+ * Write the playfield, active piece and held piece of a position back
+ * to a game. Tiles filled in both keep their color in the game; tiles
+ * only filled in the position become garbage. The piece queue is not
+ * written back. Returns false, leaving the game as is, if the game does
+ * not have a playfield of the default size.
+ */
+QDS_API bool qdsPositionToGame(const qdsPosition *pos, qdsGame *game);
+
+/**
+ * Check if a tile is filled. Tiles outside the playfield count as
+ * filled.
+ */
+QDS_API bool qdsPositionGetTile(const qdsPosition *pos, int x, int y);
+/**
+ * Check if a piece fits at a location.
+ */
+QDS_API bool qdsPositionFits(const qdsPosition *pos,
+							 const qdsRuleset *rs,
+							 int piece,
+							 int orientation,
+							 int x,
+							 int y);
+/**
+ * Spawn the next piece from the queue. Returns whether the new active
+ * piece fits.
+ */
+QDS_API bool qdsPositionSpawn(qdsPosition *pos, const qdsRuleset *rs);
+/**
+ * Swap the active piece with the held piece, or with the next piece if
+ * none is held. Returns whether holding succeeded.
+ */
+QDS_API bool qdsPositionHold(qdsPosition *pos, const qdsRuleset *rs);
+/**
+ * Move the active piece horizontally by up to a specified offset.
+ * Returns the actual offset moved.
+ */
+QDS_API int qdsPositionMove(qdsPosition *pos, const qdsRuleset *rs, int offset);
+/**
+ * Rotate the active piece as the ruleset's canRotatePosition allows.
+ * Rulesets without it have the kicks given by getKicks tried, or only
+ * rotation in place if they have none either, and never twist.
+ * Returns the result as QDS_ROTATE_*.
+ */
+QDS_API int qdsPositionRotate(qdsPosition *pos,
+							  const qdsRuleset *rs,
+							  int rotation);
+/**
+ * Drop the active piece as far as it goes. Returns the distance
+ * dropped.
+ */
+QDS_API int qdsPositionDrop(qdsPosition *pos, const qdsRuleset *rs);
+/**
+ * Lock the active piece where it is. Returns whether locking
+ * succeeded; the piece must fit where it is and be grounded.
+ */
+QDS_API bool qdsPositionLock(qdsPosition *pos, const qdsRuleset *rs);
+/**
+ * Clear all filled rows and update back-to-back and combo status.
+ * Returns the number of rows cleared.
+ */
+QDS_API int qdsPositionClearLines(qdsPosition *pos);
+
+/**
+ * Find every placement the active piece can reach by moving, rotating
+ * and soft dropping from where it is, without gravity. Placements
+ * covering the same tiles with the same twist status are found only
+ * once. Returns the number of placements written to out, at most size.
+ */
+QDS_API int qdsFindPlacements(const qdsPosition *pos,
+							  const qdsRuleset *rs,
+							  qdsPlacement *out,
+							  int size);
+/**
+ * Hold if the placement asks to, lock the active piece at a placement
+ * and clear lines. Returns the number of lines cleared, or -1 if the
+ * placement does not apply to the position.
+ */
+QDS_API int qdsPositionPlace(qdsPosition *pos,
+							 const qdsRuleset *rs,
+							 const qdsPlacement *placement);
+/**
+ * Hash a position. Positions with the same playfield, pieces,
+ * back-to-back and combo status hash the same.
+ */
+QDS_API uint64_t qdsPositionHash(const qdsPosition *pos);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !QDS__POSITION_H */
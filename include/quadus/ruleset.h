@@ -35,6 +35,9 @@ extern "C" {
 
 #include <quadus.h>
 #include <quadus/piece.h>
+#include <quadus/ruleset/mask.h>
+
+struct qdsPosition;
 
 typedef struct qdsRuleset
 {
@@ -77,11 +80,33 @@ typedef struct qdsRuleset
 	 * Get the shape of a piece.
 	 */
 	const qdsCoords *(*getShape)(int type, int orientation);
+	/**
+	 * Get the bitmask form of a piece shape. Optional; if provided,
+	 * collision checks use the mask instead of the shape.
+	 */
+	const qdsShapeMask *(*getShapeMask)(int type, int orientation);
 	/**
 	 * Check if a piece can be rotated. The kick offset is
 	 * returned in x and y.
 	 */
 	int (*canRotate)(qdsGame *game, int rotation, int *x, int *y);
+	/**
+	 * Get the kick offsets tried when rotating a piece from an
+	 * orientation, terminated with { SCHAR_MAX, SCHAR_MAX }. Optional;
+	 * used where canRotate cannot be called, such as in searches.
+	 */
+	const qdsCoords *(*getKicks)(int type, int orientation, int rotation);
+	/**
+	 * Check if the active piece of a search position can be rotated,
+	 * kicking it and recognizing twists the way canRotate does. The
+	 * kick offset is returned in x and y. Optional; without it,
+	 * searches try the kicks from getKicks and find no twists.
+	 */
+	int (*canRotatePosition)(const struct qdsPosition *pos,
+							 const struct qdsRuleset *rs,
+							 int rotation,
+							 int *x,
+							 int *y);
 } qdsRuleset;
 
 /**
@@ -107,6 +132,14 @@ QDS_API int qdsMove(qdsGame *p, int offset);
  * Specifying a negative distance is equivalent to specifying 0.
  */
 QDS_API int qdsDrop(qdsGame *p, int type, int distance);
+/**
+ * Drop the active piece as far as it can go. Returns the amount
+ * dropped.
+ *
+ * Unlike qdsDrop, this does not probe the playfield row by row unless
+ * the active piece is under an overhang.
+ */
+QDS_API int qdsInstantDrop(qdsGame *p, int type);
 /**
  * Rotate the active mino. Returns whether the rotation succeeded,
  * and whether the rotation is considered a twist.
@@ -132,8 +165,9 @@ QDS_API int qdsHold(qdsGame *);
  */
 QDS_API bool qdsClearLine(qdsGame *, int y);
 /**
- * Insert lines into the bottom of the playfield. Returns false if
- * this results in a top-out, true otherwise.
+ * Insert lines into the bottom of the playfield. Tiles past the width
+ * of the playfield are left out. Returns false if this results in a
+ * top-out, true otherwise.
  */
 QDS_API bool qdsAddLines(qdsGame *, const qdsLine *lines, size_t height);
 
@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2023 McEndu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/**
+ * Hashing helpers for rulesets and gamemodes answering
+ * QDS_GETSTATEHASH.
+ *
+ * Hashes built with these helpers depend only on the values hashed,
+ * not on the byte order or word size of the machine, so that games
+ * run on different machines can be compared.
+ */
+#ifndef QDS__RULESET_HASH_H
+#define QDS__RULESET_HASH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <quadus.h>
+#include <quadus/ruleset/utils.h>
+#include <stdint.h>
+
+/**
+ * Scramble a 64-bit value.
+ */
+inline static uint64_t qdsHashMix(uint64_t z)
+{
+	z = (z ^ (z >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+	z = (z ^ (z >> 27)) * UINT64_C(0x94d049bb133111eb);
+	return z ^ (z >> 31);
+}
+
+/**
+ * Add a value to a hash. The result depends on the order values are
+ * added in.
+ */
+inline static uint64_t qdsHashAdd(uint64_t h, uint64_t v)
+{
+	return qdsHashMix((h ^ v) + UINT64_C(0x9e3779b97f4a7c15));
+}
+
+/**
+ * Add the autorepeat state of a ruleset to a hash.
+ */
+inline static uint64_t qdsHashInputState(uint64_t h,
+										 const struct qdsInputState *istate)
+{
+	return qdsHashAdd(h,
+					  istate->lastInput
+						  | (uint64_t)(unsigned short)istate->repeatTimer << 32
+						  | (uint64_t)(unsigned short)istate->direction << 48);
+}
+
+/**
+ * Hash the state shared by rulesets built on qdsRulesetState.
+ */
+QDS_API uint64_t qdsHashRulesetState(const qdsRulesetState *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !QDS__RULESET_HASH_H */
@@ -39,10 +39,8 @@ struct qdsPendingLines
 };
 
 /**
- * Queue lines for removal.
- *
- * This API does not bounds-check; you should ensure yourself that the
- * input does not cause the queue to overflow.
+ * Queue lines for removal. Lines queued while the queue is full are
+ * dropped.
  */
 QDS_API void qdsQueueLine(struct qdsPendingLines *q, int y);
 
@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2023 McEndu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/**
+ * Bitmask representations of piece shapes and playfield lines.
+ */
+#ifndef QDS__RULESET_MASK_H
+#define QDS__RULESET_MASK_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <quadus.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * A piece shape as bitmasks of its rows.
+ *
+ * Bit n of rows[i] represents the tile at (left + n, bottom + i),
+ * relative to the rotation center. A mask of height 0 is empty.
+ */
+typedef struct qdsShapeMask
+{
+	signed char left;
+	signed char bottom;
+	unsigned char width;
+	unsigned char height;
+	uint_least16_t rows[4];
+} qdsShapeMask;
+
+/**
+ * Get a bitmask of the filled tiles in a line. Bit n is set if tile n
+ * is not empty.
+ */
+QDS_API uint_fast16_t qdsGetLineMask(const qdsTile *line);
+
+/**
+ * Convert a shape to its bitmask form.
+ */
+QDS_API void qdsBuildShapeMask(qdsShapeMask *mask, const qdsCoords *shape);
+
+/**
+ * Check if a shape mask with its rotation center placed at (x, y) does
+ * not overlap the playfield or its walls. The playfield must be of the
+ * default size.
+ */
+QDS_API bool qdsMaskFits(const qdsLine *playfield,
+						 const qdsShapeMask *mask,
+						 int x,
+						 int y);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !QDS__RULESET_MASK_H */
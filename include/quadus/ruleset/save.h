@@ -0,0 +1,203 @@
+/*
+ * Copyright (c) 2023 McEndu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/**
+ * Helpers for rulesets and gamemodes answering QDS_SAVESTATE and
+ * QDS_LOADSTATE.
+ *
+ * Values are written in a form independent of the byte order and word
+ * size of the machine: integers as variable length little-endian base
+ * 128, signed integers zigzag encoded first, and random number
+ * generator states as 8 bytes, little-endian.
+ */
+#ifndef QDS__RULESET_SAVE_H
+#define QDS__RULESET_SAVE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <quadus.h>
+#include <quadus/ruleset/input.h>
+#include <quadus/ruleset/utils.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct qdsSaveWriter
+{
+	unsigned char *buf;
+	size_t size;
+	/**
+	 * Number of bytes written. Writing past size only counts bytes, so
+	 * that the size needed can be found.
+	 */
+	size_t pos;
+} qdsSaveWriter;
+
+typedef struct qdsSaveReader
+{
+	const unsigned char *buf;
+	size_t size;
+	size_t pos;
+	/**
+	 * Set when reading past the end, or when a value read is out of
+	 * range.
+	 */
+	bool error;
+} qdsSaveReader;
+
+inline static void qdsSaveByte(qdsSaveWriter *w, unsigned int v)
+{
+	if (w->pos < w->size) w->buf[w->pos] = v;
+	w->pos += 1;
+}
+
+inline static void qdsSaveUint(qdsSaveWriter *w, uint64_t v)
+{
+	while (v >= 0x80) {
+		qdsSaveByte(w, (v & 0x7f) | 0x80);
+		v >>= 7;
+	}
+	qdsSaveByte(w, v);
+}
+
+inline static void qdsSaveInt(qdsSaveWriter *w, int64_t v)
+{
+	qdsSaveUint(w, ((uint64_t)v << 1) ^ (uint64_t)(v >> 63));
+}
+
+inline static void qdsSaveU64(qdsSaveWriter *w, uint64_t v)
+{
+	for (int i = 0; i < 8; ++i) qdsSaveByte(w, (v >> (8 * i)) & 0xff);
+}
+
+inline static void qdsSaveBytes(qdsSaveWriter *w,
+								const unsigned char *bytes,
+								size_t n)
+{
+	for (size_t i = 0; i < n; ++i) qdsSaveByte(w, bytes[i]);
+}
+
+inline static unsigned int qdsLoadByte(qdsSaveReader *r)
+{
+	if (r->pos >= r->size) {
+		r->error = true;
+		return 0;
+	}
+	return r->buf[r->pos++];
+}
+
+inline static uint64_t qdsLoadUint(qdsSaveReader *r)
+{
+	uint64_t v = 0;
+	for (int shift = 0; shift < 64; shift += 7) {
+		unsigned int b = qdsLoadByte(r);
+		v |= (uint64_t)(b & 0x7f) << shift;
+		if (!(b & 0x80)) return v;
+	}
+	r->error = true;
+	return 0;
+}
+
+inline static int64_t qdsLoadInt(qdsSaveReader *r)
+{
+	uint64_t v = qdsLoadUint(r);
+	return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+inline static uint64_t qdsLoadU64(qdsSaveReader *r)
+{
+	uint64_t v = 0;
+	for (int i = 0; i < 8; ++i) v |= (uint64_t)qdsLoadByte(r) << (8 * i);
+	return v;
+}
+
+inline static void qdsLoadBytes(qdsSaveReader *r,
+								unsigned char *bytes,
+								size_t n)
+{
+	for (size_t i = 0; i < n; ++i) bytes[i] = qdsLoadByte(r);
+}
+
+/**
+ * Read an unsigned integer, flagging an error unless it is at most max.
+ */
+inline static uint64_t qdsLoadRange(qdsSaveReader *r, uint64_t max)
+{
+	uint64_t v = qdsLoadUint(r);
+	if (v > max) {
+		r->error = true;
+		return 0;
+	}
+	return v;
+}
+
+/**
+ * Read a signed integer, flagging an error unless it is between min and
+ * max.
+ */
+inline static int64_t qdsLoadIntRange(qdsSaveReader *r,
+									  int64_t min,
+									  int64_t max)
+{
+	int64_t v = qdsLoadInt(r);
+	if (v < min || v > max) {
+		r->error = true;
+		return 0;
+	}
+	return v;
+}
+
+/**
+ * Save the autorepeat state of a ruleset.
+ */
+inline static void qdsSaveInputState(qdsSaveWriter *w,
+									 const struct qdsInputState *istate)
+{
+	qdsSaveUint(w, istate->lastInput);
+	qdsSaveInt(w, istate->repeatTimer);
+	qdsSaveInt(w, istate->direction);
+}
+
+inline static void qdsLoadInputState(qdsSaveReader *r,
+									 struct qdsInputState *istate)
+{
+	istate->lastInput = qdsLoadRange(r, UINT32_MAX);
+	istate->repeatTimer = qdsLoadIntRange(r, INT16_MIN, INT16_MAX);
+	istate->direction = qdsLoadIntRange(r, INT16_MIN, INT16_MAX);
+}
+
+/**
+ * Save the state shared by rulesets built on qdsRulesetState.
+ */
+QDS_API void qdsSaveRulesetState(qdsSaveWriter *, const qdsRulesetState *);
+/**
+ * Load the state shared by rulesets built on qdsRulesetState.
+ */
+QDS_API void qdsLoadRulesetState(qdsSaveReader *, qdsRulesetState *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !QDS__RULESET_SAVE_H */
@@ -31,6 +31,8 @@ extern "C" {
 #endif
 
 #include <quadus.h>
+#include <quadus/position.h>
+#include <quadus/ruleset.h>
 
 /**
  * Check for a twist via the immobile method.
@@ -40,6 +42,20 @@ QDS_API bool qdsCheckTwistImmobile(qdsGame *game, int x, int y, int rotation);
  * Check for a twist via the three-corner method.
  */
 QDS_API bool qdsCheckTwist3Corner(qdsGame *game, int x, int y, int rotation);
+/**
+ * Check for a twist via the immobile method in a search position.
+ */
+QDS_API bool qdsCheckPositionTwistImmobile(const qdsPosition *pos,
+										   const qdsRuleset *rs,
+										   int x,
+										   int y,
+										   int rotation);
+/**
+ * Check for a twist via the three-corner method in a search position.
+ */
+QDS_API bool qdsCheckPositionTwist3Corner(const qdsPosition *pos,
+										  int x,
+										  int y);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,202 @@
+/*
+ * Copyright (c) 2023 McEndu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/**
+ * Placement search.
+ *
+ * A search looks ahead through the piece queue with a beam search:
+ * each level places one more piece in every way it can go, with or
+ * without holding, and keeps the best positions for the next level.
+ * Positions are scored by an evaluation callback and the scores along
+ * the way to a position add up.
+ *
+ * Positions are looked up in a transposition table before being
+ * evaluated. Positions reached by placing the same pieces in another
+ * order are evaluated once and kept once, and evaluations carry over
+ * to later searches, which mostly look at positions the previous
+ * search has seen.
+ *
+ * The search stops at a node or time budget, answering with the best
+ * placement of the deepest level it finished. The first level is
+ * always finished, so there is always an answer if the piece can be
+ * placed at all.
+ */
+#ifndef QDS__SEARCH_H
+#define QDS__SEARCH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <quadus.h>
+#include <quadus/position.h>
+#include <quadus/ruleset.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef struct qdsSearch qdsSearch;
+
+/**
+ * Score a position reached by a placement clearing a number of lines.
+ * Higher is better. The score must depend only on the position and the
+ * lines cleared, as it is cached by the search.
+ */
+typedef int qdsEvaluator(const qdsPosition *pos, int lines, void *data);
+
+typedef struct qdsSearchLimits
+{
+	/**
+	 * Number of pieces to place, including the active piece.
+	 */
+	int depth;
+	/**
+	 * Number of positions kept at each level.
+	 */
+	int beamWidth;
+	/**
+	 * Maximum number of positions generated, or 0 for no limit.
+	 */
+	unsigned long nodes;
+	/**
+	 * Maximum time taken in microseconds, or 0 for no limit.
+	 */
+	unsigned long time;
+} qdsSearchLimits;
+
+typedef struct qdsSearchResult
+{
+	/**
+	 * Placement of the active piece leading to the best position.
+	 */
+	qdsPlacement placement;
+	/**
+	 * Sum of the evaluations on the way to the best position.
+	 */
+	int score;
+	/**
+	 * Number of levels finished.
+	 */
+	int depth;
+	/**
+	 * Number of positions generated.
+	 */
+	unsigned long nodes;
+	/**
+	 * Number of positions found in the transposition table.
+	 */
+	unsigned long hits;
+} qdsSearchResult;
+
+/**
+ * Allocate a search with a transposition table of 2 ** tableBits
+ * entries.
+ */
+QDS_API qdsSearch *qdsNewSearch(int tableBits);
+/**
+ * Deallocate a search.
+ */
+QDS_API void qdsDestroySearch(qdsSearch *);
+/**
+ * Forget all cached evaluations. Call this when changing evaluators.
+ */
+QDS_API void qdsClearSearch(qdsSearch *);
+
+/**
+ * Find the best placement of the active piece of a position.
+ *
+ * Returns false if the active piece cannot be placed, or the search
+ * runs out of memory.
+ */
+QDS_API bool qdsSearchPlacement(qdsSearch *,
+								const qdsPosition *pos,
+								const qdsRuleset *rs,
+								qdsEvaluator *evaluate,
+								void *data,
+								const qdsSearchLimits *limits,
+								qdsSearchResult *result);
+
+/**
+ * Maximum number of pieces in an all clear found by qdsFindAllClear():
+ * the active piece, the held piece and the whole queue.
+ */
+#define QDS_ALLCLEAR_MAX_PIECES (QDS_POSITION_QUEUE + 2)
+/**
+ * Maximum number of rows qdsFindAllClear() searches in.
+ */
+#define QDS_ALLCLEAR_MAX_LINES 6
+
+typedef struct qdsAllClearLimits
+{
+	/**
+	 * Number of rows the stack may reach, counting from the floor, up
+	 * to QDS_ALLCLEAR_MAX_LINES.
+	 */
+	int lines;
+	/**
+	 * Number of threads to search with, or 0 for one per processor.
+	 */
+	int threads;
+	/**
+	 * Maximum number of positions generated, or 0 for no limit.
+	 */
+	unsigned long nodes;
+} qdsAllClearLimits;
+
+typedef struct qdsAllClear
+{
+	/**
+	 * Placements to make in order, each of the active piece at the
+	 * time. Apply them with qdsPositionPlace().
+	 */
+	qdsPlacement placements[QDS_ALLCLEAR_MAX_PIECES];
+	int count;
+	/**
+	 * Number of positions generated.
+	 */
+	unsigned long nodes;
+} qdsAllClear;
+
+/**
+ * Find a way to clear the whole playfield with the active piece, the
+ * held piece and the queue of a position, without the stack reaching
+ * higher than limits->lines.
+ *
+ * Placements are those qdsFindPlacements() would find for a piece
+ * starting anywhere above the stack, so the active piece is taken to
+ * have just spawned. The search is exhaustive: it returns false only
+ * if there is no such all clear, or the node limit is reached first.
+ *
+ * Different first placements are searched in parallel. When several
+ * of them lead to all clears, the lowest one wins, without holding
+ * before with, so unless the node limit is reached, results do not
+ * depend on the number of threads.
+ */
+QDS_API bool qdsFindAllClear(const qdsPosition *pos,
+							 const qdsRuleset *rs,
+							 const qdsAllClearLimits *limits,
+							 qdsAllClear *solution);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !QDS__SEARCH_H */
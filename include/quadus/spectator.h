@@ -0,0 +1,162 @@
+/*
+ * Copyright (c) 2023 McEndu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/**
+ * Delta stream for spectating a game.
+ *
+ * An encoder is bound to a game as its application interface with
+ * qdsSetUi(game, &qdsSpectatorUi, &encoder). It follows the game's
+ * events to learn which rows of the playfield change, so that after
+ * each cycle qdsEncodeSpectatorFrame() writes only what changed since
+ * the previous frame: changed rows, the pose of the active piece,
+ * shifts of the next queue, the held piece and the line count, score
+ * and level. A frame in which nothing changed is a single byte.
+ *
+ * A frame is a sequence of records, each a tag byte followed by its
+ * payload, ending with a zero byte. The same bytes can be sent to any
+ * number of viewers; each viewer feeds them to
+ * qdsDecodeSpectatorFrame() to keep a qdsSpectatorView in step with
+ * the game. Viewers joining a running game start from a frame written
+ * by qdsEncodeSpectatorKeyframe(), which describes the whole state.
+ *
+ * Viewers see the leftmost 10 columns and bottom 48 rows of the
+ * playfield, all of a playfield of the default size or narrower.
+ */
+#ifndef QDS__SPECTATOR_H
+#define QDS__SPECTATOR_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <quadus.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Maximum size in bytes of an encoded frame, including keyframes.
+ */
+#define QDS_SPECTATOR_MAX_FRAME 512
+/**
+ * Maximum number of pieces of the next queue sent to viewers.
+ */
+#define QDS_SPECTATOR_QUEUE 7
+
+/**
+ * Encoder state. Initialize with qdsInitSpectator().
+ */
+typedef struct qdsSpectator
+{
+	uint_least64_t dirtyRows;
+	/* height explained by the events seen so far */
+	int expectHeight;
+	bool queueChanged;
+	bool toppedOut;
+	bool keyframe;
+
+	/* state last sent to viewers */
+	unsigned char height;
+	signed char piece;
+	signed char orientation;
+	signed char x;
+	signed char y;
+	signed char hold;
+	unsigned char queueLength;
+	signed char queue[QDS_SPECTATOR_QUEUE];
+	bool sentTopOut;
+	unsigned int lines;
+	unsigned int score;
+	int level;
+} qdsSpectator;
+
+/**
+ * Game state as known to a viewer.
+ */
+typedef struct qdsSpectatorView
+{
+	qdsLine playfield[48];
+	int height;
+	int piece;
+	int orientation;
+	int x;
+	int y;
+	int hold;
+	int queueLength;
+	int queue[QDS_SPECTATOR_QUEUE];
+	unsigned int lines;
+	unsigned int score;
+	int level;
+	bool toppedOut;
+} qdsSpectatorView;
+
+/**
+ * Application interface feeding an encoder. Its data is a
+ * qdsSpectator.
+ *
+ * The encoder takes the place of the game's application interface.
+ * Applications that need their own as well call the encoder's event
+ * handlers from theirs.
+ */
+QDS_API extern const qdsUserInterface qdsSpectatorUi;
+
+/**
+ * Initialize an encoder. The first frame it writes is a keyframe.
+ */
+QDS_API void qdsInitSpectator(qdsSpectator *);
+/**
+ * Write the changes made to the game since the previous frame.
+ *
+ * Call once after each qdsRunCycle(). buf must hold at least
+ * QDS_SPECTATOR_MAX_FRAME bytes. Returns the size of the frame.
+ */
+QDS_API size_t qdsEncodeSpectatorFrame(qdsSpectator *,
+									   qdsGame *game,
+									   unsigned char *buf);
+/**
+ * Write a frame describing the whole state of the game, for viewers
+ * joining a running game. The encoder is not affected.
+ */
+QDS_API size_t qdsEncodeSpectatorKeyframe(const qdsSpectator *,
+										  qdsGame *game,
+										  unsigned char *buf);
+
+/**
+ * Initialize a view to an empty game.
+ */
+QDS_API void qdsInitSpectatorView(qdsSpectatorView *);
+/**
+ * Apply a frame to a view.
+ *
+ * Returns the number of bytes read, or -1 if the frame is malformed
+ * or truncated, in which case the view is left in an unspecified
+ * state and the viewer should wait for a keyframe.
+ */
+QDS_API int qdsDecodeSpectatorFrame(qdsSpectatorView *,
+									const unsigned char *buf,
+									size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !QDS__SPECTATOR_H */
@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2023 McEndu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/**
+ * Two player matches with garbage exchange.
+ *
+ * Games using qdsModeVersus are paired up with qdsVersusPair(). Line
+ * clears send garbage to the opponent; the attack of a clear depends
+ * on its size, twists, back-to-back, combo and all clears. Attack
+ * first cancels garbage waiting to rise on the attacker's own
+ * playfield, and the rest is queued on the opponent, where it rises
+ * the next time the opponent locks a piece without clearing a line.
+ *
+ * A match is nothing more than two games pointing at each other. It
+ * keeps no global state and starts no threads; any number of matches
+ * may be run from one thread by calling qdsRunCycle() on both games
+ * of each match in turn.
+ */
+#ifndef QDS__VERSUS_H
+#define QDS__VERSUS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <quadus.h>
+#include <stdbool.h>
+
+/**
+ * Maximum lines of garbage risen by a single lock.
+ */
+#define QDS_VERSUS_GARBAGE_CAP 8
+
+/**
+ * Pair up two games using qdsModeVersus as opponents.
+ *
+ * Both games deal the same pieces and garbage holes from seed. Pair
+ * games before running their first cycle, and destroy neither while
+ * the other is still running. Returns false if either game is not in
+ * versus mode.
+ */
+QDS_API bool qdsVersusPair(qdsGame *a, qdsGame *b, unsigned int seed);
+/**
+ * Get the opponent of a game, or NULL if it is not paired.
+ */
+QDS_API qdsGame *qdsVersusGetOpponent(const qdsGame *);
+/**
+ * Check whether a game in versus mode has topped out.
+ */
+QDS_API bool qdsVersusHasLost(const qdsGame *);
+/**
+ * Get the attack in lines of garbage of a line clear, as returned by
+ * QDS_GETCLEARTYPE. combo counts consecutive line clears, including
+ * this one.
+ */
+QDS_API int qdsVersusAttack(unsigned int clearType, int combo);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !QDS__VERSUS_H */
@@ -20,6 +20,7 @@
  * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
  * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
+#include "actions.h"
 #include "game.h"
 #include <quadus.h>
 #include <quadus/mode.h>
@@ -31,25 +32,6 @@
 #include <stdbool.h>
 #include <string.h>
 
-#define EMIT(p, e, ...)                                                       \
-	do {                                                                      \
-		if (p->rs->events.e) (p->rs->events.e)(__VA_ARGS__);                  \
-		if (p->mode && (p->mode->events.e)) (p->mode->events.e)(__VA_ARGS__); \
-		if (p->ui && (p->ui->events.e)) (p->ui->events.e)(__VA_ARGS__);       \
-	} while (0)
-
-#define EMIT_CANCELLABLE(p, e, cancel_retval, ...)                    \
-	do {                                                              \
-		if ((p->rs->events.e) && !(p->rs->events.e)(__VA_ARGS__)) {   \
-			return (cancel_retval);                                   \
-		}                                                             \
-		if (p->mode && (p->mode->events.e)                            \
-			&& !(p->mode->events.e)(__VA_ARGS__)) {                   \
-			return (cancel_retval);                                   \
-		}                                                             \
-		if (p->ui && p->ui->events.e) (p->ui->events.e)(__VA_ARGS__); \
-	} while (0)
-
 /**
  * Draw a piece from the piece queue.
  */
@@ -67,11 +49,16 @@ static int shiftPiece(const qdsGame *p)
  */
 static bool lineFilled(qdsGame *p, int y)
 {
-	for (int i = 0; i < 10; ++i) {
-		if (p->playfield[y][i] == 0) return false;
-	}
+	return qdsGetLineMask(p->playfield[y]) == qdsFullRowMask(p->width);
+}
 
-	return true;
+void qdsUpdateColumnHeights(qdsGame *p)
+{
+	for (int x = 0; x < p->width; ++x) {
+		int y = p->height;
+		while (y > 0 && p->playfield[y - 1][x] == 0) --y;
+		p->columnHeight[x] = y;
+	}
 }
 
 QDS_API void qdsRunCycle(qdsGame *p, unsigned int input)
@@ -80,7 +67,7 @@ QDS_API void qdsRunCycle(qdsGame *p, unsigned int input)
 	assert((p->rs != NULL));
 	/* the ruleset has full control of how a game cycle should be */
 	p->rs->doGameCycle(p, input);
-	EMIT(p, onCycle, p);
+	EMIT(p, p->rs, onCycle, p);
 }
 
 QDS_API bool qdsSpawn(qdsGame *p, int type)
@@ -90,7 +77,7 @@ QDS_API bool qdsSpawn(qdsGame *p, int type)
 
 	if (type == 0) type = shiftPiece(p);
 
-	EMIT_CANCELLABLE(p, onSpawn, false, p, type);
+	EMIT_CANCELLABLE(p, p->rs, onSpawn, false, p, type);
 
 	p->piece = type;
 	p->orientation = 0;
@@ -114,50 +101,28 @@ QDS_API int qdsMove(qdsGame *p, int offset)
 {
 	assert((p != NULL));
 	assert((p->rs != NULL));
-	int i;
-	if (offset < 0) {
-		for (i = 0; i > offset; --i) {
-			if (!qdsCanMove(p, i - 1, 0)) break;
-		}
-	} else {
-		for (i = 0; i < offset; ++i) {
-			if (!qdsCanMove(p, i + 1, 0)) break;
-		}
-	}
-
-	EMIT_CANCELLABLE(p, onMove, 0, p, i);
-	p->x += i;
-	return i;
+	return qdsInlineMove(p, p->rs, offset);
 }
 
 QDS_API int qdsDrop(qdsGame *p, int type, int distance)
 {
 	assert((p != NULL));
 	assert((p->rs != NULL));
-	int i;
-	for (i = 0; i < distance; ++i) {
-		if (!qdsCanMove(p, 0, -(i + 1))) break;
-	}
+	return qdsInlineDrop(p, p->rs, type, distance);
+}
 
-	EMIT_CANCELLABLE(p, onDrop, 0, p, type, i);
-	p->y -= i;
-	return i;
+QDS_API int qdsInstantDrop(qdsGame *p, int type)
+{
+	assert((p != NULL));
+	assert((p->rs != NULL));
+	return qdsInlineInstantDrop(p, p->rs, type);
 }
 
 QDS_API int qdsRotate(qdsGame *p, int rotation)
 {
 	assert((p != NULL));
 	assert((p->rs != NULL));
-	int x, y;
-	int result = p->rs->canRotate(p, rotation, &x, &y);
-	if (result == QDS_ROTATE_FAILED) return QDS_ROTATE_FAILED;
-
-	EMIT_CANCELLABLE(p, onRotate, QDS_ROTATE_FAILED, p, rotation, result);
-
-	p->x += x;
-	p->y += y;
-	p->orientation = (p->orientation + rotation) % 4;
-	return result;
+	return qdsInlineRotate(p, p->rs, rotation);
 }
 
 QDS_API bool qdsLock(qdsGame *p)
@@ -166,22 +131,25 @@ QDS_API bool qdsLock(qdsGame *p)
 	assert((p->rs != NULL));
 
 	if (!qdsGrounded(p)) return false;
-	EMIT_CANCELLABLE(p, onLock, false, p);
+	EMIT_CANCELLABLE(p, p->rs, onLock, false, p);
 
 	const qdsCoords *shape = p->rs->getShape(p->piece, p->orientation);
 	QDS_SHAPE_FOREACH (b, shape) {
 		int x = p->x + b->x;
 		int y = p->y + b->y;
-		if (x < 0 || x >= 10 || y < 0 || y >= 48) continue;
+		if (x < 0 || x >= p->width || y < 0 || y >= p->rows) continue;
+		p->fieldHash ^= qdsRowHash(p->playfield[y], y);
 		p->playfield[y][x] = p->piece; /* for piece coloring */
+		p->fieldHash ^= qdsRowHash(p->playfield[y], y);
 
 		if (y >= p->height) p->height = y + 1;
+		if (y >= p->columnHeight[x]) p->columnHeight[x] = y + 1;
 
-		if (lineFilled(p, y)) EMIT(p, onLineFilled, p, y);
+		if (lineFilled(p, y)) EMIT(p, p->rs, onLineFilled, p, y);
 	}
 	p->piece = 0;
 	p->orientation = 0;
-	EMIT(p, postLock, p);
+	EMIT(p, p->rs, postLock, p);
 	return true;
 }
 
@@ -189,7 +157,7 @@ QDS_API int qdsHold(qdsGame *p)
 {
 	assert((p != NULL));
 	assert((p->rs != NULL));
-	EMIT_CANCELLABLE(p, onHold, QDS_HOLD_BLOCKED, p, p->piece);
+	EMIT_CANCELLABLE(p, p->rs, onHold, QDS_HOLD_BLOCKED, p, p->piece);
 
 	int active = p->piece;
 	/* spawn already draws from the queue when hold is empty */
@@ -204,12 +172,18 @@ QDS_API bool qdsClearLine(qdsGame *p, int y)
 {
 	assert((p != NULL));
 	assert((p->rs != NULL));
-	EMIT_CANCELLABLE(p, onLineClear, false, p, y);
+	EMIT_CANCELLABLE(p, p->rs, onLineClear, false, p, y);
 
 	if (y >= p->height) return true;
+	/* rows above y move down and hash differently */
+	for (int i = y; i < p->height; ++i)
+		p->fieldHash ^= qdsRowHash(p->playfield[i], i);
 	int lineNum = p->height-- - y - 1;
 	memmove(p->playfield[y], p->playfield[y + 1], lineNum * sizeof(qdsLine));
 	memset(p->playfield[p->height], 0, sizeof(qdsLine));
+	for (int i = y; i < p->height; ++i)
+		p->fieldHash ^= qdsRowHash(p->playfield[i], i);
+	qdsUpdateColumnHeights(p);
 	return true;
 }
 
@@ -223,21 +197,25 @@ QDS_API bool qdsAddLines(qdsGame *restrict p,
 	bool topout = false;
 	int playfieldRows = p->height; /* number of rows to copy */
 
-	if (count > 48) {
+	if (count > (size_t)p->rows) {
 		topout = true;
-		count = 48;
+		count = p->rows;
 		playfieldRows = 0;
-	} else if (playfieldRows + count > 48) {
+	} else if (playfieldRows + count > (size_t)p->rows) {
 		topout = true;
-		playfieldRows -= (count + playfieldRows) - 48;
+		playfieldRows -= (count + playfieldRows) - p->rows;
 	}
 	p->height = playfieldRows + count;
 
 	memmove(
 		p->playfield[count], p->playfield[0], playfieldRows * sizeof(qdsLine));
 	memcpy(p->playfield, src, count * sizeof(qdsLine));
+	for (size_t i = 0; i < count; ++i)
+		memset(p->playfield[i] + p->width, 0, QDS_MAX_WIDTH - p->width);
+	qdsUpdateColumnHeights(p);
+	qdsUpdateFieldHash(p);
 
-	if (topout) EMIT(p, onTopOut, p);
+	if (topout) EMIT(p, p->rs, onTopOut, p);
 	return !topout;
 }
 
@@ -245,30 +223,18 @@ QDS_API bool qdsCanRotate(const qdsGame *p, int x, int y, int rotation)
 {
 	assert((p != NULL));
 	assert((p->rs != NULL));
-	rotation = (unsigned)(rotation + p->orientation) % 4;
-	x += p->x;
-	y += p->y;
-
-	const qdsCoords *shape = p->rs->getShape(p->piece, rotation);
-	QDS_SHAPE_FOREACH (b, shape) {
-		int bx = x + b->x;
-		int by = y + b->y;
-
-		if (by < 0 || by >= 48) return false;
-		if (bx < 0 || bx >= 10) return false;
-		if (p->playfield[by][bx] != 0) return false;
-	}
-
-	return true;
+	return qdsInlineCanRotate(p, p->rs, x, y, rotation);
 }
 
 QDS_API void qdsClearPlayfield(qdsGame *p)
 {
-	memset(p->playfield, 0, sizeof(p->playfield));
+	memset(p->playfield, 0, p->rows * sizeof(qdsLine));
+	memset(p->columnHeight, 0, sizeof(p->columnHeight));
+	p->fieldHash = 0;
 	p->height = 0;
 }
 
 QDS_API void qdsEndGame(qdsGame *p)
 {
-	EMIT(p, onTopOut, p);
+	EMIT(p, p->rs, onTopOut, p);
 }
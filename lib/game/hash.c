@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2023 McEndu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "game.h"
+#include <quadus.h>
+#include <quadus/calls.h>
+#include <quadus/ruleset.h>
+#include <quadus/ruleset/hash.h>
+
+#include <assert.h>
+#include <stdint.h>
+
+/* keep hashes of different parts of the state apart */
+#define KEY_ROW UINT64_C(0x52f9e6d3a1c0b847)
+#define KEY_PIECE UINT64_C(0x1b873593cc9e2d51)
+#define KEY_HOLD UINT64_C(0xe6546b64a5f3c2d9)
+#define KEY_QUEUE UINT64_C(0x85ebca6bc2b2ae35)
+#define KEY_RULESET UINT64_C(0x27d4eb2f165667c5)
+#define KEY_MODE UINT64_C(0x94d049bb133111eb)
+
+uint64_t qdsRowHash(const qdsTile *row, int y)
+{
+	uint64_t lo = 0, hi = 0;
+	for (int x = 0; x < 8; ++x) {
+		lo |= (uint64_t)row[x] << (x * 8);
+		hi |= (uint64_t)row[x + 8] << (x * 8);
+	}
+
+	if (!(lo | hi)) return 0;
+	return qdsHashMix(lo + qdsHashMix(hi ^ KEY_ROW) + y * KEY_ROW);
+}
+
+void qdsUpdateFieldHash(qdsGame *p)
+{
+	p->fieldHash = 0;
+	for (int y = 0; y < p->height; ++y)
+		p->fieldHash ^= qdsRowHash(p->playfield[y], y);
+}
+
+QDS_API uint64_t qdsGetFieldHash(const qdsGame *p)
+{
+	assert((p != NULL));
+	return p->fieldHash;
+}
+
+QDS_API uint64_t qdsGetStateHash(qdsGame *p)
+{
+	assert((p != NULL));
+	assert((p->rs != NULL));
+#ifdef QDS_REFERENCE
+	qdsUpdateFieldHash(p);
+#endif
+	uint64_t h = p->fieldHash;
+
+	/* the active piece changes far more often than it is hashed, so
+	   it is hashed here instead of as it moves */
+	uint64_t pose = 0;
+	if (p->piece) {
+		pose = p->piece | p->orientation << 8
+			   | (uint64_t)(p->x & 0xffff) << 16
+			   | (uint64_t)(p->y & 0xffff) << 32;
+	}
+	h ^= qdsHashAdd(KEY_PIECE, pose);
+	h ^= qdsHashAdd(KEY_HOLD, p->hold);
+
+	int count;
+	if (qdsCall(p, QDS_GETNEXTCOUNT, &count) < 0) count = 1;
+	for (int i = 0; i < count; ++i)
+		h ^= qdsHashAdd(KEY_QUEUE + i, qdsGetNextPiece(p, i));
+
+	uint64_t state;
+	if (p->rs->call && p->rs->call(p, QDS_GETSTATEHASH, &state) == 0)
+		h ^= qdsHashAdd(KEY_RULESET, state);
+	if (p->mode && p->mode->call
+		&& p->mode->call(p, QDS_GETSTATEHASH, &state) == 0)
+		h ^= qdsHashAdd(KEY_MODE, state);
+	return h;
+}
@@ -38,6 +38,16 @@ QDS_API qdsGame *qdsNewGame(void)
 	return p;
 }
 
+QDS_API qdsGame *qdsNewGameSized(int width, int height)
+{
+	qdsGame *p = qdsNewGame();
+	if (p && !qdsSetFieldSize(p, width, height)) {
+		qdsDestroyGame(p);
+		return NULL;
+	}
+	return p;
+}
+
 QDS_API void qdsDestroyGame(qdsGame *p)
 {
 	qdsCleanupGame(p);
@@ -47,10 +57,17 @@ QDS_API void qdsDestroyGame(qdsGame *p)
 QDS_API void qdsInitGame(qdsGame *p)
 {
 	assert((p != NULL));
-	memset(p->playfield, 0, sizeof(p->playfield));
+	p->playfield = p->field;
+	p->width = QDS_DEFAULT_WIDTH;
+	p->rows = QDS_DEFAULT_ROWS;
+	memset(p->field, 0, sizeof(p->field));
 	p->piece = QDS_PIECE_NONE;
 	p->orientation = QDS_ORIENTATION_BASE;
+	p->x = 0;
+	p->y = 0;
 	p->height = 0;
+	memset(p->columnHeight, 0, sizeof(p->columnHeight));
+	p->fieldHash = 0;
 	p->hold = 0;
 	p->rs = NULL;
 	p->rsData = NULL;
@@ -70,4 +87,31 @@ QDS_API void qdsCleanupGame(qdsGame *p)
 		p->mode->destroy(p->modeData);
 		p->modeData = NULL;
 	}
+	if (p->playfield != p->field) {
+		free(p->playfield);
+		p->playfield = p->field;
+		p->width = QDS_DEFAULT_WIDTH;
+		p->rows = QDS_DEFAULT_ROWS;
+	}
+}
+
+QDS_API bool qdsSetFieldSize(qdsGame *p, int width, int height)
+{
+	assert((p != NULL));
+	if (width < QDS_MIN_WIDTH || width > QDS_MAX_WIDTH) return false;
+	if (height < QDS_MIN_HEIGHT || height > QDS_MAX_HEIGHT) return false;
+
+	int rows = height + QDS_HIDDEN_ROWS;
+	qdsLine *playfield = p->field;
+	if (rows > QDS_DEFAULT_ROWS) {
+		playfield = aligned_alloc(sizeof(qdsLine), rows * sizeof(qdsLine));
+		if (!playfield) return false;
+	}
+
+	if (p->playfield != p->field) free(p->playfield);
+	p->playfield = playfield;
+	p->width = width;
+	p->rows = rows;
+	qdsClearPlayfield(p);
+	return true;
 }
@@ -20,6 +20,7 @@
  * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
  * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
+#include "actions.h"
 #include "game.h"
 #include <quadus.h>
 #include <quadus/mode.h>
@@ -27,7 +28,6 @@
 #include <quadus/ui.h>
 
 #include <assert.h>
-#include <errno.h>
 #include <stdbool.h>
 #include <string.h>
 
@@ -39,7 +39,7 @@ QDS_API qdsLine *qdsGetPlayfield(qdsGame *p)
 
 QDS_API qdsTile qdsGetTile(const qdsGame *p, int x, int y)
 {
-	if (x < 0 || x >= 10 || y < 0 || y >= 48) return QDS_PIECE_WALL;
+	if (x < 0 || x >= p->width || y < 0 || y >= p->rows) return QDS_PIECE_WALL;
 	return p->playfield[y][x];
 }
 
@@ -104,6 +104,18 @@ QDS_API int qdsGetFieldHeight(const qdsGame *p)
 	return p->height;
 }
 
+QDS_API int qdsGetFieldWidth(const qdsGame *p)
+{
+	assert((p));
+	return p->width;
+}
+
+QDS_API int qdsGetFieldRows(const qdsGame *p)
+{
+	assert((p));
+	return p->rows;
+}
+
 QDS_API int qdsGetGhostY(const qdsGame *p)
 {
 	assert((p != NULL));
@@ -177,23 +189,5 @@ QDS_API void *qdsGetUiData(const qdsGame *p)
 QDS_API int qdsCall(qdsGame *restrict p, unsigned long req, void *restrict argp)
 {
 	assert((p != NULL));
-
-	int result;
-
-	if (p->mode && p->mode->call
-		&& (result = p->mode->call(p, req, argp)) != -ENOTTY) {
-		return result;
-	}
-
-	if (p->rs && p->rs->call
-		&& (result = p->rs->call(p, req, argp)) != -ENOTTY) {
-		return result;
-	}
-
-	if (p->ui && p->ui->call
-		&& (result = p->ui->call(p, req, argp)) != -ENOTTY) {
-		return result;
-	}
-
-	return -ENOTTY;
+	return qdsInlineCall(p, p->rs, req, argp);
 }
@@ -0,0 +1,258 @@
+/*
+ * Copyright (c) 2023 McEndu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "game.h"
+#include <quadus.h>
+#include <quadus/calls.h>
+#include <quadus/mode.h>
+#include <quadus/piece.h>
+#include <quadus/ruleset.h>
+#include <quadus/ruleset/save.h>
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SAVE_VERSION 2
+
+/*
+ * Layout, version 2:
+ *
+ *   "QDS" version
+ *   ruleset name, mode name      length-prefixed; empty if no mode
+ *   width, visible height        of the playfield
+ *   piece orientation hold x y
+ *   height, then the rows        two tiles a byte, low nibble first
+ *   ruleset state, mode state    2-byte little-endian length, then
+ *                                QDS_SAVESTATE output
+ *
+ * Version 1 lacks the playfield size, and is loaded into games with
+ * the default playfield.
+ */
+
+static void saveName(qdsSaveWriter *w, const char *name)
+{
+	size_t len = strlen(name);
+	qdsSaveUint(w, len);
+	qdsSaveBytes(w, (const unsigned char *)name, len);
+}
+
+static bool loadName(qdsSaveReader *r, const char *name)
+{
+	size_t len = qdsLoadUint(r);
+	if (r->error || len != strlen(name) || len > r->size - r->pos)
+		return false;
+	bool match = !memcmp(r->buf + r->pos, name, len);
+	r->pos += len;
+	return match;
+}
+
+static const char *rulesetName(qdsGame *p)
+{
+	const char *name = "";
+	if (p->rs->call) p->rs->call(p, QDS_GETRULESETNAME, &name);
+	return name;
+}
+
+static const char *modeName(qdsGame *p)
+{
+	const char *name = "";
+	if (p->mode && p->mode->call) p->mode->call(p, QDS_GETMODENAME, &name);
+	return name;
+}
+
+/* save the state of a ruleset or mode behind a 2-byte length */
+static bool saveBlob(qdsGame *p,
+					 int (*call)(qdsGame *, unsigned long, void *),
+					 qdsSaveWriter *w)
+{
+	size_t start = w->pos;
+	w->pos += 2;
+	if (call && call(p, QDS_SAVESTATE, w) < 0) return false;
+
+	size_t len = w->pos - start - 2;
+	if (len > 0xffff) return false;
+	if (start + 2 <= w->size) {
+		w->buf[start] = len & 0xff;
+		w->buf[start + 1] = len >> 8;
+	}
+	return true;
+}
+
+static bool loadBlob(qdsGame *p,
+					 int (*call)(qdsGame *, unsigned long, void *),
+					 qdsSaveReader *r)
+{
+	size_t len = qdsLoadByte(r);
+	len |= qdsLoadByte(r) << 8;
+	if (r->error || len > r->size - r->pos) return false;
+
+	qdsSaveReader blob = {
+		.buf = r->buf + r->pos,
+		.size = len,
+	};
+	r->pos += len;
+	if (!call) return len == 0;
+	return call(p, QDS_LOADSTATE, &blob) == 0 && !blob.error
+		   && blob.pos == len;
+}
+
+/*
+ * Keep a copy of the state behind a call, in the same form as a blob.
+ * Returns false if memory runs out.
+ */
+static bool copyState(qdsGame *p,
+					  int (*call)(qdsGame *, unsigned long, void *),
+					  qdsSaveWriter *w)
+{
+	*w = (qdsSaveWriter){ 0 };
+	if (!saveBlob(p, call, w)) return false;
+	w->buf = malloc(w->pos);
+	if (!w->buf) return false;
+	w->size = w->pos;
+	w->pos = 0;
+	return saveBlob(p, call, w);
+}
+
+static void restoreState(qdsGame *p,
+						 int (*call)(qdsGame *, unsigned long, void *),
+						 const qdsSaveWriter *w)
+{
+	qdsSaveReader r = {
+		.buf = w->buf,
+		.size = w->size,
+	};
+	loadBlob(p, call, &r);
+}
+
+QDS_API size_t qdsSaveGame(qdsGame *p, void *buf, size_t size)
+{
+	assert((p != NULL));
+	assert((p->rs != NULL));
+	qdsSaveWriter w = {
+		.buf = buf,
+		.size = size,
+	};
+
+	qdsSaveBytes(&w, (const unsigned char *)"QDS", 3);
+	qdsSaveByte(&w, SAVE_VERSION);
+	saveName(&w, rulesetName(p));
+	saveName(&w, modeName(p));
+	qdsSaveByte(&w, p->width);
+	qdsSaveByte(&w, p->rows - QDS_HIDDEN_ROWS);
+
+	qdsSaveByte(&w, p->piece);
+	qdsSaveByte(&w, p->orientation);
+	qdsSaveByte(&w, p->hold);
+	qdsSaveInt(&w, p->x);
+	qdsSaveInt(&w, p->y);
+
+	qdsSaveByte(&w, p->height);
+	for (int y = 0; y < p->height; ++y) {
+		for (int x = 0; x < p->width; x += 2)
+			qdsSaveByte(&w, p->playfield[y][x] | p->playfield[y][x + 1] << 4);
+	}
+
+	if (!saveBlob(p, p->rs->call, &w)) return 0;
+	if (!saveBlob(p, p->mode ? p->mode->call : NULL, &w)) return 0;
+	return w.pos;
+}
+
+QDS_API bool qdsLoadGame(qdsGame *p, const void *buf, size_t size)
+{
+	assert((p != NULL));
+	assert((p->rs != NULL));
+	qdsSaveReader r = {
+		.buf = buf,
+		.size = size,
+	};
+
+	unsigned char magic[3];
+	qdsLoadBytes(&r, magic, 3);
+	if (r.error || memcmp(magic, "QDS", 3)) return false;
+	int version = qdsLoadByte(&r);
+	if (version < 1 || version > SAVE_VERSION) return false;
+	if (!loadName(&r, rulesetName(p)) || !loadName(&r, modeName(p)))
+		return false;
+
+	int width = QDS_DEFAULT_WIDTH, rows = QDS_DEFAULT_ROWS;
+	if (version >= 2) {
+		width = qdsLoadByte(&r);
+		rows = qdsLoadByte(&r) + QDS_HIDDEN_ROWS;
+	}
+	if (r.error || width != p->width || rows != p->rows) return false;
+
+	int piece = qdsLoadRange(&r, QDS_PIECE_Z);
+	int orientation = qdsLoadRange(&r, 3);
+	int hold = qdsLoadRange(&r, QDS_PIECE_Z);
+	int x = qdsLoadIntRange(&r, -8, width + 7);
+	int y = qdsLoadIntRange(&r, -8, rows + 7);
+	int height = qdsLoadRange(&r, rows);
+	size_t rowSize = (width + 1) / 2;
+	if (r.error || height * rowSize > r.size - r.pos) return false;
+
+	qdsLine playfield[QDS_MAX_ROWS];
+	memset(playfield, 0, rows * sizeof(qdsLine));
+	for (int i = 0; i < height; ++i) {
+		for (int j = 0; j < width; j += 2) {
+			unsigned int tiles = qdsLoadByte(&r);
+			playfield[i][j] = tiles & 0xf;
+			playfield[i][j + 1] = tiles >> 4;
+			if (playfield[i][j] > QDS_PIECE_GARBAGE
+				|| playfield[i][j + 1] > QDS_PIECE_GARBAGE)
+				return false;
+		}
+		/* odd widths leave a nibble past the edge */
+		if (width < QDS_MAX_WIDTH && playfield[i][width]) return false;
+	}
+
+	/*
+	 * Blobs load straight into the ruleset and mode, so keep their
+	 * states to put back should anything after the first one be bad.
+	 */
+	int (*modeCall)(qdsGame *, unsigned long, void *)
+		= p->mode ? p->mode->call : NULL;
+	qdsSaveWriter rsState = { 0 }, modeState = { 0 };
+	bool ok = copyState(p, p->rs->call, &rsState)
+			  && copyState(p, modeCall, &modeState);
+	if (ok
+		&& !(loadBlob(p, p->rs->call, &r) && loadBlob(p, modeCall, &r)
+			 && r.pos == r.size)) {
+		restoreState(p, p->rs->call, &rsState);
+		restoreState(p, modeCall, &modeState);
+		ok = false;
+	}
+	free(rsState.buf);
+	free(modeState.buf);
+	if (!ok) return false;
+
+	memcpy(p->playfield, playfield, rows * sizeof(qdsLine));
+	p->piece = piece;
+	p->orientation = orientation;
+	p->hold = hold;
+	p->x = x;
+	p->y = y;
+	p->height = height;
+	qdsUpdateColumnHeights(p);
+	qdsUpdateFieldHash(p);
+	return true;
+}
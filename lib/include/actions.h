@@ -0,0 +1,249 @@
+/*
+ * Copyright (c) 2023 McEndu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/**
+ * Inline implementations of playfield actions.
+ *
+ * Each action takes the ruleset as an explicit parameter. The exported
+ * actions pass the ruleset of the game; built-in rulesets pass
+ * themselves, so that the compiler can resolve shape lookups, kicks
+ * and event handlers at compile time.
+ *
+ * Built with QDS_REFERENCE, the library leaves out its fast paths, and
+ * collisions and drops are checked one tile at a time. This reference
+ * engine is run against the normal one to catch fast paths going
+ * wrong; see reference/.
+ */
+#ifndef QDS__ACTIONS_H
+#define QDS__ACTIONS_H
+
+#include "game.h"
+#include <quadus.h>
+#include <quadus/mode.h>
+#include <quadus/ruleset.h>
+#include <quadus/ruleset/mask.h>
+#include <quadus/ui.h>
+
+#include <assert.h>
+#include <errno.h>
+#include <stdbool.h>
+
+#define QDS_INLINE static inline __attribute__((always_inline))
+
+#define EMIT(p, rs, e, ...)                                                   \
+	do {                                                                      \
+		if (rs->events.e) (rs->events.e)(__VA_ARGS__);                        \
+		if (p->mode && (p->mode->events.e)) (p->mode->events.e)(__VA_ARGS__); \
+		if (p->ui && (p->ui->events.e)) (p->ui->events.e)(__VA_ARGS__);       \
+	} while (0)
+
+#define EMIT_CANCELLABLE(p, rs, e, cancel_retval, ...)                \
+	do {                                                              \
+		if ((rs->events.e) && !(rs->events.e)(__VA_ARGS__)) {         \
+			return (cancel_retval);                                   \
+		}                                                             \
+		if (p->mode && (p->mode->events.e)                            \
+			&& !(p->mode->events.e)(__VA_ARGS__)) {                   \
+			return (cancel_retval);                                   \
+		}                                                             \
+		if (p->ui && p->ui->events.e) (p->ui->events.e)(__VA_ARGS__); \
+	} while (0)
+
+QDS_INLINE int qdsInlineCall(qdsGame *restrict p,
+							 const qdsRuleset *rs,
+							 unsigned long req,
+							 void *restrict argp)
+{
+	int result;
+
+	if (p->mode && p->mode->call
+		&& (result = p->mode->call(p, req, argp)) != -ENOTTY) {
+		return result;
+	}
+
+	if (rs && rs->call && (result = rs->call(p, req, argp)) != -ENOTTY) {
+		return result;
+	}
+
+	if (p->ui && p->ui->call
+		&& (result = p->ui->call(p, req, argp)) != -ENOTTY) {
+		return result;
+	}
+
+	return -ENOTTY;
+}
+
+QDS_INLINE bool qdsInlineMaskFits(const qdsLine *restrict playfield,
+								  int width,
+								  int rows,
+								  const qdsShapeMask *restrict mask,
+								  int x,
+								  int y)
+{
+	if (mask->height == 0) return true;
+
+	x += mask->left;
+	y += mask->bottom;
+	if (x < 0 || x + mask->width > width) return false;
+	if (y < 0 || y + mask->height > rows) return false;
+
+	for (int i = 0; i < mask->height; ++i) {
+		if (qdsGetLineMask(playfield[y + i]) & (mask->rows[i] << x))
+			return false;
+	}
+
+	return true;
+}
+
+/**
+ * Check if a shape mask with its rotation center placed at (x, y) fits
+ * the playfield of a game. Common playfield sizes have their own copy
+ * of the check, with the bounds known at compile time.
+ */
+QDS_INLINE bool qdsInlineFieldFits(const qdsGame *p,
+								   const qdsShapeMask *mask,
+								   int x,
+								   int y)
+{
+	if (p->rows == QDS_DEFAULT_ROWS) {
+		if (p->width == QDS_DEFAULT_WIDTH)
+			return qdsInlineMaskFits(p->playfield, QDS_DEFAULT_WIDTH,
+									 QDS_DEFAULT_ROWS, mask, x, y);
+		if (p->width == QDS_MIN_WIDTH)
+			return qdsInlineMaskFits(p->playfield, QDS_MIN_WIDTH,
+									 QDS_DEFAULT_ROWS, mask, x, y);
+	}
+	return qdsInlineMaskFits(p->playfield, p->width, p->rows, mask, x, y);
+}
+
+QDS_INLINE bool qdsInlineCanRotate(const qdsGame *p,
+								   const qdsRuleset *rs,
+								   int x,
+								   int y,
+								   int rotation)
+{
+	rotation = (unsigned)(rotation + p->orientation) % 4;
+	x += p->x;
+	y += p->y;
+
+#ifndef QDS_REFERENCE
+	if (rs->getShapeMask) {
+		const qdsShapeMask *mask = rs->getShapeMask(p->piece, rotation);
+		return qdsInlineFieldFits(p, mask, x, y);
+	}
+#endif
+
+	const qdsCoords *shape = rs->getShape(p->piece, rotation);
+	QDS_SHAPE_FOREACH (b, shape) {
+		int bx = x + b->x;
+		int by = y + b->y;
+
+		if (by < 0 || by >= p->rows) return false;
+		if (bx < 0 || bx >= p->width) return false;
+		if (p->playfield[by][bx] != 0) return false;
+	}
+
+	return true;
+}
+
+#define qdsInlineCanMove(p, rs, x, y) (qdsInlineCanRotate(p, rs, x, y, 0))
+#define qdsInlineOverlaps(p, rs) (!qdsInlineCanRotate(p, rs, 0, 0, 0))
+#define qdsInlineGrounded(p, rs) (!qdsInlineCanRotate(p, rs, 0, -1, 0))
+
+QDS_INLINE int qdsInlineMove(qdsGame *p, const qdsRuleset *rs, int offset)
+{
+	int i;
+	if (offset < 0) {
+		for (i = 0; i > offset; --i) {
+			if (!qdsInlineCanMove(p, rs, i - 1, 0)) break;
+		}
+	} else {
+		for (i = 0; i < offset; ++i) {
+			if (!qdsInlineCanMove(p, rs, i + 1, 0)) break;
+		}
+	}
+
+	EMIT_CANCELLABLE(p, rs, onMove, 0, p, i);
+	p->x += i;
+	return i;
+}
+
+QDS_INLINE int qdsInlineDrop(qdsGame *p,
+							 const qdsRuleset *rs,
+							 int type,
+							 int distance)
+{
+	int i;
+	for (i = 0; i < distance; ++i) {
+		if (!qdsInlineCanMove(p, rs, 0, -(i + 1))) break;
+	}
+
+	EMIT_CANCELLABLE(p, rs, onDrop, 0, p, type, i);
+	p->y -= i;
+	return i;
+}
+
+QDS_INLINE int qdsInlineInstantDrop(qdsGame *p, const qdsRuleset *rs, int type)
+{
+#ifdef QDS_REFERENCE
+	return qdsInlineDrop(p, rs, type, p->rows);
+#endif
+
+	/*
+	 * The lowest position where every tile of the piece is above the
+	 * top of its column. Only valid if the piece is already above it;
+	 * otherwise the piece is tucked under an overhang, and probing is
+	 * required.
+	 */
+	int rest = p->y - p->rows;
+	const qdsCoords *shape = rs->getShape(p->piece, p->orientation);
+	QDS_SHAPE_FOREACH (b, shape) {
+		int x = p->x + b->x;
+		if (x < 0 || x >= p->width) return qdsInlineDrop(p, rs, type, p->rows);
+		int y = p->columnHeight[x] - b->y;
+		if (y > rest) rest = y;
+	}
+
+	if (rest > p->y) return qdsInlineDrop(p, rs, type, p->rows);
+
+	int distance = p->y - rest;
+	EMIT_CANCELLABLE(p, rs, onDrop, 0, p, type, distance);
+	p->y = rest;
+	return distance;
+}
+
+QDS_INLINE int qdsInlineRotate(qdsGame *p, const qdsRuleset *rs, int rotation)
+{
+	int x, y;
+	int result = rs->canRotate(p, rotation, &x, &y);
+	if (result == QDS_ROTATE_FAILED) return QDS_ROTATE_FAILED;
+
+	EMIT_CANCELLABLE(
+		p, rs, onRotate, QDS_ROTATE_FAILED, p, rotation, result);
+
+	p->x += x;
+	p->y += y;
+	p->orientation = (p->orientation + rotation) % 4;
+	return result;
+}
+
+#endif /* !QDS__ACTIONS_H */
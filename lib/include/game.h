@@ -30,19 +30,27 @@
 #include <quadus/mode.h>
 #include <quadus/ruleset.h>
 #include <stdalign.h>
+#include <stdint.h>
 
 /**
  * Definition of qdsPlayfield.
  */
 struct qdsGame
 {
-	alignas(sizeof(qdsLine)) qdsLine playfield[48];
+	/* rows of the playfield, bottom up; see field */
+	qdsLine *playfield;
+	int width;
+	int rows;
 	int x;
 	int y;
 	int piece;
 	unsigned orientation;
 	int height;
 	int hold;
+	/* height of each column; maintained by actions for fast drops */
+	unsigned char columnHeight[QDS_MAX_WIDTH];
+	/* XOR of the hashes of non-empty rows; maintained by actions */
+	uint64_t fieldHash;
 
 	const qdsRuleset *rs;
 	void *rsData;
@@ -50,6 +58,32 @@ struct qdsGame
 	void *modeData;
 	const qdsUserInterface *ui;
 	void *uiData;
+
+	/* rows of playfields no taller than the default; taller ones are
+	   allocated by qdsSetFieldSize() */
+	alignas(sizeof(qdsLine)) qdsLine field[QDS_DEFAULT_ROWS];
 };
 
+/**
+ * Get a bitmask with the lowest width bits set, that of a full row.
+ */
+static inline uint_fast16_t qdsFullRowMask(int width)
+{
+	return ((uint_fast16_t)1 << width) - 1;
+}
+
+/**
+ * Recalculate the height of each column from the playfield.
+ */
+void qdsUpdateColumnHeights(qdsGame *p);
+
+/**
+ * Hash a row of the playfield at height y. Empty rows hash to 0.
+ */
+uint64_t qdsRowHash(const qdsTile *row, int y);
+/**
+ * Recalculate the playfield hash from the playfield.
+ */
+void qdsUpdateFieldHash(qdsGame *p);
+
 #endif /* !QDS__PLAYFIELD_H */
@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2023 McEndu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef MODES_CUSTOM_H
+#define MODES_CUSTOM_H
+
+#include <quadus.h>
+#include <quadus/mode.h>
+#include <quadus/modedef.h>
+#include <stdbool.h>
+
+#define CURVE_GRAVITY 0
+#define CURVE_DAS 1
+#define CURVE_ARR 2
+#define CURVE_LOCK 3
+#define CURVE_LINEDELAY 4
+#define CURVE_ARE 5
+#define CURVE_LINEARE 6
+#define CURVE_LINES 7
+#define CURVE_COUNT 8
+
+/* a negative value stands for the ruleset default */
+struct customLevel
+{
+	int gravity;
+	unsigned int lineTarget;
+	short das;
+	short arr;
+	short lockTime;
+	short lineDelay;
+	short are;
+	short lineAre;
+};
+
+struct qdsModeDef
+{
+	/* must come first; the mode finds its definition through
+	 * qdsGetMode() */
+	qdsGamemode mode;
+
+	char name[64];
+	int levels;
+	int nextCount;
+	struct customLevel table[];
+};
+
+struct customData
+{
+	int level;
+	unsigned int lines;
+	unsigned int time;
+	bool gameOver : 1;
+	bool lineAre : 1;
+};
+
+extern const qdsGamemode qdsModeCustom__template;
+
+#endif /* !MODES_CUSTOM_H */
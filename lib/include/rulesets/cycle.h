@@ -0,0 +1,244 @@
+/*
+ * Copyright (c) 2023 McEndu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/**
+ * Inline implementations of the ruleset utilities.
+ *
+ * Like the inline actions, these take the ruleset as an explicit
+ * parameter. A built-in ruleset passing itself and its own active cycle
+ * gets a game cycle specialized for it, with no indirect calls left
+ * other than those into the gamemode and user interface.
+ */
+#ifndef QDS__RULESET_CYCLE_H
+#define QDS__RULESET_CYCLE_H
+
+#include "actions.h"
+#include <quadus.h>
+#include <quadus/calls.h>
+#include <quadus/ruleset.h>
+#include <quadus/ruleset/utils.h>
+
+#define QDS_DEFAULT_GRAVITY (65536 / 60)
+
+/* gravity at which pieces reach the bottom of the visible field at once */
+#define QDS_INSTANT_GRAVITY(game) (((game)->rows - QDS_HIDDEN_ROWS) * 65536)
+
+QDS_INLINE void qdsInlineProcessHold(qdsRulesetState *restrict state,
+									 qdsGame *restrict game,
+									 const qdsRuleset *rs,
+									 unsigned int input)
+{
+	if (!(input & QDS_INPUT_HOLD)) return;
+
+	if (state->held && (qdsInlineCall(game, rs, QDS_GETINFINIHOLD, NULL) <= 0))
+		return;
+	qdsHold(game);
+	if (qdsInlineOverlaps(game, rs)) qdsEndGame(game);
+	state->held = true;
+}
+
+QDS_INLINE int qdsInlineProcessMovement(qdsRulesetState *restrict state,
+										qdsGame *restrict game,
+										const qdsRuleset *rs,
+										unsigned int input)
+{
+	int direction;
+
+	if (input & QDS_INPUT_LEFT) {
+		direction = -1;
+	} else if (input & QDS_INPUT_RIGHT) {
+		direction = 1;
+	} else {
+		return 0;
+	}
+
+	int distance = qdsInlineMove(game, rs, direction);
+	if (distance) state->twistCheckResult = 0;
+	return distance;
+}
+
+QDS_INLINE int qdsInlineProcessRotation(qdsRulesetState *restrict state,
+										qdsGame *restrict game,
+										const qdsRuleset *rs,
+										unsigned int input)
+{
+	int rotation;
+	if (input & QDS_INPUT_ROTATE_C) {
+		rotation = QDS_ROTATION_CLOCKWISE;
+	} else if (input & QDS_INPUT_ROTATE_CC) {
+		rotation = QDS_ROTATION_COUNTERCLOCKWISE;
+	} else {
+		return QDS_ROTATE_FAILED;
+	}
+
+	int rotateResult = qdsInlineRotate(game, rs, rotation);
+	if (rotateResult != QDS_ROTATE_FAILED)
+		state->twistCheckResult = rotateResult;
+	return rotateResult;
+}
+
+QDS_INLINE void qdsInlineProcessLineClear(qdsRulesetState *restrict state,
+										  qdsGame *restrict game,
+										  const qdsRuleset *rs,
+										  unsigned int input)
+{
+	qdsClearQueuedLines(game, &state->pendingLines);
+
+	unsigned int are;
+	if (qdsInlineCall(game, rs, QDS_GETARE, &are) < 0 || are == 0) {
+		/* not inlined; spawning leads back to locking */
+		return qdsProcessSpawn(state, game, state->delayInput);
+	} else {
+		state->status = QDS_STATUS_LOCKDELAY;
+		state->statusTime = are;
+	}
+}
+
+QDS_INLINE void qdsInlineProcessLock(qdsRulesetState *restrict state,
+									 qdsGame *restrict game,
+									 const qdsRuleset *rs)
+{
+	/* save active piece data for QDS_GETCLEARTYPE use */
+	state->clearType = qdsGetActivePieceType(game) << 16;
+
+	/* the rest is normal lock course */
+	if (!qdsLock(game)) return;
+
+	int lines = state->pendingLines.lines;
+	unsigned int delay;
+
+	if (lines > 0) {
+		/* go to line delay */
+		if (qdsInlineCall(game, rs, QDS_GETLINEDELAY, &delay) < 0
+			|| delay == 0)
+			return qdsInlineProcessLineClear(state, game, rs, 0);
+		state->status = QDS_STATUS_LINEDELAY;
+		state->statusTime = delay;
+	} else {
+		/* go to lock delay */
+		if (qdsInlineCall(game, rs, QDS_GETARE, &delay) < 0 || delay == 0) {
+			return qdsProcessSpawn(state, game, 0);
+		} else {
+			state->status = QDS_STATUS_LOCKDELAY;
+			state->statusTime = delay;
+		}
+	}
+}
+
+QDS_INLINE void qdsInlineProcessGravity(qdsRulesetState *restrict state,
+										qdsGame *restrict game,
+										const qdsRuleset *rs,
+										unsigned int input)
+{
+	if (qdsInlineGrounded(game, rs)) {
+		state->subY = 0;
+		if (--state->lockTimer == 0)
+			return qdsInlineProcessLock(state, game, rs);
+	} else {
+		int gravity, dropType = QDS_DROP_GRAVITY;
+		if (qdsInlineCall(game, rs, QDS_GETGRAVITY, &gravity) < 0)
+			gravity = QDS_DEFAULT_GRAVITY;
+		if (input & QDS_INPUT_SOFT_DROP) {
+			int softDropGravity;
+			if (qdsInlineCall(game, rs, QDS_GETSDG, &softDropGravity) < 0)
+				softDropGravity = 32768;
+			if (softDropGravity > gravity) {
+				gravity = softDropGravity;
+				dropType = QDS_DROP_SOFT;
+			}
+		} else {
+			dropType = QDS_DROP_GRAVITY;
+		}
+
+		state->subY += gravity;
+		if (state->subY >= QDS_INSTANT_GRAVITY(game)) {
+			/* the piece always ends up grounded */
+			qdsInlineInstantDrop(game, rs, dropType);
+			state->subY = 0;
+			return;
+		}
+
+		qdsInlineDrop(game, rs, dropType, state->subY / 65536);
+		if (qdsInlineGrounded(game, rs))
+			state->subY = 0;
+		else
+			state->subY %= 65536;
+	}
+}
+
+QDS_INLINE void qdsInlineProcessSpawn(qdsRulesetState *restrict state,
+									  qdsGame *restrict game,
+									  const qdsRuleset *rs,
+									  unsigned int input)
+{
+	state->status = QDS_STATUS_ACTIVE;
+	state->delayInput = 0;
+	state->held = false;
+
+	state->spawning = true;
+	qdsSpawn(game, 0);
+
+	qdsInlineProcessHold(state, game, rs, input);
+	qdsInlineProcessRotation(state, game, rs, input);
+	if (qdsInlineOverlaps(game, rs)) qdsEndGame(game);
+
+	state->spawning = false;
+
+	qdsInlineProcessGravity(state, game, rs, input & QDS_INPUT_SOFT_DROP);
+}
+
+QDS_INLINE void qdsInlineRulesetCycle(
+	qdsRulesetState *restrict state,
+	qdsGame *restrict game,
+	const qdsRuleset *rs,
+	void (*activeCycle)(qdsRulesetState *restrict,
+						qdsGame *restrict,
+						unsigned int input),
+	unsigned int input)
+{
+	if (state->pause) {
+		state->pause = false;
+		state->status = QDS_STATUS_PAUSE;
+	}
+
+	switch (state->status) {
+		case QDS_STATUS_ACTIVE:
+			return activeCycle(state, game, input);
+		case QDS_STATUS_INIT:
+		case QDS_STATUS_PREGAME:
+		case QDS_STATUS_PAUSE:
+		case QDS_STATUS_LOCKDELAY:
+			qdsProcessDelay(state, game, input);
+			if (state->statusTime == 0) {
+				qdsInlineProcessSpawn(state, game, rs, state->delayInput);
+			}
+			break;
+		case QDS_STATUS_LINEDELAY:
+			qdsProcessDelay(state, game, input);
+			if (state->statusTime == 0) {
+				qdsInlineProcessLineClear(state, game, rs, input);
+			}
+			break;
+	}
+}
+
+#endif /* !QDS__RULESET_CYCLE_H */
@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2023 McEndu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/**
+ * Collision checks against a window of playfield rows.
+ *
+ * A window holds 16 rows of the playfield as masks, with the walls,
+ * floor and ceiling filled in. Once loaded, any number of candidate
+ * positions near the window's center can be tested with only shifts
+ * and ANDs, which is what rotation systems with many kicks need.
+ */
+#ifndef QDS__RULESET_WINDOW_H
+#define QDS__RULESET_WINDOW_H
+
+#include <quadus.h>
+#include <quadus/ruleset/mask.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* column x of the playfield is at bit x + WINDOW_LEFT */
+#define WINDOW_LEFT 8
+#define WINDOW_ROWS 16
+
+typedef struct qdsMaskWindow
+{
+	int bottom;
+	uint_least32_t rows[WINDOW_ROWS];
+} qdsMaskWindow;
+
+/**
+ * Load the rows y - 8 to y + 7 of a playfield, width tiles wide and
+ * with the given number of rows, into a window.
+ */
+static inline void qdsLoadMaskWindow(qdsMaskWindow *restrict w,
+									 const qdsLine *restrict playfield,
+									 int width,
+									 int rows,
+									 int y)
+{
+	const uint_least32_t inside = ((uint_least32_t)1 << width) - 1;
+	const uint_least32_t walls = ~(inside << WINDOW_LEFT);
+
+	w->bottom = y - WINDOW_ROWS / 2;
+	for (int i = 0; i < WINDOW_ROWS; ++i) {
+		int row = w->bottom + i;
+		if (row < 0 || row >= rows) {
+			w->rows[i] = UINT32_MAX;
+		} else {
+			uint_least32_t line = qdsGetLineMask(playfield[row]);
+			w->rows[i] = walls | line << WINDOW_LEFT;
+		}
+	}
+}
+
+/**
+ * Check if a shape fits at a position in the window. Positions outside
+ * the window never fit.
+ */
+static inline bool qdsWindowFits(const qdsMaskWindow *restrict w,
+								 const qdsShapeMask *restrict mask,
+								 int x,
+								 int y)
+{
+	int shift = x + mask->left + WINDOW_LEFT;
+	int row = y + mask->bottom - w->bottom;
+	if (shift < 0 || shift + mask->width > 32) return false;
+	if (row < 0 || row + mask->height > WINDOW_ROWS) return false;
+
+	for (int i = 0; i < mask->height; ++i) {
+		if ((w->rows[row + i] >> shift) & mask->rows[i]) return false;
+	}
+
+	return true;
+}
+
+/**
+ * Check if a tile in the window is filled. Walls count as filled.
+ */
+static inline bool qdsWindowTile(const qdsMaskWindow *w, int x, int y)
+{
+	int row = y - w->bottom;
+	if (row < 0 || row >= WINDOW_ROWS) return true;
+	if (x + WINDOW_LEFT < 0 || x + WINDOW_LEFT >= 32) return true;
+	return (w->rows[row] >> (x + WINDOW_LEFT)) & 1;
+}
+
+#endif /* !QDS__RULESET_WINDOW_H */
@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) 2023 McEndu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "modes/custom.h"
+#include <config.h>
+#include <quadus.h>
+#include <quadus/calls.h>
+#include <quadus/mode.h>
+#include <quadus/ruleset/save.h>
+
+#include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
+
+static const qdsModeDef *getDef(const qdsGame *game)
+{
+	return (const qdsModeDef *)qdsGetMode(game);
+}
+
+static void *init(void)
+{
+	struct customData *data = malloc(sizeof(struct customData));
+	if (!data) return NULL;
+	data->level = 0;
+	data->lines = 0;
+	data->time = 0;
+	data->gameOver = false;
+	data->lineAre = false;
+	return data;
+}
+
+static void onCycle(qdsGame *game)
+{
+	struct customData *data = qdsGetModeData(game);
+	if (!data->gameOver) data->time += 1;
+}
+
+static bool onSpawn(qdsGame *game, int piece)
+{
+	struct customData *data = qdsGetModeData(game);
+	data->lineAre = false;
+	return true;
+}
+
+static void onLineFilled(qdsGame *game, int y)
+{
+	const qdsModeDef *def = getDef(game);
+	struct customData *data = qdsGetModeData(game);
+	data->lines += 1;
+	data->lineAre = true;
+
+	/* targets are at least a line apart; one step is enough */
+	if (data->level < def->levels - 1
+		&& data->lines >= def->table[data->level].lineTarget)
+		data->level += 1;
+}
+
+static void onTopOut(qdsGame *game)
+{
+	struct customData *data = qdsGetModeData(game);
+	data->gameOver = true;
+}
+
+static int getValue(int value, void *argp)
+{
+	if (value < 0) return -ENOTTY;
+	*(int *)argp = value;
+	return 0;
+}
+
+static int modeCall(qdsGame *game, unsigned long call, void *argp)
+{
+	const qdsModeDef *def = getDef(game);
+	struct customData *data = qdsGetModeData(game);
+	const struct customLevel *lvl = &def->table[data->level];
+	switch (call) {
+		case QDS_GETMODENAME:
+			*(const char **)argp = def->name;
+			return 0;
+		case QDS_GETTIME:
+			*(unsigned int *)argp = data->time;
+			return 0;
+		case QDS_GETLEVEL:
+			*(int *)argp = data->level + 1;
+			return 0;
+		case QDS_GETSUBLEVEL:
+			*(int *)argp = data->lines;
+			return 0;
+		case QDS_GETLEVELTARGET:
+			*(int *)argp = lvl->lineTarget;
+			return 0;
+		case QDS_GETGRAVITY:
+			return getValue(lvl->gravity, argp);
+		case QDS_GETSDG:
+			return getValue(lvl->gravity < 0 ? -1 : lvl->gravity * 20, argp);
+		case QDS_GETDAS:
+		case QDS_GETDCD:
+			return getValue(lvl->das, argp);
+		case QDS_GETARR:
+			return getValue(lvl->arr, argp);
+		case QDS_GETLOCKTIME:
+			return getValue(lvl->lockTime, argp);
+		case QDS_GETLINEDELAY:
+			return getValue(lvl->lineDelay, argp);
+		case QDS_GETARE:
+			if (data->lineAre && lvl->lineAre >= 0)
+				return getValue(lvl->lineAre, argp);
+			return getValue(lvl->are, argp);
+		case QDS_GETNEXTCOUNT:
+			return getValue(def->nextCount, argp);
+		case QDS_SAVESTATE: {
+			qdsSaveWriter *w = argp;
+			qdsSaveUint(w, data->level);
+			qdsSaveUint(w, data->lines);
+			qdsSaveUint(w, data->time);
+			qdsSaveByte(w, data->gameOver | data->lineAre << 1);
+			return 0;
+		}
+		case QDS_LOADSTATE: {
+			qdsSaveReader *r = argp;
+			int level = qdsLoadRange(r, def->levels - 1);
+			unsigned int lines = qdsLoadRange(r, UINT_MAX);
+			unsigned int time = qdsLoadRange(r, UINT_MAX);
+			unsigned int flags = qdsLoadRange(r, 3);
+			if (r->error) return -EINVAL;
+			data->level = level;
+			data->lines = lines;
+			data->time = time;
+			data->gameOver = flags & 1;
+			data->lineAre = flags >> 1 & 1;
+			return 0;
+		}
+	}
+	return -ENOTTY;
+}
+
+const qdsGamemode qdsModeCustom__template = {
+	.init = init,
+	.destroy = free,
+	.events = {
+		.onCycle = onCycle,
+		.onSpawn = onSpawn,
+		.onLineFilled = onLineFilled,
+		.onTopOut = onTopOut,
+	},
+	.call = modeCall,
+};
@@ -26,9 +26,12 @@
 #include <quadus/calls.h>
 #include <quadus/mode.h>
 #include <quadus/piecegen/quadus.h>
+#include <quadus/ruleset/save.h>
 
 #include <errno.h>
+#include <limits.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
 struct levelData
@@ -159,6 +162,27 @@ static int modeCall(qdsGame *game, unsigned long call, void *argp)
 		case QDS_GETNEXTCOUNT:
 			*(int *)argp = 8;
 			return 0;
+		case QDS_SAVESTATE: {
+			qdsSaveWriter *w = argp;
+			qdsSaveUint(w, data->level);
+			qdsSaveInt(w, data->lines);
+			qdsSaveUint(w, data->time);
+			qdsSaveByte(w, data->gameOver);
+			return 0;
+		}
+		case QDS_LOADSTATE: {
+			qdsSaveReader *r = argp;
+			int level = qdsLoadRange(r, 39);
+			int lines = qdsLoadIntRange(r, 0, INT_MAX);
+			unsigned int time = qdsLoadRange(r, UINT_MAX);
+			bool gameOver = qdsLoadRange(r, 1);
+			if (r->error) return -EINVAL;
+			data->level = level;
+			data->lines = lines;
+			data->time = time;
+			data->gameOver = gameOver;
+			return 0;
+		}
 	}
 	return -ENOTTY;
 }
@@ -171,6 +195,9 @@ static int modeInvisibleCall(qdsGame *game, unsigned long call, void *argp)
 	} else if (call == QDS_GETVISIBILITY) {
 		*(uint_fast16_t *)argp = 0;
 		return 0;
+	} else if (call == QDS_GETFIELDVISIBILITY) {
+		memset(argp, 0, qdsGetFieldRows(game) * sizeof(uint_fast16_t));
+		return 0;
 	}
 
 	return modeCall(game, call, argp);
@@ -24,6 +24,7 @@
 #include <quadus.h>
 #include <quadus/piece.h>
 
+#include <limits.h>
 #include <stdint.h>
 #include <string.h>
 
@@ -75,45 +76,99 @@ static const struct timingData *getTimings(struct modeData *data)
 	return &creditsTimings;
 }
 
-static void setTileTime(qdsGame *game, struct modeData *data)
+/*
+ * Fading credits keep a visibility mask per row instead of a lock time
+ * per tile. Each lock pushes a record of the rows it filled onto a FIFO;
+ * since every record lives for the same amount of time, expiring tiles
+ * is a matter of popping records off the front and clearing their bits.
+ */
+#define FADE_TIME TIME(0, 5)
+
+static struct fadeLock *fadeRecord(struct modeData *data, int i)
+{
+	return &data->fadeQueue[(data->fadeHead + i) % FADE_QUEUE_SIZE];
+}
+
+static void expireLock(struct modeData *data)
+{
+	struct fadeLock *lock = fadeRecord(data, 0);
+	for (int i = 0; i < 4; ++i) {
+		int y = lock->y + i;
+		if (y >= 0 && y < QDS_MAX_ROWS) data->fadeVisible[y] &= ~lock->rows[i];
+	}
+
+	data->fadeHead = (data->fadeHead + 1) % FADE_QUEUE_SIZE;
+	data->fadeCount -= 1;
+}
+
+static void fadeCycle(qdsGame *game, struct modeData *data)
+{
+	cycle(game, data);
+	while (data->fadeCount > 0
+		   && fadeRecord(data, 0)->expiry <= data->sectionTime)
+		expireLock(data);
+}
+
+static void addFadeLock(qdsGame *game, struct modeData *data)
 {
 	int cx, cy;
 	const qdsCoords *shape = qdsGetActiveShape(game);
 	qdsGetActivePosition(game, &cx, &cy);
 
+	/* a full queue cannot happen at credits timings; fade early if it does */
+	if (data->fadeCount == FADE_QUEUE_SIZE) expireLock(data);
+
+	int base = INT_MAX;
+	QDS_SHAPE_FOREACH (i, shape) {
+		if (cy + i->y < base) base = cy + i->y;
+	}
+
+	struct fadeLock *lock = fadeRecord(data, data->fadeCount++);
+	lock->expiry = data->sectionTime + FADE_TIME;
+	lock->y = base;
+	memset(lock->rows, 0, sizeof(lock->rows));
+
 	QDS_SHAPE_FOREACH (i, shape) {
 		int x = cx + i->x, y = cy + i->y;
-		data->tileTime[y][x] = data->sectionTime;
+		lock->rows[y - base] |= 1 << x;
+		data->fadeVisible[y] |= 1 << x;
 	}
 }
 
-static void clearTileTimeLine(qdsGame *game, struct modeData *data, int y)
+static void clearFadeLine(qdsGame *game, struct modeData *data, int y)
 {
-	int height = qdsGetFieldHeight(game);
-	if (y > height) return;
-	int lineNum = height-- - y - 1;
-	memmove(
-		data->tileTime[y], data->tileTime[y + 1], lineNum * sizeof(int[10]));
-	memset(data->tileTime[height], 0, sizeof(int[10]));
+	if (y < 0 || y >= QDS_MAX_ROWS) return;
+	memmove(&data->fadeVisible[y],
+			&data->fadeVisible[y + 1],
+			(QDS_MAX_ROWS - 1 - y) * sizeof(uint16_t));
+	data->fadeVisible[QDS_MAX_ROWS - 1] = 0;
+
+	for (int i = 0; i < data->fadeCount; ++i) {
+		struct fadeLock *lock = fadeRecord(data, i);
+		int row = y - lock->y;
+		if (row < 0) {
+			lock->y -= 1;
+		} else if (row < 4) {
+			memmove(&lock->rows[row],
+					&lock->rows[row + 1],
+					(3 - row) * sizeof(uint16_t));
+			lock->rows[3] = 0;
+		}
+	}
 }
 
 static uint_fast16_t fadeVisibility(struct modeData *data, int line)
 {
-	uint_fast16_t visibility = 0;
-	for (int i = 0; i < 10; ++i) {
-		if (data->sectionTime < data->tileTime[line][i] + TIME(0, 5))
-			visibility |= 1 << i;
-	}
-	return visibility;
+	return data->fadeVisible[line];
 }
 
 const struct phase SHARED(phaseCreditsFading) = {
 	.getSpeed = getSpeed,
 	.getTimings = getTimings,
 	.getVisibility = fadeVisibility,
-	.onCycle = cycle,
-	.onLock = setTileTime,
-	.onLineClear = clearTileTimeLine,
+	.onCycle = fadeCycle,
+	.onLock = addFadeLock,
+	.onLineClear = clearFadeLine,
 
 	.onLineFilled = onLineFilled,
 	.postLock = postLock,
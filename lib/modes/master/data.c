@@ -41,6 +41,11 @@ const struct timingData SHARED(timingData)[] = {
 	{ 1200, 8, 15, 6, 6, 6 },	 { SHRT_MAX, 1, 1, 1, 1, 1 },
 };
 
+const int SHARED(speedCount)
+	= sizeof(SHARED(speedData)) / sizeof(*SHARED(speedData));
+const int SHARED(timingCount)
+	= sizeof(SHARED(timingData)) / sizeof(*SHARED(timingData));
+
 const short SHARED(sectionThresholds)[]
 	= { 100, 200, 300, 400, 500, 600, 700, 800, 900, 999, SHRT_MAX };
 const short SHARED(sectionCoolThresholds)[]
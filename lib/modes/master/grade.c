@@ -57,6 +57,8 @@ static const struct subgrade
 	{ 16, 10, 28, 0, { 2, 12, 13, 30 } }, { 17, 10, 30, 0, { 0, 0, 0, 0 } },
 };
 
+const int SHARED(subgradeCount) = sizeof(gradeData) / sizeof(*gradeData);
+
 static const unsigned char comboMultiplier[][4] = {
 	{ 10, 10, 10, 10 }, { 10, 12, 14, 15 }, { 10, 12, 15, 18 },
 	{ 10, 14, 16, 20 }, { 10, 14, 17, 22 }, { 10, 14, 18, 23 },
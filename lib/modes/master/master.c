@@ -26,10 +26,12 @@
 #include <quadus/calls.h>
 #include <quadus/mode.h>
 #include <quadus/ruleset/linequeue.h>
+#include <quadus/ruleset/save.h>
 
 #include <errno.h>
 #include <limits.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
 const struct phase *SHARED(phases)[] = {
@@ -72,6 +74,10 @@ static void *init(void)
 	data->message = "";
 	data->messageTime = 0;
 
+	memset(data->fadeVisible, 0, sizeof(data->fadeVisible));
+	data->fadeHead = 0;
+	data->fadeCount = 0;
+
 	qdsTgmGenInit(&data->gen, time(NULL));
 
 	return data;
@@ -144,7 +150,7 @@ static void onTopOut(qdsGame *game)
 
 uint_fast16_t SHARED(visible)(struct modeData *data, int y)
 {
-	return 0x03ff;
+	return 0xffff;
 }
 
 uint_fast16_t SHARED(invisible)(struct modeData *data, int y)
@@ -162,6 +168,101 @@ static int draw(void *data)
 	return qdsTgmGenDraw(&((struct modeData *)data)->gen);
 }
 
+static const char *const messages[] = { "", "Cool!", "Too bad!" };
+#define MESSAGE_COUNT (sizeof(messages) / sizeof(*messages))
+
+static void saveState(struct modeData *data,
+					  qdsGame *game,
+					  qdsSaveWriter *w)
+{
+	unsigned int message = 0;
+	for (unsigned int i = 0; i < MESSAGE_COUNT; ++i) {
+		if (!strcmp(data->message, messages[i])) message = i;
+	}
+
+	qdsSaveUint(w, data->time);
+	qdsSaveUint(w, data->sectionTime);
+	qdsSaveUint(w, data->lastCoolTime);
+	qdsSaveByte(w, data->phase);
+	qdsSaveUint(w, data->level);
+	qdsSaveByte(w, data->section);
+	qdsSaveUint(w, data->cools);
+	qdsSaveUint(w, data->grade);
+	qdsSaveInt(w, data->gradePoints);
+	qdsSaveUint(w, data->decayTimer);
+	qdsSaveUint(w, data->combo);
+	qdsSaveUint(w, data->speedIndex);
+	qdsSaveUint(w, data->timingIndex);
+	qdsSaveUint(w, data->creditsPoints);
+	qdsSaveByte(w, data->lines);
+	qdsSaveByte(w, data->areType | data->held << 1 | data->cool << 2);
+	qdsSaveByte(w, message);
+	qdsSaveUint(w, data->messageTime);
+
+	for (int y = 0; y < qdsGetFieldRows(game); ++y)
+		qdsSaveUint(w, data->fadeVisible[y]);
+	qdsSaveByte(w, data->fadeCount);
+	for (int i = 0; i < data->fadeCount; ++i) {
+		const struct fadeLock *lock
+			= &data->fadeQueue[(data->fadeHead + i) % FADE_QUEUE_SIZE];
+		qdsSaveUint(w, lock->expiry);
+		qdsSaveInt(w, lock->y);
+		for (int j = 0; j < 4; ++j)
+			qdsSaveUint(w, lock->rows[j]);
+	}
+
+	qdsTgmGenSave(&data->gen, w);
+}
+
+static int loadState(struct modeData *data,
+					 qdsGame *game,
+					 qdsSaveReader *r)
+{
+	struct modeData loaded = *data;
+	loaded.time = qdsLoadRange(r, INT_MAX);
+	loaded.sectionTime = qdsLoadRange(r, INT_MAX);
+	loaded.lastCoolTime = qdsLoadRange(r, INT_MAX);
+	loaded.phase = qdsLoadRange(r, PHASE_GAME_OVER);
+	loaded.level = qdsLoadRange(r, 999);
+	loaded.section = qdsLoadRange(r, 10);
+	loaded.cools = qdsLoadRange(r, SHRT_MAX);
+	loaded.grade = qdsLoadRange(r, SHARED(subgradeCount) - 1);
+	loaded.gradePoints = qdsLoadIntRange(r, SHRT_MIN, SHRT_MAX);
+	loaded.decayTimer = qdsLoadRange(r, SHRT_MAX);
+	loaded.combo = qdsLoadRange(r, SHRT_MAX);
+	loaded.speedIndex = qdsLoadRange(r, SHARED(speedCount) - 2);
+	loaded.timingIndex = qdsLoadRange(r, SHARED(timingCount) - 2);
+	loaded.creditsPoints = qdsLoadRange(r, INT_MAX);
+	loaded.lines = qdsLoadRange(r, 4);
+
+	unsigned int flags = qdsLoadRange(r, 7);
+	loaded.areType = flags & 1;
+	loaded.held = flags & 2;
+	loaded.cool = flags & 4;
+	loaded.message = messages[qdsLoadRange(r, MESSAGE_COUNT - 1)];
+	loaded.messageTime = qdsLoadRange(r, INT_MAX);
+
+	int rows = qdsGetFieldRows(game);
+	memset(loaded.fadeVisible, 0, sizeof(loaded.fadeVisible));
+	for (int y = 0; y < rows; ++y)
+		loaded.fadeVisible[y] = qdsLoadRange(r, UINT16_MAX);
+	loaded.fadeHead = 0;
+	loaded.fadeCount = qdsLoadRange(r, FADE_QUEUE_SIZE);
+	for (int i = 0; i < loaded.fadeCount; ++i) {
+		struct fadeLock *lock = &loaded.fadeQueue[i];
+		lock->expiry = qdsLoadRange(r, USHRT_MAX);
+		lock->y = qdsLoadIntRange(r, -4, rows - 1);
+		for (int j = 0; j < 4; ++j)
+			lock->rows[j] = qdsLoadRange(r, UINT16_MAX);
+	}
+
+	qdsTgmGenLoad(&loaded.gen, r);
+
+	if (r->error) return -EINVAL;
+	*data = loaded;
+	return 0;
+}
+
 static int call(qdsGame *game, unsigned long req, void *argp)
 {
 	struct modeData *data = qdsGetModeData(game);
@@ -234,9 +335,24 @@ static int call(qdsGame *game, unsigned long req, void *argp)
 			*(uint_fast16_t *)argp = SHARED(phases)[data->phase]->getVisibility(
 				data, *(uint_fast16_t *)argp);
 			return 0;
+		case QDS_GETFIELDVISIBILITY: {
+			const struct phase *phase = SHARED(phases)[data->phase];
+			uint_fast16_t *visibility = argp;
+			for (int y = 0; y < qdsGetFieldRows(game); ++y)
+				visibility[y] = phase->getVisibility(data, y);
+			return 0;
+		}
 		case QDS_SHOWGHOST:
 			*(bool *)argp = data->level < 100;
 			return 0;
+		case QDS_SAVESTATE:
+			saveState(data, game, argp);
+			return 0;
+		case QDS_LOADSTATE:
+			return loadState(data, game, argp);
+		case QDS_SETSEED:
+			qdsTgmGenInit(&data->gen, *(unsigned int *)argp);
+			return 0;
 	}
 	return -ENOTTY;
 }
@@ -28,6 +28,8 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+#define FADE_QUEUE_SIZE 64
+
 struct modeData
 {
 	int time;
@@ -57,7 +59,16 @@ struct modeData
 	const char *message;
 	int messageTime;
 
-	int tileTime[48][10];
+	/* credits fading; see credits.c */
+	uint16_t fadeVisible[QDS_MAX_ROWS];
+	struct fadeLock
+	{
+		unsigned short expiry;
+		signed char y;
+		uint16_t rows[4];
+	} fadeQueue[FADE_QUEUE_SIZE];
+	unsigned char fadeHead;
+	unsigned char fadeCount;
 
 	struct qdsTgmGen gen;
 };
@@ -93,6 +104,12 @@ extern const struct timingData
 	short lineAre;
 } SHARED(timingData)[];
 
+/* sizes of the speed, timing and grade tables, for checking saved
+   indices into them */
+extern const int SHARED(speedCount);
+extern const int SHARED(timingCount);
+extern const int SHARED(subgradeCount);
+
 extern const char *SHARED(gradeNames)[];
 
 extern const short SHARED(sectionThresholds)[];
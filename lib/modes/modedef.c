@@ -0,0 +1,276 @@
+/*
+ * Copyright (c) 2023 McEndu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "modes/custom.h"
+#include <config.h>
+#include <quadus.h>
+#include <quadus/modedef.h>
+
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_LINE 256
+
+static const struct curveInfo
+{
+	const char *name;
+	int min;
+	int max;
+} curves[CURVE_COUNT] = {
+	[CURVE_GRAVITY] = { "gravity", 0, INT_MAX / 20 },
+	[CURVE_DAS] = { "das", 0, SHRT_MAX },
+	[CURVE_ARR] = { "arr", 0, SHRT_MAX },
+	[CURVE_LOCK] = { "lock", 0, SHRT_MAX },
+	[CURVE_LINEDELAY] = { "linedelay", 0, SHRT_MAX },
+	[CURVE_ARE] = { "are", 0, SHRT_MAX },
+	[CURVE_LINEARE] = { "lineare", 0, SHRT_MAX },
+	[CURVE_LINES] = { "lines", 1, SHRT_MAX },
+};
+
+/* points on every curve, indexed by level; negative if absent */
+typedef int curveTable[CURVE_COUNT][QDS_MODEDEF_MAX_LEVELS];
+
+struct parser
+{
+	char name[64];
+	int levels;
+	int nextCount;
+	int lastPoint;
+	int lastPointLine;
+	curveTable *points;
+};
+
+static char *nextToken(char **s)
+{
+	char *p = *s;
+	while (isspace((unsigned char)*p)) ++p;
+	if (!*p) return NULL;
+
+	char *token = p;
+	while (*p && !isspace((unsigned char)*p)) ++p;
+	if (*p) *p++ = '\0';
+	*s = p;
+	return token;
+}
+
+static bool parseInt(const char *s, int min, int max, int *value)
+{
+	if (!s) return false;
+
+	char *end;
+	errno = 0;
+	long l = strtol(s, &end, 10);
+	if (errno || *end || end == s || l < min || l > max) return false;
+
+	*value = l;
+	return true;
+}
+
+static bool parseName(struct parser *p, char *rest)
+{
+	while (isspace((unsigned char)*rest)) ++rest;
+	size_t len = strlen(rest);
+	while (len > 0 && isspace((unsigned char)rest[len - 1])) --len;
+	if (len == 0 || len >= sizeof(p->name)) return false;
+
+	memcpy(p->name, rest, len);
+	p->name[len] = '\0';
+	return true;
+}
+
+static bool parseDirective(struct parser *p, char *line, int lineNum)
+{
+	char *hash = strchr(line, '#');
+	if (hash) *hash = '\0';
+
+	char *rest = line;
+	char *key = nextToken(&rest);
+	if (!key) return true;
+
+	if (!strcmp(key, "name")) return parseName(p, rest);
+
+	int value;
+	if (!strcmp(key, "levels")) {
+		if (!parseInt(nextToken(&rest), 1, QDS_MODEDEF_MAX_LEVELS, &value))
+			return false;
+		p->levels = value;
+		return !nextToken(&rest);
+	} else if (!strcmp(key, "next")) {
+		if (!parseInt(nextToken(&rest), 0, SHRT_MAX, &value)) return false;
+		p->nextCount = value;
+		return !nextToken(&rest);
+	}
+
+	for (int c = 0; c < CURVE_COUNT; ++c) {
+		if (strcmp(key, curves[c].name)) continue;
+
+		int level;
+		if (!parseInt(nextToken(&rest), 1, QDS_MODEDEF_MAX_LEVELS, &level))
+			return false;
+		if (!parseInt(nextToken(&rest), curves[c].min, curves[c].max, &value))
+			return false;
+		if (nextToken(&rest)) return false;
+
+		(*p->points)[c][level - 1] = value;
+		if (level > p->lastPoint) {
+			p->lastPoint = level;
+			p->lastPointLine = lineNum;
+		}
+		return true;
+	}
+
+	return false;
+}
+
+/*
+ * Expand the points of each curve into a value for every level.
+ */
+static qdsModeDef *expand(const struct parser *p)
+{
+	qdsModeDef *def = malloc(sizeof(qdsModeDef)
+							 + p->levels * sizeof(struct customLevel));
+	if (!def) return NULL;
+
+	def->mode = qdsModeCustom__template;
+	strcpy(def->name, p->name);
+	def->levels = p->levels;
+	def->nextCount = p->nextCount;
+
+	int value[CURVE_COUNT];
+	for (int c = 0; c < CURVE_COUNT; ++c) value[c] = -1;
+	value[CURVE_LINES] = 10;
+
+	unsigned int target = 0;
+	for (int l = 0; l < p->levels; ++l) {
+		for (int c = 0; c < CURVE_COUNT; ++c) {
+			if ((*p->points)[c][l] >= 0) value[c] = (*p->points)[c][l];
+		}
+
+		struct customLevel *lvl = &def->table[l];
+		target += value[CURVE_LINES];
+		lvl->gravity = value[CURVE_GRAVITY];
+		lvl->lineTarget = target;
+		lvl->das = value[CURVE_DAS];
+		lvl->arr = value[CURVE_ARR];
+		lvl->lockTime = value[CURVE_LOCK];
+		lvl->lineDelay = value[CURVE_LINEDELAY];
+		lvl->are = value[CURVE_ARE];
+		lvl->lineAre = value[CURVE_LINEARE];
+	}
+
+	return def;
+}
+
+QDS_API qdsModeDef *qdsParseModeDef(const char *src, size_t len, int *line)
+{
+	struct parser p = {
+		.name = "Custom",
+		.levels = 0,
+		.nextCount = -1,
+		.lastPoint = 0,
+		.lastPointLine = 0,
+		.points = malloc(sizeof(curveTable)),
+	};
+	if (!p.points) return NULL;
+	memset(p.points, 0xff, sizeof(curveTable));
+
+	int lineNum = 0;
+	const char *end = src + len;
+	while (src < end) {
+		const char *eol = memchr(src, '\n', end - src);
+		if (!eol) eol = end;
+		++lineNum;
+
+		char buf[MAX_LINE];
+		size_t n = eol - src;
+		if (n >= sizeof(buf)) goto invalid;
+		memcpy(buf, src, n);
+		buf[n] = '\0';
+		if (!parseDirective(&p, buf, lineNum)) goto invalid;
+
+		src = eol + 1;
+	}
+
+	/* without a level count, the last point decides */
+	if (p.levels == 0) p.levels = p.lastPoint ? p.lastPoint : 1;
+	if (p.lastPoint > p.levels) {
+		lineNum = p.lastPointLine;
+		goto invalid;
+	}
+
+	qdsModeDef *def = expand(&p);
+	free(p.points);
+	return def;
+
+invalid:
+	free(p.points);
+	if (line) *line = lineNum;
+	errno = EINVAL;
+	return NULL;
+}
+
+QDS_API qdsModeDef *qdsLoadModeDef(const char *path, int *line)
+{
+	FILE *f = fopen(path, "r");
+	if (!f) return NULL;
+
+	size_t size = 0, capacity = 4096;
+	char *src = malloc(capacity);
+	while (src) {
+		size += fread(src + size, 1, capacity - size, f);
+		if (size < capacity) break;
+
+		capacity *= 2;
+		char *larger = realloc(src, capacity);
+		if (!larger) free(src);
+		src = larger;
+	}
+
+	qdsModeDef *def = NULL;
+	if (src && !ferror(f)) def = qdsParseModeDef(src, size, line);
+	else if (src) errno = EIO;
+
+	int e = errno;
+	free(src);
+	fclose(f);
+	errno = e;
+	return def;
+}
+
+QDS_API void qdsFreeModeDef(qdsModeDef *def)
+{
+	free(def);
+}
+
+QDS_API const char *qdsGetModeDefName(const qdsModeDef *def)
+{
+	return def->name;
+}
+
+QDS_API const qdsGamemode *qdsGetModeDefMode(const qdsModeDef *def)
+{
+	return &def->mode;
+}
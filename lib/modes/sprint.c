@@ -24,8 +24,10 @@
 #include <quadus.h>
 #include <quadus/calls.h>
 #include <quadus/mode.h>
+#include <quadus/ruleset/save.h>
 
 #include <errno.h>
+#include <limits.h>
 #include <stdlib.h>
 
 #define LINE_TARGET 40
@@ -105,6 +107,24 @@ static int call(qdsGame *game, unsigned long req, void *argp)
 		case QDS_GETLINEDELAY:
 			*(int *)argp = 0;
 			return 0;
+		case QDS_SAVESTATE: {
+			qdsSaveWriter *w = argp;
+			qdsSaveUint(w, data->time);
+			qdsSaveInt(w, data->lines);
+			qdsSaveByte(w, data->gameOver);
+			return 0;
+		}
+		case QDS_LOADSTATE: {
+			qdsSaveReader *r = argp;
+			unsigned int time = qdsLoadRange(r, UINT_MAX);
+			int lines = qdsLoadIntRange(r, 0, INT_MAX);
+			bool gameOver = qdsLoadRange(r, 1);
+			if (r->error) return -EINVAL;
+			data->time = time;
+			data->lines = lines;
+			data->gameOver = gameOver;
+			return 0;
+		}
 	}
 
 	return -ENOTTY;
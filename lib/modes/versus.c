@@ -0,0 +1,369 @@
+/*
+ * Copyright (c) 2023 McEndu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <config.h>
+#include <quadus.h>
+#include <quadus/calls.h>
+#include <quadus/mode.h>
+#include <quadus/piece.h>
+#include <quadus/piecegen/bag.h>
+#include <quadus/ruleset.h>
+#include <quadus/ruleset/hash.h>
+#include <quadus/ruleset/rand.h>
+#include <quadus/ruleset/save.h>
+#include <quadus/versus.h>
+
+#include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define GARBAGE_QUEUE 16
+
+struct garbage
+{
+	unsigned char lines;
+	signed char hole;
+};
+
+struct modeData
+{
+	qdsGame *opponent;
+	struct qdsBag gen;
+	qdsRandState rand;
+
+	unsigned int time;
+	unsigned int attack;
+	int combo;
+
+	/* garbage waiting to rise, oldest first */
+	unsigned char incomingHead;
+	unsigned char incomingCount;
+	int incomingLines;
+	struct garbage incoming[GARBAGE_QUEUE];
+
+	bool gameOver : 1;
+};
+
+static const unsigned char lineAttack[] = { 0, 0, 1, 2, 4 };
+static const unsigned char miniAttack[] = { 0, 0, 1, 2, 4 };
+static const unsigned char twistAttack[] = { 0, 2, 4, 6, 6 };
+static const unsigned char comboAttack[]
+	= { 0, 0, 1, 1, 1, 2, 2, 3, 3, 4, 4, 4, 5 };
+
+QDS_API int qdsVersusAttack(unsigned int clearType, int combo)
+{
+	int lines = clearType & QDS_LINECLEAR_MAX;
+	if (lines == 0) return 0;
+	if (lines > 4) lines = 4;
+
+	/* minis carry both flags, as they are QDS_ROTATE_TWIST_MINI << 8 */
+	const unsigned char *table = lineAttack;
+	if (clearType & QDS_LINECLEAR_MINI)
+		table = miniAttack;
+	else if (clearType & QDS_LINECLEAR_TWIST)
+		table = twistAttack;
+
+	int attack = table[lines];
+	if (clearType & QDS_LINECLEAR_B2B) attack += 1;
+	if (clearType & QDS_LINECLEAR_ALLCLEAR) attack += 10;
+
+	int comboCount = sizeof(comboAttack) / sizeof(*comboAttack);
+	if (combo > comboCount) combo = comboCount;
+	if (combo > 0) attack += comboAttack[combo - 1];
+
+	return attack;
+}
+
+static struct garbage *incoming(struct modeData *data, int i)
+{
+	return &data->incoming[(data->incomingHead + i) % GARBAGE_QUEUE];
+}
+
+static void queueGarbage(struct modeData *data, int lines)
+{
+	data->incomingLines += lines;
+
+	while (lines > 0) {
+		/* a full queue piles onto its newest entry */
+		if (data->incomingCount == GARBAGE_QUEUE) {
+			struct garbage *g = incoming(data, GARBAGE_QUEUE - 1);
+			int total = g->lines + lines;
+			g->lines = total > UCHAR_MAX ? UCHAR_MAX : total;
+			data->incomingLines -= total - g->lines;
+			return;
+		}
+
+		struct garbage *g = incoming(data, data->incomingCount++);
+		g->lines = lines > UCHAR_MAX ? UCHAR_MAX : lines;
+		g->hole = -1;
+		lines -= g->lines;
+	}
+}
+
+/*
+ * Offset an attack against incoming garbage. Returns what is left of
+ * the attack.
+ */
+static int cancelGarbage(struct modeData *data, int attack)
+{
+	while (attack > 0 && data->incomingCount > 0) {
+		struct garbage *g = incoming(data, 0);
+		int cancelled = attack < g->lines ? attack : g->lines;
+		g->lines -= cancelled;
+		attack -= cancelled;
+		data->incomingLines -= cancelled;
+
+		if (g->lines == 0) {
+			data->incomingHead = (data->incomingHead + 1) % GARBAGE_QUEUE;
+			data->incomingCount -= 1;
+		}
+	}
+	return attack;
+}
+
+static void riseGarbage(qdsGame *game, struct modeData *data)
+{
+	qdsLine rows[QDS_VERSUS_GARBAGE_CAP];
+	int width = qdsGetFieldWidth(game);
+	int count = 0;
+
+	while (count < QDS_VERSUS_GARBAGE_CAP && data->incomingCount > 0) {
+		struct garbage *g = incoming(data, 0);
+		if (g->hole < 0) g->hole = qdsRand(&data->rand) % width;
+
+		for (; g->lines > 0 && count < QDS_VERSUS_GARBAGE_CAP; --g->lines) {
+			memset(rows[count], 0, sizeof(qdsLine));
+			memset(rows[count], QDS_PIECE_GARBAGE, width);
+			rows[count][g->hole] = 0;
+			++count;
+		}
+
+		if (g->lines == 0) {
+			data->incomingHead = (data->incomingHead + 1) % GARBAGE_QUEUE;
+			data->incomingCount -= 1;
+		}
+	}
+
+	if (count == 0) return;
+	data->incomingLines -= count;
+	qdsAddLines(game, rows, count);
+}
+
+static void *init(void)
+{
+	struct modeData *data = malloc(sizeof(struct modeData));
+	if (!data) return NULL;
+
+	unsigned int seed = time(NULL);
+	data->opponent = NULL;
+	qdsBagInit(&data->gen, seed);
+	qdsSrand(seed, &data->rand);
+
+	data->time = 0;
+	data->attack = 0;
+	data->combo = 0;
+
+	data->incomingHead = 0;
+	data->incomingCount = 0;
+	data->incomingLines = 0;
+
+	data->gameOver = false;
+	return data;
+}
+
+static void onCycle(qdsGame *game)
+{
+	struct modeData *data = qdsGetModeData(game);
+	if (!data->gameOver) data->time += 1;
+}
+
+static void postLock(qdsGame *game)
+{
+	struct modeData *data = qdsGetModeData(game);
+	if (data->gameOver) return;
+
+	unsigned int clearType;
+	if (qdsCall(game, QDS_GETCLEARTYPE, &clearType) < 0) clearType = 0;
+
+	if ((clearType & QDS_LINECLEAR_MAX) == 0) {
+		data->combo = 0;
+		riseGarbage(game, data);
+		return;
+	}
+
+	data->combo += 1;
+	int attack = qdsVersusAttack(clearType, data->combo);
+	attack = cancelGarbage(data, attack);
+	if (attack > 0 && data->opponent) {
+		struct modeData *opponent = qdsGetModeData(data->opponent);
+		if (!opponent->gameOver) queueGarbage(opponent, attack);
+		data->attack += attack;
+	}
+}
+
+static void onTopOut(qdsGame *game)
+{
+	struct modeData *data = qdsGetModeData(game);
+	data->gameOver = true;
+}
+
+static int peek(const void *data, int pos)
+{
+	return qdsBagPeek(&((const struct modeData *)data)->gen, pos);
+}
+
+static int draw(void *data)
+{
+	return qdsBagDraw(&((struct modeData *)data)->gen);
+}
+
+static uint64_t hashState(struct modeData *data)
+{
+	uint64_t h = qdsHashAdd(data->gen.rng, data->rand);
+	h = qdsHashAdd(h, data->time | (uint64_t)data->attack << 32);
+	h = qdsHashAdd(h, (uint32_t)data->combo | (uint64_t)data->gameOver << 32);
+	for (int i = 0; i < data->incomingCount; ++i) {
+		const struct garbage *g = incoming(data, i);
+		h = qdsHashAdd(h, g->lines | (unsigned char)g->hole << 8);
+	}
+	return h;
+}
+
+static void saveState(struct modeData *data, qdsSaveWriter *w)
+{
+	qdsBagSave(&data->gen, w);
+	qdsSaveU64(w, data->rand);
+	qdsSaveUint(w, data->time);
+	qdsSaveUint(w, data->attack);
+	qdsSaveInt(w, data->combo);
+	qdsSaveByte(w, data->gameOver);
+	qdsSaveByte(w, data->incomingCount);
+	for (int i = 0; i < data->incomingCount; ++i) {
+		const struct garbage *g = incoming(data, i);
+		qdsSaveByte(w, g->lines);
+		qdsSaveInt(w, g->hole);
+	}
+}
+
+/* the opponent is left as it is; pair games again if needed */
+static int loadState(struct modeData *data,
+					 qdsGame *game,
+					 qdsSaveReader *r)
+{
+	int width = qdsGetFieldWidth(game);
+	struct modeData loaded = *data;
+	qdsBagLoad(&loaded.gen, r);
+	loaded.rand = qdsLoadU64(r);
+	loaded.time = qdsLoadRange(r, UINT_MAX);
+	loaded.attack = qdsLoadRange(r, UINT_MAX);
+	loaded.combo = qdsLoadIntRange(r, INT_MIN, INT_MAX);
+	loaded.gameOver = qdsLoadRange(r, 1);
+
+	loaded.incomingHead = 0;
+	loaded.incomingCount = qdsLoadRange(r, GARBAGE_QUEUE);
+	loaded.incomingLines = 0;
+	for (int i = 0; i < loaded.incomingCount; ++i) {
+		struct garbage *g = &loaded.incoming[i];
+		g->lines = qdsLoadByte(r);
+		g->hole = qdsLoadIntRange(r, -1, width - 1);
+		loaded.incomingLines += g->lines;
+	}
+
+	if (r->error) return -EINVAL;
+	*data = loaded;
+	return 0;
+}
+
+static int call(qdsGame *game, unsigned long req, void *argp)
+{
+	struct modeData *data = qdsGetModeData(game);
+
+	switch (req) {
+		case QDS_GETMODENAME:
+			*(const char **)argp = "Versus";
+			return 0;
+		case QDS_GETTIME:
+			*(unsigned int *)argp = data->time;
+			return 0;
+		case QDS_GETNEXTCOUNT:
+			*(int *)argp = 5;
+			return 0;
+		case QDS_GETINCOMING:
+			*(int *)argp = data->incomingLines;
+			return 0;
+		case QDS_GETATTACK:
+			*(unsigned int *)argp = data->attack;
+			return 0;
+		case QDS_GETSTATEHASH:
+			*(uint64_t *)argp = hashState(data);
+			return 0;
+		case QDS_SAVESTATE:
+			saveState(data, argp);
+			return 0;
+		case QDS_LOADSTATE:
+			return loadState(data, game, argp);
+	}
+
+	return -ENOTTY;
+}
+
+QDS_API const qdsGamemode qdsModeVersus = {
+	.init = init,
+	.destroy = free,
+	.events = {
+		.onCycle = onCycle,
+		.postLock = postLock,
+		.onTopOut = onTopOut,
+	},
+	.call = call,
+	.getPiece = peek,
+	.shiftPiece = draw,
+};
+
+QDS_API bool qdsVersusPair(qdsGame *a, qdsGame *b, unsigned int seed)
+{
+	if (qdsGetMode(a) != &qdsModeVersus || qdsGetMode(b) != &qdsModeVersus)
+		return false;
+
+	struct modeData *da = qdsGetModeData(a), *db = qdsGetModeData(b);
+	da->opponent = b;
+	db->opponent = a;
+	qdsBagInit(&da->gen, seed);
+	qdsBagInit(&db->gen, seed);
+	qdsSrand(seed, &da->rand);
+	qdsSrand(seed, &db->rand);
+	return true;
+}
+
+QDS_API qdsGame *qdsVersusGetOpponent(const qdsGame *game)
+{
+	const struct modeData *data = qdsGetModeData(game);
+	return data->opponent;
+}
+
+QDS_API bool qdsVersusHasLost(const qdsGame *game)
+{
+	const struct modeData *data = qdsGetModeData(game);
+	return data->gameOver;
+}
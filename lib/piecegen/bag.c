@@ -64,3 +64,23 @@ QDS_API int qdsBagDraw(struct qdsBag *q)
 	}
 	return p;
 }
+
+QDS_API void qdsBagSave(const struct qdsBag *q, qdsSaveWriter *w)
+{
+	qdsSaveU64(w, q->rng);
+	qdsSaveByte(w, q->head);
+	qdsSaveBytes(w, q->pieces, 14);
+}
+
+QDS_API void qdsBagLoad(struct qdsBag *q, qdsSaveReader *r)
+{
+	q->rng = qdsLoadU64(r);
+	q->head = qdsLoadByte(r);
+	qdsLoadBytes(r, q->pieces, 14);
+
+	if (q->head >= 14) r->error = true;
+	for (int i = 0; i < 14; ++i) {
+		if (q->pieces[i] < QDS_PIECE_I || q->pieces[i] > QDS_PIECE_Z)
+			r->error = true;
+	}
+}
@@ -88,3 +88,26 @@ QDS_API int qdsHisDraw(struct qdsHis *q)
 	q->queueHead %= 8;
 	return result;
 }
+
+QDS_API void qdsHisSave(const struct qdsHis *q, qdsSaveWriter *w)
+{
+	qdsSaveU64(w, q->rng);
+	qdsSaveByte(w, q->queueHead);
+	qdsSaveByte(w, q->hisHead);
+	qdsSaveBytes(w, q->queue, 8);
+	qdsSaveBytes(w, q->history, 4);
+}
+
+QDS_API void qdsHisLoad(struct qdsHis *q, qdsSaveReader *r)
+{
+	q->rng = qdsLoadU64(r);
+	q->queueHead = qdsLoadRange(r, 7);
+	q->hisHead = qdsLoadRange(r, 3);
+	qdsLoadBytes(r, q->queue, 8);
+	qdsLoadBytes(r, q->history, 4);
+
+	for (int i = 0; i < 8; ++i) {
+		if (q->queue[i] < QDS_PIECE_I || q->queue[i] > QDS_PIECE_Z)
+			r->error = true;
+	}
+}
@@ -148,3 +148,40 @@ QDS_API void qdsTgmGenInit(struct qdsTgmGen *q, unsigned seed)
 		q->queue[i] = draw(q, 6);
 	}
 }
+
+QDS_API void qdsTgmGenSave(const struct qdsTgmGen *q, qdsSaveWriter *w)
+{
+	qdsSaveU64(w, q->rand);
+	qdsSaveByte(w, q->queueHead);
+	qdsSaveByte(w, q->hisHead);
+	qdsSaveBytes(w, q->queue, 8);
+	qdsSaveBytes(w, q->history, 4);
+	qdsSaveBytes(w, q->bag, 8);
+	for (int i = 0; i < 8; ++i) {
+		qdsSaveByte(w, q->histograph[i].piece);
+		qdsSaveByte(w, q->histograph[i].drought);
+	}
+}
+
+QDS_API void qdsTgmGenLoad(struct qdsTgmGen *q, qdsSaveReader *r)
+{
+	q->rand = qdsLoadU64(r);
+	q->queueHead = qdsLoadRange(r, 7);
+	q->hisHead = qdsLoadRange(r, 3);
+	qdsLoadBytes(r, q->queue, 8);
+	qdsLoadBytes(r, q->history, 4);
+	qdsLoadBytes(r, q->bag, 8);
+	for (int i = 0; i < 8; ++i) {
+		q->histograph[i].piece = qdsLoadByte(r);
+		q->histograph[i].drought = qdsLoadByte(r);
+		/* the histograph is a heap starting at 1 */
+		int piece = q->histograph[i].piece;
+		if (i > 0 && (piece < QDS_PIECE_I || piece > QDS_PIECE_Z))
+			r->error = true;
+	}
+
+	for (int i = 0; i < 8; ++i) {
+		if (q->queue[i] < QDS_PIECE_I || q->queue[i] > QDS_PIECE_Z)
+			r->error = true;
+	}
+}
@@ -21,14 +21,19 @@
  * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 #include "rulesets/arcade.h"
+#include "rulesets/cycle.h"
 #include <config.h>
 #include <quadus.h>
 #include <quadus/calls.h>
+#include <quadus/mode.h>
 #include <quadus/piece.h>
 #include <quadus/piecegen/tgm.h>
+#include <quadus/position.h>
 #include <quadus/ruleset.h>
+#include <quadus/ruleset/hash.h>
 #include <quadus/ruleset/input.h>
 #include <quadus/ruleset/linequeue.h>
+#include <quadus/ruleset/save.h>
 #include <quadus/ruleset/twist.h>
 
 #include <errno.h>
@@ -40,6 +45,16 @@
 #define DEFAULT_LOCKTIME 30
 #define DEFAULT_GRAVITY (65536 / 60)
 
+/*
+ * Passed to the inline utilities to specialize them for this ruleset;
+ * see standard.c for QDS_GENERIC_CYCLE.
+ */
+#ifdef QDS_GENERIC_CYCLE
+#define RS (game->rs)
+#else
+#define RS (&qdsRulesetArcade)
+#endif
+
 static const signed char kickOrderCw[] = { 1, -1, SCHAR_MAX };
 static const signed char kickOrderCcw[] = { -1, 1, SCHAR_MAX };
 static const signed char kickOrderCwI[] = { 1, SCHAR_MAX };
@@ -115,7 +130,7 @@ static int canRotate(qdsGame *restrict game,
 
 	*y = 0;
 
-	if (qdsCanRotate(game, 0, 0, rotation)) {
+	if (qdsInlineCanRotate(game, RS, 0, 0, rotation)) {
 		*x = 0;
 		return checkTwist(game, rotation, *x, *y);
 	}
@@ -141,7 +156,7 @@ static int canRotate(qdsGame *restrict game,
 
 kick:
 	for (const signed char *k = kicks; *k != SCHAR_MAX; ++k) {
-		if (qdsCanRotate(game, *k, 0, rotation)) {
+		if (qdsInlineCanRotate(game, RS, *k, 0, rotation)) {
 			*x = *k;
 			return checkTwist(game, rotation, *x, *y);
 		}
@@ -150,10 +165,76 @@ kick:
 	return QDS_ROTATE_FAILED;
 }
 
+static int checkPositionTwist(const qdsPosition *restrict pos,
+							  const qdsRuleset *restrict rs,
+							  int rotation,
+							  int x)
+{
+	if (qdsCheckPositionTwistImmobile(pos, rs, x, 0, rotation))
+		return QDS_ROTATE_TWIST;
+	else
+		return QDS_ROTATE_NORMAL;
+}
+
+static int canRotatePosition(const qdsPosition *restrict pos,
+							 const qdsRuleset *restrict rs,
+							 int rotation,
+							 int *restrict x,
+							 int *restrict y)
+{
+	if (rotation == 0) return QDS_ROTATE_FAILED;
+
+	int piece = pos->piece % 8;
+	const signed char *kicks;
+
+	if (rotation > 0) {
+		rotation = 1;
+		kicks = pieces[piece].kickOrderCw;
+	} else {
+		rotation = -1;
+		kicks = pieces[piece].kickOrderCcw;
+	}
+
+	int orientation = (pos->orientation + rotation) & 3;
+	*y = 0;
+
+	if (qdsPositionFits(pos, rs, piece, orientation, pos->x, pos->y)) {
+		*x = 0;
+		return checkPositionTwist(pos, rs, rotation, *x);
+	}
+
+	switch (piece) {
+		case QDS_PIECE_O:
+			return QDS_ROTATE_FAILED;
+		case QDS_PIECE_J:
+		case QDS_PIECE_L:
+		case QDS_PIECE_T:
+			/* center-column rule */
+			for (int dy = 2; dy >= 0; --dy)
+				for (int dx = -1; dx <= 1; ++dx)
+					if (qdsPositionGetTile(pos, pos->x + dx, pos->y + dy)) {
+						if (dx == 0)
+							return QDS_ROTATE_FAILED;
+						else
+							goto kick;
+					}
+	}
+
+kick:
+	for (const signed char *k = kicks; *k != SCHAR_MAX; ++k) {
+		if (qdsPositionFits(pos, rs, piece, orientation, pos->x + *k, pos->y)) {
+			*x = *k;
+			return checkPositionTwist(pos, rs, rotation, *x);
+		}
+	}
+
+	return QDS_ROTATE_FAILED;
+}
+
 static bool resetLock(arcadeData *restrict data, qdsGame *restrict game)
 {
 	int lockTime;
-	if (qdsCall(game, QDS_GETLOCKTIME, &lockTime) < 0)
+	if (qdsInlineCall(game, RS, QDS_GETLOCKTIME, &lockTime) < 0)
 		lockTime = DEFAULT_LOCKTIME;
 	data->baseState.lockTimer = lockTime;
 	return true;
@@ -179,14 +260,14 @@ static void doGravity(arcadeData *restrict data,
 					  unsigned int input)
 {
 	if (input & QDS_INPUT_HARD_DROP) {
-		qdsDrop(game, QDS_DROP_HARD, 48);
+		qdsInlineDrop(game, RS, QDS_DROP_HARD, qdsGetFieldRows(game));
 	}
 
-	if (qdsGrounded(game) && (input & QDS_INPUT_SOFT_DROP)) {
-		return qdsProcessLock(&data->baseState, game);
+	if (qdsInlineGrounded(game, RS) && (input & QDS_INPUT_SOFT_DROP)) {
+		return qdsInlineProcessLock(&data->baseState, game, RS);
 	}
 
-	return qdsProcessGravity(&data->baseState, game, input);
+	return qdsInlineProcessGravity(&data->baseState, game, RS, input);
 }
 
 static bool onDrop(qdsGame *game, int type, int dy)
@@ -216,7 +297,7 @@ static void addLockScore(qdsGame *restrict game)
 	}
 
 	int level, postlevel;
-	if (qdsCall(game, QDS_GETSUBLEVEL, &level) < 0) level = 1;
+	if (qdsInlineCall(game, RS, QDS_GETSUBLEVEL, &level) < 0) level = 1;
 
 	int score = (level + lines + 3) / 4;
 	score += data->softDistance;
@@ -240,9 +321,10 @@ static void doActiveCycle(qdsRulesetState *restrict data,
 						  qdsGame *restrict game,
 						  unsigned int input)
 {
-	qdsProcessHold(data, game, input);
-	qdsProcessRotation(data, game, input);
-	qdsProcessMovement(data, game, input);
+	qdsInlineProcessHold(data, game, RS, input);
+	qdsInlineProcessRotation(data, game, RS, input);
+	qdsInlineProcessMovement(data, game, RS, input);
+	/* baseState is the first element of arcadeData */
 	doGravity((arcadeData *)data, game, input);
 }
 
@@ -253,17 +335,17 @@ static void gameCycle(qdsGame *restrict game, unsigned int input)
 	unsigned int effective
 		= qdsFilterDirections(game, &data->inputState, input);
 
-	qdsRulesetCycle(&data->baseState, game, doActiveCycle, effective);
+	qdsInlineRulesetCycle(&data->baseState, game, RS, doActiveCycle, effective);
 }
 
 static int spawnX(qdsGame *game)
 {
-	return 4;
+	return (qdsGetFieldWidth(game) - 1) / 2;
 }
 
 static int spawnY(qdsGame *game)
 {
-	return 20;
+	return qdsGetFieldRows(game) - QDS_HIDDEN_ROWS;
 }
 
 static int peekNext(void *data, int pos)
@@ -291,7 +373,7 @@ static void onLineFilled(qdsGame *restrict game, int y)
 static int getSoftDropGravity(qdsGame *game)
 {
 	int g;
-	if (qdsCall(game, QDS_GETGRAVITY, &g) < 0) g = 1092;
+	if (qdsInlineCall(game, RS, QDS_GETGRAVITY, &g) < 0) g = 1092;
 	return g > 65536 ? g : 65536;
 }
 
@@ -318,6 +400,47 @@ static int rulesetCall(qdsGame *restrict game, unsigned long call, void *argp)
 		case QDS_GETNEXTCOUNT:
 			*(int *)argp = 8;
 			return 0;
+		case QDS_GETSTATEHASH: {
+			uint64_t h = qdsHashRulesetState(&data->baseState);
+			h = qdsHashInputState(h, &data->inputState);
+			/* the generator is idle while the mode deals pieces */
+			if (!qdsGetMode(game) || !qdsGetMode(game)->getPiece)
+				h = qdsHashAdd(h, data->gen.rand);
+			h = qdsHashAdd(h, data->score | (uint64_t)data->combo << 32);
+			h = qdsHashAdd(h,
+						   data->softDistance
+							   | (uint32_t)data->sonicDistance << 16);
+			*(uint64_t *)argp = h;
+			return 0;
+		}
+		case QDS_SAVESTATE: {
+			qdsSaveWriter *w = argp;
+			qdsSaveRulesetState(w, &data->baseState);
+			qdsSaveInputState(w, &data->inputState);
+			qdsTgmGenSave(&data->gen, w);
+			qdsSaveUint(w, data->score);
+			qdsSaveUint(w, data->combo);
+			qdsSaveUint(w, data->softDistance);
+			qdsSaveUint(w, data->sonicDistance);
+			return 0;
+		}
+		case QDS_LOADSTATE: {
+			qdsSaveReader *r = argp;
+			arcadeData loaded = *data;
+			qdsLoadRulesetState(r, &loaded.baseState);
+			qdsLoadInputState(r, &loaded.inputState);
+			qdsTgmGenLoad(&loaded.gen, r);
+			loaded.score = qdsLoadRange(r, UINT_MAX);
+			loaded.combo = qdsLoadRange(r, UINT_MAX);
+			loaded.softDistance = qdsLoadRange(r, USHRT_MAX);
+			loaded.sonicDistance = qdsLoadRange(r, USHRT_MAX);
+			if (r->error) return -EINVAL;
+			*data = loaded;
+			return 0;
+		}
+		case QDS_SETSEED:
+			qdsTgmGenInit(&data->gen, *(unsigned int *)argp);
+			return 0;
 		default:
 			return qdsUtilCallHandler(&data->baseState, game, call, argp);
 	}
@@ -332,6 +455,7 @@ QDS_API const qdsRuleset qdsRulesetArcade = {
 	.shiftPiece = drawNext,
 	.getShape = getShape,
 	.canRotate = canRotate,
+	.canRotatePosition = canRotatePosition,
 	.doGameCycle = gameCycle,
 	.events = {
 		.onSpawn = onSpawn,
@@ -21,10 +21,12 @@
  * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 #include <quadus/ruleset/linequeue.h>
+
 #include <stddef.h>
 
 QDS_API void qdsQueueLine(struct qdsPendingLines *q, int y)
 {
+	if (q->lines >= sizeof(q->h)) return;
 	q->h[q->lines++] = y;
 }
 
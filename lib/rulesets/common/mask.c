@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2023 McEndu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <quadus.h>
+#include <quadus/piece.h>
+#include <quadus/ruleset/mask.h>
+
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+QDS_API uint_fast16_t qdsGetLineMask(const qdsTile *line)
+{
+#ifdef __SSE2__
+	/* a line is exactly one vector wide */
+	__m128i tiles = _mm_loadu_si128((const __m128i *)line);
+	__m128i empty = _mm_cmpeq_epi8(tiles, _mm_setzero_si128());
+	return ~_mm_movemask_epi8(empty) & 0xffff;
+#else
+	uint_fast16_t mask = 0;
+	for (int i = 0; i < QDS_MAX_WIDTH; ++i)
+		mask |= (uint_fast16_t)(line[i] != 0) << i;
+	return mask;
+#endif
+}
+
+QDS_API void qdsBuildShapeMask(qdsShapeMask *restrict mask,
+							   const qdsCoords *restrict shape)
+{
+	int left = SCHAR_MAX, right = SCHAR_MIN;
+	int bottom = SCHAR_MAX, top = SCHAR_MIN;
+
+	memset(mask, 0, sizeof(qdsShapeMask));
+	QDS_SHAPE_FOREACH (i, shape) {
+		if (i->x < left) left = i->x;
+		if (i->x > right) right = i->x;
+		if (i->y < bottom) bottom = i->y;
+		if (i->y > top) top = i->y;
+	}
+	if (left > right) return; /* empty shape */
+
+	mask->left = left;
+	mask->bottom = bottom;
+	mask->width = right - left + 1;
+	mask->height = top - bottom + 1;
+	QDS_SHAPE_FOREACH (i, shape) {
+		mask->rows[i->y - bottom] |= 1 << (i->x - left);
+	}
+}
+
+QDS_API bool qdsMaskFits(const qdsLine *restrict playfield,
+						 const qdsShapeMask *restrict mask,
+						 int x,
+						 int y)
+{
+	if (mask->height == 0) return true;
+
+	x += mask->left;
+	y += mask->bottom;
+	if (x < 0 || x + mask->width > QDS_DEFAULT_WIDTH) return false;
+	if (y < 0 || y + mask->height > QDS_DEFAULT_ROWS) return false;
+
+	for (int i = 0; i < mask->height; ++i) {
+		if (qdsGetLineMask(playfield[y + i]) & (mask->rows[i] << x))
+			return false;
+	}
+
+	return true;
+}
@@ -21,6 +21,7 @@
  * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 #include <quadus.h>
+#include <quadus/position.h>
 #include <quadus/ruleset.h>
 #include <quadus/ruleset/twist.h>
 
@@ -53,3 +54,38 @@ QDS_API bool qdsCheckTwist3Corner(qdsGame *game, int dx, int dy, int r)
 			return false;
 	}
 }
+
+QDS_API bool qdsCheckPositionTwistImmobile(const qdsPosition *pos,
+										   const qdsRuleset *rs,
+										   int x,
+										   int y,
+										   int r)
+{
+	int piece = pos->piece, orientation = (pos->orientation + r) & 3;
+	x += pos->x, y += pos->y;
+	return !qdsPositionFits(pos, rs, piece, orientation, x, y - 1)
+		   && !qdsPositionFits(pos, rs, piece, orientation, x, y + 1)
+		   && !qdsPositionFits(pos, rs, piece, orientation, x - 1, y)
+		   && !qdsPositionFits(pos, rs, piece, orientation, x + 1, y);
+}
+
+QDS_API bool qdsCheckPositionTwist3Corner(const qdsPosition *pos,
+										  int dx,
+										  int dy)
+{
+	int x = pos->x + dx, y = pos->y + dy, corners = 0;
+	switch (pos->piece) {
+		case QDS_PIECE_J:
+		case QDS_PIECE_L:
+		case QDS_PIECE_T:
+		case QDS_PIECE_S:
+		case QDS_PIECE_Z:
+			corners += qdsPositionGetTile(pos, x - 1, y - 1);
+			corners += qdsPositionGetTile(pos, x - 1, y + 1);
+			corners += qdsPositionGetTile(pos, x + 1, y - 1);
+			corners += qdsPositionGetTile(pos, x + 1, y + 1);
+			return corners >= 3;
+		default:
+			return false;
+	}
+}
@@ -20,12 +20,16 @@
  * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
  * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
+#include "rulesets/cycle.h"
 #include <errno.h>
 #include <quadus.h>
 #include <quadus/calls.h>
 #include <quadus/ruleset.h>
+#include <quadus/ruleset/hash.h>
 #include <quadus/ruleset/input.h>
+#include <quadus/ruleset/save.h>
 #include <quadus/ruleset/utils.h>
+#include <stdint.h>
 #include <string.h>
 
 #define DEFAULT_GRAVITY (65536 / 60)
@@ -52,20 +56,7 @@ QDS_API void qdsProcessSpawn(qdsRulesetState *restrict state,
 							 qdsGame *restrict game,
 							 unsigned int input)
 {
-	state->status = QDS_STATUS_ACTIVE;
-	state->delayInput = 0;
-	state->held = false;
-
-	state->spawning = true;
-	qdsSpawn(game, 0);
-
-	qdsProcessHold(state, game, input);
-	qdsProcessRotation(state, game, input);
-	if (qdsOverlaps(game)) qdsEndGame(game);
-
-	state->spawning = false;
-
-	qdsProcessGravity(state, game, input & QDS_INPUT_SOFT_DROP);
+	qdsInlineProcessSpawn(state, game, game->rs, input);
 }
 
 QDS_API void qdsHandleSpawn(qdsRulesetState *restrict state)
@@ -78,110 +69,34 @@ QDS_API void qdsProcessHold(qdsRulesetState *restrict data,
 							qdsGame *restrict game,
 							unsigned int input)
 {
-	if (!(input & QDS_INPUT_HOLD)) return;
-
-	if (data->held && (qdsCall(game, QDS_GETINFINIHOLD, NULL) <= 0)) return;
-	qdsHold(game);
-	if (qdsOverlaps(game)) qdsEndGame(game);
-	data->held = true;
+	qdsInlineProcessHold(data, game, game->rs, input);
 }
 
 QDS_API int qdsProcessMovement(qdsRulesetState *restrict data,
 							   qdsGame *restrict game,
 							   unsigned int input)
 {
-	int direction;
-
-	if (input & QDS_INPUT_LEFT) {
-		direction = -1;
-	} else if (input & QDS_INPUT_RIGHT) {
-		direction = 1;
-	} else {
-		return 0;
-	}
-
-	int distance = qdsMove(game, direction);
-	if (distance) data->twistCheckResult = 0;
-	return distance;
+	return qdsInlineProcessMovement(data, game, game->rs, input);
 }
 
 QDS_API int qdsProcessRotation(qdsRulesetState *restrict data,
 							   qdsGame *restrict game,
 							   unsigned int input)
 {
-	int rotation;
-	if (input & QDS_INPUT_ROTATE_C) {
-		rotation = QDS_ROTATION_CLOCKWISE;
-	} else if (input & QDS_INPUT_ROTATE_CC) {
-		rotation = QDS_ROTATION_COUNTERCLOCKWISE;
-	} else {
-		return QDS_ROTATE_FAILED;
-	}
-
-	int rotateResult = qdsRotate(game, rotation);
-	if (rotateResult != QDS_ROTATE_FAILED)
-		data->twistCheckResult = rotateResult;
-	return rotateResult;
+	return qdsInlineProcessRotation(data, game, game->rs, input);
 }
 
 QDS_API void qdsProcessGravity(qdsRulesetState *restrict state,
 							   qdsGame *restrict game,
 							   unsigned int input)
 {
-	if (qdsGrounded(game)) {
-		state->subY = 0;
-		if (--state->lockTimer == 0) return qdsProcessLock(state, game);
-	} else {
-		int gravity, dropType = QDS_DROP_GRAVITY;
-		if (qdsCall(game, QDS_GETGRAVITY, &gravity) < 0) gravity = 65536 / 60;
-		if (input & QDS_INPUT_SOFT_DROP) {
-			int softDropGravity;
-			if (qdsCall(game, QDS_GETSDG, &softDropGravity) < 0)
-				softDropGravity = 32768;
-			if (softDropGravity > gravity) {
-				gravity = softDropGravity;
-				dropType = QDS_DROP_SOFT;
-			}
-		} else {
-			dropType = QDS_DROP_GRAVITY;
-		}
-
-		state->subY += gravity;
-		qdsDrop(game, dropType, state->subY / 65536);
-		if (qdsGrounded(game))
-			state->subY = 0;
-		else
-			state->subY %= 65536;
-	}
+	qdsInlineProcessGravity(state, game, game->rs, input);
 }
 
 QDS_API void qdsProcessLock(qdsRulesetState *restrict state,
 							qdsGame *restrict game)
 {
-	/* save active piece data for QDS_GETCLEARTYPE use */
-	state->clearType = qdsGetActivePieceType(game) << 16;
-
-	/* the rest is normal lock course */
-	if (!qdsLock(game)) return;
-
-	int lines = state->pendingLines.lines;
-	unsigned int delay;
-
-	if (lines > 0) {
-		/* go to line delay */
-		if (qdsCall(game, QDS_GETLINEDELAY, &delay) < 0 || delay == 0)
-			return qdsProcessLineClear(state, game, 0);
-		state->status = QDS_STATUS_LINEDELAY;
-		state->statusTime = delay;
-	} else {
-		/* go to lock delay */
-		if (qdsCall(game, QDS_GETARE, &delay) < 0 || delay == 0) {
-			return qdsProcessSpawn(state, game, 0);
-		} else {
-			state->status = QDS_STATUS_LOCKDELAY;
-			state->statusTime = delay;
-		}
-	}
+	qdsInlineProcessLock(state, game, game->rs);
 }
 
 QDS_API unsigned int qdsCheckLockType(qdsRulesetState *restrict state,
@@ -215,15 +130,7 @@ QDS_API void qdsProcessLineClear(qdsRulesetState *restrict state,
 								 qdsGame *restrict game,
 								 unsigned int input)
 {
-	qdsClearQueuedLines(game, &state->pendingLines);
-
-	unsigned int are;
-	if (qdsCall(game, QDS_GETARE, &are) < 0 || are == 0) {
-		return qdsProcessSpawn(state, game, state->delayInput);
-	} else {
-		state->status = QDS_STATUS_LOCKDELAY;
-		state->statusTime = are;
-	}
+	qdsInlineProcessLineClear(state, game, game->rs, input);
 }
 
 QDS_API void qdsProcessDelay(qdsRulesetState *restrict state,
@@ -252,30 +159,7 @@ QDS_API void qdsRulesetCycle(qdsRulesetState *restrict state,
 												 unsigned int input),
 							 unsigned int input)
 {
-	if (state->pause) {
-		state->pause = false;
-		state->status = QDS_STATUS_PAUSE;
-	}
-
-	switch (state->status) {
-		case QDS_STATUS_ACTIVE:
-			return activeCycle(state, game, input);
-		case QDS_STATUS_INIT:
-		case QDS_STATUS_PREGAME:
-		case QDS_STATUS_PAUSE:
-		case QDS_STATUS_LOCKDELAY:
-			qdsProcessDelay(state, game, input);
-			if (state->statusTime == 0) {
-				qdsProcessSpawn(state, game, state->delayInput);
-			}
-			break;
-		case QDS_STATUS_LINEDELAY:
-			qdsProcessDelay(state, game, input);
-			if (state->statusTime == 0) {
-				qdsProcessLineClear(state, game, input);
-			}
-			break;
-	}
+	qdsInlineRulesetCycle(state, game, game->rs, activeCycle, input);
 }
 
 static int getSoftDropGravity(qdsGame *game, int *result)
@@ -288,6 +172,72 @@ static int getSoftDropGravity(qdsGame *game, int *result)
 	return 0;
 }
 
+QDS_API uint64_t qdsHashRulesetState(const qdsRulesetState *state)
+{
+	uint64_t status = state->status
+					  | (uint64_t)(unsigned short)state->statusTime << 16
+					  | (uint64_t)state->lockTimer << 32
+					  | (uint64_t)state->resetsLeft << 48;
+	uint64_t h = qdsHashAdd(0, status);
+	h = qdsHashAdd(h, state->subY | (uint64_t)state->delayInput << 32);
+	h = qdsHashAdd(h,
+				   state->twistCheckResult | (uint64_t)state->clearType << 32);
+	h = qdsHashAdd(h,
+				   state->held | state->b2b << 1 | state->reset << 2
+					   | state->pause << 3 | state->spawning << 4);
+	for (int i = 0; i < state->pendingLines.lines; ++i)
+		h = qdsHashAdd(h, state->pendingLines.h[i]);
+	return h;
+}
+
+QDS_API void qdsSaveRulesetState(qdsSaveWriter *w,
+								 const qdsRulesetState *state)
+{
+	qdsSaveUint(w, state->status);
+	qdsSaveInt(w, state->statusTime);
+	qdsSaveUint(w, state->subY);
+	qdsSaveUint(w, state->lockTimer);
+	qdsSaveUint(w, state->resetsLeft);
+	qdsSaveUint(w, state->delayInput);
+	qdsSaveUint(w, state->twistCheckResult);
+	qdsSaveUint(w, state->clearType);
+	qdsSaveByte(w,
+				state->held | state->b2b << 1 | state->reset << 2
+					| state->pause << 3 | state->spawning << 4);
+
+	qdsSaveByte(w, state->pendingLines.lines);
+	qdsSaveBytes(w, state->pendingLines.h, state->pendingLines.lines);
+}
+
+QDS_API void qdsLoadRulesetState(qdsSaveReader *r, qdsRulesetState *state)
+{
+	state->status = qdsLoadRange(r, QDS_STATUS_GAMEOVER);
+	state->statusTime = qdsLoadIntRange(r, INT16_MIN, INT16_MAX);
+	state->subY = qdsLoadRange(r, UINT32_MAX);
+	state->lockTimer = qdsLoadRange(r, UINT16_MAX);
+	state->resetsLeft = qdsLoadRange(r, UINT16_MAX);
+	state->delayInput = qdsLoadRange(r, UINT32_MAX);
+	state->twistCheckResult = qdsLoadRange(r, UINT32_MAX);
+	state->clearType = qdsLoadRange(r, UINT32_MAX);
+	unsigned int flags = qdsLoadByte(r);
+	state->held = flags & 1;
+	state->b2b = flags >> 1 & 1;
+	state->reset = flags >> 2 & 1;
+	state->pause = flags >> 3 & 1;
+	state->spawning = flags >> 4 & 1;
+
+	struct qdsPendingLines *q = &state->pendingLines;
+	q->lines = qdsLoadByte(r);
+	if (q->lines > sizeof(q->h)) {
+		r->error = true;
+		q->lines = 0;
+	}
+	qdsLoadBytes(r, q->h, q->lines);
+	for (int i = 0; i < q->lines; ++i) {
+		if (q->h[i] >= QDS_MAX_ROWS) r->error = true;
+	}
+}
+
 QDS_API int qdsUtilCallHandler(qdsRulesetState *state,
 							   qdsGame *game,
 							   unsigned long call,
@@ -315,6 +265,9 @@ QDS_API int qdsUtilCallHandler(qdsRulesetState *state,
 		case QDS_GETCLEARTYPE:
 			*(int *)argp = state->clearType;
 			return 0;
+		case QDS_GETSTATEHASH:
+			*(uint64_t *)argp = qdsHashRulesetState(state);
+			return 0;
 		case QDS_PAUSE:
 			state->pause = true;
 			state->statusTime = *(int *)argp;
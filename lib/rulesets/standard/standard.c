@@ -20,17 +20,24 @@
  * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
  * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
+#include "rulesets/cycle.h"
 #include "rulesets/standard.h"
+#include "rulesets/window.h"
 #include <config.h>
 #include <quadus.h>
 #include <quadus/calls.h>
+#include <quadus/mode.h>
 #include <quadus/piece.h>
 #include <quadus/piecegen/bag.h>
+#include <quadus/position.h>
 #include <quadus/ruleset.h>
+#include <quadus/ruleset/hash.h>
 #include <quadus/ruleset/input.h>
 #include <quadus/ruleset/linequeue.h>
+#include <quadus/ruleset/mask.h>
 #include <quadus/ruleset/rand.h>
 #include <quadus/ruleset/twist.h>
+#include <quadus/ruleset/save.h>
 #include <quadus/ruleset/utils.h>
 
 #include <errno.h>
@@ -103,6 +110,56 @@ static const struct pieceData
 	[QDS_PIECE_Z] = { &qdsPieceZ, &kicksNormal },
 };
 
+/*
+ * Collision masks of the piece shapes, in the format of
+ * { left, bottom, width, height, { rows from bottom up } }.
+ */
+static const qdsShapeMask masks[8][4] = {
+	[QDS_PIECE_NONE] = { { 0 } },
+	[QDS_PIECE_I] = {
+		{ -1, 0, 4, 1, { 0xf } },
+		{ 1, -2, 1, 4, { 0x1, 0x1, 0x1, 0x1 } },
+		{ -1, -1, 4, 1, { 0xf } },
+		{ 0, -2, 1, 4, { 0x1, 0x1, 0x1, 0x1 } },
+	},
+	[QDS_PIECE_J] = {
+		{ -1, 0, 3, 2, { 0x7, 0x1 } },
+		{ 0, -1, 2, 3, { 0x1, 0x1, 0x3 } },
+		{ -1, -1, 3, 2, { 0x4, 0x7 } },
+		{ -1, -1, 2, 3, { 0x3, 0x2, 0x2 } },
+	},
+	[QDS_PIECE_L] = {
+		{ -1, 0, 3, 2, { 0x7, 0x4 } },
+		{ 0, -1, 2, 3, { 0x3, 0x1, 0x1 } },
+		{ -1, -1, 3, 2, { 0x1, 0x7 } },
+		{ -1, -1, 2, 3, { 0x2, 0x2, 0x3 } },
+	},
+	[QDS_PIECE_O] = {
+		{ 0, 0, 2, 2, { 0x3, 0x3 } },
+		{ 0, 0, 2, 2, { 0x3, 0x3 } },
+		{ 0, 0, 2, 2, { 0x3, 0x3 } },
+		{ 0, 0, 2, 2, { 0x3, 0x3 } },
+	},
+	[QDS_PIECE_S] = {
+		{ -1, 0, 3, 2, { 0x3, 0x6 } },
+		{ 0, -1, 2, 3, { 0x2, 0x3, 0x1 } },
+		{ -1, -1, 3, 2, { 0x3, 0x6 } },
+		{ -1, -1, 2, 3, { 0x2, 0x3, 0x1 } },
+	},
+	[QDS_PIECE_T] = {
+		{ -1, 0, 3, 2, { 0x7, 0x2 } },
+		{ 0, -1, 2, 3, { 0x1, 0x3, 0x1 } },
+		{ -1, -1, 3, 2, { 0x2, 0x7 } },
+		{ -1, -1, 2, 3, { 0x2, 0x3, 0x2 } },
+	},
+	[QDS_PIECE_Z] = {
+		{ -1, 0, 3, 2, { 0x6, 0x3 } },
+		{ 0, -1, 2, 3, { 0x1, 0x3, 0x2 } },
+		{ -1, -1, 3, 2, { 0x6, 0x3 } },
+		{ -1, -1, 2, 3, { 0x1, 0x3, 0x2 } },
+	},
+};
+
 static const int dropScore[4][5] = {
 	[0] = { 0, 100, 300, 500, 800 },
 	[QDS_ROTATE_NORMAL] = { 0, 100, 300, 500, 800 },
@@ -115,6 +172,18 @@ static const int allClearBonus[] = { 0, 800, 1200, 1800, 2000 };
 #define DEFAULT_LOCKTIME 30
 #define DEFAULT_GRAVITY (65536 / 60)
 
+/*
+ * Passed to the inline utilities to specialize them for this ruleset.
+ * Built with QDS_GENERIC_CYCLE, they take the ruleset of the game
+ * instead, like the exported utilities do; benchmarks/ times the two
+ * against each other.
+ */
+#ifdef QDS_GENERIC_CYCLE
+#define RS (game->rs)
+#else
+#define RS (&qdsRulesetStandard)
+#endif
+
 static void *init(void)
 {
 	standardData *data = malloc(sizeof(standardData));
@@ -146,7 +215,7 @@ static int addLevelMultipliedScore(standardData *restrict data,
 								   int pts)
 {
 	int level;
-	if (qdsCall(game, QDS_GETLEVEL, &level) < 0) level = 1;
+	if (qdsInlineCall(game, RS, QDS_GETLEVEL, &level) < 0) level = 1;
 	data->score += pts * level;
 	return data->score;
 }
@@ -157,7 +226,7 @@ static bool resetLock(standardData *restrict data,
 {
 	if (refresh) {
 		int resets;
-		if (qdsCall(game, QDS_GETRESETS, &resets) < 0) resets = 15;
+		if (qdsInlineCall(game, RS, QDS_GETRESETS, &resets) < 0) resets = 15;
 		data->baseState.resetsLeft = resets;
 	} else {
 		if (data->baseState.resetsLeft == 0) return false;
@@ -165,7 +234,7 @@ static bool resetLock(standardData *restrict data,
 	}
 
 	int lockTime;
-	if (qdsCall(game, QDS_GETLOCKTIME, &lockTime) < 0)
+	if (qdsInlineCall(game, RS, QDS_GETLOCKTIME, &lockTime) < 0)
 		lockTime = DEFAULT_LOCKTIME;
 	data->baseState.lockTimer = lockTime;
 	return true;
@@ -183,8 +252,8 @@ static void doMovement(standardData *restrict data,
 					   qdsGame *restrict game,
 					   unsigned int input)
 {
-	bool grounded = qdsGrounded(game);
-	if (qdsProcessMovement(&data->baseState, game, input) && grounded)
+	bool grounded = qdsInlineGrounded(game, RS);
+	if (qdsInlineProcessMovement(&data->baseState, game, RS, input) && grounded)
 		data->baseState.reset = true;
 }
 
@@ -192,12 +261,49 @@ static void doRotate(standardData *restrict data,
 					 qdsGame *restrict game,
 					 unsigned int input)
 {
-	bool grounded = qdsGrounded(game);
-	if (qdsProcessRotation(&data->baseState, game, input) != QDS_ROTATE_FAILED
+	bool grounded = qdsInlineGrounded(game, RS);
+	if (qdsInlineProcessRotation(&data->baseState, game, RS, input)
+			!= QDS_ROTATE_FAILED
 		&& grounded)
 		data->baseState.reset = true;
 }
 
+static const qdsShapeMask *getShapeMask(int type, int orientation)
+{
+	return &masks[type % 8][orientation % 4];
+}
+
+static const qdsCoords *getKicks(int type, int orientation, int rotation)
+{
+	const struct kickData *kicks = pieces[type % 8].kicks;
+	if (rotation > 0)
+		return kicks->cw[orientation % 4];
+	else
+		return kicks->ccw[orientation % 4];
+}
+
+/**
+ * Check for a twist with the three-corner rule.
+ */
+static bool check3Corner(const qdsMaskWindow *w, int piece, int x, int y)
+{
+	int corners = 0;
+	switch (piece) {
+		case QDS_PIECE_J:
+		case QDS_PIECE_L:
+		case QDS_PIECE_T:
+		case QDS_PIECE_S:
+		case QDS_PIECE_Z:
+			corners += qdsWindowTile(w, x - 1, y - 1);
+			corners += qdsWindowTile(w, x - 1, y + 1);
+			corners += qdsWindowTile(w, x + 1, y - 1);
+			corners += qdsWindowTile(w, x + 1, y + 1);
+			return corners >= 3;
+		default:
+			return false;
+	}
+}
+
 static int canRotate(qdsGame *restrict game,
 					 int rotation,
 					 int *restrict x,
@@ -205,33 +311,84 @@ static int canRotate(qdsGame *restrict game,
 {
 	if (rotation == 0) return QDS_ROTATE_FAILED;
 
+	rotation = rotation > 0 ? 1 : -1;
+
 	int piece = qdsGetActivePieceType(game) % 8;
 	int orientation = qdsGetActiveOrientation(game);
-	const qdsCoords *kicks;
+	const qdsCoords *kicks = getKicks(piece, orientation, rotation);
 
-	if (rotation > 0) {
-		rotation = 1;
-		kicks = pieces[piece].kicks->cw[orientation];
-	} else {
-		rotation = -1;
-		kicks = pieces[piece].kicks->ccw[orientation];
+#ifdef QDS_REFERENCE
+	QDS_SHAPE_FOREACH (k, kicks) {
+		if (!qdsInlineCanRotate(game, RS, k->x, k->y, rotation)) continue;
+
+		*x = k->x;
+		*y = k->y;
+		if (qdsCheckTwistImmobile(game, k->x, k->y, rotation))
+			return QDS_ROTATE_TWIST;
+		if (qdsCheckTwist3Corner(game, k->x, k->y, rotation))
+			return QDS_ROTATE_TWIST_MINI;
+		return QDS_ROTATE_NORMAL;
 	}
+	return QDS_ROTATE_FAILED;
+#endif
+
+	/* every kick and twist check is resolved against the same rows */
+	const qdsShapeMask *mask = &masks[piece][(orientation + rotation) & 3];
+	int cx, cy;
+	qdsGetActivePosition(game, &cx, &cy);
+	qdsMaskWindow w;
+	qdsLoadMaskWindow(&w, qdsGetPlayfield(game), game->width, game->rows, cy);
 
 	QDS_SHAPE_FOREACH (k, kicks) {
-		if (qdsCanRotate(game, k->x, k->y, rotation)) {
-			*x = k->x;
-			*y = k->y;
-
-			/*
-			 * Full twist: passes immobile check
-			 * Mini twist: fails immobile but passes three-corner
-			 */
-			if (qdsCheckTwistImmobile(game, k->x, k->y, rotation))
-				return QDS_ROTATE_TWIST;
-			if (qdsCheckTwist3Corner(game, k->x, k->y, rotation))
-				return QDS_ROTATE_TWIST_MINI;
-			return QDS_ROTATE_NORMAL;
-		}
+		int kx = cx + k->x;
+		int ky = cy + k->y;
+		if (!qdsWindowFits(&w, mask, kx, ky)) continue;
+
+		*x = k->x;
+		*y = k->y;
+
+		/*
+		 * Full twist: passes immobile check
+		 * Mini twist: fails immobile but passes three-corner
+		 */
+		if (!qdsWindowFits(&w, mask, kx, ky - 1)
+			&& !qdsWindowFits(&w, mask, kx, ky + 1)
+			&& !qdsWindowFits(&w, mask, kx - 1, ky)
+			&& !qdsWindowFits(&w, mask, kx + 1, ky))
+			return QDS_ROTATE_TWIST;
+		if (check3Corner(&w, piece, kx, ky)) return QDS_ROTATE_TWIST_MINI;
+		return QDS_ROTATE_NORMAL;
+	}
+
+	return QDS_ROTATE_FAILED;
+}
+
+static int canRotatePosition(const qdsPosition *restrict pos,
+							 const qdsRuleset *restrict rs,
+							 int rotation,
+							 int *restrict x,
+							 int *restrict y)
+{
+	if (rotation == 0) return QDS_ROTATE_FAILED;
+
+	rotation = rotation > 0 ? 1 : -1;
+
+	int piece = pos->piece % 8;
+	int orientation = (pos->orientation + rotation) & 3;
+	const qdsCoords *kicks = getKicks(piece, pos->orientation, rotation);
+
+	QDS_SHAPE_FOREACH (k, kicks) {
+		int kx = pos->x + k->x;
+		int ky = pos->y + k->y;
+		if (!qdsPositionFits(pos, rs, piece, orientation, kx, ky)) continue;
+
+		*x = k->x;
+		*y = k->y;
+		if (qdsCheckPositionTwistImmobile(pos, rs, k->x, k->y, rotation))
+			return QDS_ROTATE_TWIST;
+		if (qdsCheckPositionTwist3Corner(pos, k->x, k->y))
+			return QDS_ROTATE_TWIST_MINI;
+		return QDS_ROTATE_NORMAL;
 	}
 
 	return QDS_ROTATE_FAILED;
@@ -242,8 +399,8 @@ static void doGravity(standardData *restrict data,
 					  unsigned int input)
 {
 	if (input & QDS_INPUT_HARD_DROP) {
-		qdsDrop(game, QDS_DROP_HARD, 48);
-		return qdsProcessLock(&data->baseState, game);
+		qdsInlineDrop(game, RS, QDS_DROP_HARD, game->rows);
+		return qdsInlineProcessLock(&data->baseState, game, RS);
 	}
 
 	bool reset = false;
@@ -252,8 +409,8 @@ static void doGravity(standardData *restrict data,
 		data->baseState.reset = false;
 	}
 
-	if (!reset || !qdsGrounded(game))
-		return qdsProcessGravity(&data->baseState, game, input);
+	if (!reset || !qdsInlineGrounded(game, RS))
+		return qdsInlineProcessGravity(&data->baseState, game, RS, input);
 }
 
 static bool onDrop(qdsGame *restrict game, int type, int distance)
@@ -298,7 +455,7 @@ static void doActiveCycle(qdsRulesetState *restrict data,
 						  qdsGame *restrict game,
 						  unsigned int input)
 {
-	qdsProcessHold(data, game, input);
+	qdsInlineProcessHold(data, game, RS, input);
 	/* baseState is the first element of standardData */
 	doMovement((standardData *)data, game, input);
 	doRotate((standardData *)data, game, input);
@@ -313,19 +470,19 @@ static void gameCycle(qdsGame *restrict game, unsigned int input)
 	effective |= qdsFilterDirections(game, &data->inputState, input)
 				 & ~(QDS_INPUT_HARD_DROP);
 
-	qdsRulesetCycle(&data->baseState, game, doActiveCycle, effective);
+	qdsInlineRulesetCycle(&data->baseState, game, RS, doActiveCycle, effective);
 
 	data->time += 1;
 }
 
 static int spawnX(qdsGame *game)
 {
-	return 4;
+	return (qdsGetFieldWidth(game) - 1) / 2;
 }
 
 static int spawnY(qdsGame *game)
 {
-	return 20;
+	return qdsGetFieldRows(game) - QDS_HIDDEN_ROWS;
 }
 
 static int peekNext(void *data, int pos)
@@ -371,6 +528,45 @@ static int rulesetCall(qdsGame *restrict game, unsigned long call, void *argp)
 		case QDS_GETCOMBO:
 			*(unsigned int *)argp = data->combo;
 			return 0;
+		case QDS_GETSTATEHASH: {
+			uint64_t h = qdsHashRulesetState(&data->baseState);
+			h = qdsHashInputState(h, &data->inputState);
+			/* the generator is idle while the mode deals pieces */
+			if (!qdsGetMode(game) || !qdsGetMode(game)->getPiece)
+				h = qdsHashAdd(h, data->gen.rng);
+			h = qdsHashAdd(h, data->time | (uint64_t)data->lines << 32);
+			h = qdsHashAdd(h, data->score | (uint64_t)data->combo << 32);
+			*(uint64_t *)argp = h;
+			return 0;
+		}
+		case QDS_SAVESTATE: {
+			qdsSaveWriter *w = argp;
+			qdsSaveRulesetState(w, &data->baseState);
+			qdsSaveInputState(w, &data->inputState);
+			qdsBagSave(&data->gen, w);
+			qdsSaveUint(w, data->time);
+			qdsSaveUint(w, data->lines);
+			qdsSaveUint(w, data->score);
+			qdsSaveUint(w, data->combo);
+			return 0;
+		}
+		case QDS_LOADSTATE: {
+			qdsSaveReader *r = argp;
+			standardData loaded = *data;
+			qdsLoadRulesetState(r, &loaded.baseState);
+			qdsLoadInputState(r, &loaded.inputState);
+			qdsBagLoad(&loaded.gen, r);
+			loaded.time = qdsLoadRange(r, UINT_MAX);
+			loaded.lines = qdsLoadRange(r, UINT_MAX);
+			loaded.score = qdsLoadRange(r, UINT_MAX);
+			loaded.combo = qdsLoadRange(r, UINT_MAX);
+			if (r->error) return -EINVAL;
+			*data = loaded;
+			return 0;
+		}
+		case QDS_SETSEED:
+			qdsBagInit(&data->gen, *(unsigned int *)argp);
+			return 0;
 		case QDS_GETNEXTCOUNT:
 			*(int *)argp = 7;
 			return 0;
@@ -390,7 +586,10 @@ QDS_API const qdsRuleset qdsRulesetStandard = {
 	.getPiece = peekNext,
 	.shiftPiece = drawNext,
 	.getShape = getShape,
+	.getShapeMask = getShapeMask,
 	.canRotate = canRotate,
+	.getKicks = getKicks,
+	.canRotatePosition = canRotatePosition,
 	.doGameCycle = gameCycle,
 	.events = {
 		.onSpawn = onSpawn,
@@ -0,0 +1,508 @@
+/*
+ * Copyright (c) 2023 McEndu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "rulesets/arcade.h"
+#include "rulesets/cycle.h"
+#include "rulesets/tgm.h"
+#include <config.h>
+#include <quadus.h>
+#include <quadus/calls.h>
+#include <quadus/mode.h>
+#include <quadus/piece.h>
+#include <quadus/piecegen/his.h>
+#include <quadus/position.h>
+#include <quadus/ruleset.h>
+#include <quadus/ruleset/hash.h>
+#include <quadus/ruleset/input.h>
+#include <quadus/ruleset/linequeue.h>
+#include <quadus/ruleset/mask.h>
+#include <quadus/ruleset/save.h>
+#include <quadus/ruleset/utils.h>
+
+#include <errno.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define KEND                 \
+	{                        \
+		SCHAR_MAX, SCHAR_MAX \
+	}
+
+#define DEFAULT_LOCKTIME 30
+
+/*
+ * Passed to the inline utilities to specialize them for this ruleset;
+ * see standard.c for QDS_GENERIC_CYCLE.
+ */
+#ifdef QDS_GENERIC_CYCLE
+#define RS (game->rs)
+#else
+#define RS (&qdsRulesetTgm)
+#endif
+
+/*
+ * Kicks are tried in order; the first offset that fits wins. Unlike
+ * the arcade ruleset, the right kick always goes first regardless of
+ * rotation direction, and the I piece never kicks.
+ */
+static const qdsCoords kicksNormal[] = { { 0, 0 }, { +1, 0 }, { -1, 0 }, KEND };
+static const qdsCoords kicksNone[] = { { 0, 0 }, KEND };
+
+static const struct pieceData
+{
+	const qdsPiecedef *shape;
+	const qdsCoords *kicks;
+	bool centerColumn;
+} pieces[] = {
+	[QDS_PIECE_NONE] = { &qdsPieceNone, kicksNone, false },
+	[QDS_PIECE_I] = { &RSSYM(pieceI), kicksNone, false },
+	[QDS_PIECE_J] = { &RSSYM(pieceJ), kicksNormal, true },
+	[QDS_PIECE_L] = { &RSSYM(pieceL), kicksNormal, true },
+	[QDS_PIECE_O] = { &RSSYM(pieceO), kicksNone, false },
+	[QDS_PIECE_S] = { &RSSYM(pieceS), kicksNormal, false },
+	[QDS_PIECE_T] = { &RSSYM(pieceT), kicksNormal, true },
+	[QDS_PIECE_Z] = { &RSSYM(pieceZ), kicksNormal, false },
+};
+
+/*
+ * Collision masks of the arcade piece shapes, in the format of
+ * { left, bottom, width, height, { rows from bottom up } }.
+ */
+static const qdsShapeMask masks[8][4] = {
+	[QDS_PIECE_NONE] = { { 0 } },
+	[QDS_PIECE_I] = {
+		{ -1, 0, 4, 1, { 0xf } },
+		{ 1, -2, 1, 4, { 0x1, 0x1, 0x1, 0x1 } },
+		{ -1, 0, 4, 1, { 0xf } },
+		{ 0, -2, 1, 4, { 0x1, 0x1, 0x1, 0x1 } },
+	},
+	[QDS_PIECE_J] = {
+		{ -1, 0, 3, 2, { 0x4, 0x7 } },
+		{ -1, 0, 2, 3, { 0x3, 0x2, 0x2 } },
+		{ -1, 0, 3, 2, { 0x7, 0x1 } },
+		{ 0, 0, 2, 3, { 0x1, 0x1, 0x3 } },
+	},
+	[QDS_PIECE_L] = {
+		{ -1, 0, 3, 2, { 0x1, 0x7 } },
+		{ -1, 0, 2, 3, { 0x2, 0x2, 0x3 } },
+		{ -1, 0, 3, 2, { 0x7, 0x4 } },
+		{ 0, 0, 2, 3, { 0x3, 0x1, 0x1 } },
+	},
+	[QDS_PIECE_O] = {
+		{ 0, 0, 2, 2, { 0x3, 0x3 } },
+		{ 0, 0, 2, 2, { 0x3, 0x3 } },
+		{ 0, 0, 2, 2, { 0x3, 0x3 } },
+		{ 0, 0, 2, 2, { 0x3, 0x3 } },
+	},
+	[QDS_PIECE_S] = {
+		{ -1, 0, 3, 2, { 0x3, 0x6 } },
+		{ -1, 0, 2, 3, { 0x2, 0x3, 0x1 } },
+		{ -1, 0, 3, 2, { 0x3, 0x6 } },
+		{ 0, 0, 2, 3, { 0x2, 0x3, 0x1 } },
+	},
+	[QDS_PIECE_T] = {
+		{ -1, 0, 3, 2, { 0x2, 0x7 } },
+		{ -1, 0, 2, 3, { 0x2, 0x3, 0x2 } },
+		{ -1, 0, 3, 2, { 0x7, 0x2 } },
+		{ 0, 0, 2, 3, { 0x1, 0x3, 0x1 } },
+	},
+	[QDS_PIECE_Z] = {
+		{ -1, 0, 3, 2, { 0x6, 0x3 } },
+		{ -1, 0, 2, 3, { 0x1, 0x3, 0x2 } },
+		{ -1, 0, 3, 2, { 0x6, 0x3 } },
+		{ 0, 0, 2, 3, { 0x1, 0x3, 0x2 } },
+	},
+};
+
+static void *init(void)
+{
+	tgmData *data = malloc(sizeof(tgmData));
+	if (!data) return NULL;
+
+	qdsInitRulesetState(&data->baseState);
+
+	data->score = 0;
+	data->combo = 1;
+	data->softDistance = 0;
+
+	data->inputState.lastInput = 0;
+	data->inputState.direction = 0;
+
+	qdsHisInit(&data->gen, time(NULL));
+
+	return data;
+}
+
+static const qdsCoords *getShape(int type, int orientation)
+{
+	type %= 8;
+	return ((const qdsCoords **)(pieces[type].shape))[orientation];
+}
+
+static const qdsShapeMask *getShapeMask(int type, int orientation)
+{
+	return &masks[type % 8][orientation % 4];
+}
+
+/**
+ * Get tiles x - 1 to x + 1 of a line as a 3-bit mask, counting walls
+ * as filled.
+ */
+static unsigned int centerBox(const qdsGame *game, int x, int y)
+{
+	if (y < 0 || y >= game->rows || x < 0) return 7;
+
+#ifdef QDS_REFERENCE
+	unsigned int box = 0;
+	for (int i = 0; i < 3; ++i) {
+		int tx = x - 1 + i;
+		if (tx < 0 || tx >= game->width || game->playfield[y][tx])
+			box |= 1 << i;
+	}
+	return box;
+#endif
+
+	/* column n is at bit n + 1; everything outside the field is wall */
+	uint_fast32_t line = qdsGetLineMask(game->playfield[y]) << 1;
+	line |= ~(uint_fast32_t)(qdsFullRowMask(game->width) << 1);
+	return (line >> x) & 7;
+}
+
+/**
+ * Check the center-column rule: J, L and T cannot kick if the first
+ * tile found in the 3x3 box around the piece, read from the top left,
+ * is in the center column.
+ */
+static bool centerColumnBlocked(const qdsGame *game, int x, int y)
+{
+	for (int dy = 2; dy >= 0; --dy) {
+		unsigned int box = centerBox(game, x, y + dy);
+		if (box) return (box & 3) == 2;
+	}
+	return false;
+}
+
+static int canRotate(qdsGame *restrict game,
+					 int rotation,
+					 int *restrict x,
+					 int *restrict y)
+{
+	if (rotation == 0) return QDS_ROTATE_FAILED;
+	rotation = rotation > 0 ? 1 : -1;
+
+	int piece = qdsGetActivePieceType(game) % 8;
+	const struct pieceData *def = &pieces[piece];
+#ifndef QDS_REFERENCE
+	int orientation = (qdsGetActiveOrientation(game) + rotation) & 3;
+	const qdsShapeMask *mask = &masks[piece][orientation];
+#endif
+
+	int cx, cy;
+	qdsGetActivePosition(game, &cx, &cy);
+
+	QDS_SHAPE_FOREACH (k, def->kicks) {
+		/* checked once rotating in place has failed */
+		if (k == def->kicks + 1 && def->centerColumn
+			&& centerColumnBlocked(game, cx, cy))
+			return QDS_ROTATE_FAILED;
+
+#ifdef QDS_REFERENCE
+		bool fits = qdsInlineCanRotate(game, RS, k->x, k->y, rotation);
+#else
+		bool fits = qdsInlineFieldFits(game, mask, cx + k->x, cy + k->y);
+#endif
+		if (fits) {
+			*x = k->x;
+			*y = k->y;
+			return QDS_ROTATE_NORMAL;
+		}
+	}
+
+	return QDS_ROTATE_FAILED;
+}
+
+/**
+ * Check the center-column rule in a search position.
+ */
+static bool positionCenterColumnBlocked(const qdsPosition *pos, int x, int y)
+{
+	for (int dy = 2; dy >= 0; --dy) {
+		for (int dx = -1; dx <= 1; ++dx) {
+			if (qdsPositionGetTile(pos, x + dx, y + dy)) return dx == 0;
+		}
+	}
+	return false;
+}
+
+static int canRotatePosition(const qdsPosition *restrict pos,
+							 const qdsRuleset *restrict rs,
+							 int rotation,
+							 int *restrict x,
+							 int *restrict y)
+{
+	if (rotation == 0) return QDS_ROTATE_FAILED;
+	rotation = rotation > 0 ? 1 : -1;
+
+	int piece = pos->piece % 8;
+	const struct pieceData *def = &pieces[piece];
+	int orientation = (pos->orientation + rotation) & 3;
+
+	QDS_SHAPE_FOREACH (k, def->kicks) {
+		if (k == def->kicks + 1 && def->centerColumn
+			&& positionCenterColumnBlocked(pos, pos->x, pos->y))
+			return QDS_ROTATE_FAILED;
+
+		int kx = pos->x + k->x;
+		int ky = pos->y + k->y;
+		if (qdsPositionFits(pos, rs, piece, orientation, kx, ky)) {
+			*x = k->x;
+			*y = k->y;
+			return QDS_ROTATE_NORMAL;
+		}
+	}
+
+	return QDS_ROTATE_FAILED;
+}
+
+static void resetLock(tgmData *restrict data, qdsGame *restrict game)
+{
+	int lockTime;
+	if (qdsInlineCall(game, RS, QDS_GETLOCKTIME, &lockTime) < 0)
+		lockTime = DEFAULT_LOCKTIME;
+	data->baseState.lockTimer = lockTime;
+}
+
+static bool onSpawn(qdsGame *restrict game, int piece)
+{
+	tgmData *data = qdsGetRulesetData(game);
+	qdsHandleSpawn(&data->baseState);
+	resetLock(data, game);
+	data->softDistance = 0;
+	return true;
+}
+
+static void doGravity(tgmData *restrict data,
+					  qdsGame *restrict game,
+					  unsigned int input)
+{
+	/* sonic drop; the piece is left to lock on its own */
+	if (input & QDS_INPUT_HARD_DROP)
+		qdsInlineInstantDrop(game, RS, QDS_DROP_HARD);
+
+	if (qdsInlineGrounded(game, RS) && (input & QDS_INPUT_SOFT_DROP))
+		return qdsInlineProcessLock(&data->baseState, game, RS);
+
+	return qdsInlineProcessGravity(&data->baseState, game, RS, input);
+}
+
+static bool onDrop(qdsGame *game, int type, int dy)
+{
+	tgmData *data = qdsGetRulesetData(game);
+	if (dy > 0) {
+		/* lock delay only resets on stepping down */
+		resetLock(data, game);
+		if (type == QDS_DROP_SOFT) data->softDistance += dy;
+	}
+	return true;
+}
+
+static void addLockScore(qdsGame *restrict game)
+{
+	tgmData *restrict data = qdsGetRulesetData(game);
+	unsigned lockType = qdsCheckLockType(&data->baseState, game);
+	int lines = lockType & QDS_LINECLEAR_MAX;
+
+	if (lines == 0) {
+		/* break combo */
+		data->combo = 1;
+		return;
+	}
+
+	data->combo += 2 * lines - 2;
+
+	int level;
+	if (qdsInlineCall(game, RS, QDS_GETSUBLEVEL, &level) < 0) level = 1;
+
+	int score = (level + lines + 3) / 4 + data->softDistance;
+	score *= lines * data->combo;
+	if (lockType & QDS_LINECLEAR_ALLCLEAR) score *= 4;
+
+	data->score += score;
+}
+
+static void doActiveCycle(qdsRulesetState *restrict data,
+						  qdsGame *restrict game,
+						  unsigned int input)
+{
+	qdsInlineProcessRotation(data, game, RS, input);
+	qdsInlineProcessMovement(data, game, RS, input);
+	/* baseState is the first element of tgmData */
+	doGravity((tgmData *)data, game, input);
+}
+
+static void gameCycle(qdsGame *restrict game, unsigned int input)
+{
+	tgmData *data = qdsGetRulesetData(game);
+
+	unsigned int effective
+		= qdsFilterDirections(game, &data->inputState, input);
+
+	/* there is no hold in classic rules, including initial hold */
+	effective &= ~QDS_INPUT_HOLD;
+	qdsInlineRulesetCycle(&data->baseState, game, RS, doActiveCycle, effective);
+}
+
+static int spawnX(qdsGame *game)
+{
+	return (qdsGetFieldWidth(game) - 1) / 2;
+}
+
+static int spawnY(qdsGame *game)
+{
+	return qdsGetFieldRows(game) - QDS_HIDDEN_ROWS;
+}
+
+static int peekNext(void *data, int pos)
+{
+	return qdsHisPeek(&((tgmData *)data)->gen, pos);
+}
+
+static int drawNext(void *data)
+{
+	return qdsHisDraw(&((tgmData *)data)->gen);
+}
+
+static void onTopOut(qdsGame *restrict game)
+{
+	((tgmData *)qdsGetRulesetData(game))->baseState.status
+		= QDS_STATUS_GAMEOVER;
+}
+
+static void onLineFilled(qdsGame *restrict game, int y)
+{
+	tgmData *data = qdsGetRulesetData(game);
+	qdsQueueLine(&data->baseState.pendingLines, y);
+}
+
+static int getSoftDropGravity(qdsGame *game)
+{
+	int g;
+	if (qdsInlineCall(game, RS, QDS_GETGRAVITY, &g) < 0) g = 1092;
+	return g > 65536 ? g : 65536;
+}
+
+static int rulesetCall(qdsGame *restrict game, unsigned long call, void *argp)
+{
+	tgmData *data = qdsGetRulesetData(game);
+
+	switch (call) {
+		case QDS_GETRULESETNAME:
+			*(const char **)argp = "TGM";
+			return 0;
+		case QDS_GETSCORE:
+			*(unsigned int *)argp = data->score;
+			return 0;
+		case QDS_GETDAS:
+			*(int *)argp = 16;
+			return 0;
+		case QDS_GETARR:
+			*(int *)argp = 1;
+			return 0;
+		case QDS_GETARE:
+			*(unsigned int *)argp = 30;
+			return 0;
+		case QDS_GETLINEDELAY:
+			*(unsigned int *)argp = 41;
+			return 0;
+		case QDS_GETSDG:
+			*(int *)argp = getSoftDropGravity(game);
+			return 0;
+		case QDS_GETNEXTCOUNT:
+			*(int *)argp = 1;
+			return 0;
+		case QDS_CANHOLD:
+			return false;
+		case QDS_GETSTATEHASH: {
+			uint64_t h = qdsHashRulesetState(&data->baseState);
+			h = qdsHashInputState(h, &data->inputState);
+			/* the generator is idle while the mode deals pieces */
+			if (!qdsGetMode(game) || !qdsGetMode(game)->getPiece)
+				h = qdsHashAdd(h, data->gen.rng);
+			h = qdsHashAdd(h, data->score | (uint64_t)data->combo << 32);
+			h = qdsHashAdd(h, data->softDistance);
+			*(uint64_t *)argp = h;
+			return 0;
+		}
+		case QDS_SAVESTATE: {
+			qdsSaveWriter *w = argp;
+			qdsSaveRulesetState(w, &data->baseState);
+			qdsSaveInputState(w, &data->inputState);
+			qdsHisSave(&data->gen, w);
+			qdsSaveUint(w, data->score);
+			qdsSaveUint(w, data->combo);
+			qdsSaveUint(w, data->softDistance);
+			return 0;
+		}
+		case QDS_LOADSTATE: {
+			qdsSaveReader *r = argp;
+			tgmData loaded = *data;
+			qdsLoadRulesetState(r, &loaded.baseState);
+			qdsLoadInputState(r, &loaded.inputState);
+			qdsHisLoad(&loaded.gen, r);
+			loaded.score = qdsLoadRange(r, UINT_MAX);
+			loaded.combo = qdsLoadRange(r, UINT_MAX);
+			loaded.softDistance = qdsLoadRange(r, USHRT_MAX);
+			if (r->error) return -EINVAL;
+			*data = loaded;
+			return 0;
+		}
+		case QDS_SETSEED:
+			qdsHisInit(&data->gen, *(unsigned int *)argp);
+			return 0;
+		default:
+			return qdsUtilCallHandler(&data->baseState, game, call, argp);
+	}
+}
+
+QDS_API const qdsRuleset qdsRulesetTgm = {
+	.init = init,
+	.destroy = free,
+	.spawnX = spawnX,
+	.spawnY = spawnY,
+	.getPiece = peekNext,
+	.shiftPiece = drawNext,
+	.getShape = getShape,
+	.getShapeMask = getShapeMask,
+	.canRotate = canRotate,
+	.canRotatePosition = canRotatePosition,
+	.doGameCycle = gameCycle,
+	.events = {
+		.onSpawn = onSpawn,
+		.onDrop = onDrop,
+		.onLineFilled = onLineFilled,
+		.postLock = addLockScore,
+		.onTopOut = onTopOut,
+	},
+	.call = rulesetCall,
+};
@@ -0,0 +1,685 @@
+/*
+ * Copyright (c) 2023 McEndu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <quadus.h>
+#include <quadus/piece.h>
+#include <quadus/position.h>
+#include <quadus/ruleset.h>
+#include <quadus/ruleset/mask.h>
+#include <quadus/search.h>
+
+#include <assert.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/*
+ * The playfield is kept as a bitboard, with tile (x, y) at bit
+ * y * 10 + x. QDS_ALLCLEAR_MAX_LINES rows fit in 64 bits.
+ */
+typedef uint64_t board;
+
+#define ROW(b, y) ((unsigned)((b) >> (10 * (y))) & QDS_POSITION_FULL_ROW)
+
+/* rows a piece moves through: the playfield, and room above it */
+#define MOVE_ROWS (QDS_ALLCLEAR_MAX_LINES + 4)
+#define MAX_KICKS 16
+
+/* size of the table of positions known to lead nowhere, per thread */
+#define DEAD_BITS 15
+/* number of positions generated between updates to the shared count */
+#define NODE_BATCH 256
+
+struct kick
+{
+	signed char x;
+	signed char y;
+};
+
+/**
+ * Shapes and kicks of a piece. Locations are those of the bottom left
+ * corner of its mask rather than of the piece.
+ */
+struct piece
+{
+	qdsShapeMask masks[4];
+	/* kicks for rotating right, then left, from each orientation */
+	struct kick kicks[4][2][MAX_KICKS];
+	int kickCount[4][2];
+};
+
+/**
+ * A position in the search: the playfield, the number of rows it may
+ * take, and the pieces left.
+ */
+struct state
+{
+	board field;
+	int lines;
+	int piece;
+	int hold;
+	/* index of the next piece in the queue */
+	int next;
+	bool held;
+};
+
+struct move
+{
+	board footprint;
+	qdsPlacement placement;
+};
+
+struct shared
+{
+	struct piece pieces[8];
+	unsigned char queue[QDS_POSITION_QUEUE];
+	int queueLength;
+	unsigned long nodeLimit;
+
+	/* placements of the first piece; holding comes after not holding */
+	struct move roots[2 * QDS_MAX_PLACEMENTS];
+	struct state after[2 * QDS_MAX_PLACEMENTS];
+	int rootCount;
+
+	atomic_int next;
+	/* lowest first placement an all clear is known for */
+	atomic_int best;
+	atomic_ulong nodes;
+	atomic_bool stop;
+};
+
+struct entry
+{
+	board field;
+	/* the rest of the state, with bit 31 set in used entries */
+	uint32_t rest;
+};
+
+struct worker
+{
+	struct shared *shared;
+	struct entry *dead;
+
+	qdsPlacement path[QDS_ALLCLEAR_MAX_PIECES];
+	int length;
+	int root;
+	unsigned long nodes;
+
+	/* lowest first placement this worker found an all clear for */
+	int found;
+	qdsPlacement solution[QDS_ALLCLEAR_MAX_PIECES];
+	int count;
+};
+
+static void loadPiece(struct piece *p, const qdsRuleset *rs, int type)
+{
+	static const qdsCoords noKicks[] = { { 0, 0 }, { SCHAR_MAX, SCHAR_MAX } };
+
+	for (int o = 0; o < 4; ++o) {
+		if (rs->getShapeMask)
+			p->masks[o] = *rs->getShapeMask(type, o);
+		else
+			qdsBuildShapeMask(&p->masks[o], rs->getShape(type, o));
+	}
+
+	for (int o = 0; o < 4; ++o) {
+		for (int r = 0; r < 2; ++r) {
+			int rotation = r ? -1 : 1;
+			const qdsShapeMask *from = &p->masks[o];
+			const qdsShapeMask *to = &p->masks[(o + rotation) & 3];
+			const qdsCoords *kicks = noKicks;
+			if (rs->getKicks) kicks = rs->getKicks(type, o, rotation);
+
+			int n = 0;
+			QDS_SHAPE_FOREACH (k, kicks) {
+				if (n == MAX_KICKS) break;
+				p->kicks[o][r][n].x = k->x - from->left + to->left;
+				p->kicks[o][r][n].y = k->y - from->bottom + to->bottom;
+				n += 1;
+			}
+			p->kickCount[o][r] = n;
+		}
+	}
+}
+
+static int height(board field)
+{
+	int h = 0;
+	while (field >> (10 * h)) ++h;
+	return h;
+}
+
+static unsigned shiftX(unsigned set, int dx)
+{
+	return dx >= 0 ? set << dx : set >> -dx;
+}
+
+/**
+ * Find the places a mask fits in each row, as bitmasks of x.
+ */
+static void findFits(board field,
+					 const qdsShapeMask *mask,
+					 unsigned fits[MOVE_ROWS])
+{
+	unsigned walls = (1u << (11 - mask->width)) - 1;
+	for (int y = 0; y < MOVE_ROWS; ++y) {
+		unsigned collide = 0;
+		for (int i = 0; i < mask->height; ++i) {
+			if (y + i >= QDS_ALLCLEAR_MAX_LINES) break;
+			unsigned row = ROW(field, y + i);
+			for (unsigned m = mask->rows[i]; m; m &= m - 1)
+				collide |= row >> __builtin_ctz(m);
+		}
+		fits[y] = walls & ~collide;
+	}
+}
+
+/**
+ * Find every placement of a piece within a number of rows. The piece
+ * can get anywhere above the stack; from there, moves are followed a
+ * row at a time for all rows and orientations at once.
+ */
+static int findMoves(const struct piece *p,
+					 int type,
+					 board field,
+					 int lines,
+					 struct move *out)
+{
+	unsigned fits[4][MOVE_ROWS];
+	unsigned reach[4][MOVE_ROWS];
+	int top = height(field);
+
+	for (int o = 0; o < 4; ++o) {
+		findFits(field, &p->masks[o], fits[o]);
+		for (int y = 0; y < MOVE_ROWS; ++y)
+			reach[o][y] = y >= top ? fits[o][y] : 0;
+	}
+
+	bool changed = true;
+	while (changed) {
+		changed = false;
+		for (int o = 0; o < 4; ++o) {
+			for (int y = MOVE_ROWS - 1; y >= 0; --y) {
+				unsigned set = reach[o][y];
+				/* sideways */
+				for (;;) {
+					unsigned grown = set | ((set << 1 | set >> 1) & fits[o][y]);
+					if (grown == set) break;
+					set = grown;
+				}
+				/* down */
+				if (y > 0) {
+					unsigned down = set & fits[o][y - 1];
+					if (down & ~reach[o][y - 1]) {
+						reach[o][y - 1] |= down;
+						changed = true;
+					}
+				}
+				if (set != reach[o][y]) changed = true;
+				reach[o][y] = set;
+
+				/* rotations, trying kicks in order */
+				for (int r = 0; r < 2; ++r) {
+					int to = (o + (r ? -1 : 1)) & 3;
+					unsigned left = set;
+					for (int i = 0; i < p->kickCount[o][r] && left; ++i) {
+						struct kick k = p->kicks[o][r][i];
+						int ty = y + k.y;
+						if (ty < 0) continue;
+						unsigned walls = (1u << (11 - p->masks[to].width)) - 1;
+						unsigned room = ty < MOVE_ROWS ? fits[to][ty] : walls;
+						unsigned moved = shiftX(left, k.x) & room;
+						left &= ~shiftX(moved, -k.x);
+						if (ty >= MOVE_ROWS) continue;
+						if (moved & ~reach[to][ty]) {
+							reach[to][ty] |= moved;
+							changed = true;
+						}
+					}
+				}
+			}
+		}
+	}
+
+	int count = 0;
+	for (int y = 0; y < lines; ++y) {
+		for (int o = 0; o < 4; ++o) {
+			const qdsShapeMask *mask = &p->masks[o];
+			if (y + mask->height > lines) continue;
+			unsigned grounded = reach[o][y] & ~(y > 0 ? fits[o][y - 1] : 0);
+			for (; grounded; grounded &= grounded - 1) {
+				int x = __builtin_ctz(grounded);
+				board footprint = 0;
+				for (int i = 0; i < mask->height; ++i)
+					footprint |= (board)mask->rows[i] << (10 * (y + i) + x);
+
+				bool duplicate = false;
+				for (int j = 0; j < count && !duplicate; ++j)
+					duplicate = out[j].footprint == footprint;
+				if (duplicate) continue;
+
+				out[count].footprint = footprint;
+				out[count].placement = (qdsPlacement){
+					.x = x - mask->left,
+					.y = y - mask->bottom,
+					.piece = type,
+					.orientation = o,
+				};
+				count += 1;
+			}
+		}
+	}
+	return count;
+}
+
+/**
+ * Clear filled rows. Returns the number of rows cleared.
+ */
+static int clearLines(board *field, int lines)
+{
+	board result = 0;
+	int kept = 0;
+	for (int y = 0; y < lines; ++y) {
+		board row = ROW(*field, y);
+		if (row == QDS_POSITION_FULL_ROW) continue;
+		result |= row << (10 * kept++);
+	}
+	*field = result;
+	return lines - kept;
+}
+
+static int piecesLeft(const struct shared *s, const struct state *st)
+{
+	return (st->piece != QDS_PIECE_NONE) + (st->hold != QDS_PIECE_NONE)
+		   + s->queueLength - st->next;
+}
+
+/* bitboards of the rows below a height, and of the tiles in column 0 */
+static board rowsBelow(int lines)
+{
+	return ((board)1 << (10 * lines)) - 1;
+}
+
+static board columnMask(int lines)
+{
+	board column = 0;
+	for (int y = 0; y < lines; ++y) column |= (board)1 << (10 * y);
+	return column;
+}
+
+/**
+ * Check if empty tiles can be split into pieces. A piece covers tiles
+ * next to each other in a row, or in a column once the rows between
+ * have been cleared; tiles that cannot be joined either way must be
+ * filled by different pieces.
+ */
+static bool canSplit(board empty, int lines)
+{
+	board column = columnMask(lines);
+	board notLeft = ~(column * 0x001), notRight = ~(column * 0x200);
+
+	while (empty) {
+		board part = empty & -empty, grown;
+		for (;;) {
+			grown = part | (part << 1 & notLeft) | (part >> 1 & notRight);
+			/* spread through columns */
+			unsigned columns = 0;
+			for (int y = 0; y < lines; ++y) columns |= ROW(grown, y);
+			grown = (grown | column * columns) & empty;
+			if (grown == part) break;
+			part = grown;
+		}
+		if (__builtin_popcountll(part) % 4 != 0) return false;
+		empty &= ~part;
+	}
+	return true;
+}
+
+/**
+ * Check if pieces can fill empty tiles in even and odd columns in the
+ * right proportion, which line clears do not change. Counting tiles
+ * in even columns less those in odd ones, an I piece adds 0 or 4, a
+ * J or L piece 2 and a T piece 0 or 2, either way; the others add 0.
+ */
+static bool canBalance(const struct shared *s,
+					   const struct state *st,
+					   int lines,
+					   int pieces)
+{
+	board even = columnMask(lines) * 0x155 & rowsBelow(lines);
+	board empty = ~st->field & rowsBelow(lines);
+	int balance = __builtin_popcountll(empty & even)
+				  - __builtin_popcountll(empty & ~even);
+	if (balance < 0) balance = -balance;
+
+	int counts[8] = { 0 };
+	counts[st->piece] += 1;
+	counts[st->hold] += 1;
+	for (int i = st->next; i < s->queueLength; ++i) counts[s->queue[i]] += 1;
+	int other = counts[QDS_PIECE_O] + counts[QDS_PIECE_S] + counts[QDS_PIECE_Z];
+	int jl = counts[QDS_PIECE_J] + counts[QDS_PIECE_L];
+
+	/* any of the pieces left may be the ones used */
+	for (int i = 0; i <= counts[QDS_PIECE_I] && i <= pieces; ++i) {
+		for (int t = 0; t <= counts[QDS_PIECE_T] && i + t <= pieces; ++t) {
+			for (int j = 0; j <= jl && i + t + j <= pieces; ++j) {
+				if (i + t + j + other < pieces) continue;
+				if (balance > 4 * i + 2 * j + 2 * t) continue;
+				if (t > 0 || (balance - 2 * j) % 4 == 0) return true;
+			}
+		}
+	}
+	return false;
+}
+
+/**
+ * Check if the tiles left to fill can add up to whole rows. Every
+ * piece fills 4 tiles, so only heights with a multiple of 4 empty
+ * tiles below them and few enough of those for the pieces left are
+ * possible.
+ */
+static bool canClear(const struct shared *s, const struct state *st)
+{
+	int filled = __builtin_popcountll(st->field);
+	int top = height(st->field);
+	int pieces = piecesLeft(s, st);
+
+	for (int h = top; h <= st->lines; ++h) {
+		int empty = h * 10 - filled;
+		if (empty % 4 != 0) continue;
+		if (empty > 4 * pieces) return false;
+		/* above the stack, every column joins every other */
+		if (h == top && !canSplit(~st->field & rowsBelow(h), h)) continue;
+		if (canBalance(s, st, h, empty / 4)) return true;
+	}
+	return false;
+}
+
+static uint32_t packRest(const struct state *st)
+{
+	return 1u << 31 | st->lines | st->piece << 4 | st->hold << 8
+		   | st->next << 12 | st->held << 16;
+}
+
+static uint64_t entryIndex(const struct state *st)
+{
+	uint64_t h = st->field ^ (uint64_t)packRest(st) << 40;
+	h ^= h >> 31;
+	h *= UINT64_C(0x7fb5d329728ea185);
+	h ^= h >> 27;
+	return h & (((uint64_t)1 << DEAD_BITS) - 1);
+}
+
+static bool outOfBudget(struct worker *w)
+{
+	struct shared *s = w->shared;
+	if (++w->nodes % NODE_BATCH == 0) {
+		unsigned long total = atomic_fetch_add(&s->nodes, NODE_BATCH);
+		if (s->nodeLimit && total + NODE_BATCH >= s->nodeLimit)
+			atomic_store(&s->stop, true);
+	}
+	if (atomic_load_explicit(&s->stop, memory_order_relaxed)) return true;
+	/* an all clear following an earlier first placement wins anyway */
+	return atomic_load_explicit(&s->best, memory_order_relaxed) < w->root;
+}
+
+/**
+ * Find the pieces left after placing one, with or without holding.
+ * Returns the piece placed, or QDS_PIECE_NONE if there is none.
+ */
+static int takePiece(const struct shared *s,
+					 const struct state *st,
+					 bool hold,
+					 struct state *next)
+{
+	*next = *st;
+	next->held = false;
+	int piece = st->piece;
+
+	if (hold) {
+		if (st->held) return QDS_PIECE_NONE;
+		if (st->hold != QDS_PIECE_NONE) {
+			piece = st->hold;
+		} else {
+			if (st->next >= s->queueLength) return QDS_PIECE_NONE;
+			piece = s->queue[next->next++];
+		}
+		/* holding the same piece changes nothing */
+		if (piece == st->piece) return QDS_PIECE_NONE;
+		next->hold = st->piece;
+	}
+
+	next->piece = QDS_PIECE_NONE;
+	if (next->next < s->queueLength) next->piece = s->queue[next->next++];
+	return piece;
+}
+
+/**
+ * Find the placements of the next piece, with or without holding.
+ */
+static int findChildren(const struct shared *s,
+						const struct state *st,
+						bool hold,
+						struct move *moves,
+						struct state *next)
+{
+	int piece = takePiece(s, st, hold, next);
+	if (piece == QDS_PIECE_NONE || piece >= 8) return 0;
+	const struct piece *p = &s->pieces[piece];
+	int count = findMoves(p, piece, st->field, st->lines, moves);
+	for (int i = 0; i < count; ++i) moves[i].placement.hold = hold;
+	return count;
+}
+
+static void applyMove(struct state *st, const struct move *m)
+{
+	st->field |= m->footprint;
+	st->lines -= clearLines(&st->field, st->lines);
+}
+
+enum result
+{
+	NONE,
+	FOUND,
+	STOPPED,
+};
+
+/**
+ * Search for an all clear from a position whose last piece has just
+ * locked.
+ */
+static enum result solve(struct worker *w, const struct state *st, int depth)
+{
+	struct shared *s = w->shared;
+	if (depth >= QDS_ALLCLEAR_MAX_PIECES) return NONE;
+	if (!canClear(s, st)) return NONE;
+
+	uint32_t rest = packRest(st);
+	struct entry *dead = &w->dead[entryIndex(st)];
+	if (dead->rest == rest && dead->field == st->field) return NONE;
+
+	for (int hold = 0; hold <= 1; ++hold) {
+		struct move moves[QDS_MAX_PLACEMENTS];
+		struct state base;
+		int count = findChildren(s, st, hold, moves, &base);
+
+		for (int i = 0; i < count; ++i) {
+			if (outOfBudget(w)) return STOPPED;
+
+			struct state next = base;
+			applyMove(&next, &moves[i]);
+			w->path[depth] = moves[i].placement;
+			w->length = depth + 1;
+			if (next.field == 0) return FOUND;
+
+			enum result r = solve(w, &next, depth + 1);
+			if (r != NONE) return r;
+		}
+	}
+
+	/* only finished searches tell anything about the position */
+	dead->field = st->field;
+	dead->rest = rest;
+	return NONE;
+}
+
+static void lowerBest(struct shared *s, int root)
+{
+	int best = atomic_load(&s->best);
+	while (root < best && !atomic_compare_exchange_weak(&s->best, &best, root))
+		;
+}
+
+static void *work(void *arg)
+{
+	struct worker *w = arg;
+	struct shared *s = w->shared;
+
+	for (;;) {
+		int root = atomic_fetch_add(&s->next, 1);
+		if (root >= s->rootCount || root > atomic_load(&s->best)) break;
+
+		w->root = root;
+		w->path[0] = s->roots[root].placement;
+		w->length = 1;
+		const struct state *st = &s->after[root];
+		enum result r = st->field == 0 ? FOUND : solve(w, st, 1);
+
+		if (r == FOUND) {
+			/* roots are taken in order, so the first found is the lowest */
+			w->found = root;
+			w->count = w->length;
+			memcpy(w->solution, w->path, w->length * sizeof(qdsPlacement));
+			lowerBest(s, root);
+			break;
+		}
+		if (r == STOPPED && atomic_load(&s->stop)) break;
+	}
+
+	atomic_fetch_add(&s->nodes, w->nodes % NODE_BATCH);
+	return NULL;
+}
+
+static int threadCount(const qdsAllClearLimits *limits, int roots)
+{
+	long threads = limits->threads;
+	if (threads <= 0) threads = sysconf(_SC_NPROCESSORS_ONLN);
+	if (threads > roots) threads = roots;
+	return threads > 0 ? threads : 1;
+}
+
+QDS_API bool qdsFindAllClear(const qdsPosition *pos,
+							 const qdsRuleset *rs,
+							 const qdsAllClearLimits *limits,
+							 qdsAllClear *solution)
+{
+	assert((pos != NULL));
+	assert((rs != NULL));
+	assert((limits != NULL));
+	assert((solution != NULL));
+
+	solution->count = 0;
+	solution->nodes = 0;
+	int lines = limits->lines;
+	if (lines > QDS_ALLCLEAR_MAX_LINES) lines = QDS_ALLCLEAR_MAX_LINES;
+	if (pos->height > lines || pos->piece == QDS_PIECE_NONE) return false;
+
+	struct shared *s = malloc(sizeof(struct shared));
+	if (!s) return false;
+	for (int i = QDS_PIECE_I; i <= QDS_PIECE_Z; ++i)
+		loadPiece(&s->pieces[i], rs, i);
+	memcpy(s->queue, pos->queue, pos->queueLength);
+	s->queueLength = pos->queueLength;
+	s->nodeLimit = limits->nodes;
+	atomic_init(&s->next, 0);
+	atomic_init(&s->best, INT_MAX);
+	atomic_init(&s->nodes, 0);
+	atomic_init(&s->stop, false);
+
+	struct state start = {
+		.lines = lines,
+		.piece = pos->piece,
+		.hold = pos->hold,
+		.held = pos->held,
+	};
+	for (int y = 0; y < pos->height; ++y)
+		start.field |= (board)pos->rows[y] << (10 * y);
+
+	s->rootCount = 0;
+	for (int hold = 0; hold <= 1; ++hold) {
+		struct state base;
+		struct move *moves = &s->roots[s->rootCount];
+		int count = findChildren(s, &start, hold, moves, &base);
+		for (int i = 0; i < count; ++i) {
+			s->after[s->rootCount + i] = base;
+			applyMove(&s->after[s->rootCount + i], &moves[i]);
+		}
+		s->rootCount += count;
+	}
+	atomic_store(&s->nodes, s->rootCount);
+
+	int threads = threadCount(limits, s->rootCount);
+	struct worker *workers = calloc(threads, sizeof(struct worker));
+	pthread_t *ids = calloc(threads, sizeof(pthread_t));
+	if (!workers || !ids) threads = 0;
+
+	int started = 0;
+	for (int i = 0; i < threads; ++i) {
+		workers[i].shared = s;
+		workers[i].found = INT_MAX;
+		workers[i].dead = calloc((size_t)1 << DEAD_BITS, sizeof(struct entry));
+		if (!workers[i].dead) break;
+		/* the calling thread is the first worker */
+		if (i > 0 && pthread_create(&ids[i], NULL, work, &workers[i])) {
+			free(workers[i].dead);
+			break;
+		}
+		started += 1;
+	}
+	if (started > 0) work(&workers[0]);
+
+	struct worker *best = NULL;
+	for (int i = 0; i < started; ++i) {
+		if (i > 0) pthread_join(ids[i], NULL);
+		if (workers[i].found < (best ? best->found : INT_MAX))
+			best = &workers[i];
+		free(workers[i].dead);
+	}
+
+	if (best) {
+		solution->count = best->count;
+		memcpy(solution->placements,
+			   best->solution,
+			   best->count * sizeof(qdsPlacement));
+	}
+	solution->nodes = atomic_load(&s->nodes);
+
+	free(ids);
+	free(workers);
+	free(s);
+	return best != NULL;
+}
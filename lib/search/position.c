@@ -0,0 +1,501 @@
+/*
+ * Copyright (c) 2023 McEndu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "game.h"
+#include <quadus.h>
+#include <quadus/calls.h>
+#include <quadus/piece.h>
+#include <quadus/position.h>
+#include <quadus/ruleset.h>
+#include <quadus/ruleset/hash.h>
+#include <quadus/ruleset/mask.h>
+
+#include <assert.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#define KEND                 \
+	{                        \
+		SCHAR_MAX, SCHAR_MAX \
+	}
+
+static const qdsCoords noKicks[] = { { 0, 0 }, KEND };
+
+/**
+ * Get the mask of a piece, building it into buf if the ruleset does
+ * not provide masks.
+ */
+static const qdsShapeMask *getMask(const qdsRuleset *rs,
+								   int piece,
+								   int orientation,
+								   qdsShapeMask *buf)
+{
+	if (rs->getShapeMask) return rs->getShapeMask(piece, orientation);
+	qdsBuildShapeMask(buf, rs->getShape(piece, orientation));
+	return buf;
+}
+
+static bool maskFits(const qdsPosition *pos,
+					 const qdsShapeMask *mask,
+					 int x,
+					 int y)
+{
+	if (mask->height == 0) return true;
+
+	x += mask->left;
+	y += mask->bottom;
+	if (x < 0 || x + mask->width > 10) return false;
+	if (y < 0 || y + mask->height > 48) return false;
+
+	for (int i = 0; i < mask->height; ++i) {
+		if (pos->rows[y + i] & (mask->rows[i] << x)) return false;
+	}
+
+	return true;
+}
+
+QDS_API bool qdsPositionFromGame(qdsPosition *pos, qdsGame *game)
+{
+	assert((pos != NULL));
+	assert((game != NULL));
+	assert((game->rs != NULL));
+	if (game->width != QDS_DEFAULT_WIDTH || game->rows != QDS_DEFAULT_ROWS)
+		return false;
+
+	for (int y = 0; y < 48; ++y)
+		pos->rows[y] = qdsGetLineMask(game->playfield[y]);
+	pos->height = game->height;
+
+	pos->x = game->x;
+	pos->y = game->y;
+	pos->piece = game->piece;
+	pos->orientation = game->orientation % 4;
+	pos->spawnX = game->rs->spawnX(game);
+	pos->spawnY = game->rs->spawnY(game);
+
+	pos->hold = game->hold;
+	pos->held = qdsCall(game, QDS_CANHOLD, NULL) == 0;
+
+	int count;
+	if (qdsCall(game, QDS_GETNEXTCOUNT, &count) < 0) count = 1;
+	if (count > QDS_POSITION_QUEUE) count = QDS_POSITION_QUEUE;
+	for (int i = 0; i < count; ++i) pos->queue[i] = qdsGetNextPiece(game, i);
+	pos->queueLength = count;
+
+	int combo;
+	if (qdsCall(game, QDS_GETCOMBO, &combo) < 0) combo = 0;
+	pos->twist = 0;
+	pos->b2b = false;
+	pos->combo = combo;
+	return true;
+}
+
+QDS_API bool qdsPositionToGame(const qdsPosition *pos, qdsGame *game)
+{
+	assert((pos != NULL));
+	assert((game != NULL));
+	if (game->width != QDS_DEFAULT_WIDTH || game->rows != QDS_DEFAULT_ROWS)
+		return false;
+
+	for (int y = 0; y < 48; ++y) {
+		for (int x = 0; x < 10; ++x) {
+			if (!((pos->rows[y] >> x) & 1))
+				game->playfield[y][x] = 0;
+			else if (!game->playfield[y][x])
+				game->playfield[y][x] = QDS_PIECE_GARBAGE;
+		}
+	}
+	game->height = pos->height;
+	qdsUpdateColumnHeights(game);
+	qdsUpdateFieldHash(game);
+
+	game->x = pos->x;
+	game->y = pos->y;
+	game->piece = pos->piece;
+	game->orientation = pos->orientation;
+	game->hold = pos->hold;
+	return true;
+}
+
+QDS_API bool qdsPositionGetTile(const qdsPosition *pos, int x, int y)
+{
+	if (x < 0 || x >= 10 || y < 0 || y >= 48) return true;
+	return (pos->rows[y] >> x) & 1;
+}
+
+QDS_API bool qdsPositionFits(const qdsPosition *pos,
+							 const qdsRuleset *rs,
+							 int piece,
+							 int orientation,
+							 int x,
+							 int y)
+{
+	qdsShapeMask buf;
+	return maskFits(pos, getMask(rs, piece, orientation, &buf), x, y);
+}
+
+QDS_API bool qdsPositionSpawn(qdsPosition *pos, const qdsRuleset *rs)
+{
+	int piece = QDS_PIECE_NONE;
+	if (pos->queueLength > 0) {
+		piece = pos->queue[0];
+		pos->queueLength -= 1;
+		memmove(pos->queue, pos->queue + 1, pos->queueLength);
+	}
+
+	pos->piece = piece;
+	pos->orientation = QDS_ORIENTATION_BASE;
+	pos->x = pos->spawnX;
+	pos->y = pos->spawnY;
+	pos->held = false;
+	pos->twist = 0;
+	return qdsPositionFits(pos, rs, piece, 0, pos->x, pos->y);
+}
+
+QDS_API bool qdsPositionHold(qdsPosition *pos, const qdsRuleset *rs)
+{
+	if (pos->held) return false;
+
+	int active = pos->piece;
+	if (pos->hold) {
+		pos->piece = pos->hold;
+		pos->orientation = QDS_ORIENTATION_BASE;
+		pos->x = pos->spawnX;
+		pos->y = pos->spawnY;
+		pos->twist = 0;
+	} else {
+		qdsPositionSpawn(pos, rs);
+	}
+
+	pos->hold = active;
+	pos->held = true;
+	return true;
+}
+
+QDS_API int qdsPositionMove(qdsPosition *pos, const qdsRuleset *rs, int offset)
+{
+	qdsShapeMask buf;
+	const qdsShapeMask *mask = getMask(rs, pos->piece, pos->orientation, &buf);
+	int step = offset < 0 ? -1 : 1;
+
+	int i;
+	for (i = 0; i != offset; i += step) {
+		if (!maskFits(pos, mask, pos->x + i + step, pos->y)) break;
+	}
+
+	pos->x += i;
+	if (i) pos->twist = 0;
+	return i;
+}
+
+/**
+ * Try the kicks from getKicks, for rulesets that cannot rotate
+ * positions themselves.
+ */
+static int kickPosition(const qdsPosition *pos,
+						const qdsRuleset *rs,
+						int rotation,
+						int *x,
+						int *y)
+{
+	int orientation = (pos->orientation + rotation) & 3;
+	qdsShapeMask buf;
+	const qdsShapeMask *mask = getMask(rs, pos->piece, orientation, &buf);
+
+	const qdsCoords *kicks = noKicks;
+	if (rs->getKicks)
+		kicks = rs->getKicks(pos->piece, pos->orientation, rotation);
+
+	QDS_SHAPE_FOREACH (k, kicks) {
+		if (!maskFits(pos, mask, pos->x + k->x, pos->y + k->y)) continue;
+
+		*x = k->x;
+		*y = k->y;
+		return QDS_ROTATE_NORMAL;
+	}
+
+	return QDS_ROTATE_FAILED;
+}
+
+QDS_API int qdsPositionRotate(qdsPosition *pos,
+							  const qdsRuleset *rs,
+							  int rotation)
+{
+	if (rotation == 0) return QDS_ROTATE_FAILED;
+	rotation = rotation > 0 ? 1 : -1;
+
+	int x, y, result;
+	if (rs->canRotatePosition)
+		result = rs->canRotatePosition(pos, rs, rotation, &x, &y);
+	else
+		result = kickPosition(pos, rs, rotation, &x, &y);
+	if (result == QDS_ROTATE_FAILED) return result;
+
+	pos->x += x;
+	pos->y += y;
+	pos->orientation = (pos->orientation + rotation) & 3;
+	pos->twist = result;
+	return result;
+}
+
+QDS_API int qdsPositionDrop(qdsPosition *pos, const qdsRuleset *rs)
+{
+	qdsShapeMask buf;
+	const qdsShapeMask *mask = getMask(rs, pos->piece, pos->orientation, &buf);
+
+	int i = 0;
+	while (maskFits(pos, mask, pos->x, pos->y - i - 1)) ++i;
+
+	pos->y -= i;
+	if (i) pos->twist = 0;
+	return i;
+}
+
+QDS_API bool qdsPositionLock(qdsPosition *pos, const qdsRuleset *rs)
+{
+	qdsShapeMask buf;
+	const qdsShapeMask *mask = getMask(rs, pos->piece, pos->orientation, &buf);
+	if (!maskFits(pos, mask, pos->x, pos->y)) return false;
+	if (maskFits(pos, mask, pos->x, pos->y - 1)) return false;
+
+	int x = pos->x + mask->left;
+	int y = pos->y + mask->bottom;
+	for (int i = 0; i < mask->height; ++i) {
+		pos->rows[y + i] |= mask->rows[i] << x;
+		if (y + i >= pos->height) pos->height = y + i + 1;
+	}
+
+	pos->piece = QDS_PIECE_NONE;
+	pos->orientation = QDS_ORIENTATION_BASE;
+	return true;
+}
+
+QDS_API int qdsPositionClearLines(qdsPosition *pos)
+{
+	int lines = 0;
+	for (int y = 0; y < pos->height; ++y) {
+		if (pos->rows[y] == QDS_POSITION_FULL_ROW)
+			lines += 1;
+		else
+			pos->rows[y - lines] = pos->rows[y];
+	}
+
+	for (int y = pos->height - lines; y < pos->height; ++y) pos->rows[y] = 0;
+	pos->height -= lines;
+
+	if (lines > 0) {
+		pos->b2b = lines >= 4 || pos->twist >= QDS_ROTATE_TWIST;
+		pos->combo += 1;
+	} else {
+		pos->combo = 0;
+	}
+	pos->twist = 0;
+	return lines;
+}
+
+QDS_API int qdsPositionPlace(qdsPosition *pos,
+							 const qdsRuleset *rs,
+							 const qdsPlacement *placement)
+{
+	if (placement->hold && !qdsPositionHold(pos, rs)) return -1;
+	if (pos->piece != placement->piece) return -1;
+	if (!qdsPositionFits(pos,
+						 rs,
+						 placement->piece,
+						 placement->orientation,
+						 placement->x,
+						 placement->y))
+		return -1;
+
+	pos->x = placement->x;
+	pos->y = placement->y;
+	pos->orientation = placement->orientation;
+	pos->twist = placement->twist;
+	if (!qdsPositionLock(pos, rs)) return -1;
+	return qdsPositionClearLines(pos);
+}
+
+/* room for every pose a piece can be in; see poseIndex */
+#define POSE_COUNT (4 * 3 * 56 * 16)
+
+struct pose
+{
+	signed char x;
+	signed char y;
+	unsigned char orientation;
+	unsigned char twist;
+};
+
+/**
+ * Rotations that end in a twist lead to different results from other
+ * ways of getting to the same place.
+ */
+static int twistClass(int twist)
+{
+	return twist >= QDS_ROTATE_TWIST ? twist - QDS_ROTATE_TWIST + 1 : 0;
+}
+
+static int poseIndex(struct pose p)
+{
+	if (p.x < -4 || p.x >= 12 || p.y < -4 || p.y >= 52) return -1;
+	int i = p.orientation * 3 + twistClass(p.twist);
+	return (i * 56 + p.y + 4) * 16 + p.x + 4;
+}
+
+/**
+ * Get the tiles covered by a placement, and whether it is a twist.
+ */
+static uint64_t footprint(const qdsShapeMask *mask, const qdsPlacement *p)
+{
+	uint64_t key = p->y + mask->bottom;
+	key |= (uint64_t)twistClass(p->twist) << 6;
+	for (int i = 0; i < mask->height; ++i) {
+		uint64_t row = mask->rows[i] << (p->x + mask->left);
+		key |= (row & QDS_POSITION_FULL_ROW) << (8 + 10 * i);
+	}
+	return key;
+}
+
+QDS_API int qdsFindPlacements(const qdsPosition *pos,
+							  const qdsRuleset *rs,
+							  qdsPlacement *out,
+							  int size)
+{
+	assert((pos != NULL));
+	assert((rs != NULL));
+	int piece = pos->piece;
+	if (!piece) return 0;
+	if (!qdsPositionFits(pos, rs, piece, pos->orientation, pos->x, pos->y))
+		return 0;
+	if (size > QDS_MAX_PLACEMENTS) size = QDS_MAX_PLACEMENTS;
+
+	qdsShapeMask buf[4];
+	const qdsShapeMask *masks[4];
+	for (int i = 0; i < 4; ++i) masks[i] = getMask(rs, piece, i, &buf[i]);
+
+	uint_least32_t visited[POSE_COUNT / 32] = { 0 };
+	struct pose queue[POSE_COUNT];
+	uint64_t found[QDS_MAX_PLACEMENTS];
+	int head = 0, tail = 0, count = 0;
+
+	struct pose start = { pos->x, pos->y, pos->orientation, 0 };
+	int index = poseIndex(start);
+	if (index < 0) return 0;
+	visited[index / 32] |= (uint_least32_t)1 << (index % 32);
+	queue[tail++] = start;
+
+	qdsPosition s = *pos;
+	while (head < tail) {
+		struct pose p = queue[head++];
+		const qdsShapeMask *mask = masks[p.orientation];
+
+		/* above the stack, moving down a row at a time reaches nothing
+		   dropping all the way does not */
+		bool grounded = !maskFits(pos, mask, p.x, p.y - 1);
+		bool inStack = p.y + mask->bottom <= pos->height;
+
+		for (int action = 0; action < 5; ++action) {
+			s.x = p.x;
+			s.y = p.y;
+			s.orientation = p.orientation;
+			s.twist = p.twist;
+
+			bool moved;
+			switch (action) {
+				case 0:
+					moved = qdsPositionMove(&s, rs, -1) != 0;
+					break;
+				case 1:
+					moved = qdsPositionMove(&s, rs, 1) != 0;
+					break;
+				case 2:
+					moved = qdsPositionRotate(&s, rs, 1) != QDS_ROTATE_FAILED;
+					break;
+				case 3:
+					moved = qdsPositionRotate(&s, rs, -1) != QDS_ROTATE_FAILED;
+					break;
+				default:
+					if (grounded) {
+						moved = false;
+					} else if (inStack) {
+						s.y -= 1;
+						s.twist = 0;
+						moved = true;
+					} else {
+						moved = qdsPositionDrop(&s, rs) != 0;
+					}
+					break;
+			}
+			if (!moved) continue;
+
+			struct pose next = { s.x, s.y, s.orientation, s.twist };
+			index = poseIndex(next);
+			if (index < 0) continue;
+			uint_least32_t bit = (uint_least32_t)1 << (index % 32);
+			if (visited[index / 32] & bit) continue;
+			visited[index / 32] |= bit;
+			queue[tail++] = next;
+		}
+
+		if (!grounded || count >= size) continue;
+
+		qdsPlacement placement = {
+			.x = p.x,
+			.y = p.y,
+			.piece = piece,
+			.orientation = p.orientation,
+			.twist = p.twist,
+		};
+		uint64_t key = footprint(mask, &placement);
+		bool duplicate = false;
+		for (int i = 0; i < count && !duplicate; ++i)
+			duplicate = found[i] == key;
+		if (duplicate) continue;
+		found[count] = key;
+		out[count++] = placement;
+	}
+
+	return count;
+}
+
+QDS_API uint64_t qdsPositionHash(const qdsPosition *pos)
+{
+	uint64_t h = 0;
+	for (int y = 0; y < pos->height; ++y) {
+		if (pos->rows[y]) h ^= qdsHashMix(pos->rows[y] | (uint64_t)y << 16);
+	}
+
+	uint64_t pieces = pos->piece | pos->orientation << 4 | pos->hold << 8
+					  | pos->held << 12 | pos->b2b << 13
+					  | (uint64_t)(pos->x & 0xff) << 16
+					  | (uint64_t)(pos->y & 0xff) << 24
+					  | (uint64_t)(unsigned short)pos->combo << 32
+					  | (uint64_t)pos->twist << 48;
+	h = qdsHashAdd(h, pieces);
+
+	uint64_t queue = (uint64_t)pos->queueLength << 32;
+	for (int i = 0; i < pos->queueLength; ++i)
+		queue |= (uint64_t)(pos->queue[i] & 15) << (4 * i);
+	return qdsHashAdd(h, queue);
+}
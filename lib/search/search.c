@@ -0,0 +1,292 @@
+/*
+ * Copyright (c) 2023 McEndu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <quadus.h>
+#include <quadus/position.h>
+#include <quadus/ruleset.h>
+#include <quadus/ruleset/hash.h>
+#include <quadus/search.h>
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+struct entry
+{
+	uint64_t key;
+	int score;
+	/* level the position was last generated at, or 0 if unused */
+	unsigned int stamp;
+	/* index of the position in that level */
+	unsigned int node;
+};
+
+struct node
+{
+	qdsPosition pos;
+	int score;
+	/* first placement on the way here */
+	unsigned short root;
+	/* order of generation, for breaking ties */
+	unsigned int order;
+};
+
+struct qdsSearch
+{
+	struct entry *table;
+	size_t tableMask;
+	unsigned int stamp;
+
+	struct node *beam;
+	size_t beamSize;
+	struct node *children;
+	size_t childCount;
+	size_t childSize;
+};
+
+struct context
+{
+	qdsSearch *s;
+	const qdsRuleset *rs;
+	qdsEvaluator *evaluate;
+	void *data;
+
+	/* placements of the active piece, at the first level */
+	qdsPlacement roots[2 * QDS_MAX_PLACEMENTS];
+	int rootCount;
+	bool first;
+
+	unsigned long nodes;
+	unsigned long hits;
+	unsigned long nodeLimit;
+	uint64_t deadline;
+	bool outOfMemory;
+};
+
+QDS_API qdsSearch *qdsNewSearch(int tableBits)
+{
+	if (tableBits < 1) tableBits = 1;
+	if (tableBits > 30) tableBits = 30;
+
+	qdsSearch *s = malloc(sizeof(qdsSearch));
+	if (!s) return NULL;
+	s->table = calloc((size_t)1 << tableBits, sizeof(struct entry));
+	if (!s->table) {
+		free(s);
+		return NULL;
+	}
+	s->tableMask = ((size_t)1 << tableBits) - 1;
+	s->stamp = 0;
+	s->beam = s->children = NULL;
+	s->beamSize = s->childCount = s->childSize = 0;
+	return s;
+}
+
+QDS_API void qdsDestroySearch(qdsSearch *s)
+{
+	if (!s) return;
+	free(s->table);
+	free(s->beam);
+	free(s->children);
+	free(s);
+}
+
+QDS_API void qdsClearSearch(qdsSearch *s)
+{
+	assert((s != NULL));
+	for (size_t i = 0; i <= s->tableMask; ++i) s->table[i].stamp = 0;
+	s->stamp = 0;
+}
+
+static uint64_t now(void)
+{
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (uint64_t)t.tv_sec * 1000000 + t.tv_nsec / 1000;
+}
+
+static bool outOfBudget(const struct context *c)
+{
+	if (c->first) return false;
+	if (c->nodeLimit && c->nodes >= c->nodeLimit) return true;
+	/* reading the clock costs more than generating a position */
+	return c->deadline && c->nodes % 64 == 0 && now() >= c->deadline;
+}
+
+static struct node *addChild(qdsSearch *s)
+{
+	if (s->childCount == s->childSize) {
+		size_t size = s->childSize ? s->childSize * 2 : 256;
+		struct node *children
+			= realloc(s->children, size * sizeof(struct node));
+		if (!children) return NULL;
+		s->children = children;
+		s->childSize = size;
+	}
+	return &s->children[s->childCount++];
+}
+
+/**
+ * Generate the positions after placing the active piece of a position
+ * in every way it can go. Returns false when the search has to stop.
+ */
+static bool expand(struct context *c, const struct node *parent, bool hold)
+{
+	qdsSearch *s = c->s;
+	qdsPosition base = parent->pos;
+	if (hold && !qdsPositionHold(&base, c->rs)) return true;
+
+	qdsPlacement placements[QDS_MAX_PLACEMENTS];
+	int count = qdsFindPlacements(&base, c->rs, placements, QDS_MAX_PLACEMENTS);
+
+	for (int i = 0; i < count; ++i) {
+		if (outOfBudget(c)) return false;
+		c->nodes += 1;
+
+		qdsPosition pos = base;
+		int lines = qdsPositionPlace(&pos, c->rs, &placements[i]);
+		if (lines < 0 || !qdsPositionSpawn(&pos, c->rs)) continue;
+
+		int root = parent->root;
+		if (c->first) {
+			root = c->rootCount++;
+			c->roots[root] = placements[i];
+			c->roots[root].hold = hold;
+		}
+
+		uint64_t key = qdsHashAdd(qdsPositionHash(&pos), lines);
+		struct entry *e = &s->table[key & s->tableMask];
+		int score;
+		if (e->stamp && e->key == key) {
+			c->hits += 1;
+			score = e->score;
+			if (e->stamp == s->stamp) {
+				/* reached the same position another way */
+				struct node *other = &s->children[e->node];
+				if (parent->score + score > other->score) {
+					other->score = parent->score + score;
+					other->root = root;
+				}
+				continue;
+			}
+		} else {
+			score = c->evaluate(&pos, lines, c->data);
+			e->key = key;
+			e->score = score;
+		}
+
+		struct node *child = addChild(s);
+		if (!child) {
+			c->outOfMemory = true;
+			return false;
+		}
+		child->pos = pos;
+		child->score = parent->score + score;
+		child->root = root;
+		child->order = s->childCount;
+		e->stamp = s->stamp;
+		e->node = s->childCount - 1;
+	}
+
+	return true;
+}
+
+static int compareNodes(const void *a, const void *b)
+{
+	const struct node *x = a, *y = b;
+	if (x->score != y->score) return x->score > y->score ? -1 : 1;
+	return x->order < y->order ? -1 : x->order > y->order;
+}
+
+QDS_API bool qdsSearchPlacement(qdsSearch *s,
+								const qdsPosition *pos,
+								const qdsRuleset *rs,
+								qdsEvaluator *evaluate,
+								void *data,
+								const qdsSearchLimits *limits,
+								qdsSearchResult *result)
+{
+	assert((s != NULL));
+	assert((pos != NULL));
+	assert((rs != NULL));
+	assert((evaluate != NULL));
+	assert((limits != NULL));
+	assert((result != NULL));
+
+	struct context context = {
+		.s = s,
+		.rs = rs,
+		.evaluate = evaluate,
+		.data = data,
+		.first = true,
+		.nodeLimit = limits->nodes,
+		.deadline = limits->time ? now() + limits->time : 0,
+	};
+	struct context *c = &context;
+
+	int beamWidth = limits->beamWidth > 0 ? limits->beamWidth : 1;
+	if ((size_t)beamWidth > s->beamSize) {
+		struct node *beam = realloc(s->beam, beamWidth * sizeof(struct node));
+		if (!beam) return false;
+		s->beam = beam;
+		s->beamSize = beamWidth;
+	}
+
+	s->beam[0] = (struct node){ .pos = *pos };
+	size_t beamCount = 1;
+	bool found = false;
+	result->depth = 0;
+
+	for (int level = 0; level < limits->depth; ++level) {
+		/* a new stamp tells this level's positions from older ones */
+		if (++s->stamp == 0) {
+			qdsClearSearch(s);
+			s->stamp = 1;
+		}
+		s->childCount = 0;
+
+		bool finished = true;
+		for (size_t i = 0; i < beamCount && finished; ++i) {
+			finished = expand(c, &s->beam[i], false)
+					   && expand(c, &s->beam[i], true);
+		}
+		if (!finished || s->childCount == 0) break;
+
+		qsort(s->children, s->childCount, sizeof(struct node), compareNodes);
+		beamCount = s->childCount < (size_t)beamWidth ? s->childCount
+													  : (size_t)beamWidth;
+		memcpy(s->beam, s->children, beamCount * sizeof(struct node));
+
+		found = true;
+		result->placement = c->roots[s->beam[0].root];
+		result->score = s->beam[0].score;
+		result->depth = level + 1;
+		c->first = false;
+	}
+
+	result->nodes = c->nodes;
+	result->hits = c->hits;
+	return found && !c->outOfMemory;
+}
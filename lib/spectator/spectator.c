@@ -0,0 +1,463 @@
+/*
+ * Copyright (c) 2023 McEndu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <quadus.h>
+#include <quadus/calls.h>
+#include <quadus/piece.h>
+#include <quadus/spectator.h>
+#include <quadus/ui.h>
+
+#include <assert.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+/* record tags */
+#define TAG_END 0
+#define TAG_RESET 1	   /* forget everything known */
+#define TAG_HEIGHT 2   /* u8 height; rows above are empty */
+#define TAG_ROW 3	   /* u8 y, 5 bytes of tiles, 2 per byte */
+#define TAG_PIECE 4	   /* u8 piece, u8 orientation */
+#define TAG_POSITION 5 /* s8 x, s8 y */
+#define TAG_HOLD 6	   /* u8 piece */
+#define TAG_QUEUE 7	   /* u8 count, count * u8 piece */
+#define TAG_SHIFT 8	   /* u8 piece appended to the queue */
+#define TAG_LINES 9	   /* varint */
+#define TAG_SCORE 10   /* varint */
+#define TAG_LEVEL 11   /* varint */
+#define TAG_TOPOUT 12
+
+/* the part of the playfield viewers see */
+#define VIEW_WIDTH 10
+#define VIEW_ROWS 48
+
+#define ROW_BYTES 5
+#define ALL_ROWS ((((uint_least64_t)1) << VIEW_ROWS) - 1)
+#define ROW_BIT(y) (((uint_least64_t)1) << (y))
+
+static unsigned char *putVarint(unsigned char *p, unsigned int value)
+{
+	while (value >= 0x80) {
+		*p++ = (value & 0x7f) | 0x80;
+		value >>= 7;
+	}
+	*p++ = value;
+	return p;
+}
+
+static unsigned char *putRow(unsigned char *p, qdsGame *game, int y)
+{
+	const qdsTile *row = qdsGetPlayfield(game)[y];
+	*p++ = TAG_ROW;
+	*p++ = y;
+	for (int x = 0; x < VIEW_WIDTH; x += 2) {
+		*p++ = (row[x] & 15) | (row[x + 1] & 15) << 4;
+	}
+	return p;
+}
+
+static int getHeight(qdsGame *game)
+{
+	int height = qdsGetFieldHeight(game);
+	return height < VIEW_ROWS ? height : VIEW_ROWS;
+}
+
+static unsigned int getStat(qdsGame *game, unsigned long req)
+{
+	unsigned int value = 0;
+	if (qdsCall(game, req, &value) < 0) return 0;
+	return value;
+}
+
+static int getQueue(qdsGame *game, signed char *queue)
+{
+	int count;
+	if (qdsCall(game, QDS_GETNEXTCOUNT, &count) < 0) count = 1;
+	if (count > QDS_SPECTATOR_QUEUE) count = QDS_SPECTATOR_QUEUE;
+	if (count < 0) count = 0;
+	for (int i = 0; i < count; ++i) queue[i] = qdsGetNextPiece(game, i);
+	return count;
+}
+
+static bool onSpawn(qdsGame *game, int piece)
+{
+	qdsSpectator *s = qdsGetUiData(game);
+	s->queueChanged = true;
+	return true;
+}
+
+static bool onHold(qdsGame *game, int piece)
+{
+	qdsSpectator *s = qdsGetUiData(game);
+	s->queueChanged = true;
+	return true;
+}
+
+static bool onLock(qdsGame *game)
+{
+	qdsSpectator *s = qdsGetUiData(game);
+	int x, y;
+	qdsGetActivePosition(game, &x, &y);
+
+	QDS_SHAPE_FOREACH (b, qdsGetActiveShape(game)) {
+		int row = y + b->y;
+		if (x + b->x < 0 || x + b->x >= VIEW_WIDTH) continue;
+		if (row < 0 || row >= VIEW_ROWS) continue;
+		s->dirtyRows |= ROW_BIT(row);
+		if (row >= s->expectHeight) s->expectHeight = row + 1;
+	}
+	return true;
+}
+
+static bool onLineClear(qdsGame *game, int y)
+{
+	qdsSpectator *s = qdsGetUiData(game);
+	if (y >= s->expectHeight) return true;
+	/* everything above moves down a row */
+	s->dirtyRows |= ALL_ROWS & ~(ROW_BIT(y) - 1);
+	s->expectHeight -= 1;
+	return true;
+}
+
+static void onTopOut(qdsGame *game)
+{
+	qdsSpectator *s = qdsGetUiData(game);
+	s->toppedOut = true;
+	/* overflowing garbage may shift the playfield without changing its
+	   height */
+	s->dirtyRows = ALL_ROWS;
+}
+
+QDS_API const qdsUserInterface qdsSpectatorUi = {
+	.events = {
+		.onSpawn = onSpawn,
+		.onLock = onLock,
+		.onHold = onHold,
+		.onLineClear = onLineClear,
+		.onTopOut = onTopOut,
+	},
+};
+
+QDS_API void qdsInitSpectator(qdsSpectator *s)
+{
+	assert((s != NULL));
+	memset(s, 0, sizeof(qdsSpectator));
+	s->keyframe = true;
+}
+
+static unsigned char *putState(unsigned char *p,
+							   qdsGame *game,
+							   bool toppedOut)
+{
+	int height = getHeight(game);
+	*p++ = TAG_RESET;
+	*p++ = TAG_HEIGHT;
+	*p++ = height;
+	for (int y = 0; y < height; ++y) {
+		const qdsTile *row = qdsGetPlayfield(game)[y];
+		for (int x = 0; x < VIEW_WIDTH; ++x) {
+			if (row[x]) {
+				p = putRow(p, game, y);
+				break;
+			}
+		}
+	}
+
+	int piece = qdsGetActivePieceType(game);
+	*p++ = TAG_PIECE;
+	*p++ = piece;
+	*p++ = piece ? qdsGetActiveOrientation(game) : 0;
+	if (piece) {
+		*p++ = TAG_POSITION;
+		*p++ = qdsGetActiveX(game);
+		*p++ = qdsGetActiveY(game);
+	}
+	*p++ = TAG_HOLD;
+	*p++ = qdsGetHeldPiece(game);
+
+	signed char queue[QDS_SPECTATOR_QUEUE];
+	int count = getQueue(game, queue);
+	*p++ = TAG_QUEUE;
+	*p++ = count;
+	for (int i = 0; i < count; ++i) *p++ = queue[i];
+
+	*p++ = TAG_LINES;
+	p = putVarint(p, getStat(game, QDS_GETLINES));
+	*p++ = TAG_SCORE;
+	p = putVarint(p, getStat(game, QDS_GETSCORE));
+	*p++ = TAG_LEVEL;
+	p = putVarint(p, getStat(game, QDS_GETLEVEL));
+	if (toppedOut) *p++ = TAG_TOPOUT;
+	return p;
+}
+
+/**
+ * Record the state of the game as known to viewers after a keyframe.
+ */
+static void snapshot(qdsSpectator *s, qdsGame *game)
+{
+	s->dirtyRows = 0;
+	s->height = s->expectHeight = getHeight(game);
+	s->piece = qdsGetActivePieceType(game);
+	s->orientation = s->piece ? qdsGetActiveOrientation(game) : 0;
+	s->x = s->piece ? qdsGetActiveX(game) : 0;
+	s->y = s->piece ? qdsGetActiveY(game) : 0;
+	s->hold = qdsGetHeldPiece(game);
+	s->queueLength = getQueue(game, s->queue);
+	s->queueChanged = false;
+	s->lines = getStat(game, QDS_GETLINES);
+	s->score = getStat(game, QDS_GETSCORE);
+	s->level = getStat(game, QDS_GETLEVEL);
+	s->sentTopOut = s->toppedOut;
+	s->keyframe = false;
+}
+
+static unsigned char *putQueue(unsigned char *p, qdsSpectator *s, qdsGame *game)
+{
+	signed char queue[QDS_SPECTATOR_QUEUE];
+	int count = getQueue(game, queue);
+	s->queueChanged = false;
+
+	if (count == s->queueLength && !memcmp(queue, s->queue, count)) return p;
+	if (count && count == s->queueLength
+		&& !memcmp(queue, s->queue + 1, count - 1)) {
+		*p++ = TAG_SHIFT;
+		*p++ = queue[count - 1];
+	} else {
+		*p++ = TAG_QUEUE;
+		*p++ = count;
+		for (int i = 0; i < count; ++i) *p++ = queue[i];
+	}
+	s->queueLength = count;
+	memcpy(s->queue, queue, count);
+	return p;
+}
+
+static unsigned char *putStat(unsigned char *p,
+							  int tag,
+							  unsigned int *sent,
+							  unsigned int value)
+{
+	if (value == *sent) return p;
+	*sent = value;
+	*p++ = tag;
+	return putVarint(p, value);
+}
+
+QDS_API size_t qdsEncodeSpectatorFrame(qdsSpectator *s,
+									   qdsGame *game,
+									   unsigned char *buf)
+{
+	assert((s != NULL));
+	assert((game != NULL));
+	unsigned char *p = buf;
+
+	if (s->keyframe) {
+		p = putState(p, game, s->toppedOut);
+		snapshot(s, game);
+		*p++ = TAG_END;
+		return p - buf;
+	}
+
+	/* rows changed outside of locks and line clears, such as rising
+	   garbage or a cleared playfield */
+	int height = getHeight(game);
+	if (height != s->expectHeight) s->dirtyRows = ALL_ROWS;
+	s->expectHeight = height;
+
+	if (height != s->height) {
+		*p++ = TAG_HEIGHT;
+		*p++ = s->height = height;
+	}
+	uint_least64_t rows = s->dirtyRows & (ROW_BIT(height) - 1);
+	for (int y = 0; rows; ++y, rows >>= 1) {
+		if (rows & 1) p = putRow(p, game, y);
+	}
+	s->dirtyRows = 0;
+
+	int piece = qdsGetActivePieceType(game);
+	int orientation = piece ? qdsGetActiveOrientation(game) : 0;
+	if (piece != s->piece || orientation != s->orientation) {
+		*p++ = TAG_PIECE;
+		*p++ = s->piece = piece;
+		*p++ = s->orientation = orientation;
+		s->x = s->y = SCHAR_MIN; /* always followed by a position */
+	}
+	if (piece) {
+		int x, y;
+		qdsGetActivePosition(game, &x, &y);
+		if (x != s->x || y != s->y) {
+			*p++ = TAG_POSITION;
+			*p++ = s->x = x;
+			*p++ = s->y = y;
+		}
+	}
+
+	int hold = qdsGetHeldPiece(game);
+	if (hold != s->hold) {
+		*p++ = TAG_HOLD;
+		*p++ = s->hold = hold;
+	}
+
+	if (s->queueChanged) p = putQueue(p, s, game);
+
+	p = putStat(p, TAG_LINES, &s->lines, getStat(game, QDS_GETLINES));
+	p = putStat(p, TAG_SCORE, &s->score, getStat(game, QDS_GETSCORE));
+	p = putStat(p,
+				TAG_LEVEL,
+				(unsigned int *)&s->level,
+				getStat(game, QDS_GETLEVEL));
+
+	if (s->toppedOut && !s->sentTopOut) {
+		*p++ = TAG_TOPOUT;
+		s->sentTopOut = true;
+	}
+
+	*p++ = TAG_END;
+	assert((p - buf <= QDS_SPECTATOR_MAX_FRAME));
+	return p - buf;
+}
+
+QDS_API size_t qdsEncodeSpectatorKeyframe(const qdsSpectator *s,
+										  qdsGame *game,
+										  unsigned char *buf)
+{
+	assert((s != NULL));
+	assert((game != NULL));
+	unsigned char *p = putState(buf, game, s->toppedOut);
+	*p++ = TAG_END;
+	return p - buf;
+}
+
+QDS_API void qdsInitSpectatorView(qdsSpectatorView *view)
+{
+	assert((view != NULL));
+	memset(view, 0, sizeof(qdsSpectatorView));
+}
+
+static const unsigned char *getVarint(const unsigned char *p,
+									  const unsigned char *end,
+									  unsigned int *value)
+{
+	unsigned int result = 0;
+	for (int shift = 0; p < end && shift < 32; shift += 7) {
+		unsigned char c = *p++;
+		result |= (unsigned int)(c & 0x7f) << shift;
+		if (!(c & 0x80)) {
+			*value = result;
+			return p;
+		}
+	}
+	return NULL;
+}
+
+QDS_API int qdsDecodeSpectatorFrame(qdsSpectatorView *view,
+									const unsigned char *buf,
+									size_t size)
+{
+	assert((view != NULL));
+	const unsigned char *p = buf;
+	const unsigned char *end = buf + size;
+
+#define NEED(n)                       \
+	do {                              \
+		if (end - p < (n)) return -1; \
+	} while (0)
+
+	for (;;) {
+		NEED(1);
+		switch (*p++) {
+			case TAG_END:
+				return p - buf;
+			case TAG_RESET:
+				qdsInitSpectatorView(view);
+				break;
+			case TAG_HEIGHT:
+				NEED(1);
+				if (p[0] > VIEW_ROWS) return -1;
+				view->height = *p++;
+				memset(view->playfield[view->height],
+					   0,
+					   (VIEW_ROWS - view->height) * sizeof(qdsLine));
+				break;
+			case TAG_ROW: {
+				NEED(1 + ROW_BYTES);
+				if (p[0] >= VIEW_ROWS) return -1;
+				qdsTile *row = view->playfield[*p++];
+				for (int x = 0; x < VIEW_WIDTH; x += 2) {
+					row[x] = *p & 15;
+					row[x + 1] = *p++ >> 4;
+				}
+				break;
+			}
+			case TAG_PIECE:
+				NEED(2);
+				if (p[0] > QDS_PIECE_Z || p[1] > QDS_ORIENTATION_CC) return -1;
+				view->piece = *p++;
+				view->orientation = *p++;
+				break;
+			case TAG_POSITION:
+				NEED(2);
+				view->x = (signed char)*p++;
+				view->y = (signed char)*p++;
+				break;
+			case TAG_HOLD:
+				NEED(1);
+				if (p[0] > QDS_PIECE_Z) return -1;
+				view->hold = *p++;
+				break;
+			case TAG_QUEUE:
+				NEED(1);
+				if (p[0] > QDS_SPECTATOR_QUEUE) return -1;
+				NEED(1 + p[0]);
+				view->queueLength = *p++;
+				for (int i = 0; i < view->queueLength; ++i)
+					view->queue[i] = *p++;
+				break;
+			case TAG_SHIFT:
+				NEED(1);
+				if (!view->queueLength) return -1;
+				memmove(view->queue,
+						view->queue + 1,
+						(view->queueLength - 1) * sizeof(int));
+				view->queue[view->queueLength - 1] = *p++;
+				break;
+			case TAG_LINES:
+				if (!(p = getVarint(p, end, &view->lines))) return -1;
+				break;
+			case TAG_SCORE:
+				if (!(p = getVarint(p, end, &view->score))) return -1;
+				break;
+			case TAG_LEVEL:
+				if (!(p = getVarint(p, end, (unsigned int *)&view->level)))
+					return -1;
+				break;
+			case TAG_TOPOUT:
+				view->toppedOut = true;
+				break;
+			default:
+				return -1;
+		}
+	}
+#undef NEED
+}
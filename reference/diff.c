@@ -0,0 +1,225 @@
+/*
+ * Copyright (c) 2023 McEndu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/*
+ * Runs the library and the reference engine side by side.
+ *
+ *   diffReference [-b] PLAY REFERENCE
+ *
+ * PLAY and REFERENCE are the play program built against each. Every
+ * setup is played from a few seeds on both, and the state hashes are
+ * compared after every cycle; the first cycle where they differ is
+ * reported. With -b, the setups are timed on both instead, and the
+ * speedup of the library over the reference engine is reported.
+ */
+#include <errno.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define SEEDS 4
+#define CYCLES 20000
+#define BENCH_CYCLES 500000
+#define BENCH_RUNS 3
+#define MAX_SETUPS 64
+
+struct child
+{
+	pid_t pid;
+	FILE *out;
+};
+
+/* run a program with its output piped back */
+static bool spawn(struct child *c, char *const argv[])
+{
+	int fds[2];
+	if (pipe(fds) < 0) return false;
+
+	c->pid = fork();
+	if (c->pid < 0) {
+		close(fds[0]);
+		close(fds[1]);
+		return false;
+	}
+	if (c->pid == 0) {
+		dup2(fds[1], STDOUT_FILENO);
+		close(fds[0]);
+		close(fds[1]);
+		execv(argv[0], argv);
+		_exit(127);
+	}
+
+	close(fds[1]);
+	c->out = fdopen(fds[0], "r");
+	return c->out != NULL;
+}
+
+static bool reap(struct child *c)
+{
+	int status;
+	fclose(c->out);
+	while (waitpid(c->pid, &status, 0) < 0) {
+		if (errno != EINTR) return false;
+	}
+	return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+static int listSetups(char *play, char names[][64])
+{
+	struct child c;
+	if (!spawn(&c, (char *[]){ play, NULL })) return -1;
+
+	int count = 0;
+	while (count < MAX_SETUPS && fgets(names[count], 64, c.out)) {
+		names[count][strcspn(names[count], "\n")] = '\0';
+		count += 1;
+	}
+	return reap(&c) ? count : -1;
+}
+
+/* returns the first cycle with differing hashes, or -1 if none */
+static long compare(char *play, char *ref, int setup, int seed, bool *ok)
+{
+	char setupArg[16], seedArg[16], cyclesArg[16];
+	snprintf(setupArg, sizeof(setupArg), "%d", setup);
+	snprintf(seedArg, sizeof(seedArg), "%d", seed);
+	snprintf(cyclesArg, sizeof(cyclesArg), "%d", CYCLES);
+
+	struct child a, b;
+	*ok = false;
+	if (!spawn(&a, (char *[]){ play, setupArg, seedArg, cyclesArg, NULL }))
+		return -1;
+	if (!spawn(&b, (char *[]){ ref, setupArg, seedArg, cyclesArg, NULL })) {
+		kill(a.pid, SIGTERM);
+		reap(&a);
+		return -1;
+	}
+	*ok = true;
+
+	long diverged = -1;
+	for (long i = 0; i < CYCLES; ++i) {
+		uint64_t ha, hb;
+		if (fread(&ha, sizeof(ha), 1, a.out) != 1
+			|| fread(&hb, sizeof(hb), 1, b.out) != 1) {
+			*ok = false;
+			break;
+		}
+		if (ha != hb) {
+			diverged = i;
+			break;
+		}
+	}
+
+	/* stopped early, the rest of the hashes are not needed */
+	if (diverged >= 0 || !*ok) {
+		kill(a.pid, SIGTERM);
+		kill(b.pid, SIGTERM);
+	}
+	bool exited = reap(&a) & reap(&b);
+	if (diverged < 0 && *ok) *ok = exited;
+	return diverged;
+}
+
+static double timeRun(char *play, int setup)
+{
+	char setupArg[16], cyclesArg[16];
+	snprintf(setupArg, sizeof(setupArg), "%d", setup);
+	snprintf(cyclesArg, sizeof(cyclesArg), "%d", BENCH_CYCLES);
+
+	struct child c;
+	if (!spawn(&c, (char *[]){ play, "-t", setupArg, "1", cyclesArg, NULL }))
+		return -1;
+
+	double ns;
+	if (fscanf(c.out, "%lf", &ns) != 1) ns = -1;
+	return reap(&c) ? ns : -1;
+}
+
+/* the best of a few runs, as the others are likely disturbed */
+static double timeSetup(char *play, int setup)
+{
+	double best = -1;
+	for (int i = 0; i < BENCH_RUNS; ++i) {
+		double ns = timeRun(play, setup);
+		if (ns < 0) return -1;
+		if (best < 0 || ns < best) best = ns;
+	}
+	return best;
+}
+
+int main(int argc, char **argv)
+{
+	bool bench = argc > 1 && !strcmp(argv[1], "-b");
+	if (argc != 3 + bench) {
+		fprintf(stderr, "usage: %s [-b] PLAY REFERENCE\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	char *play = argv[1 + bench], *ref = argv[2 + bench];
+
+	static char names[MAX_SETUPS][64];
+	int count = listSetups(play, names);
+	if (count < 0) {
+		fprintf(stderr, "%s: cannot run %s\n", argv[0], play);
+		return EXIT_FAILURE;
+	}
+
+	if (bench) {
+		printf("%-20s %12s %12s %8s\n", "setup", "library", "reference", "");
+		for (int i = 0; i < count; ++i) {
+			double fast = timeSetup(play, i), slow = timeSetup(ref, i);
+			if (fast < 0 || slow < 0) return EXIT_FAILURE;
+			printf("%-20s %9.1f ns %9.1f ns %7.2fx\n",
+				   names[i],
+				   fast,
+				   slow,
+				   slow / fast);
+		}
+		return EXIT_SUCCESS;
+	}
+
+	int status = EXIT_SUCCESS;
+	for (int i = 0; i < count; ++i) {
+		bool passed = true;
+		for (int seed = 1; seed <= SEEDS; ++seed) {
+			bool ok;
+			long cycle = compare(play, ref, i, seed, &ok);
+			if (cycle >= 0) {
+				printf("%s, seed %d: diverged at cycle %ld\n",
+					   names[i],
+					   seed,
+					   cycle);
+				passed = false;
+			} else if (!ok) {
+				printf("%s, seed %d: failed to run\n", names[i], seed);
+				passed = false;
+			}
+		}
+		if (passed) printf("%s: ok\n", names[i]);
+		else status = EXIT_FAILURE;
+	}
+	return status;
+}
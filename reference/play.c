@@ -0,0 +1,210 @@
+/*
+ * Copyright (c) 2023 McEndu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/*
+ * Plays games for the differential runner. Built twice, once against
+ * the library and once against the reference engine.
+ *
+ *   play                        list the setups, one a line
+ *   play SETUP SEED CYCLES      write the state hash after every cycle
+ *   play -t SETUP SEED CYCLES   print the time taken per cycle in ns
+ *
+ * Hashes are written as 8 bytes each in host byte order. Games that
+ * end are started again with the next seed.
+ */
+#include <quadus.h>
+#include <quadus/calls.h>
+#include <quadus/mode.h>
+#include <quadus/ruleset.h>
+#include <quadus/ruleset/utils.h>
+#include <quadus/versus.h>
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static const struct setup
+{
+	const char *name;
+	const qdsRuleset *rs;
+	const qdsGamemode *mode;
+	int width;
+	int height;
+} setups[] = {
+	{ "standard-marathon", &qdsRulesetStandard, &qdsModeMarathon, 10, 20 },
+	{ "standard-sprint", &qdsRulesetStandard, &qdsModeSprint, 10, 20 },
+	{ "standard-master", &qdsRulesetStandard, &qdsModeMaster, 10, 20 },
+	{ "standard-versus", &qdsRulesetStandard, &qdsModeVersus, 10, 20 },
+	{ "standard-versus-4x20", &qdsRulesetStandard, &qdsModeVersus, 4, 20 },
+	{ "arcade-marathon", &qdsRulesetArcade, &qdsModeMarathon, 10, 20 },
+	{ "arcade-master", &qdsRulesetArcade, &qdsModeMaster, 10, 20 },
+	{ "arcade-master-7x8", &qdsRulesetArcade, &qdsModeMaster, 7, 8 },
+	{ "tgm-marathon", &qdsRulesetTgm, &qdsModeMarathon, 10, 20 },
+	{ "tgm-marathon-16x100", &qdsRulesetTgm, &qdsModeMarathon, 16, 100 },
+	{ "tgm-master", &qdsRulesetTgm, &qdsModeMaster, 10, 20 },
+	{ "tgm-versus", &qdsRulesetTgm, &qdsModeVersus, 10, 20 },
+};
+#define SETUP_COUNT (sizeof(setups) / sizeof(*setups))
+
+struct match
+{
+	const struct setup *setup;
+	unsigned int seed;
+	qdsGame *games[2];
+	int count;
+};
+
+static qdsGame *newGame(const struct setup *setup, unsigned int seed)
+{
+	qdsGame *game = qdsNewGameSized(setup->width, setup->height);
+	if (!game) abort();
+	qdsSetRuleset(game, setup->rs);
+	qdsSetMode(game, setup->mode);
+	setup->rs->call(game, QDS_SETSEED, &seed);
+	if (setup->mode->call) setup->mode->call(game, QDS_SETSEED, &seed);
+	return game;
+}
+
+static void startMatch(struct match *m)
+{
+	m->games[0] = newGame(m->setup, m->seed);
+	m->count = 1;
+	if (m->setup->mode == &qdsModeVersus) {
+		m->games[1] = newGame(m->setup, m->seed);
+		qdsVersusPair(m->games[0], m->games[1], m->seed);
+		m->count = 2;
+	}
+}
+
+static void endMatch(struct match *m)
+{
+	for (int i = 0; i < m->count; ++i) qdsDestroyGame(m->games[i]);
+}
+
+static bool hasEnded(const struct match *m)
+{
+	for (int i = 0; i < m->count; ++i) {
+		const qdsRulesetState *state = qdsGetRulesetData(m->games[i]);
+		if (state->status == QDS_STATUS_GAMEOVER) return true;
+	}
+	return false;
+}
+
+/**
+ * Generate a pseudorandom input stream resembling actual play, with
+ * frequent movement and rotation and an occasional hard drop.
+ */
+static unsigned int nextInput(unsigned long *seed)
+{
+	*seed = *seed * 6364136223846793005ul + 1442695040888963407ul;
+	unsigned int r = *seed >> 33;
+	unsigned int input = 0;
+
+	switch (r % 8) {
+		case 0:
+		case 1:
+			input |= QDS_INPUT_LEFT;
+			break;
+		case 2:
+		case 3:
+			input |= QDS_INPUT_RIGHT;
+			break;
+		case 4:
+			input |= QDS_INPUT_SOFT_DROP;
+			break;
+	}
+	if (r / 8 % 4 == 0) input |= QDS_INPUT_ROTATE_C;
+	if (r / 32 % 4 == 0) input |= QDS_INPUT_ROTATE_CC;
+	if (r / 128 % 32 == 0) input |= QDS_INPUT_HARD_DROP;
+	if (r / 4096 % 64 == 0) input |= QDS_INPUT_HOLD;
+	return input;
+}
+
+static void cycle(struct match *m, unsigned long *inputSeed)
+{
+	for (int i = 0; i < m->count; ++i)
+		qdsRunCycle(m->games[i], nextInput(inputSeed));
+
+	if (hasEnded(m)) {
+		endMatch(m);
+		m->seed += 1;
+		startMatch(m);
+	}
+}
+
+static uint64_t stateHash(const struct match *m)
+{
+	uint64_t h = 0;
+	for (int i = 0; i < m->count; ++i)
+		h = h * 0x9e3779b97f4a7c15 ^ qdsGetStateHash(m->games[i]);
+	return h;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 2) {
+		for (size_t i = 0; i < SETUP_COUNT; ++i) puts(setups[i].name);
+		return EXIT_SUCCESS;
+	}
+
+	bool timed = !strcmp(argv[1], "-t");
+	if (argc != 4 + timed) {
+		fprintf(stderr, "usage: %s [-t] SETUP SEED CYCLES\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	unsigned long setup = strtoul(argv[1 + timed], NULL, 10);
+	if (setup >= SETUP_COUNT) {
+		fprintf(stderr, "%s: no setup %lu\n", argv[0], setup);
+		return EXIT_FAILURE;
+	}
+
+	struct match m = {
+		.setup = &setups[setup],
+		.seed = strtoul(argv[2 + timed], NULL, 10),
+	};
+	long cycles = strtol(argv[3 + timed], NULL, 10);
+	unsigned long inputSeed = m.seed;
+	startMatch(&m);
+
+	if (timed) {
+		struct timespec start, end;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for (long i = 0; i < cycles; ++i) cycle(&m, &inputSeed);
+		clock_gettime(CLOCK_MONOTONIC, &end);
+
+		double ns = (end.tv_sec - start.tv_sec) * 1e9;
+		ns += end.tv_nsec - start.tv_nsec;
+		printf("%.1f\n", ns / cycles);
+	} else {
+		for (long i = 0; i < cycles; ++i) {
+			cycle(&m, &inputSeed);
+			uint64_t h = stateHash(&m);
+			fwrite(&h, sizeof(h), 1, stdout);
+		}
+	}
+
+	endMatch(&m);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2023 McEndu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "server.h"
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static struct server *server;
+
+static void stop(int sig)
+{
+	stopServer(server);
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "usage: %s [-u path] [-p port]\n", name);
+	exit(2);
+}
+
+int main(int argc, char **argv)
+{
+	server = newServer();
+	if (!server) {
+		perror("Failed to create server");
+		return 1;
+	}
+
+	bool listening = false;
+	int opt;
+	while ((opt = getopt(argc, argv, "u:p:")) != -1) {
+		switch (opt) {
+			case 'u':
+				if (!listenUnix(server, optarg)) {
+					perror(optarg);
+					return 1;
+				}
+				break;
+			case 'p':
+				if (!listenTcp(server, atoi(optarg))) {
+					perror(optarg);
+					return 1;
+				}
+				break;
+			default:
+				usage(argv[0]);
+		}
+		listening = true;
+	}
+	if (!listening || optind != argc) usage(argv[0]);
+
+	struct sigaction sa = { .sa_handler = stop };
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+
+	bool ok = runServer(server);
+	if (!ok) perror("Event loop failed");
+	freeServer(server);
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2023 McEndu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "match.h"
+#include "protocol.h"
+#include <quadus.h>
+#include <quadus/mode.h>
+#include <quadus/ruleset/hash.h>
+#include <quadus/versus.h>
+
+#include <stdlib.h>
+
+struct match *newMatch(uint32_t id, uint32_t seed)
+{
+	struct match *m = calloc(1, sizeof(struct match));
+	if (!m) return NULL;
+	m->id = id;
+	m->seed = seed;
+	m->winner = -1;
+
+	for (int i = 0; i < 2; ++i) {
+		m->players[i] = qdsNewGame();
+		if (!m->players[i]) {
+			freeMatch(m);
+			return NULL;
+		}
+		qdsSetRuleset(m->players[i], &qdsRulesetStandard);
+		qdsSetMode(m->players[i], &qdsModeVersus);
+	}
+	qdsVersusPair(m->players[0], m->players[1], seed);
+
+	return m;
+}
+
+void freeMatch(struct match *m)
+{
+	for (int i = 0; i < 2; ++i) {
+		if (m->players[i]) qdsDestroyGame(m->players[i]);
+	}
+	free(m);
+}
+
+bool inputWindowFull(const struct match *m, int seat)
+{
+	return m->received[seat] - m->frame >= INPUT_WINDOW;
+}
+
+bool pushInput(struct match *m, int seat, uint32_t frame, int input)
+{
+	if (frame != m->received[seat] || inputWindowFull(m, seat)) return false;
+	m->inputs[seat][frame % INPUT_WINDOW] = input;
+	m->received[seat] += 1;
+	return true;
+}
+
+bool stepMatch(struct match *m, uint16_t *inputs)
+{
+	if (m->winner >= 0 || m->received[0] == m->frame
+		|| m->received[1] == m->frame)
+		return false;
+
+	int slot = m->frame % INPUT_WINDOW;
+	qdsRunCycle(m->players[0], m->inputs[0][slot]);
+	qdsRunCycle(m->players[1], m->inputs[1][slot]);
+	*inputs = m->inputs[0][slot] | m->inputs[1][slot] << 8;
+
+	m->frame += 1;
+
+	bool lost0 = qdsVersusHasLost(m->players[0]);
+	bool lost1 = qdsVersusHasLost(m->players[1]);
+	if (lost0 && lost1)
+		m->winner = MATCH_DRAW;
+	else if (lost0)
+		m->winner = 1;
+	else if (lost1)
+		m->winner = 0;
+	return true;
+}
+
+uint32_t matchHash(const struct match *m)
+{
+	uint64_t h = qdsGetStateHash(m->players[0])
+				 ^ qdsHashMix(qdsGetStateHash(m->players[1]));
+	return h ^ h >> 32;
+}
@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2023 McEndu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef SERVER_MATCH_H
+#define SERVER_MATCH_H
+
+#include <quadus.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* frames of input a player may send ahead of the simulation */
+#define INPUT_WINDOW 64
+
+struct connection;
+
+/*
+ * A lockstep match between two versus games. Frame n is simulated as
+ * soon as both players' input for frame n has arrived.
+ */
+struct match
+{
+	uint32_t id;
+	uint32_t seed;
+	uint32_t frame;
+
+	qdsGame *players[2];
+	struct connection *conns[2];
+
+	/* input ring per player; received counts frames ever received */
+	uint32_t received[2];
+	unsigned char inputs[2][INPUT_WINDOW];
+
+	bool started;
+	/* the winning seat, MATCH_DRAW, or -1 while the match goes on */
+	int winner;
+
+	/* list of matches waiting for an opponent */
+	struct match *next;
+};
+
+extern struct match *newMatch(uint32_t id, uint32_t seed);
+extern void freeMatch(struct match *m);
+
+/*
+ * Queue the input of a player. Returns false if the input is not for
+ * the next frame expected from that player, or if it is too far ahead
+ * of the simulation.
+ */
+extern bool pushInput(struct match *m, int seat, uint32_t frame, int input);
+extern bool inputWindowFull(const struct match *m, int seat);
+
+/*
+ * Simulate the next frame if both inputs for it are available. On
+ * success, the frame's inputs are stored as seat 0 in the low byte
+ * and seat 1 in the high byte.
+ */
+extern bool stepMatch(struct match *m, uint16_t *inputs);
+
+/* hash of everything a desynced client could disagree on */
+extern uint32_t matchHash(const struct match *m);
+
+#endif /* !SERVER_MATCH_H */
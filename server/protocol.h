@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2023 McEndu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/*
+ * Wire format of the match server.
+ *
+ * Every message is MSG_SIZE bytes long, little-endian:
+ *
+ *     offset  size  field
+ *     0       1     type
+ *     1       1     seat
+ *     2       2     input
+ *     4       4     frame
+ *     8       4     value
+ *
+ * A client joins with MSG_JOIN, value being the match to join. Once a
+ * second client joins the same match, both receive MSG_START with
+ * their seat and the match's seed as value. Clients then send one
+ * MSG_INPUT per frame, in order. Each simulated frame is broadcast as
+ * MSG_FRAME, with the input of seat 0 in the low byte of input and
+ * that of seat 1 in the high byte, and the state hash after the frame
+ * as value. MSG_END carries the winning seat, or MATCH_DRAW.
+ */
+#ifndef SERVER_PROTOCOL_H
+#define SERVER_PROTOCOL_H
+
+#include <stdint.h>
+
+#define MSG_SIZE 12
+
+#define MSG_JOIN 1
+#define MSG_START 2
+#define MSG_INPUT 3
+#define MSG_FRAME 4
+#define MSG_END 5
+
+#define MATCH_DRAW 2
+
+struct message
+{
+	uint8_t type;
+	uint8_t seat;
+	uint16_t input;
+	uint32_t frame;
+	uint32_t value;
+};
+
+static inline void put16(unsigned char *p, uint16_t v)
+{
+	p[0] = v;
+	p[1] = v >> 8;
+}
+
+static inline void put32(unsigned char *p, uint32_t v)
+{
+	put16(p, v);
+	put16(p + 2, v >> 16);
+}
+
+static inline uint16_t get16(const unsigned char *p)
+{
+	return p[0] | p[1] << 8;
+}
+
+static inline uint32_t get32(const unsigned char *p)
+{
+	return get16(p) | (uint32_t)get16(p + 2) << 16;
+}
+
+static inline void encodeMessage(unsigned char *buf, const struct message *m)
+{
+	buf[0] = m->type;
+	buf[1] = m->seat;
+	put16(buf + 2, m->input);
+	put32(buf + 4, m->frame);
+	put32(buf + 8, m->value);
+}
+
+static inline void decodeMessage(struct message *m, const unsigned char *buf)
+{
+	m->type = buf[0];
+	m->seat = buf[1];
+	m->input = get16(buf + 2);
+	m->frame = get32(buf + 4);
+	m->value = get32(buf + 8);
+}
+
+#endif /* !SERVER_PROTOCOL_H */
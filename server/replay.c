@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) 2023 McEndu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "replay.h"
+#include "match.h"
+#include "protocol.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+int connectUnix(const char *path)
+{
+	struct sockaddr_un addr = { .sun_family = AF_UNIX };
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+		errno = ENAMETOOLONG;
+		return -1;
+	}
+	strcpy(addr.sun_path, path);
+
+	int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd < 0) return -1;
+	if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+int connectTcp(int port)
+{
+	struct sockaddr_in addr = {
+		.sin_family = AF_INET,
+		.sin_port = htons(port),
+		.sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+	};
+
+	int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd < 0) return -1;
+	if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+static bool writeAll(int fd, const unsigned char *buf, size_t size)
+{
+	while (size > 0) {
+		ssize_t n = send(fd, buf, size, MSG_NOSIGNAL);
+		if (n < 0 && errno == EINTR) continue;
+		if (n <= 0) return false;
+		buf += n;
+		size -= n;
+	}
+	return true;
+}
+
+static bool readMessage(int fd, struct message *m)
+{
+	unsigned char buf[MSG_SIZE];
+	size_t size = 0;
+	while (size < MSG_SIZE) {
+		ssize_t n = read(fd, buf + size, MSG_SIZE - size);
+		if (n < 0 && errno == EINTR) continue;
+		if (n <= 0) return false;
+		size += n;
+	}
+	decodeMessage(m, buf);
+	return true;
+}
+
+/* send inputs up to half an input window ahead of the server */
+static bool sendInputs(int fd,
+					   const unsigned char *inputs,
+					   size_t count,
+					   uint32_t *sent,
+					   uint32_t received)
+{
+	unsigned char buf[MSG_SIZE * INPUT_WINDOW / 2];
+	size_t size = 0;
+
+	for (; *sent < received + INPUT_WINDOW / 2; ++*sent) {
+		struct message m = { .type = MSG_INPUT, .frame = *sent };
+		m.input = *sent < count ? inputs[*sent] : 0;
+		encodeMessage(buf + size, &m);
+		size += MSG_SIZE;
+	}
+
+	return writeAll(fd, buf, size);
+}
+
+bool replayMatch(int fd,
+				 uint32_t id,
+				 const unsigned char *inputs,
+				 size_t count,
+				 struct replayResult *result)
+{
+	result->seat = -1;
+	result->winner = -1;
+	result->frames = 0;
+	result->desyncs = 0;
+
+	unsigned char buf[MSG_SIZE];
+	struct message m = { .type = MSG_JOIN, .value = id };
+	encodeMessage(buf, &m);
+	if (!writeAll(fd, buf, MSG_SIZE)) return false;
+	if (!readMessage(fd, &m) || m.type != MSG_START) return false;
+	result->seat = m.seat;
+
+	struct match *local = newMatch(id, m.value);
+	if (!local) return false;
+
+	bool ok = true;
+	uint32_t sent = 0;
+	while (ok) {
+		ok = sendInputs(fd, inputs, count, &sent, result->frames)
+			 && readMessage(fd, &m);
+		if (!ok) break;
+
+		if (m.type == MSG_END) {
+			result->winner = m.seat;
+			break;
+		} else if (m.type != MSG_FRAME || m.frame != result->frames) {
+			ok = false;
+			break;
+		}
+
+		uint16_t frameInputs;
+		pushInput(local, 0, m.frame, m.input & 0xff);
+		pushInput(local, 1, m.frame, m.input >> 8);
+		stepMatch(local, &frameInputs);
+		if (matchHash(local) != m.value) result->desyncs += 1;
+		result->frames += 1;
+	}
+
+	freeMatch(local);
+	return ok;
+}
@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2023 McEndu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef SERVER_REPLAY_H
+#define SERVER_REPLAY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * A stand-in client that plays back recorded inputs, for driving the
+ * server without a player.
+ */
+struct replayResult
+{
+	int seat;
+	/* the winning seat, MATCH_DRAW, or -1 if the match did not end */
+	int winner;
+	/* frames received from the server */
+	uint32_t frames;
+	/* frames whose hash disagrees with the local simulation */
+	uint32_t desyncs;
+};
+
+extern int connectUnix(const char *path);
+extern int connectTcp(int port);
+
+/*
+ * Join a match and send inputs, one per frame, then no input until the
+ * match ends. Every frame is simulated locally as well, and its hash
+ * compared with the server's. Returns false if the connection fails.
+ */
+extern bool replayMatch(int fd,
+						uint32_t id,
+						const unsigned char *inputs,
+						size_t count,
+						struct replayResult *result);
+
+#endif /* !SERVER_REPLAY_H */
@@ -0,0 +1,474 @@
+/*
+ * Copyright (c) 2023 McEndu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "server.h"
+#include "match.h"
+#include "protocol.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_EVENTS 256
+#define IN_BUFFER (MSG_SIZE * INPUT_WINDOW)
+#define OUT_BUFFER 4096
+
+/*
+ * Everything runs on one thread around one epoll set; matches are
+ * plain data stepped whenever input arrives, so the number of games is
+ * bounded by memory rather than by threads.
+ */
+struct connection
+{
+	int fd;
+	bool listener : 1;
+	bool paused : 1;
+	bool closing : 1;
+	bool closed : 1;
+	bool writing : 1;
+
+	struct match *match;
+	int seat;
+
+	struct connection *prev;
+	struct connection *next;
+	/* closed connections are freed after the events at hand */
+	struct connection *nextClosed;
+
+	size_t inLength;
+	size_t outLength;
+	unsigned char in[IN_BUFFER];
+	unsigned char out[OUT_BUFFER];
+};
+
+struct server
+{
+	int epoll;
+	int stop;
+	uint32_t nextSeed;
+	struct match *waiting;
+	struct connection *connections;
+	struct connection *closed;
+};
+
+static bool watch(struct server *s, struct connection *c, uint32_t events)
+{
+	struct epoll_event ev = { .events = events, .data.ptr = c };
+	if (epoll_ctl(s->epoll, EPOLL_CTL_ADD, c->fd, &ev) < 0) return false;
+
+	c->prev = NULL;
+	c->next = s->connections;
+	if (c->next) c->next->prev = c;
+	s->connections = c;
+	return true;
+}
+
+static void forget(struct server *s, struct connection *c)
+{
+	if (c->prev)
+		c->prev->next = c->next;
+	else
+		s->connections = c->next;
+	if (c->next) c->next->prev = c->prev;
+}
+
+static void rearm(struct server *s, struct connection *c)
+{
+	uint32_t events = 0;
+	if (!c->paused) events |= EPOLLIN;
+	if (c->writing) events |= EPOLLOUT;
+	struct epoll_event ev = { .events = events, .data.ptr = c };
+	epoll_ctl(s->epoll, EPOLL_CTL_MOD, c->fd, &ev);
+}
+
+static struct connection *newConnection(int fd)
+{
+	struct connection *c = malloc(sizeof(struct connection));
+	if (!c) return NULL;
+	c->fd = fd;
+	c->listener = false;
+	c->paused = false;
+	c->closing = false;
+	c->closed = false;
+	c->writing = false;
+	c->nextClosed = NULL;
+	c->match = NULL;
+	c->seat = 0;
+	c->inLength = 0;
+	c->outLength = 0;
+	return c;
+}
+
+struct server *newServer(void)
+{
+	struct server *s = malloc(sizeof(struct server));
+	if (!s) return NULL;
+	s->epoll = epoll_create1(EPOLL_CLOEXEC);
+	s->stop = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	s->nextSeed = time(NULL) ^ getpid();
+	s->waiting = NULL;
+	s->connections = NULL;
+	s->closed = NULL;
+
+	struct epoll_event ev = { .events = EPOLLIN, .data.ptr = NULL };
+	if (s->epoll < 0 || s->stop < 0
+		|| epoll_ctl(s->epoll, EPOLL_CTL_ADD, s->stop, &ev) < 0) {
+		freeServer(s);
+		return NULL;
+	}
+	return s;
+}
+
+void freeServer(struct server *s)
+{
+	while (s->connections) {
+		struct connection *c = s->connections;
+		s->connections = c->next;
+
+		struct match *m = c->match;
+		if (m) {
+			m->conns[c->seat] = NULL;
+			if (!m->conns[!c->seat]) freeMatch(m);
+		}
+		close(c->fd);
+		free(c);
+	}
+
+	if (s->epoll >= 0) close(s->epoll);
+	if (s->stop >= 0) close(s->stop);
+	free(s);
+}
+
+static bool addListener(struct server *s, int fd)
+{
+	struct connection *c;
+	if (listen(fd, SOMAXCONN) < 0 || !(c = newConnection(fd))) {
+		close(fd);
+		return false;
+	}
+	c->listener = true;
+	if (!watch(s, c, EPOLLIN)) {
+		close(fd);
+		free(c);
+		return false;
+	}
+	return true;
+}
+
+bool listenUnix(struct server *s, const char *path)
+{
+	struct sockaddr_un addr = { .sun_family = AF_UNIX };
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+		errno = ENAMETOOLONG;
+		return false;
+	}
+	strcpy(addr.sun_path, path);
+
+	int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (fd < 0) return false;
+	unlink(path);
+	if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+		close(fd);
+		return false;
+	}
+	return addListener(s, fd);
+}
+
+bool listenTcp(struct server *s, int port)
+{
+	struct sockaddr_in addr = {
+		.sin_family = AF_INET,
+		.sin_port = htons(port),
+		.sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+	};
+
+	int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (fd < 0) return false;
+	int one = 1;
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+		close(fd);
+		return false;
+	}
+	return addListener(s, fd);
+}
+
+void stopServer(struct server *s)
+{
+	uint64_t one = 1;
+	write(s->stop, &one, sizeof(one));
+}
+
+static void sendMessage(struct connection *c, const struct message *m)
+{
+	if (!c || c->closing) return;
+	if (c->outLength + MSG_SIZE > OUT_BUFFER) {
+		/* a client this far behind is not keeping up with the match */
+		c->closing = true;
+		return;
+	}
+	encodeMessage(c->out + c->outLength, m);
+	c->outLength += MSG_SIZE;
+}
+
+static void flush(struct server *s, struct connection *c)
+{
+	if (!c || c->closing || c->outLength == 0) return;
+
+	ssize_t n = send(c->fd, c->out, c->outLength, MSG_NOSIGNAL);
+	if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+		c->closing = true;
+		return;
+	}
+	if (n > 0) {
+		memmove(c->out, c->out + n, c->outLength - n);
+		c->outLength -= n;
+	}
+
+	bool writing = c->outLength > 0;
+	if (writing != c->writing) {
+		c->writing = writing;
+		rearm(s, c);
+	}
+}
+
+static void endMatch(struct match *m)
+{
+	struct message end = { .type = MSG_END, .seat = m->winner };
+	end.frame = m->frame;
+	sendMessage(m->conns[0], &end);
+	sendMessage(m->conns[1], &end);
+}
+
+static void join(struct server *s, struct connection *c, uint32_t id)
+{
+	struct match **p = &s->waiting;
+	while (*p && (*p)->id != id) p = &(*p)->next;
+
+	struct match *m = *p;
+	if (!m) {
+		s->nextSeed = s->nextSeed * 1103515245 + 12345;
+		if (!(m = newMatch(id, s->nextSeed))) {
+			c->closing = true;
+			return;
+		}
+		m->conns[0] = c;
+		m->next = s->waiting;
+		s->waiting = m;
+		c->match = m;
+		c->seat = 0;
+		return;
+	}
+
+	*p = m->next;
+	m->next = NULL;
+	m->started = true;
+	m->conns[1] = c;
+	c->match = m;
+	c->seat = 1;
+
+	for (int i = 0; i < 2; ++i) {
+		struct message start = { .type = MSG_START, .seat = i };
+		start.value = m->seed;
+		sendMessage(m->conns[i], &start);
+	}
+}
+
+/*
+ * Handle buffered messages of a connection. Returns whether any were
+ * handled.
+ */
+static bool parse(struct server *s, struct connection *c)
+{
+	size_t used = 0;
+	while (!c->closing && c->inLength - used >= MSG_SIZE) {
+		struct message msg;
+		decodeMessage(&msg, c->in + used);
+
+		struct match *m = c->match;
+		if (msg.type == MSG_JOIN && !m) {
+			join(s, c, msg.value);
+		} else if (msg.type == MSG_INPUT && m && m->started) {
+			if (inputWindowFull(m, c->seat)) break;
+			if (!pushInput(m, c->seat, msg.frame, msg.input))
+				c->closing = true;
+		} else {
+			c->closing = true;
+		}
+		used += MSG_SIZE;
+	}
+
+	memmove(c->in, c->in + used, c->inLength - used);
+	c->inLength -= used;
+
+	/* read more only once the buffer has room for it */
+	bool paused = c->inLength == IN_BUFFER;
+	if (paused != c->paused && !c->closing) {
+		c->paused = paused;
+		rearm(s, c);
+	}
+	return used > 0;
+}
+
+static void serviceMatch(struct server *s, struct match *m)
+{
+	bool progress = true;
+	while (progress) {
+		progress = false;
+		for (int i = 0; i < 2; ++i) {
+			if (m->conns[i]) progress |= parse(s, m->conns[i]);
+		}
+
+		uint16_t inputs;
+		while (stepMatch(m, &inputs)) {
+			struct message frame = { .type = MSG_FRAME, .input = inputs };
+			frame.frame = m->frame - 1;
+			frame.value = matchHash(m);
+			sendMessage(m->conns[0], &frame);
+			sendMessage(m->conns[1], &frame);
+			if (m->winner >= 0) endMatch(m);
+			progress = true;
+		}
+	}
+}
+
+static void closeConnection(struct server *s, struct connection *c)
+{
+	struct match *m = c->match;
+	if (m) {
+		m->conns[c->seat] = NULL;
+		struct connection *other = m->conns[!c->seat];
+
+		if (!m->started) {
+			/* still waiting for an opponent */
+			struct match **p = &s->waiting;
+			while (*p != m) p = &(*p)->next;
+			*p = m->next;
+		} else if (m->winner < 0) {
+			/* leaving a match forfeits it */
+			m->winner = !c->seat;
+			endMatch(m);
+			flush(s, other);
+		}
+
+		if (!other) freeMatch(m);
+	}
+
+	epoll_ctl(s->epoll, EPOLL_CTL_DEL, c->fd, NULL);
+	close(c->fd);
+	forget(s, c);
+	c->closed = true;
+	c->nextClosed = s->closed;
+	s->closed = c;
+}
+
+static void acceptClients(struct server *s, struct connection *listener)
+{
+	int fd;
+	while ((fd = accept(listener->fd, NULL, NULL)) >= 0) {
+		fcntl(fd, F_SETFL, O_NONBLOCK);
+		fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+		int one = 1;
+		setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+		struct connection *c = newConnection(fd);
+		if (!c || !watch(s, c, EPOLLIN)) {
+			close(fd);
+			free(c);
+		}
+	}
+}
+
+static void readable(struct server *s, struct connection *c)
+{
+	ssize_t n = read(c->fd, c->in + c->inLength, IN_BUFFER - c->inLength);
+	if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+		c->closing = true;
+		return;
+	}
+	if (n > 0) c->inLength += n;
+}
+
+static void handle(struct server *s, struct connection *c, uint32_t events)
+{
+	if (c->closed) return;
+	if (c->listener) {
+		acceptClients(s, c);
+		return;
+	}
+
+	if (events & EPOLLIN) readable(s, c);
+	if (events & EPOLLERR) c->closing = true;
+	/* a paused connection only hears of a hangup this way */
+	if (events & EPOLLHUP && !(events & EPOLLIN)) c->closing = true;
+
+	struct match *m = c->match;
+	if (!c->closing && !m) {
+		parse(s, c);
+		m = c->match;
+	}
+
+	if (m) {
+		serviceMatch(s, m);
+		struct connection *conns[2] = { m->conns[0], m->conns[1] };
+		for (int i = 0; i < 2; ++i) flush(s, conns[i]);
+		for (int i = 0; i < 2; ++i) {
+			if (conns[i] && conns[i]->closing) closeConnection(s, conns[i]);
+		}
+	} else {
+		flush(s, c);
+		if (c->closing) closeConnection(s, c);
+	}
+}
+
+bool runServer(struct server *s)
+{
+	struct epoll_event events[MAX_EVENTS];
+	for (;;) {
+		int n = epoll_wait(s->epoll, events, MAX_EVENTS, -1);
+		if (n < 0 && errno == EINTR) continue;
+		if (n < 0) return false;
+
+		for (int i = 0; i < n; ++i) {
+			if (!events[i].data.ptr) return true;
+			handle(s, events[i].data.ptr, events[i].events);
+		}
+
+		while (s->closed) {
+			struct connection *c = s->closed;
+			s->closed = c->nextClosed;
+			free(c);
+		}
+	}
+}
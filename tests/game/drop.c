@@ -139,6 +139,67 @@ START_TEST(cancel)
 }
 END_TEST
 
+START_TEST(instantDrop)
+{
+	const qdsLine lines[] = {
+		{ 8, 8, 8, 8, 0, 8, 8, 8, 8, 8 },
+		{ 0, 0, 0, 0, 8, 0, 0, 0, 0, 0 },
+	};
+	qdsAddLines(game, lines, 2);
+	qdsSpawn(game, QDS_PIECE_O);
+
+	ck_assert_int_eq(qdsInstantDrop(game, QDS_DROP_HARD), 18);
+	ck_assert_int_eq(game->y, 2);
+	ck_assert_int_eq(rsData->dropDistance, 18);
+	ck_assert_int_eq(modeData->dropDistance, 18);
+	ck_assert(qdsGrounded(game));
+
+	/* column heights follow locking and line clears */
+	qdsLock(game);
+	qdsSpawn(game, QDS_PIECE_O);
+	ck_assert_int_eq(qdsInstantDrop(game, QDS_DROP_HARD), 16);
+	ck_assert_int_eq(game->y, 4);
+
+	qdsClearLine(game, 0);
+	qdsSpawn(game, QDS_PIECE_O);
+	ck_assert_int_eq(qdsInstantDrop(game, QDS_DROP_HARD), 17);
+	ck_assert_int_eq(game->y, 3);
+
+	qdsClearPlayfield(game);
+	qdsSpawn(game, QDS_PIECE_O);
+	ck_assert_int_eq(qdsInstantDrop(game, QDS_DROP_HARD), 20);
+	ck_assert_int_eq(game->y, 0);
+}
+END_TEST
+
+START_TEST(instantDropOverhang)
+{
+	const qdsLine lines[] = {
+		{ 8, 8, 8, 8, 0, 0, 8, 8, 8, 8 },
+		{ 8, 8, 8, 8, 0, 0, 8, 8, 8, 8 },
+		{ 8, 8, 8, 8, 0, 0, 8, 8, 8, 8 },
+		{ 0, 0, 0, 0, 8, 8, 0, 0, 0, 0 },
+	};
+	qdsAddLines(game, lines, 4);
+	qdsSpawn(game, QDS_PIECE_O);
+	ck_assert(qdsTeleport(game, 0, -(game->y - 1)));
+
+	ck_assert_int_eq(qdsInstantDrop(game, QDS_DROP_HARD), 1);
+	ck_assert_int_eq(game->y, 0);
+	ck_assert(qdsGrounded(game));
+}
+END_TEST
+
+START_TEST(instantDropCancel)
+{
+	qdsSpawn(game, QDS_PIECE_O);
+	int y = game->y;
+	rsData->blockDrop = true;
+	ck_assert_int_eq(qdsInstantDrop(game, QDS_DROP_HARD), 0);
+	ck_assert_int_eq(game->y, y);
+}
+END_TEST
+
 TCase *caseDrop(void)
 {
 	TCase *c = tcase_create("caseDrop");
@@ -147,5 +208,8 @@ TCase *caseDrop(void)
 	tcase_add_test(c, edgeCollision);
 	tcase_add_test(c, tileCollision);
 	tcase_add_test(c, cancel);
+	tcase_add_test(c, instantDrop);
+	tcase_add_test(c, instantDropOverhang);
+	tcase_add_test(c, instantDropCancel);
 	return c;
 }
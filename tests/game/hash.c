@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) 2023 McEndu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <check.h>
+
+#include <stdint.h>
+
+#include "mockruleset.h"
+#include <game.h>
+#include <quadus.h>
+#include <quadus/ruleset.h>
+#include <quadus/versus.h>
+
+static qdsGame *game = &(qdsGame){ 0 };
+
+static void setup(void)
+{
+	qdsInitGame(game);
+	qdsSetRuleset(game, mockRuleset);
+	qdsSetMode(game, mockGamemode);
+}
+
+static void teardown(void)
+{
+	qdsCleanupGame(game);
+}
+
+/* check the maintained hash against one calculated from scratch */
+static void checkFieldHash(qdsGame *game)
+{
+	qdsGame *copy = &(qdsGame){ 0 };
+	qdsInitGame(copy);
+	qdsSetRuleset(copy, mockRuleset);
+	qdsAddLines(copy, game->playfield, game->height);
+	ck_assert(qdsGetFieldHash(copy) == qdsGetFieldHash(game));
+	qdsCleanupGame(copy);
+}
+
+static void lockAt(qdsGame *game, int piece, int x, int y)
+{
+	qdsSpawn(game, piece);
+	game->x = x;
+	game->y = y;
+	ck_assert(qdsLock(game));
+}
+
+START_TEST(incremental)
+{
+	ck_assert(qdsGetFieldHash(game) == 0);
+
+	const qdsLine lines[] = {
+		{ 8, 8, 8, 8, 8, 0, 8, 8, 8, 8 },
+		{ 8, 8, 8, 8, 8, 8, 8, 8, 8, 0 },
+	};
+	qdsAddLines(game, lines, 2);
+	checkFieldHash(game);
+
+	lockAt(game, QDS_PIECE_T, 3, 2);
+	checkFieldHash(game);
+	lockAt(game, QDS_PIECE_O, 7, 2);
+	checkFieldHash(game);
+
+	qdsClearLine(game, 0);
+	checkFieldHash(game);
+	qdsClearLine(game, 2);
+	checkFieldHash(game);
+
+	qdsClearPlayfield(game);
+	ck_assert(qdsGetFieldHash(game) == 0);
+}
+END_TEST
+
+/* the field hash depends on the tiles, not how they got there */
+START_TEST(transposition)
+{
+	qdsGame *other = &(qdsGame){ 0 };
+	qdsInitGame(other);
+	qdsSetRuleset(other, mockRuleset);
+
+	lockAt(game, QDS_PIECE_O, 1, 0);
+	lockAt(game, QDS_PIECE_I, 6, 0);
+	lockAt(other, QDS_PIECE_I, 6, 0);
+	ck_assert(qdsGetFieldHash(game) != qdsGetFieldHash(other));
+	lockAt(other, QDS_PIECE_O, 1, 0);
+	ck_assert(qdsGetFieldHash(game) == qdsGetFieldHash(other));
+
+	/* the same rows in another order are another playfield */
+	const qdsLine lines[] = {
+		{ 8, 8, 8, 8, 8, 0, 8, 8, 8, 8 },
+		{ 8, 8, 8, 8, 8, 8, 8, 8, 8, 0 },
+	};
+	qdsClearPlayfield(game);
+	qdsClearPlayfield(other);
+	qdsAddLines(game, &lines[0], 1);
+	qdsAddLines(game, &lines[1], 1);
+	qdsAddLines(other, &lines[1], 1);
+	qdsAddLines(other, &lines[0], 1);
+	ck_assert(qdsGetFieldHash(game) != qdsGetFieldHash(other));
+
+	qdsCleanupGame(other);
+}
+END_TEST
+
+START_TEST(lockstep)
+{
+	qdsGame *a = qdsNewGame(), *b = qdsNewGame();
+	qdsSetRuleset(a, &qdsRulesetStandard);
+	qdsSetRuleset(b, &qdsRulesetStandard);
+	qdsSetMode(a, &qdsModeVersus);
+	qdsSetMode(b, &qdsModeVersus);
+	ck_assert(qdsVersusPair(a, b, 11));
+
+	static const unsigned int inputs[] = {
+		0,
+		QDS_INPUT_LEFT,
+		QDS_INPUT_ROTATE_C,
+		QDS_INPUT_HARD_DROP,
+		QDS_INPUT_RIGHT,
+		QDS_INPUT_HOLD,
+		QDS_INPUT_HARD_DROP,
+	};
+	for (int i = 0; i < 500; ++i) {
+		qdsRunCycle(a, inputs[i / 3 % 7]);
+		qdsRunCycle(b, inputs[i / 3 % 7]);
+		ck_assert(qdsGetStateHash(a) == qdsGetStateHash(b));
+		checkFieldHash(a);
+	}
+
+	/* a single differing input is noticed */
+	qdsRunCycle(a, QDS_INPUT_LEFT);
+	qdsRunCycle(b, QDS_INPUT_RIGHT);
+	ck_assert(qdsGetStateHash(a) != qdsGetStateHash(b));
+
+	qdsDestroyGame(a);
+	qdsDestroyGame(b);
+}
+END_TEST
+
+TCase *caseHash(void)
+{
+	TCase *c = tcase_create("caseHash");
+	tcase_add_checked_fixture(c, setup, teardown);
+	tcase_add_test(c, incremental);
+	tcase_add_test(c, transposition);
+	tcase_add_test(c, lockstep);
+	return c;
+}
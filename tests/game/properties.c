@@ -48,7 +48,7 @@ static void teardown(void)
 START_TEST(getPlayfield)
 {
 	const void *p = qdsGetPlayfield(game);
-	ck_assert_ptr_eq(p, &game->playfield);
+	ck_assert_ptr_eq(p, game->playfield);
 }
 END_TEST
 
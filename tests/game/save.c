@@ -0,0 +1,256 @@
+/*
+ * Copyright (c) 2023 McEndu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <check.h>
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "play.h"
+#include <quadus.h>
+#include <quadus/calls.h>
+#include <quadus/ruleset.h>
+#include <quadus/versus.h>
+
+static qdsGame *newGame(const qdsRuleset *rs, const qdsGamemode *mode)
+{
+	return newPlayGame(rs, mode, QDS_DEFAULT_WIDTH, QDS_DEFAULT_HEIGHT);
+}
+
+static size_t save(qdsGame *game, unsigned char **buf)
+{
+	size_t size = qdsSaveGame(game, NULL, 0);
+	ck_assert_uint_ne(size, 0);
+	*buf = malloc(size);
+	ck_assert_uint_eq(qdsSaveGame(game, *buf, size), size);
+	return size;
+}
+
+/* a loaded game must carry on exactly like the saved one */
+static void checkRoundTrip(const qdsRuleset *rs, const qdsGamemode *mode)
+{
+	qdsGame *a = newGame(rs, mode), *b = newGame(rs, mode);
+	for (int i = 0; i < 600; ++i) qdsRunCycle(a, playInput(i));
+
+	unsigned char *buf;
+	size_t size = save(a, &buf);
+	ck_assert(qdsLoadGame(b, buf, size));
+	ck_assert(qdsGetStateHash(a) == qdsGetStateHash(b));
+
+	for (int i = 0; i < 600; ++i) {
+		qdsRunCycle(a, playInput(i + 1));
+		qdsRunCycle(b, playInput(i + 1));
+		ck_assert(qdsGetStateHash(a) == qdsGetStateHash(b));
+	}
+
+	free(buf);
+	qdsDestroyGame(a);
+	qdsDestroyGame(b);
+}
+
+START_TEST(roundTrip)
+{
+	checkRoundTrip(&qdsRulesetStandard, &qdsModeMarathon);
+	checkRoundTrip(&qdsRulesetStandard, &qdsModeSprint);
+	checkRoundTrip(&qdsRulesetArcade, &qdsModeMaster);
+	checkRoundTrip(&qdsRulesetTgm, &qdsModeMaster);
+}
+END_TEST
+
+START_TEST(roundTripVersus)
+{
+	qdsGame *a = newGame(&qdsRulesetStandard, &qdsModeVersus);
+	qdsGame *b = newGame(&qdsRulesetStandard, &qdsModeVersus);
+	qdsGame *c = newGame(&qdsRulesetStandard, &qdsModeVersus);
+	qdsGame *d = newGame(&qdsRulesetStandard, &qdsModeVersus);
+	ck_assert(qdsVersusPair(a, b, 5));
+	ck_assert(qdsVersusPair(c, d, 9));
+
+	/* trade some garbage first */
+	for (int i = 0; i < 900; ++i) {
+		qdsRunCycle(a, playInput(i));
+		qdsRunCycle(b, playInput(i + 7));
+	}
+
+	unsigned char *bufA, *bufB;
+	size_t sizeA = save(a, &bufA), sizeB = save(b, &bufB);
+	ck_assert(qdsLoadGame(c, bufA, sizeA));
+	ck_assert(qdsLoadGame(d, bufB, sizeB));
+
+	for (int i = 0; i < 900; ++i) {
+		qdsRunCycle(a, playInput(i + 2));
+		qdsRunCycle(b, playInput(i + 3));
+		qdsRunCycle(c, playInput(i + 2));
+		qdsRunCycle(d, playInput(i + 3));
+		ck_assert(qdsGetStateHash(a) == qdsGetStateHash(c));
+		ck_assert(qdsGetStateHash(b) == qdsGetStateHash(d));
+	}
+
+	free(bufA);
+	free(bufB);
+	qdsDestroyGame(a);
+	qdsDestroyGame(b);
+	qdsDestroyGame(c);
+	qdsDestroyGame(d);
+}
+END_TEST
+
+START_TEST(shortBuffer)
+{
+	qdsGame *game = newGame(&qdsRulesetStandard, &qdsModeMarathon);
+	for (int i = 0; i < 300; ++i) qdsRunCycle(game, playInput(i));
+
+	unsigned char *buf;
+	size_t size = save(game, &buf);
+	unsigned char *copy = malloc(size);
+	memset(copy, 0xa5, size);
+	ck_assert_uint_eq(qdsSaveGame(game, copy, size - 1), size);
+	ck_assert_mem_eq(copy, buf, size - 1);
+	ck_assert_uint_eq(copy[size - 1], 0xa5);
+
+	free(buf);
+	free(copy);
+	qdsDestroyGame(game);
+}
+END_TEST
+
+START_TEST(damaged)
+{
+	qdsGame *a = newGame(&qdsRulesetArcade, &qdsModeMaster);
+	qdsGame *b = newGame(&qdsRulesetArcade, &qdsModeMaster);
+	for (int i = 0; i < 600; ++i) qdsRunCycle(a, playInput(i));
+
+	unsigned char *buf;
+	size_t size = save(a, &buf);
+
+	uint64_t hash = qdsGetStateHash(b);
+	for (size_t i = 0; i < size; ++i) {
+		ck_assert(!qdsLoadGame(b, buf, i));
+		ck_assert(qdsGetStateHash(b) == hash);
+	}
+
+	unsigned char *longer = malloc(size + 1);
+	memcpy(longer, buf, size);
+	longer[size] = 0;
+	ck_assert(!qdsLoadGame(b, longer, size + 1));
+
+	buf[0] ^= 1;
+	ck_assert(!qdsLoadGame(b, buf, size));
+	buf[0] ^= 1;
+	buf[3] += 1;
+	ck_assert(!qdsLoadGame(b, buf, size));
+	buf[3] -= 1;
+
+	/* whatever else is changed must not break the game */
+	for (size_t i = 0; i < size; ++i) {
+		for (int bit = 0; bit < 8; ++bit) {
+			buf[i] ^= 1 << bit;
+			/* a failed load leaves the game as it was */
+			hash = qdsGetStateHash(b);
+			if (!qdsLoadGame(b, buf, size)) {
+				ck_assert(qdsGetStateHash(b) == hash);
+				qdsLoadGame(b, longer, size);
+			}
+			for (int j = 0; j < 10; ++j) qdsRunCycle(b, playInput(j));
+			buf[i] ^= 1 << bit;
+		}
+	}
+
+	free(buf);
+	free(longer);
+	qdsDestroyGame(a);
+	qdsDestroyGame(b);
+}
+END_TEST
+
+START_TEST(mismatch)
+{
+	qdsGame *a = newGame(&qdsRulesetStandard, &qdsModeMarathon);
+	for (int i = 0; i < 300; ++i) qdsRunCycle(a, playInput(i));
+
+	unsigned char *buf;
+	size_t size = save(a, &buf);
+
+	qdsGame *b = newGame(&qdsRulesetArcade, &qdsModeMarathon);
+	ck_assert(!qdsLoadGame(b, buf, size));
+	qdsDestroyGame(b);
+
+	b = newGame(&qdsRulesetStandard, &qdsModeSprint);
+	ck_assert(!qdsLoadGame(b, buf, size));
+	qdsDestroyGame(b);
+
+	free(buf);
+	qdsDestroyGame(a);
+}
+END_TEST
+
+/* Standard, until it is told to refuse saving its state */
+static bool refuseSave;
+
+static int refusingCall(qdsGame *game, unsigned long req, void *argp)
+{
+	if (refuseSave && req == QDS_SAVESTATE) return -EINVAL;
+	return qdsRulesetStandard.call(game, req, argp);
+}
+
+START_TEST(unsaveable)
+{
+	qdsGame *a = newGame(&qdsRulesetStandard, &qdsModeMarathon);
+	for (int i = 0; i < 300; ++i) qdsRunCycle(a, playInput(i));
+	unsigned char *buf;
+	size_t size = save(a, &buf);
+
+	qdsRuleset refusing = qdsRulesetStandard;
+	refusing.call = refusingCall;
+	qdsGame *b = newGame(&refusing, &qdsModeMarathon);
+	for (int i = 0; i < 100; ++i) qdsRunCycle(b, playInput(i));
+	refuseSave = false;
+	ck_assert(qdsLoadGame(b, buf, size));
+	ck_assert(qdsGetStateHash(a) == qdsGetStateHash(b));
+
+	/* without a state to fall back on, nothing is loaded */
+	for (int i = 0; i < 100; ++i) qdsRunCycle(b, playInput(i));
+	uint64_t hash = qdsGetStateHash(b);
+	refuseSave = true;
+	ck_assert(!qdsLoadGame(b, buf, size));
+	ck_assert(qdsGetStateHash(b) == hash);
+
+	free(buf);
+	qdsDestroyGame(a);
+	qdsDestroyGame(b);
+}
+END_TEST
+
+TCase *caseSave(void)
+{
+	TCase *c = tcase_create("caseSave");
+	tcase_add_test(c, roundTrip);
+	tcase_add_test(c, roundTripVersus);
+	tcase_add_test(c, shortBuffer);
+	tcase_add_test(c, damaged);
+	tcase_add_test(c, mismatch);
+	tcase_add_test(c, unsaveable);
+	return c;
+}
@@ -0,0 +1,258 @@
+/*
+ * Copyright (c) 2023 McEndu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <check.h>
+
+#include <errno.h>
+#include <stdlib.h>
+
+#include "mockruleset.h"
+#include "play.h"
+#include <game.h>
+#include <quadus.h>
+#include <quadus/calls.h>
+#include <quadus/ruleset/utils.h>
+#include <quadus/versus.h>
+
+/* nothing may ever be left past the edges of the playfield */
+static void checkBounds(qdsGame *game)
+{
+	int width = qdsGetFieldWidth(game), rows = qdsGetFieldRows(game);
+	ck_assert_int_le(qdsGetFieldHeight(game), rows);
+	for (int y = 0; y < rows; ++y) {
+		for (int x = width; x < QDS_MAX_WIDTH; ++x)
+			ck_assert_int_eq(game->playfield[y][x], 0);
+	}
+}
+
+START_TEST(sizes)
+{
+	qdsGame *game = qdsNewGame();
+	ck_assert_int_eq(qdsGetFieldWidth(game), QDS_DEFAULT_WIDTH);
+	ck_assert_int_eq(qdsGetFieldRows(game), QDS_DEFAULT_ROWS);
+
+	ck_assert(!qdsSetFieldSize(game, QDS_MIN_WIDTH - 1, 20));
+	ck_assert(!qdsSetFieldSize(game, QDS_MAX_WIDTH + 1, 20));
+	ck_assert(!qdsSetFieldSize(game, 10, QDS_MIN_HEIGHT - 1));
+	ck_assert(!qdsSetFieldSize(game, 10, QDS_MAX_HEIGHT + 1));
+	ck_assert_int_eq(qdsGetFieldWidth(game), QDS_DEFAULT_WIDTH);
+	ck_assert_int_eq(qdsGetFieldRows(game), QDS_DEFAULT_ROWS);
+
+	ck_assert(qdsSetFieldSize(game, QDS_MAX_WIDTH, QDS_MAX_HEIGHT));
+	ck_assert_int_eq(qdsGetFieldWidth(game), QDS_MAX_WIDTH);
+	ck_assert_int_eq(qdsGetFieldRows(game), QDS_MAX_ROWS);
+	ck_assert(qdsSetFieldSize(game, 4, 20));
+	ck_assert_int_eq(qdsGetFieldWidth(game), 4);
+	ck_assert_int_eq(qdsGetFieldRows(game), 48);
+	qdsDestroyGame(game);
+
+	ck_assert_ptr_null(qdsNewGameSized(3, 20));
+	ck_assert_ptr_null(qdsNewGameSized(10, 0));
+}
+END_TEST
+
+START_TEST(narrow)
+{
+	qdsGame *game = newPlayGame(mockRuleset, mockGamemode, 4, 20);
+	mockRulesetData *rsData = game->rsData;
+
+	ck_assert_int_eq(qdsGetTile(game, 3, 0), 0);
+	ck_assert_int_eq(qdsGetTile(game, 4, 0), QDS_PIECE_WALL);
+
+	/* an I piece fills the whole width */
+	qdsSpawn(game, QDS_PIECE_I);
+	game->x = 1;
+	ck_assert(qdsCanMove(game, 0, 0));
+	ck_assert(!qdsCanMove(game, 1, 0));
+	ck_assert(!qdsCanMove(game, -1, 0));
+	ck_assert_int_eq(qdsInstantDrop(game, QDS_DROP_HARD), 20);
+	ck_assert_int_eq(game->y, 0);
+	ck_assert(qdsLock(game));
+	ck_assert_int_eq(rsData->lineFillCount, 1);
+	ck_assert_int_eq(qdsGetFieldHeight(game), 1);
+
+	ck_assert(qdsClearLine(game, 0));
+	ck_assert_int_eq(qdsGetFieldHeight(game), 0);
+	ck_assert(qdsGetFieldHash(game) == 0);
+
+	/* tiles of wider lines are cut off */
+	const qdsLine garbage = { 8, 8, 0, 8, 8, 8, 8, 8, 8, 8 };
+	ck_assert(qdsAddLines(game, &garbage, 1));
+	ck_assert_int_eq(qdsGetTile(game, 3, 0), 8);
+	checkBounds(game);
+	qdsDestroyGame(game);
+}
+END_TEST
+
+START_TEST(tall)
+{
+	qdsGame *game = newPlayGame(mockRuleset, mockGamemode, 10, 60);
+	ck_assert_int_eq(qdsGetFieldRows(game), 88);
+
+	qdsLine garbage[70];
+	for (int i = 0; i < 70; ++i) {
+		for (int x = 0; x < 16; ++x) garbage[i][x] = x < 10 && x != i % 10;
+	}
+	ck_assert(qdsAddLines(game, garbage, 70));
+	ck_assert_int_eq(qdsGetFieldHeight(game), 70);
+	ck_assert_int_eq(qdsGetTile(game, 0, 69), 1);
+	ck_assert_int_eq(qdsGetTile(game, 0, 87), 0);
+	ck_assert_int_eq(qdsGetTile(game, 0, 88), QDS_PIECE_WALL);
+
+	qdsSpawn(game, QDS_PIECE_I);
+	game->y = 80;
+	ck_assert_int_eq(qdsInstantDrop(game, QDS_DROP_HARD), 10);
+	ck_assert_int_eq(game->y, 70);
+
+	/* the same rows hash the same however they got there */
+	qdsGame *copy = newPlayGame(mockRuleset, mockGamemode, 10, 60);
+	ck_assert(qdsAddLines(copy, garbage, 70));
+	ck_assert(qdsGetFieldHash(game) == qdsGetFieldHash(copy));
+	ck_assert(qdsLock(game));
+	ck_assert(qdsGetFieldHash(game) != qdsGetFieldHash(copy));
+	qdsDestroyGame(copy);
+
+	ck_assert(!qdsAddLines(game, garbage, 20));
+	ck_assert_int_eq(qdsGetFieldHeight(game), 88);
+	qdsDestroyGame(game);
+}
+END_TEST
+
+static int gravityCall(qdsGame *game, unsigned long req, void *argp)
+{
+	if (req != QDS_GETGRAVITY) return -ENOTTY;
+	*(int *)argp = 20 * 65536;
+	return 0;
+}
+
+/* 20G only reaches the floor at once if the visible field is 20 rows */
+START_TEST(tallGravity)
+{
+	qdsGamemode mode = *noHandlerGamemode;
+	mode.call = gravityCall;
+	qdsGame *game = newPlayGame(&qdsRulesetStandard, &mode, 10, 100);
+
+	qdsRunCycle(game, 0);
+	ck_assert_int_ne(qdsGetActivePieceType(game), QDS_PIECE_NONE);
+	int y = qdsGetActiveY(game);
+	ck_assert_int_lt(y, 100);
+	ck_assert_int_ge(y, 80);
+	for (int i = 0; i < 3; ++i) {
+		qdsRunCycle(game, 0);
+		ck_assert_int_eq(qdsGetActiveY(game), y - 20);
+		y -= 20;
+	}
+	qdsDestroyGame(game);
+}
+END_TEST
+
+/* built-in rulesets and modes play on any playfield */
+static void checkPlay(const qdsRuleset *rs, const qdsGamemode *mode)
+{
+	static const int sizes[][2] = { { 4, 20 }, { 7, 8 }, { 16, 100 } };
+	for (size_t i = 0; i < sizeof(sizes) / sizeof(*sizes); ++i) {
+		qdsGame *a = newPlayGame(rs, mode, sizes[i][0], sizes[i][1]);
+		qdsGame *b = newPlayGame(rs, mode, sizes[i][0], sizes[i][1]);
+		ck_assert_int_eq(rs->spawnY(a), sizes[i][1]);
+
+		for (int j = 0; j < 1500; ++j) {
+			qdsRunCycle(a, playInput(j));
+			checkBounds(a);
+		}
+
+		size_t size = qdsSaveGame(a, NULL, 0);
+		ck_assert_uint_ne(size, 0);
+		unsigned char *buf = malloc(size);
+		ck_assert_uint_eq(qdsSaveGame(a, buf, size), size);
+		ck_assert(qdsLoadGame(b, buf, size));
+		ck_assert(qdsGetStateHash(a) == qdsGetStateHash(b));
+
+		/* snapshots only load into games of the same size */
+		qdsGame *other = newPlayGame(rs, mode, 10, 20);
+		ck_assert(!qdsLoadGame(other, buf, size));
+		qdsDestroyGame(other);
+
+		free(buf);
+		qdsDestroyGame(a);
+		qdsDestroyGame(b);
+	}
+}
+
+START_TEST(play)
+{
+	checkPlay(&qdsRulesetStandard, &qdsModeMarathon);
+	checkPlay(&qdsRulesetStandard, &qdsModeVersus);
+	checkPlay(&qdsRulesetArcade, &qdsModeMaster);
+	checkPlay(&qdsRulesetTgm, &qdsModeMaster);
+}
+END_TEST
+
+/* garbage rising partway keeps its hole, wherever it is on the row */
+START_TEST(versusHole)
+{
+	int hole = -1;
+	for (unsigned int seed = 0; seed < 64 && hole < 10; ++seed) {
+		qdsGame *a = newPlayGame(&qdsRulesetStandard, &qdsModeVersus, 16, 20);
+		qdsGame *b = newPlayGame(&qdsRulesetStandard, &qdsModeVersus, 16, 20);
+		ck_assert(qdsVersusPair(a, b, seed));
+
+		/* send more than rises at once, then lock without clearing */
+		qdsRulesetState *state = qdsGetRulesetData(a);
+		state->clearType = QDS_LINECLEAR_QUADUS | QDS_LINECLEAR_ALLCLEAR;
+		a->mode->events.postLock(a);
+		state = qdsGetRulesetData(b);
+		state->clearType = 0;
+		b->mode->events.postLock(b);
+
+		int incoming;
+		ck_assert_int_eq(qdsCall(b, QDS_GETINCOMING, &incoming), 0);
+		ck_assert_int_gt(incoming, 0);
+		for (hole = 0; hole < 16 && b->playfield[0][hole]; ++hole);
+		ck_assert_int_lt(hole, 16);
+
+		size_t size = qdsSaveGame(b, NULL, 0);
+		unsigned char *buf = malloc(size);
+		ck_assert_uint_eq(qdsSaveGame(b, buf, size), size);
+		qdsGame *c = newPlayGame(&qdsRulesetStandard, &qdsModeVersus, 16, 20);
+		ck_assert(qdsLoadGame(c, buf, size));
+		ck_assert(qdsGetStateHash(b) == qdsGetStateHash(c));
+
+		free(buf);
+		qdsDestroyGame(a);
+		qdsDestroyGame(b);
+		qdsDestroyGame(c);
+	}
+	ck_assert_int_ge(hole, 10);
+}
+END_TEST
+
+TCase *caseSize(void)
+{
+	TCase *c = tcase_create("caseSize");
+	tcase_add_test(c, sizes);
+	tcase_add_test(c, narrow);
+	tcase_add_test(c, tall);
+	tcase_add_test(c, tallGravity);
+	tcase_add_test(c, play);
+	tcase_add_test(c, versusHole);
+	return c;
+}
@@ -26,6 +26,7 @@ extern TCase *caseAddLines(void);
 extern TCase *caseClear(void);
 extern TCase *caseCycle(void);
 extern TCase *caseDrop(void);
+extern TCase *caseHash(void);
 extern TCase *caseHold(void);
 extern TCase *caseInit(void);
 extern TCase *caseLock(void);
@@ -34,6 +35,8 @@ extern TCase *caseOverlap(void);
 extern TCase *caseProperties(void);
 extern TCase *caseRotate(void);
 extern TCase *caseRotateWithKick(void);
+extern TCase *caseSave(void);
+extern TCase *caseSize(void);
 extern TCase *caseSpawn(void);
 extern TCase *caseSpawnNoHandler(void);
 
@@ -44,6 +47,7 @@ Suite *createSuite(void)
 	suite_add_tcase(s, caseClear());
 	suite_add_tcase(s, caseCycle());
 	suite_add_tcase(s, caseDrop());
+	suite_add_tcase(s, caseHash());
 	suite_add_tcase(s, caseHold());
 	suite_add_tcase(s, caseInit());
 	suite_add_tcase(s, caseLock());
@@ -52,6 +56,8 @@ Suite *createSuite(void)
 	suite_add_tcase(s, caseProperties());
 	suite_add_tcase(s, caseRotate());
 	suite_add_tcase(s, caseRotateWithKick());
+	suite_add_tcase(s, caseSave());
+	suite_add_tcase(s, caseSize());
 	suite_add_tcase(s, caseSpawn());
 	suite_add_tcase(s, caseSpawnNoHandler());
 	return s;
@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2023 McEndu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <check.h>
+
+#include <quadus.h>
+#include <quadus/calls.h>
+#include <quadus/ruleset.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+static qdsGame *game;
+
+static void setup(void)
+{
+	game = qdsNewGameSized(10, 60);
+	if (!game) abort();
+	qdsSetRuleset(game, &qdsRulesetStandard);
+}
+
+static void teardown(void)
+{
+	qdsDestroyGame(game);
+}
+
+/* every row is hidden, and nothing past the playfield is written */
+START_TEST(invisible)
+{
+	qdsSetMode(game, &qdsModeInvisible);
+	const qdsLine lines[] = {
+		{ 1, 1, 1, 1, 0, 1, 1, 1, 1, 1 },
+	};
+	qdsAddLines(game, lines, 1);
+
+	uint_fast16_t visibility[QDS_MAX_ROWS];
+	for (int y = 0; y < QDS_MAX_ROWS; ++y) visibility[y] = 0xffff;
+	ck_assert_int_eq(qdsCall(game, QDS_GETFIELDVISIBILITY, visibility), 0);
+	for (int y = 0; y < qdsGetFieldRows(game); ++y) {
+		ck_assert_uint_eq(visibility[y], 0);
+
+		uint_fast16_t line = y;
+		ck_assert_int_eq(qdsCall(game, QDS_GETVISIBILITY, &line), 0);
+		ck_assert_uint_eq(line, 0);
+	}
+	for (int y = qdsGetFieldRows(game); y < QDS_MAX_ROWS; ++y)
+		ck_assert_uint_eq(visibility[y], 0xffff);
+}
+END_TEST
+
+/* the plain mode leaves every tile shown */
+START_TEST(visible)
+{
+	qdsSetMode(game, &qdsModeMarathon);
+
+	uint_fast16_t visibility[QDS_MAX_ROWS];
+	ck_assert_int_lt(qdsCall(game, QDS_GETFIELDVISIBILITY, visibility), 0);
+}
+END_TEST
+
+Suite *createSuite(void)
+{
+	Suite *s = suite_create("qdsModeMarathon");
+
+	TCase *c = tcase_create("visibility");
+	tcase_add_checked_fixture(c, setup, teardown);
+	tcase_add_test(c, invisible);
+	tcase_add_test(c, visible);
+	suite_add_tcase(s, c);
+
+	return s;
+}
@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2023 McEndu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <check.h>
+
+#include "game.h"
+#include "master.h"
+#include <quadus.h>
+#include <quadus/calls.h>
+#include <quadus/mode.h>
+#include <quadus/piece.h>
+#include <stdlib.h>
+#include <string.h>
+
+static qdsGame *game;
+static struct modeData *data;
+
+/* the rule the fade masks replace: a tile shows for 5 s after its lock */
+static int tileTime[QDS_MAX_ROWS][QDS_MAX_WIDTH];
+
+static void setup(void)
+{
+	game = qdsNewGame();
+	if (!game) abort();
+	qdsSetRuleset(game, &qdsRulesetArcade);
+	qdsSetMode(game, &qdsModeMaster);
+
+	data = qdsGetModeData(game);
+	data->phase = PHASE_CREDITS_FADE;
+	data->sectionTime = 0;
+	for (int y = 0; y < QDS_MAX_ROWS; ++y) {
+		for (int x = 0; x < QDS_MAX_WIDTH; ++x) tileTime[y][x] = -1;
+	}
+}
+
+static void teardown(void)
+{
+	qdsDestroyGame(game);
+}
+
+/* lock a piece as the ruleset would, and return its lowest row */
+static int lock(int piece, int orientation, int x, int y)
+{
+	game->piece = piece;
+	game->orientation = orientation;
+	game->x = x;
+	game->y = y;
+	ck_assert(game->mode->events.onLock(game));
+
+	int base = QDS_MAX_ROWS;
+	QDS_SHAPE_FOREACH (i, qdsGetActiveShape(game)) {
+		tileTime[y + i->y][x + i->x] = data->sectionTime;
+		if (y + i->y < base) base = y + i->y;
+	}
+	return base;
+}
+
+static void clearLine(int y)
+{
+	ck_assert(game->mode->events.onLineClear(game, y));
+	memmove(tileTime[y],
+			tileTime[y + 1],
+			(QDS_MAX_ROWS - 1 - y) * sizeof(*tileTime));
+	for (int x = 0; x < QDS_MAX_WIDTH; ++x) tileTime[QDS_MAX_ROWS - 1][x] = -1;
+}
+
+static void run(int cycles)
+{
+	for (int i = 0; i < cycles; ++i) game->mode->events.onCycle(game);
+}
+
+static void checkVisibility(void)
+{
+	uint_fast16_t visibility[QDS_DEFAULT_ROWS];
+	ck_assert_int_eq(qdsCall(game, QDS_GETFIELDVISIBILITY, visibility), 0);
+	for (int y = 0; y < QDS_DEFAULT_ROWS; ++y) {
+		uint_fast16_t expected = 0;
+		for (int x = 0; x < QDS_MAX_WIDTH; ++x) {
+			if (tileTime[y][x] >= 0
+				&& data->sectionTime < tileTime[y][x] + TIME(0, 5))
+				expected |= 1 << x;
+		}
+		ck_assert_uint_eq(visibility[y], expected);
+	}
+}
+
+START_TEST(fading)
+{
+	lock(QDS_PIECE_T, QDS_ORIENTATION_BASE, 7, 2);
+	int bottom = lock(QDS_PIECE_S, QDS_ORIENTATION_C, 4, 8);
+	run(60);
+	lock(QDS_PIECE_O, QDS_ORIENTATION_BASE, 0, 14);
+	checkVisibility();
+
+	/* the lower two rows of the S, top first as rulesets do */
+	run(100);
+	clearLine(bottom + 1);
+	clearLine(bottom);
+	checkVisibility();
+	lock(QDS_PIECE_L, QDS_ORIENTATION_BASE, 1, 10);
+	checkVisibility();
+
+	/* locks fade on the frame they turn 5 s old */
+	run(TIME(0, 5) - 161);
+	checkVisibility();
+	run(1);
+	checkVisibility();
+	run(60);
+	checkVisibility();
+	run(100);
+	checkVisibility();
+}
+END_TEST
+
+Suite *createSuite(void)
+{
+	Suite *s = suite_create("qdsModeMaster");
+
+	TCase *c = tcase_create("credits");
+	tcase_add_checked_fixture(c, setup, teardown);
+	tcase_add_test(c, fading);
+	suite_add_tcase(s, c);
+
+	return s;
+}
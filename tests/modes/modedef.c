@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2023 McEndu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <check.h>
+
+#include "game.h"
+#include <errno.h>
+#include <quadus.h>
+#include <quadus/calls.h>
+#include <quadus/mode.h>
+#include <quadus/modedef.h>
+#include <string.h>
+
+static const char src[] = "# test mode\n"
+						  "name  Weekly Event \n"
+						  "levels 4\n"
+						  "next 5\n"
+						  "gravity 1 1092\n"
+						  "gravity 3 2097152   # 20G\n"
+						  "\n"
+						  "lock 2 20\n"
+						  "lines 1 2\n"
+						  "lines 2 3\n";
+
+static qdsModeDef *parse(const char *s, int *line)
+{
+	return qdsParseModeDef(s, strlen(s), line);
+}
+
+static int get(qdsGame *game, unsigned long req)
+{
+	int value = -1;
+	if (qdsCall(game, req, &value) < 0) return -1;
+	return value;
+}
+
+/* ask the mode alone, without falling back to the ruleset */
+static int modeCall(qdsGame *game, unsigned long req)
+{
+	int value;
+	return game->mode->call(game, req, &value);
+}
+
+static void fillLine(qdsGame *game)
+{
+	game->mode->events.onLineFilled(game, 0);
+}
+
+START_TEST(parseCurves)
+{
+	qdsModeDef *def = parse(src, NULL);
+	ck_assert_ptr_nonnull(def);
+	ck_assert_str_eq(qdsGetModeDefName(def), "Weekly Event");
+
+	qdsGame *game = qdsNewGame();
+	qdsSetRuleset(game, &qdsRulesetStandard);
+	qdsSetMode(game, qdsGetModeDefMode(def));
+
+	const char *name;
+	ck_assert_int_eq(qdsCall(game, QDS_GETMODENAME, &name), 0);
+	ck_assert_str_eq(name, "Weekly Event");
+	ck_assert_int_eq(get(game, QDS_GETNEXTCOUNT), 5);
+	ck_assert_int_eq(get(game, QDS_GETLEVEL), 1);
+	ck_assert_int_eq(get(game, QDS_GETGRAVITY), 1092);
+	ck_assert_int_eq(get(game, QDS_GETLEVELTARGET), 2);
+	ck_assert_int_eq(modeCall(game, QDS_GETLOCKTIME), -ENOTTY);
+	ck_assert_int_eq(modeCall(game, QDS_GETDAS), -ENOTTY);
+
+	fillLine(game);
+	fillLine(game);
+	ck_assert_int_eq(get(game, QDS_GETLEVEL), 2);
+	ck_assert_int_eq(get(game, QDS_GETGRAVITY), 1092);
+	ck_assert_int_eq(get(game, QDS_GETLOCKTIME), 20);
+	ck_assert_int_eq(get(game, QDS_GETLEVELTARGET), 5);
+
+	for (int i = 0; i < 3; ++i) fillLine(game);
+	ck_assert_int_eq(get(game, QDS_GETLEVEL), 3);
+	ck_assert_int_eq(get(game, QDS_GETGRAVITY), 2097152);
+	ck_assert_int_eq(get(game, QDS_GETLOCKTIME), 20);
+	ck_assert_int_eq(get(game, QDS_GETLEVELTARGET), 8);
+
+	/* the last level never ends */
+	for (int i = 0; i < 20; ++i) fillLine(game);
+	ck_assert_int_eq(get(game, QDS_GETLEVEL), 4);
+	ck_assert_int_eq(get(game, QDS_GETSUBLEVEL), 25);
+
+	qdsDestroyGame(game);
+	qdsFreeModeDef(def);
+}
+END_TEST
+
+START_TEST(defaults)
+{
+	qdsModeDef *def = parse("gravity 3 65536\n", NULL);
+	ck_assert_ptr_nonnull(def);
+	ck_assert_str_eq(qdsGetModeDefName(def), "Custom");
+
+	qdsGame *game = qdsNewGame();
+	qdsSetRuleset(game, &qdsRulesetStandard);
+	qdsSetMode(game, qdsGetModeDefMode(def));
+	ck_assert_int_eq(modeCall(game, QDS_GETGRAVITY), -ENOTTY);
+	ck_assert_int_eq(get(game, QDS_GETLEVELTARGET), 10);
+	for (int i = 0; i < 20; ++i) fillLine(game);
+	ck_assert_int_eq(get(game, QDS_GETLEVEL), 3);
+	ck_assert_int_eq(get(game, QDS_GETGRAVITY), 65536);
+
+	qdsDestroyGame(game);
+	qdsFreeModeDef(def);
+}
+END_TEST
+
+START_TEST(errors)
+{
+	int line = 0;
+	ck_assert_ptr_null(parse("levels 2\nspeed 1 10\n", &line));
+	ck_assert_int_eq(errno, EINVAL);
+	ck_assert_int_eq(line, 2);
+
+	ck_assert_ptr_null(parse("lines 1 0\n", &line));
+	ck_assert_int_eq(line, 1);
+	ck_assert_ptr_null(parse("\ngravity 0 1092\n", &line));
+	ck_assert_int_eq(line, 2);
+	ck_assert_ptr_null(parse("das 1 12 3\n", &line));
+	ck_assert_int_eq(line, 1);
+	ck_assert_ptr_null(parse("levels 2\n\ndas 3 10\nlevels x\n", &line));
+	ck_assert_int_eq(line, 4);
+	ck_assert_ptr_null(parse("das 3 10\nlevels 2\n", &line));
+	ck_assert_int_eq(line, 1);
+	ck_assert_ptr_null(parse("name\n", &line));
+	ck_assert_int_eq(line, 1);
+}
+END_TEST
+
+Suite *createSuite(void)
+{
+	Suite *s = suite_create("qdsModeDef");
+
+	TCase *c = tcase_create("base");
+	tcase_add_test(c, parseCurves);
+	tcase_add_test(c, defaults);
+	tcase_add_test(c, errors);
+	suite_add_tcase(s, c);
+
+	return s;
+}
@@ -0,0 +1,220 @@
+/*
+ * Copyright (c) 2023 McEndu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <check.h>
+
+#include "game.h"
+#include <quadus.h>
+#include <quadus/calls.h>
+#include <quadus/mode.h>
+#include <quadus/piece.h>
+#include <quadus/ruleset/utils.h>
+#include <quadus/versus.h>
+#include <stdlib.h>
+
+static qdsGame *a, *b;
+
+static void setup(void)
+{
+	a = qdsNewGame();
+	b = qdsNewGame();
+	if (!a || !b) abort();
+	qdsSetRuleset(a, &qdsRulesetStandard);
+	qdsSetRuleset(b, &qdsRulesetStandard);
+	qdsSetMode(a, &qdsModeVersus);
+	qdsSetMode(b, &qdsModeVersus);
+	ck_assert(qdsVersusPair(a, b, 42));
+}
+
+static void teardown(void)
+{
+	qdsDestroyGame(a);
+	qdsDestroyGame(b);
+}
+
+/* pretend the ruleset has just locked a piece */
+static void lock(qdsGame *game, unsigned int clearType)
+{
+	qdsRulesetState *state = qdsGetRulesetData(game);
+	state->clearType = clearType;
+	game->mode->events.postLock(game);
+}
+
+static int incoming(qdsGame *game)
+{
+	int lines;
+	ck_assert_int_eq(qdsCall(game, QDS_GETINCOMING, &lines), 0);
+	return lines;
+}
+
+START_TEST(attack)
+{
+	ck_assert_int_eq(qdsVersusAttack(0, 0), 0);
+	ck_assert_int_eq(qdsVersusAttack(QDS_LINECLEAR_SINGLE, 1), 0);
+	ck_assert_int_eq(qdsVersusAttack(QDS_LINECLEAR_DOUBLE, 1), 1);
+	ck_assert_int_eq(qdsVersusAttack(QDS_LINECLEAR_QUADUS, 1), 4);
+	ck_assert_int_eq(
+		qdsVersusAttack(QDS_LINECLEAR_QUADUS | QDS_LINECLEAR_B2B, 1), 5);
+	ck_assert_int_eq(
+		qdsVersusAttack(QDS_LINECLEAR_DOUBLE | QDS_LINECLEAR_TWIST, 1), 4);
+	/* minis carry the twist flag as well */
+	unsigned int miniSingle
+		= QDS_LINECLEAR_SINGLE | QDS_LINECLEAR_MINI | QDS_LINECLEAR_TWIST;
+	ck_assert_int_eq(qdsVersusAttack(miniSingle, 1), 0);
+	ck_assert_int_eq(
+		qdsVersusAttack(QDS_LINECLEAR_SINGLE | QDS_LINECLEAR_ALLCLEAR, 1),
+		10);
+	ck_assert_int_eq(qdsVersusAttack(QDS_LINECLEAR_SINGLE, 5), 1);
+	ck_assert_int_eq(qdsVersusAttack(QDS_LINECLEAR_SINGLE, 100), 5);
+}
+END_TEST
+
+/* clear types as the rulesets build them */
+static unsigned int lockType(qdsGame *game, int lines, int twist)
+{
+	qdsRulesetState *state = qdsGetRulesetData(game);
+	state->pendingLines.lines = lines;
+	state->twistCheckResult = twist;
+	state->b2b = false;
+	unsigned int clearType = qdsCheckLockType(state, game);
+	state->pendingLines.lines = 0;
+	return clearType;
+}
+
+START_TEST(twists)
+{
+	const qdsLine garbage[4] = { { 8 }, { 8 }, { 8 }, { 8 } };
+	qdsAddLines(a, garbage, 4);
+
+	unsigned int mini = lockType(a, 1, QDS_ROTATE_TWIST_MINI);
+	ck_assert_int_eq(qdsVersusAttack(mini, 0), 0);
+	mini = lockType(a, 2, QDS_ROTATE_TWIST_MINI);
+	ck_assert_int_eq(qdsVersusAttack(mini, 0), 1);
+
+	unsigned int full = lockType(a, 1, QDS_ROTATE_TWIST);
+	ck_assert_int_eq(qdsVersusAttack(full, 0), 2);
+	full = lockType(a, 2, QDS_ROTATE_TWIST);
+	ck_assert_int_eq(qdsVersusAttack(full, 0), 4);
+
+	unsigned int plain = lockType(a, 2, QDS_ROTATE_NORMAL);
+	ck_assert_int_eq(qdsVersusAttack(plain, 0), 1);
+
+	/* a mini single sends nothing to the opponent */
+	lock(a, lockType(a, 1, QDS_ROTATE_TWIST_MINI));
+	ck_assert_int_eq(incoming(b), 0);
+}
+END_TEST
+
+START_TEST(pairing)
+{
+	ck_assert_ptr_eq(qdsVersusGetOpponent(a), b);
+	ck_assert_ptr_eq(qdsVersusGetOpponent(b), a);
+	for (int i = 0; i < 5; ++i)
+		ck_assert_int_eq(qdsGetNextPiece(a, i), qdsGetNextPiece(b, i));
+
+	qdsGame *other = qdsNewGame();
+	qdsSetRuleset(other, &qdsRulesetStandard);
+	qdsSetMode(other, &qdsModeMarathon);
+	ck_assert(!qdsVersusPair(a, other, 0));
+	qdsDestroyGame(other);
+}
+END_TEST
+
+START_TEST(exchange)
+{
+	lock(a, QDS_LINECLEAR_QUADUS);
+	ck_assert_int_eq(incoming(b), 4);
+	ck_assert_int_eq(incoming(a), 0);
+
+	/* a double cancels one line instead of attacking */
+	lock(b, QDS_LINECLEAR_DOUBLE);
+	ck_assert_int_eq(incoming(b), 3);
+	ck_assert_int_eq(incoming(a), 0);
+
+	/* garbage rises when no lines are cleared */
+	lock(b, 0);
+	ck_assert_int_eq(incoming(b), 0);
+	ck_assert_int_eq(qdsGetFieldHeight(b), 3);
+
+	int hole = -1;
+	for (int x = 0; x < 10; ++x) {
+		if (!b->playfield[0][x]) hole = x;
+	}
+	ck_assert_int_ge(hole, 0);
+	for (int y = 0; y < 3; ++y) {
+		for (int x = 0; x < 10; ++x) {
+			if (x == hole)
+				ck_assert_int_eq(b->playfield[y][x], 0);
+			else
+				ck_assert_int_eq(b->playfield[y][x], QDS_PIECE_GARBAGE);
+		}
+	}
+
+	unsigned int sent;
+	qdsCall(a, QDS_GETATTACK, &sent);
+	ck_assert_uint_eq(sent, 4);
+}
+END_TEST
+
+START_TEST(garbageCap)
+{
+	lock(a, QDS_LINECLEAR_QUADUS);
+	lock(a, QDS_LINECLEAR_QUADUS);
+	lock(a, QDS_LINECLEAR_QUADUS);
+	ck_assert_int_eq(incoming(b), 13);
+
+	lock(b, 0);
+	ck_assert_int_eq(qdsGetFieldHeight(b), QDS_VERSUS_GARBAGE_CAP);
+	ck_assert_int_eq(incoming(b), 13 - QDS_VERSUS_GARBAGE_CAP);
+
+	lock(b, 0);
+	ck_assert_int_eq(qdsGetFieldHeight(b), 13);
+	ck_assert_int_eq(incoming(b), 0);
+	ck_assert(!qdsVersusHasLost(b));
+}
+END_TEST
+
+START_TEST(topOut)
+{
+	for (int i = 0; i < 13; ++i) lock(a, QDS_LINECLEAR_QUADUS);
+	for (int i = 0; i < 7; ++i) lock(b, 0);
+	ck_assert(qdsVersusHasLost(b));
+	ck_assert(!qdsVersusHasLost(a));
+}
+END_TEST
+
+Suite *createSuite(void)
+{
+	Suite *s = suite_create("qdsModeVersus");
+
+	TCase *c = tcase_create("base");
+	tcase_add_checked_fixture(c, setup, teardown);
+	tcase_add_test(c, attack);
+	tcase_add_test(c, twists);
+	tcase_add_test(c, pairing);
+	tcase_add_test(c, exchange);
+	tcase_add_test(c, garbageCap);
+	tcase_add_test(c, topOut);
+	suite_add_tcase(s, c);
+
+	return s;
+}
@@ -72,6 +72,17 @@ START_TEST(addLine)
 }
 END_TEST
 
+START_TEST(overflow)
+{
+	unsigned char *end = (unsigned char *)q + sizeof(*q);
+	*end = 0xa5;
+	for (int i = 0; i < 50; ++i) qdsQueueLine(q, i);
+	ck_assert_int_eq(q->lines, sizeof(q->h));
+	ck_assert_int_eq(q->h[sizeof(q->h) - 1], sizeof(q->h) - 1);
+	ck_assert_int_eq(*end, 0xa5);
+}
+END_TEST
+
 START_TEST(process)
 {
 	const unsigned char pending[] = { 1, 3, 5, 9, 7, 19, 17, 11, 15, 13 };
@@ -116,6 +127,7 @@ Suite *createSuite(void)
 	tcase_add_unchecked_fixture(c, setupCase, teardownCase);
 	tcase_add_checked_fixture(c, setup, NULL);
 	tcase_add_test(c, addLine);
+	tcase_add_test(c, overflow);
 	tcase_add_test(c, process);
 	suite_add_tcase(s, c);
 
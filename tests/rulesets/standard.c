@@ -22,6 +22,7 @@
  */
 #include <check.h>
 
+#include "game.h"
 #include "rulesets/standard.h"
 
 #include "mockgen.h"
@@ -30,6 +31,8 @@
 #include <quadus.h>
 #include <quadus/calls.h>
 #include <quadus/ruleset.h>
+#include <quadus/ruleset/mask.h>
+#include <quadus/ruleset/twist.h>
 #include <stdlib.h>
 
 static qdsGame *game;
@@ -713,6 +716,68 @@ START_TEST(topOutHold)
 }
 END_TEST
 
+START_TEST(masks)
+{
+	for (int p = QDS_PIECE_I; p <= QDS_PIECE_Z; ++p) {
+		for (int o = 0; o < 4; ++o) {
+			const qdsShapeMask *mask = qdsRulesetStandard.getShapeMask(p, o);
+			qdsShapeMask expected;
+			qdsBuildShapeMask(&expected, qdsRulesetStandard.getShape(p, o));
+
+			ck_assert_int_eq(mask->left, expected.left);
+			ck_assert_int_eq(mask->bottom, expected.bottom);
+			ck_assert_int_eq(mask->width, expected.width);
+			ck_assert_int_eq(mask->height, expected.height);
+			for (int i = 0; i < expected.height; ++i)
+				ck_assert_uint_eq(mask->rows[i], expected.rows[i]);
+		}
+	}
+}
+END_TEST
+
+START_TEST(rotationTwistCheck)
+{
+	/* the one-pass kick evaluation agrees with the generic twist checks */
+	srand(1919);
+	for (int round = 0; round < 32; ++round) {
+		qdsClearPlayfield(game);
+		for (int y = 0; y < 8; ++y)
+			for (int x = 0; x < 10; ++x)
+				game->playfield[y][x] = rand() % 3 ? 0 : QDS_PIECE_GARBAGE;
+		game->height = 8;
+
+		for (int p = QDS_PIECE_I; p <= QDS_PIECE_Z; ++p) {
+			for (int o = 0; o < 4; ++o) {
+				for (int y = 0; y < 10; ++y) {
+					for (int x = 0; x < 10; ++x) {
+						game->piece = p;
+						game->orientation = o;
+						game->x = x;
+						game->y = y;
+						if (qdsOverlaps(game)) continue;
+
+						for (int r = -1; r <= 1; r += 2) {
+							int dx, dy;
+							int result = qdsRulesetStandard.canRotate(
+								game, r, &dx, &dy);
+							if (result == QDS_ROTATE_FAILED) continue;
+
+							ck_assert(qdsCanRotate(game, dx, dy, r));
+							int expected = QDS_ROTATE_NORMAL;
+							if (qdsCheckTwistImmobile(game, dx, dy, r))
+								expected = QDS_ROTATE_TWIST;
+							else if (qdsCheckTwist3Corner(game, dx, dy, r))
+								expected = QDS_ROTATE_TWIST_MINI;
+							ck_assert_int_eq(result, expected);
+						}
+					}
+				}
+			}
+		}
+	}
+}
+END_TEST
+
 Suite *createSuite(void)
 {
 	Suite *s = suite_create("qdsRulesetStandard");
@@ -742,6 +807,8 @@ Suite *createSuite(void)
 	tcase_add_test(c, lockTimeResetLimit);
 	tcase_add_test(c, topOut);
 	tcase_add_test(c, topOutHold);
+	tcase_add_test(c, masks);
+	tcase_add_test(c, rotationTwistCheck);
 	tcase_add_checked_fixture(c, setup, teardown);
 	suite_add_tcase(s, c);
 
@@ -0,0 +1,227 @@
+/*
+ * Copyright (c) 2023 McEndu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <check.h>
+
+#include "game.h"
+#include "rulesets/tgm.h"
+
+#include "mockgen.h"
+#include "mockruleset.h"
+#include <quadus.h>
+#include <quadus/calls.h>
+#include <quadus/ruleset.h>
+#include <quadus/ruleset/mask.h>
+#include <stdlib.h>
+#include <string.h>
+
+static qdsGame *game;
+static tgmData *data;
+
+static void setupCase(void)
+{
+	game = qdsNewGame();
+	if (!game) abort();
+}
+
+static void teardownCase(void)
+{
+	qdsDestroyGame(game);
+}
+
+static void setup(void)
+{
+	qdsInitGame(game);
+	qdsSetRuleset(game, &qdsRulesetTgm);
+	qdsSetMode(game, &mockGenMode);
+
+	data = qdsGetRulesetData(game);
+}
+
+static void teardown(void)
+{
+	qdsCleanupGame(game);
+}
+
+START_TEST(masks)
+{
+	for (int p = QDS_PIECE_I; p <= QDS_PIECE_Z; ++p) {
+		for (int o = 0; o < 4; ++o) {
+			const qdsShapeMask *mask = qdsRulesetTgm.getShapeMask(p, o);
+			qdsShapeMask expected;
+			qdsBuildShapeMask(&expected, qdsRulesetTgm.getShape(p, o));
+
+			ck_assert_int_eq(mask->left, expected.left);
+			ck_assert_int_eq(mask->bottom, expected.bottom);
+			ck_assert_int_eq(mask->width, expected.width);
+			ck_assert_int_eq(mask->height, expected.height);
+			for (int i = 0; i < expected.height; ++i)
+				ck_assert_uint_eq(mask->rows[i], expected.rows[i]);
+		}
+	}
+}
+END_TEST
+
+START_TEST(base)
+{
+	const int seq[] = { QDS_PIECE_T, QDS_PIECE_L };
+	setMockSequence(game, seq, 2);
+
+	qdsRunCycle(game, 0);
+	ck_assert_int_eq(data->baseState.status, QDS_STATUS_ACTIVE);
+	ck_assert_int_eq(qdsGetActivePieceType(game), QDS_PIECE_T);
+	ck_assert_int_eq(qdsGetActiveX(game), 4);
+	ck_assert_int_eq(qdsGetActiveY(game), 20);
+
+	qdsRunCycle(game, QDS_INPUT_LEFT);
+	ck_assert_int_eq(qdsGetActiveX(game), 3);
+	qdsRunCycle(game, QDS_INPUT_RIGHT);
+	ck_assert_int_eq(qdsGetActiveX(game), 4);
+	qdsRunCycle(game, QDS_INPUT_ROTATE_C);
+	ck_assert_int_eq(qdsGetActiveOrientation(game), QDS_ORIENTATION_C);
+	qdsRunCycle(game, QDS_INPUT_ROTATE_CC);
+	ck_assert_int_eq(qdsGetActiveOrientation(game), QDS_ORIENTATION_BASE);
+
+	/* sonic drop does not lock */
+	qdsRunCycle(game, QDS_INPUT_HARD_DROP);
+	ck_assert_int_eq(qdsGetActivePieceType(game), QDS_PIECE_T);
+	ck_assert_int_eq(qdsGetActiveY(game), 0);
+	qdsRunCycle(game, QDS_INPUT_SOFT_DROP);
+	ck_assert_int_eq(data->baseState.status, QDS_STATUS_LOCKDELAY);
+}
+END_TEST
+
+START_TEST(noHold)
+{
+	const int seq[] = { QDS_PIECE_T, QDS_PIECE_L };
+	setMockSequence(game, seq, 2);
+
+	qdsRunCycle(game, QDS_INPUT_HOLD);
+	ck_assert_int_eq(qdsGetActivePieceType(game), QDS_PIECE_T);
+	qdsRunCycle(game, 0);
+	qdsRunCycle(game, QDS_INPUT_HOLD);
+	ck_assert_int_eq(qdsGetActivePieceType(game), QDS_PIECE_T);
+	ck_assert_int_eq(qdsGetHeldPiece(game), QDS_PIECE_NONE);
+	ck_assert_int_eq(qdsCall(game, QDS_CANHOLD, NULL), 0);
+}
+END_TEST
+
+START_TEST(wallKick)
+{
+	const int seq[] = { QDS_PIECE_T };
+	setMockSequence(game, seq, 1);
+
+	qdsRunCycle(game, QDS_INPUT_ROTATE_CC);
+	ck_assert_int_eq(qdsGetActiveOrientation(game), QDS_ORIENTATION_CC);
+	while (qdsGetActiveX(game) > 0) {
+		qdsRunCycle(game, QDS_INPUT_LEFT);
+		qdsRunCycle(game, 0);
+	}
+
+	qdsRunCycle(game, QDS_INPUT_ROTATE_C);
+	ck_assert_int_eq(qdsGetActiveOrientation(game), QDS_ORIENTATION_BASE);
+	ck_assert_int_eq(qdsGetActiveX(game), 1);
+}
+END_TEST
+
+START_TEST(iNoKick)
+{
+	const int seq[] = { QDS_PIECE_I };
+	setMockSequence(game, seq, 1);
+
+	qdsRunCycle(game, QDS_INPUT_ROTATE_C);
+	ck_assert_int_eq(qdsGetActiveOrientation(game), QDS_ORIENTATION_C);
+	while (qdsGetActiveX(game) < 8) {
+		qdsRunCycle(game, QDS_INPUT_RIGHT);
+		qdsRunCycle(game, 0);
+	}
+
+	qdsRunCycle(game, QDS_INPUT_ROTATE_CC);
+	ck_assert_int_eq(qdsGetActiveOrientation(game), QDS_ORIENTATION_C);
+	ck_assert_int_eq(qdsGetActiveX(game), 8);
+}
+END_TEST
+
+START_TEST(centerColumn)
+{
+	const int seq[] = { QDS_PIECE_T };
+	setMockSequence(game, seq, 1);
+
+	qdsRunCycle(game, 0);
+	qdsRunCycle(game, QDS_INPUT_HARD_DROP);
+	ck_assert_int_eq(qdsGetActiveY(game), 0);
+
+	/* first tile in the rotation box is in the center column */
+	game->playfield[2][4] = 8;
+	qdsRunCycle(game, QDS_INPUT_ROTATE_C);
+	ck_assert_int_eq(qdsGetActiveOrientation(game), QDS_ORIENTATION_BASE);
+	ck_assert_int_eq(qdsGetActiveX(game), 4);
+	qdsRunCycle(game, 0);
+
+	/* first tile is on the left; kicking is allowed */
+	game->playfield[2][3] = 8;
+	qdsRunCycle(game, QDS_INPUT_ROTATE_C);
+	ck_assert_int_eq(qdsGetActiveOrientation(game), QDS_ORIENTATION_C);
+	ck_assert_int_eq(qdsGetActiveX(game), 5);
+}
+END_TEST
+
+START_TEST(lineClear)
+{
+	const int seq[] = { QDS_PIECE_I };
+	const qdsLine playfield[] = {
+		{ 8, 8, 8, 0, 0, 0, 0, 8, 8, 8 },
+	};
+	setMockSequence(game, seq, 1);
+	qdsAddLines(game, playfield, 1);
+
+	qdsRunCycle(game, 0);
+	qdsRunCycle(game, QDS_INPUT_HARD_DROP);
+	qdsRunCycle(game, QDS_INPUT_SOFT_DROP);
+	ck_assert_int_eq(data->baseState.status, QDS_STATUS_LINEDELAY);
+
+	unsigned int score;
+	qdsCall(game, QDS_GETSCORE, &score);
+	/* a single at level 1, quadrupled for clearing the field */
+	ck_assert_uint_eq(score, 4);
+	ck_assert_uint_eq(data->combo, 1);
+}
+END_TEST
+
+Suite *createSuite(void)
+{
+	Suite *s = suite_create("qdsRulesetTgm");
+
+	TCase *c = tcase_create("base");
+	tcase_add_unchecked_fixture(c, setupCase, teardownCase);
+	tcase_add_test(c, masks);
+	tcase_add_test(c, base);
+	tcase_add_test(c, noHold);
+	tcase_add_test(c, wallKick);
+	tcase_add_test(c, iNoKick);
+	tcase_add_test(c, centerColumn);
+	tcase_add_test(c, lineClear);
+	tcase_add_checked_fixture(c, setup, teardown);
+	suite_add_tcase(s, c);
+
+	return s;
+}
@@ -0,0 +1,193 @@
+/*
+ * Copyright (c) 2023 McEndu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <check.h>
+
+#include <quadus.h>
+#include <quadus/piece.h>
+#include <quadus/position.h>
+#include <quadus/ruleset.h>
+#include <quadus/search.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const qdsRuleset *rs = &qdsRulesetStandard;
+static qdsPosition pos;
+static qdsAllClear solution;
+
+static void setup(void)
+{
+	memset(&pos, 0, sizeof(qdsPosition));
+	memset(&solution, 0, sizeof(qdsAllClear));
+	pos.spawnX = 4;
+	pos.spawnY = 20;
+}
+
+static void setPieces(int piece, int hold, const char *queue)
+{
+	pos.piece = piece;
+	pos.hold = hold;
+	pos.x = pos.spawnX;
+	pos.y = pos.spawnY;
+	pos.orientation = QDS_ORIENTATION_BASE;
+	pos.queueLength = strlen(queue);
+	for (int i = 0; i < pos.queueLength; ++i) pos.queue[i] = queue[i] - '0';
+}
+
+static void setRows(const uint_least16_t *rows, int height)
+{
+	memcpy(pos.rows, rows, height * sizeof(*rows));
+	pos.height = height;
+}
+
+static bool solve(int lines, int threads)
+{
+	qdsAllClearLimits limits = { .lines = lines, .threads = threads };
+	return qdsFindAllClear(&pos, rs, &limits, &solution);
+}
+
+/* play a solution out and check that it clears the playfield */
+static void checkSolution(int lines)
+{
+	qdsPosition copy = pos;
+	ck_assert_int_gt(solution.count, 0);
+	for (int i = 0; i < solution.count; ++i) {
+		if (i > 0) ck_assert(qdsPositionSpawn(&copy, rs));
+		int cleared = qdsPositionPlace(&copy, rs, &solution.placements[i]);
+		ck_assert_int_ge(cleared, 0);
+		ck_assert_int_le(copy.height + cleared, lines);
+		lines -= cleared;
+	}
+	ck_assert_int_eq(copy.height, 0);
+}
+
+START_TEST(singlePiece)
+{
+	static const uint_least16_t rows[] = { 0x0ff, 0x0ff };
+	setRows(rows, 2);
+	setPieces(QDS_PIECE_O, QDS_PIECE_NONE, "");
+
+	ck_assert(solve(2, 1));
+	ck_assert_int_eq(solution.count, 1);
+	checkSolution(2);
+
+	/* the piece does not fit in the gap */
+	setPieces(QDS_PIECE_T, QDS_PIECE_NONE, "");
+	ck_assert(!solve(2, 1));
+	ck_assert_int_eq(solution.count, 0);
+
+	/* holding brings in a piece that does */
+	setPieces(QDS_PIECE_T, QDS_PIECE_O, "");
+	ck_assert(solve(2, 1));
+	ck_assert_int_eq(solution.count, 1);
+	ck_assert(solution.placements[0].hold);
+	checkSolution(2);
+}
+END_TEST
+
+START_TEST(opening)
+{
+	/* 5 pieces fill 2 rows */
+	setPieces(QDS_PIECE_I, QDS_PIECE_NONE, "1444");
+	ck_assert(solve(2, 1));
+	ck_assert_int_eq(solution.count, 5);
+	checkSolution(2);
+
+	/* allowing more rows does not make it take more pieces */
+	ck_assert(solve(4, 1));
+	ck_assert_int_eq(solution.count, 5);
+	checkSolution(4);
+}
+END_TEST
+
+START_TEST(parity)
+{
+	/* 1 tile left can never be filled */
+	static const uint_least16_t rows[] = { 0x1ff };
+	setRows(rows, 1);
+	setPieces(QDS_PIECE_I, QDS_PIECE_O, "1234567");
+	ck_assert(!solve(1, 1));
+
+	/* too few pieces to fill 2 rows, so nothing is searched past them */
+	setup();
+	setPieces(QDS_PIECE_I, QDS_PIECE_NONE, "44");
+	ck_assert(!solve(2, 1));
+	ck_assert_uint_lt(solution.nodes, 64);
+}
+END_TEST
+
+START_TEST(lineLimit)
+{
+	/* a vertical I gap needs 4 rows */
+	static const uint_least16_t rows[] = { 0x1ff, 0x1ff, 0x1ff, 0x1ff };
+	setRows(rows, 4);
+	setPieces(QDS_PIECE_I, QDS_PIECE_NONE, "");
+	ck_assert(solve(4, 1));
+	checkSolution(4);
+	ck_assert(!solve(3, 1));
+}
+END_TEST
+
+START_TEST(threads)
+{
+	/* T, with I held, and 8 pieces to come make 4 rows */
+	setPieces(QDS_PIECE_T, QDS_PIECE_I, "43257143");
+	ck_assert(solve(4, 1));
+	checkSolution(4);
+	qdsAllClear single = solution;
+
+	for (int threads = 0; threads <= 4; threads += 2) {
+		ck_assert(solve(4, threads));
+		checkSolution(4);
+		ck_assert_int_eq(solution.count, single.count);
+		ck_assert(!memcmp(solution.placements,
+						  single.placements,
+						  single.count * sizeof(qdsPlacement)));
+	}
+}
+END_TEST
+
+START_TEST(nodeBudget)
+{
+	setPieces(QDS_PIECE_T, QDS_PIECE_I, "43257143");
+	qdsAllClearLimits limits = { .lines = 4, .threads = 1, .nodes = 1000 };
+	ck_assert(!qdsFindAllClear(&pos, rs, &limits, &solution));
+	ck_assert_uint_lt(solution.nodes, 1000 + 512);
+}
+END_TEST
+
+Suite *createSuite(void)
+{
+	Suite *s = suite_create("qdsFindAllClear");
+
+	TCase *c = tcase_create("base");
+	tcase_add_checked_fixture(c, setup, NULL);
+	tcase_add_test(c, singlePiece);
+	tcase_add_test(c, opening);
+	tcase_add_test(c, parity);
+	tcase_add_test(c, lineLimit);
+	tcase_add_test(c, threads);
+	tcase_add_test(c, nodeBudget);
+	suite_add_tcase(s, c);
+
+	return s;
+}
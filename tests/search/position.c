@@ -0,0 +1,359 @@
+/*
+ * Copyright (c) 2023 McEndu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <check.h>
+
+#include "game.h"
+#include "mockgen.h"
+#include "mockruleset.h"
+#include <quadus.h>
+#include <quadus/calls.h>
+#include <quadus/piece.h>
+#include <quadus/position.h>
+#include <quadus/ruleset.h>
+#include <stdlib.h>
+
+static qdsGame *game;
+static qdsPosition pos;
+
+static const int seq[] = {
+	QDS_PIECE_T, QDS_PIECE_I, QDS_PIECE_O, QDS_PIECE_S,
+	QDS_PIECE_Z, QDS_PIECE_J, QDS_PIECE_L,
+};
+
+static void setupCase(void)
+{
+	game = qdsNewGame();
+	if (!game) abort();
+}
+
+static void teardownCase(void)
+{
+	qdsDestroyGame(game);
+}
+
+static void setup(void)
+{
+	qdsInitGame(game);
+	qdsSetRuleset(game, &qdsRulesetStandard);
+	qdsSetMode(game, &mockGenMode);
+	setMockSequence(game, seq, 7);
+}
+
+static void teardown(void)
+{
+	qdsCleanupGame(game);
+}
+
+START_TEST(fromGame)
+{
+	const qdsLine lines[] = {
+		{ 1, 1, 1, 1, 0, 0, 1, 1, 1, 1 },
+		{ 0, 2, 0, 0, 0, 0, 0, 0, 0, 3 },
+	};
+	qdsAddLines(game, lines, 2);
+	qdsRunCycle(game, 0);
+
+	ck_assert(qdsPositionFromGame(&pos, game));
+	ck_assert_uint_eq(pos.rows[0], 0x3cf);
+	ck_assert_uint_eq(pos.rows[1], 0x202);
+	ck_assert_uint_eq(pos.rows[2], 0);
+	ck_assert_int_eq(pos.height, 2);
+	ck_assert_int_eq(pos.piece, QDS_PIECE_T);
+	ck_assert_int_eq(pos.x, qdsGetActiveX(game));
+	ck_assert_int_eq(pos.y, qdsGetActiveY(game));
+	ck_assert_int_eq(pos.spawnX, 4);
+	ck_assert_int_eq(pos.spawnY, 20);
+	ck_assert_int_eq(pos.hold, QDS_PIECE_NONE);
+	ck_assert(!pos.held);
+	ck_assert_int_eq(pos.queueLength, 7);
+	ck_assert_int_eq(pos.queue[0], QDS_PIECE_I);
+	ck_assert_int_eq(pos.queue[5], QDS_PIECE_L);
+}
+END_TEST
+
+START_TEST(toGame)
+{
+	const qdsLine lines[] = {
+		{ 1, 1, 1, 1, 0, 0, 1, 1, 1, 1 },
+	};
+	qdsAddLines(game, lines, 1);
+	qdsRunCycle(game, 0);
+	ck_assert(qdsPositionFromGame(&pos, game));
+
+	pos.rows[0] |= 0x010;
+	pos.rows[0] &= ~0x001;
+	pos.rows[1] = 0x001;
+	pos.height = 2;
+	pos.x = 2;
+	pos.y = 10;
+	pos.orientation = QDS_ORIENTATION_C;
+	pos.hold = QDS_PIECE_S;
+	ck_assert(qdsPositionToGame(&pos, game));
+
+	ck_assert_int_eq(game->playfield[0][0], 0);
+	ck_assert_int_eq(game->playfield[0][1], 1);
+	ck_assert_int_eq(game->playfield[0][4], QDS_PIECE_GARBAGE);
+	ck_assert_int_eq(game->playfield[0][5], 0);
+	ck_assert_int_eq(game->playfield[1][0], QDS_PIECE_GARBAGE);
+	ck_assert_int_eq(qdsGetFieldHeight(game), 2);
+	ck_assert_int_eq(qdsGetActiveX(game), 2);
+	ck_assert_int_eq(qdsGetActiveY(game), 10);
+	ck_assert_int_eq(qdsGetActiveOrientation(game), QDS_ORIENTATION_C);
+	ck_assert_int_eq(qdsGetHeldPiece(game), QDS_PIECE_S);
+}
+END_TEST
+
+/* positions only model the default playfield */
+START_TEST(otherSize)
+{
+	qdsGame *wide = qdsNewGameSized(12, 20);
+	ck_assert_ptr_nonnull(wide);
+	qdsSetRuleset(wide, &qdsRulesetStandard);
+
+	ck_assert(qdsPositionFromGame(&pos, game));
+	pos.rows[0] = 0x3ff;
+	pos.height = 1;
+	ck_assert(!qdsPositionFromGame(&pos, wide));
+	ck_assert_uint_eq(pos.rows[0], 0x3ff);
+	ck_assert(!qdsPositionToGame(&pos, wide));
+	ck_assert_int_eq(qdsGetFieldHeight(wide), 0);
+	qdsDestroyGame(wide);
+}
+END_TEST
+
+START_TEST(moveDrop)
+{
+	qdsRunCycle(game, 0);
+	ck_assert(qdsPositionFromGame(&pos, game));
+
+	ck_assert_int_eq(qdsPositionMove(&pos, &qdsRulesetStandard, -10), -3);
+	ck_assert_int_eq(pos.x, 1);
+	ck_assert_int_eq(qdsPositionMove(&pos, &qdsRulesetStandard, 2), 2);
+	ck_assert_int_eq(pos.x, 3);
+	ck_assert_int_eq(qdsPositionDrop(&pos, &qdsRulesetStandard), 20);
+	ck_assert_int_eq(pos.y, 0);
+	ck_assert_int_eq(qdsPositionDrop(&pos, &qdsRulesetStandard), 0);
+
+	/* the game is untouched */
+	ck_assert_int_eq(qdsGetActiveX(game), 4);
+	ck_assert_int_eq(qdsGetActiveY(game), 20);
+}
+END_TEST
+
+START_TEST(rotateMatchesGame)
+{
+	const qdsLine lines[] = {
+		{ 1, 1, 1, 0, 1, 1, 1, 1, 1, 1 },
+		{ 1, 1, 0, 0, 0, 1, 1, 1, 1, 1 },
+		{ 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 },
+		{ 0, 0, 0, 1, 1, 0, 0, 0, 0, 0 },
+	};
+	qdsAddLines(game, lines, 4);
+	qdsRunCycle(game, 0);
+	qdsTeleport(game, -1, -18);
+	ck_assert(qdsPositionFromGame(&pos, game));
+
+	/* a T-spin triple setup exercising kicks and twist detection */
+	for (int i = 0; i < 4; ++i) {
+		int expected = qdsRotate(game, QDS_ROTATION_CLOCKWISE);
+		int result = qdsPositionRotate(
+			&pos, &qdsRulesetStandard, QDS_ROTATION_CLOCKWISE);
+		ck_assert_int_eq(result, expected);
+		ck_assert_int_eq(pos.x, qdsGetActiveX(game));
+		ck_assert_int_eq(pos.y, qdsGetActiveY(game));
+		ck_assert_int_eq(pos.orientation, qdsGetActiveOrientation(game));
+	}
+}
+END_TEST
+
+/**
+ * Rotate the game and the position alike, and check that they agree.
+ * Returns whether the rotation kicked the piece.
+ */
+static bool rotateBoth(const qdsRuleset *rs, int rotation)
+{
+	int x = pos.x, y = pos.y;
+	int expected = qdsRotate(game, rotation);
+	ck_assert_int_eq(qdsPositionRotate(&pos, rs, rotation), expected);
+	ck_assert_int_eq(pos.x, qdsGetActiveX(game));
+	ck_assert_int_eq(pos.y, qdsGetActiveY(game));
+	ck_assert_int_eq(pos.orientation, qdsGetActiveOrientation(game));
+	return pos.x != x || pos.y != y;
+}
+
+/**
+ * Exercise the wall kicks and center-column rule of a classic ruleset.
+ */
+static void checkClassic(const qdsRuleset *rs)
+{
+	static const int pieces[] = { QDS_PIECE_I, QDS_PIECE_J, QDS_PIECE_T };
+	const qdsLine lines[] = {
+		{ 1, 1, 0, 1, 1, 1, 1, 1, 0, 1 },
+		{ 0, 1, 0, 0, 1, 0, 0, 1, 0, 0 },
+	};
+	qdsSetRuleset(game, rs);
+	qdsAddLines(game, lines, 2);
+
+	int kicks = 0;
+	for (int i = 0; i < 3; ++i) {
+		for (int r = -1; r <= 1; r += 2) {
+			for (int wall = -10; wall <= 10; wall += 20) {
+				qdsSpawn(game, pieces[i]);
+				ck_assert(qdsPositionFromGame(&pos, game));
+				rotateBoth(rs, r);
+				ck_assert_int_eq(qdsPositionMove(&pos, rs, wall),
+								 qdsMove(game, wall));
+				kicks += rotateBoth(rs, r);
+				kicks += rotateBoth(rs, r);
+				qdsInstantDrop(game, QDS_DROP_SOFT);
+				qdsPositionDrop(&pos, rs);
+				ck_assert_int_eq(pos.y, qdsGetActiveY(game));
+				kicks += rotateBoth(rs, -r);
+				kicks += rotateBoth(rs, -r);
+			}
+		}
+	}
+	ck_assert_int_gt(kicks, 0);
+
+	/* the T is stuck against the wall with a tile over its center */
+	qdsSpawn(game, QDS_PIECE_T);
+	ck_assert(qdsPositionFromGame(&pos, game));
+	rotateBoth(rs, QDS_ROTATION_CLOCKWISE);
+	qdsMove(game, -10);
+	qdsPositionMove(&pos, rs, -10);
+	qdsInstantDrop(game, QDS_DROP_SOFT);
+	qdsPositionDrop(&pos, rs);
+	ck_assert_int_eq(pos.x, qdsGetActiveX(game));
+	ck_assert_int_eq(pos.y, qdsGetActiveY(game));
+	game->playfield[pos.y + 2][pos.x] = QDS_PIECE_GARBAGE;
+	pos.rows[pos.y + 2] |= 1 << pos.x;
+	rotateBoth(rs, QDS_ROTATION_CLOCKWISE);
+	rotateBoth(rs, QDS_ROTATION_COUNTERCLOCKWISE);
+}
+
+START_TEST(rotateTgm)
+{
+	checkClassic(&qdsRulesetTgm);
+}
+END_TEST
+
+START_TEST(rotateArcade)
+{
+	checkClassic(&qdsRulesetArcade);
+}
+END_TEST
+
+START_TEST(lockClear)
+{
+	const qdsLine lines[] = {
+		{ 1, 1, 1, 0, 0, 0, 0, 1, 1, 1 },
+		{ 1, 1, 1, 0, 0, 0, 0, 1, 1, 0 },
+	};
+	qdsAddLines(game, lines, 2);
+	qdsRunCycle(game, 0);
+	ck_assert(qdsPositionFromGame(&pos, game));
+
+	/* the T does not fill the bottom row */
+	ck_assert(!qdsPositionLock(&pos, &qdsRulesetStandard));
+
+	/* nor does it lock past the walls or into the stack */
+	int x = pos.x, y = pos.y;
+	pos.x = -2;
+	pos.y = 2;
+	ck_assert(!qdsPositionLock(&pos, &qdsRulesetStandard));
+	pos.x = 1;
+	pos.y = 0;
+	ck_assert(!qdsPositionLock(&pos, &qdsRulesetStandard));
+	ck_assert_uint_eq(pos.rows[0], 0x387);
+	ck_assert_uint_eq(pos.rows[1], 0x187);
+	ck_assert_int_eq(pos.height, 2);
+	ck_assert_int_eq(pos.piece, QDS_PIECE_T);
+	pos.x = x;
+	pos.y = y;
+
+	qdsPositionDrop(&pos, &qdsRulesetStandard);
+	ck_assert(qdsPositionLock(&pos, &qdsRulesetStandard));
+	ck_assert_int_eq(pos.piece, QDS_PIECE_NONE);
+	ck_assert_int_eq(qdsPositionClearLines(&pos), 0);
+	ck_assert_int_eq(pos.combo, 0);
+
+	ck_assert(qdsPositionSpawn(&pos, &qdsRulesetStandard));
+	ck_assert_int_eq(pos.piece, QDS_PIECE_I);
+	ck_assert_int_eq(pos.queueLength, 6);
+	qdsPositionDrop(&pos, &qdsRulesetStandard);
+	ck_assert(qdsPositionLock(&pos, &qdsRulesetStandard));
+	ck_assert_int_eq(qdsPositionClearLines(&pos), 0);
+
+	/* fill the last gap of the bottom row */
+	pos.rows[0] |= 0x078;
+	ck_assert_int_eq(qdsPositionClearLines(&pos), 1);
+	ck_assert_int_eq(pos.combo, 1);
+	ck_assert(!pos.b2b);
+	ck_assert_int_eq(pos.height, 2);
+	ck_assert_uint_eq(pos.rows[0], 0x197);
+	ck_assert_uint_eq(pos.rows[1], 0x078);
+}
+END_TEST
+
+START_TEST(hold)
+{
+	qdsRunCycle(game, 0);
+	ck_assert(qdsPositionFromGame(&pos, game));
+
+	ck_assert(qdsPositionHold(&pos, &qdsRulesetStandard));
+	ck_assert_int_eq(pos.hold, QDS_PIECE_T);
+	ck_assert_int_eq(pos.piece, QDS_PIECE_I);
+	ck_assert(!qdsPositionHold(&pos, &qdsRulesetStandard));
+
+	qdsPositionDrop(&pos, &qdsRulesetStandard);
+	qdsPositionLock(&pos, &qdsRulesetStandard);
+	qdsPositionSpawn(&pos, &qdsRulesetStandard);
+	ck_assert_int_eq(pos.piece, QDS_PIECE_O);
+	ck_assert(qdsPositionHold(&pos, &qdsRulesetStandard));
+	ck_assert_int_eq(pos.hold, QDS_PIECE_O);
+	ck_assert_int_eq(pos.piece, QDS_PIECE_T);
+	ck_assert_int_eq(pos.x, 4);
+	ck_assert_int_eq(pos.y, 20);
+}
+END_TEST
+
+Suite *createSuite(void)
+{
+	Suite *s = suite_create("qdsPosition");
+
+	TCase *c = tcase_create("base");
+	tcase_add_unchecked_fixture(c, setupCase, teardownCase);
+	tcase_add_test(c, fromGame);
+	tcase_add_test(c, toGame);
+	tcase_add_test(c, otherSize);
+	tcase_add_test(c, moveDrop);
+	tcase_add_test(c, rotateMatchesGame);
+	tcase_add_test(c, rotateTgm);
+	tcase_add_test(c, rotateArcade);
+	tcase_add_test(c, lockClear);
+	tcase_add_test(c, hold);
+	tcase_add_checked_fixture(c, setup, teardown);
+	suite_add_tcase(s, c);
+
+	return s;
+}
@@ -0,0 +1,261 @@
+/*
+ * Copyright (c) 2023 McEndu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <check.h>
+
+#include <quadus.h>
+#include <quadus/piece.h>
+#include <quadus/position.h>
+#include <quadus/ruleset.h>
+#include <quadus/search.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static const qdsRuleset *rs = &qdsRulesetStandard;
+static qdsSearch *search;
+static qdsPosition pos;
+static qdsPlacement placements[QDS_MAX_PLACEMENTS];
+
+static void setup(void)
+{
+	search = qdsNewSearch(16);
+	if (!search) abort();
+	memset(&pos, 0, sizeof(qdsPosition));
+	pos.spawnX = 4;
+	pos.spawnY = 20;
+}
+
+static void teardown(void)
+{
+	qdsDestroySearch(search);
+}
+
+static void setPieces(int piece, const char *queue)
+{
+	pos.piece = piece;
+	pos.x = pos.spawnX;
+	pos.y = pos.spawnY;
+	pos.orientation = QDS_ORIENTATION_BASE;
+	pos.queueLength = strlen(queue);
+	for (int i = 0; i < pos.queueLength; ++i) pos.queue[i] = queue[i] - '0';
+}
+
+static void setRows(const uint_least16_t *rows, int height)
+{
+	memcpy(pos.rows, rows, height * sizeof(*rows));
+	pos.height = height;
+}
+
+/* prefer clearing lines, a low stack and no holes */
+static int evaluate(const qdsPosition *pos, int lines, void *data)
+{
+	int score = lines * lines * 100 - pos->height * 10;
+	for (int x = 0; x < 10; ++x) {
+		bool covered = false;
+		for (int y = pos->height - 1; y >= 0; --y) {
+			bool filled = (pos->rows[y] >> x) & 1;
+			if (covered && !filled) score -= 50;
+			covered = covered || filled;
+		}
+	}
+	if (data) *(int *)data += 1;
+	return score;
+}
+
+START_TEST(placementsEmpty)
+{
+	setPieces(QDS_PIECE_O, "");
+	ck_assert_int_eq(qdsFindPlacements(&pos, rs, placements, 256), 9);
+	setPieces(QDS_PIECE_I, "");
+	ck_assert_int_eq(qdsFindPlacements(&pos, rs, placements, 256), 17);
+	setPieces(QDS_PIECE_S, "");
+	ck_assert_int_eq(qdsFindPlacements(&pos, rs, placements, 256), 17);
+	setPieces(QDS_PIECE_T, "");
+	ck_assert_int_eq(qdsFindPlacements(&pos, rs, placements, 256), 34);
+
+	/* every placement rests on something */
+	int count = qdsFindPlacements(&pos, rs, placements, 256);
+	for (int i = 0; i < count; ++i) {
+		const qdsPlacement *p = &placements[i];
+		int piece = p->piece, orientation = p->orientation;
+		ck_assert(qdsPositionFits(&pos, rs, piece, orientation, p->x, p->y));
+		ck_assert(
+			!qdsPositionFits(&pos, rs, piece, orientation, p->x, p->y - 1));
+	}
+	ck_assert_int_eq(qdsFindPlacements(&pos, rs, placements, 5), 5);
+}
+END_TEST
+
+START_TEST(placementsTwist)
+{
+	/* a T slot under an overhang */
+	static const uint_least16_t rows[] = { 0x3ef, 0x3c7, 0x008 };
+	setRows(rows, 3);
+	setPieces(QDS_PIECE_T, "");
+
+	int count = qdsFindPlacements(&pos, rs, placements, 256);
+	int twists = 0;
+	for (int i = 0; i < count; ++i) {
+		if (placements[i].twist != QDS_ROTATE_TWIST) continue;
+		qdsPosition copy = pos;
+		if (qdsPositionPlace(&copy, rs, &placements[i]) == 2) twists += 1;
+	}
+	ck_assert_int_gt(twists, 0);
+}
+END_TEST
+
+/* the same slot is no twist where the ruleset has none */
+START_TEST(placementsTgm)
+{
+	static const uint_least16_t rows[] = { 0x3ef, 0x3c7, 0x008 };
+	setRows(rows, 3);
+	setPieces(QDS_PIECE_T, "");
+
+	int count = qdsFindPlacements(&pos, &qdsRulesetTgm, placements, 256);
+	ck_assert_int_gt(count, 0);
+	for (int i = 0; i < count; ++i)
+		ck_assert_int_lt(placements[i].twist, QDS_ROTATE_TWIST);
+}
+END_TEST
+
+START_TEST(bestPlacement)
+{
+	static const uint_least16_t rows[] = { 0x1ff, 0x1ff, 0x1ff, 0x1ff };
+	setRows(rows, 4);
+	setPieces(QDS_PIECE_I, "4");
+
+	qdsSearchLimits limits = { .depth = 2, .beamWidth = 16 };
+	qdsSearchResult result;
+	ck_assert(qdsSearchPlacement(
+		search, &pos, rs, evaluate, NULL, &limits, &result));
+	ck_assert_int_eq(result.depth, 2);
+	ck_assert(!result.placement.hold);
+	ck_assert_int_eq(qdsPositionPlace(&pos, rs, &result.placement), 4);
+	ck_assert_int_eq(pos.height, 0);
+}
+END_TEST
+
+START_TEST(holdPlacement)
+{
+	static const uint_least16_t rows[] = { 0x1ff, 0x1ff, 0x1ff, 0x1ff };
+	setRows(rows, 4);
+	setPieces(QDS_PIECE_O, "1");
+
+	qdsSearchLimits limits = { .depth = 1, .beamWidth = 16 };
+	qdsSearchResult result;
+	ck_assert(qdsSearchPlacement(
+		search, &pos, rs, evaluate, NULL, &limits, &result));
+	ck_assert(result.placement.hold);
+	ck_assert_int_eq(result.placement.piece, QDS_PIECE_I);
+	ck_assert_int_eq(qdsPositionPlace(&pos, rs, &result.placement), 4);
+}
+END_TEST
+
+START_TEST(transpositions)
+{
+	setPieces(QDS_PIECE_O, "4");
+	pos.held = true;
+
+	int evaluations = 0;
+	qdsSearchLimits limits = { .depth = 2, .beamWidth = 1000 };
+	qdsSearchResult result;
+	ck_assert(qdsSearchPlacement(
+		search, &pos, rs, evaluate, &evaluations, &limits, &result));
+	/* two Os side by side are reached in either order */
+	ck_assert_uint_gt(result.hits, 0);
+	ck_assert_uint_eq(result.nodes, evaluations + result.hits);
+
+	/* evaluations carry over */
+	int again = 0;
+	ck_assert(qdsSearchPlacement(
+		search, &pos, rs, evaluate, &again, &limits, &result));
+	ck_assert_int_eq(again, 0);
+	ck_assert_uint_eq(result.hits, result.nodes);
+}
+END_TEST
+
+START_TEST(nodeBudget)
+{
+	setPieces(QDS_PIECE_T, "123456");
+
+	qdsSearchLimits limits = { .depth = 6, .beamWidth = 64, .nodes = 100 };
+	qdsSearchResult result;
+	ck_assert(qdsSearchPlacement(
+		search, &pos, rs, evaluate, NULL, &limits, &result));
+	ck_assert_int_ge(result.depth, 1);
+	ck_assert_int_lt(result.depth, 6);
+	ck_assert_uint_le(result.nodes, 100);
+	ck_assert_int_eq(result.placement.piece,
+					 result.placement.hold ? QDS_PIECE_I : QDS_PIECE_T);
+}
+END_TEST
+
+START_TEST(timeBudget)
+{
+	setPieces(QDS_PIECE_T, "1234567");
+
+	qdsSearchLimits limits = { .depth = 8, .beamWidth = 4096, .time = 5000 };
+	qdsSearchResult result;
+	struct timespec start, end;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	ck_assert(qdsSearchPlacement(
+		search, &pos, rs, evaluate, NULL, &limits, &result));
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	long elapsed = (end.tv_sec - start.tv_sec) * 1000000
+				   + (end.tv_nsec - start.tv_nsec) / 1000;
+	ck_assert_int_lt(elapsed, 500000);
+	ck_assert_int_ge(result.depth, 1);
+}
+END_TEST
+
+START_TEST(noPlacement)
+{
+	setPieces(QDS_PIECE_NONE, "");
+	qdsSearchLimits limits = { .depth = 1, .beamWidth = 1 };
+	qdsSearchResult result;
+	ck_assert(!qdsSearchPlacement(
+		search, &pos, rs, evaluate, NULL, &limits, &result));
+	ck_assert_int_eq(result.depth, 0);
+}
+END_TEST
+
+Suite *createSuite(void)
+{
+	Suite *s = suite_create("qdsSearch");
+
+	TCase *c = tcase_create("base");
+	tcase_add_checked_fixture(c, setup, teardown);
+	tcase_add_test(c, placementsEmpty);
+	tcase_add_test(c, placementsTwist);
+	tcase_add_test(c, placementsTgm);
+	tcase_add_test(c, bestPlacement);
+	tcase_add_test(c, holdPlacement);
+	tcase_add_test(c, transpositions);
+	tcase_add_test(c, nodeBudget);
+	tcase_add_test(c, timeBudget);
+	tcase_add_test(c, noPlacement);
+	suite_add_tcase(s, c);
+
+	return s;
+}
@@ -0,0 +1,252 @@
+/*
+ * Copyright (c) 2023 McEndu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <check.h>
+
+#include "match.h"
+#include "protocol.h"
+#include "replay.h"
+#include "server.h"
+#include <pthread.h>
+#include <quadus.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define REPLAY_FRAMES 600
+
+static char dir[64];
+static char path[96];
+static struct server *server;
+static pthread_t serverThread;
+
+static unsigned char dropInputs[REPLAY_FRAMES];
+
+static void *serve(void *arg)
+{
+	runServer(arg);
+	return NULL;
+}
+
+static void setup(void)
+{
+	strcpy(dir, "/tmp/quadus-test-XXXXXX");
+	ck_assert_ptr_nonnull(mkdtemp(dir));
+	snprintf(path, sizeof(path), "%s/server", dir);
+
+	server = newServer();
+	ck_assert_ptr_nonnull(server);
+	ck_assert(listenUnix(server, path));
+	ck_assert_int_eq(pthread_create(&serverThread, NULL, serve, server), 0);
+
+	/* hard drop every other frame to top out quickly */
+	for (int i = 0; i < REPLAY_FRAMES; ++i)
+		dropInputs[i] = i % 2 ? 0 : QDS_INPUT_HARD_DROP;
+}
+
+static void teardown(void)
+{
+	stopServer(server);
+	pthread_join(serverThread, NULL);
+	freeServer(server);
+	unlink(path);
+	rmdir(dir);
+}
+
+struct client
+{
+	pthread_t thread;
+	uint32_t id;
+	const unsigned char *inputs;
+	size_t count;
+	bool ok;
+	struct replayResult result;
+};
+
+static void *play(void *arg)
+{
+	struct client *c = arg;
+	int fd = connectUnix(path);
+	c->ok = fd >= 0
+			&& replayMatch(fd, c->id, c->inputs, c->count, &c->result);
+	if (fd >= 0) close(fd);
+	return NULL;
+}
+
+static void startClient(struct client *c, uint32_t id, bool drop)
+{
+	c->id = id;
+	c->inputs = drop ? dropInputs : NULL;
+	c->count = drop ? REPLAY_FRAMES : 0;
+	ck_assert_int_eq(pthread_create(&c->thread, NULL, play, c), 0);
+}
+
+static void checkMatch(struct client *dropper, struct client *idler)
+{
+	pthread_join(dropper->thread, NULL);
+	pthread_join(idler->thread, NULL);
+
+	ck_assert(dropper->ok);
+	ck_assert(idler->ok);
+	ck_assert_int_ne(dropper->result.seat, idler->result.seat);
+	ck_assert_int_eq(dropper->result.desyncs, 0);
+	ck_assert_int_eq(idler->result.desyncs, 0);
+	ck_assert_int_eq(dropper->result.frames, idler->result.frames);
+	ck_assert_int_gt(dropper->result.frames, 0);
+	ck_assert_int_lt(dropper->result.frames, REPLAY_FRAMES);
+
+	/* topping out first loses */
+	ck_assert_int_eq(dropper->result.winner, idler->result.seat);
+	ck_assert_int_eq(idler->result.winner, idler->result.seat);
+}
+
+START_TEST(replay)
+{
+	struct client dropper, idler;
+	startClient(&dropper, 1, true);
+	startClient(&idler, 1, false);
+	checkMatch(&dropper, &idler);
+}
+END_TEST
+
+START_TEST(concurrentMatches)
+{
+	struct client clients[16][2];
+	for (int i = 0; i < 16; ++i) {
+		startClient(&clients[i][0], 100 + i, true);
+		startClient(&clients[i][1], 100 + i, false);
+	}
+	for (int i = 0; i < 16; ++i) checkMatch(&clients[i][0], &clients[i][1]);
+}
+END_TEST
+
+static void sendMessage(int fd, const struct message *m)
+{
+	unsigned char buf[MSG_SIZE];
+	encodeMessage(buf, m);
+	ck_assert_int_eq(write(fd, buf, MSG_SIZE), MSG_SIZE);
+}
+
+static void readMessage(int fd, struct message *m)
+{
+	unsigned char buf[MSG_SIZE];
+	ck_assert_int_eq(recv(fd, buf, MSG_SIZE, MSG_WAITALL), MSG_SIZE);
+	decodeMessage(m, buf);
+}
+
+START_TEST(forfeit)
+{
+	int a = connectUnix(path), b = connectUnix(path);
+	ck_assert_int_ge(a, 0);
+	ck_assert_int_ge(b, 0);
+
+	struct message m = { .type = MSG_JOIN, .value = 7 };
+	sendMessage(a, &m);
+	sendMessage(b, &m);
+	readMessage(a, &m);
+	ck_assert_int_eq(m.type, MSG_START);
+	int seat = m.seat;
+	readMessage(b, &m);
+	ck_assert_int_eq(m.type, MSG_START);
+	ck_assert_int_eq(m.seat, !seat);
+
+	close(b);
+	readMessage(a, &m);
+	ck_assert_int_eq(m.type, MSG_END);
+	ck_assert_int_eq(m.seat, seat);
+	close(a);
+}
+END_TEST
+
+START_TEST(badInput)
+{
+	int a = connectUnix(path), b = connectUnix(path);
+	struct message m = { .type = MSG_JOIN, .value = 8 };
+	sendMessage(a, &m);
+	sendMessage(b, &m);
+	readMessage(a, &m);
+	int seat = m.seat;
+	readMessage(b, &m);
+
+	/* frames must arrive in order */
+	m = (struct message){ .type = MSG_INPUT, .frame = 5 };
+	sendMessage(b, &m);
+	readMessage(a, &m);
+	ck_assert_int_eq(m.type, MSG_END);
+	ck_assert_int_eq(m.seat, seat);
+	ck_assert_int_eq(recv(b, &m, 1, 0), 0);
+	close(a);
+	close(b);
+}
+END_TEST
+
+START_TEST(hash)
+{
+	struct match *a = newMatch(1, 42), *b = newMatch(1, 42);
+	uint16_t inputs;
+	ck_assert_uint_eq(matchHash(a), matchHash(b));
+
+	/* identical until the inputs differ */
+	int frame = 0;
+	for (; frame < 30; ++frame) {
+		for (int seat = 0; seat < 2; ++seat) {
+			pushInput(a, seat, frame, 0);
+			pushInput(b, seat, frame, 0);
+		}
+		ck_assert(stepMatch(a, &inputs));
+		ck_assert(stepMatch(b, &inputs));
+		ck_assert_uint_eq(matchHash(a), matchHash(b));
+	}
+
+	pushInput(a, 0, frame, QDS_INPUT_LEFT);
+	pushInput(a, 1, frame, 0);
+	pushInput(b, 0, frame, QDS_INPUT_RIGHT);
+	pushInput(b, 1, frame, 0);
+	ck_assert(stepMatch(a, &inputs));
+	ck_assert_uint_eq(inputs, QDS_INPUT_LEFT);
+	ck_assert(stepMatch(b, &inputs));
+	ck_assert_uint_ne(matchHash(a), matchHash(b));
+	ck_assert(!stepMatch(a, &inputs));
+
+	freeMatch(a);
+	freeMatch(b);
+}
+END_TEST
+
+Suite *createSuite(void)
+{
+	Suite *s = suite_create("server");
+
+	TCase *c = tcase_create("base");
+	tcase_add_checked_fixture(c, setup, teardown);
+	tcase_add_test(c, replay);
+	tcase_add_test(c, concurrentMatches);
+	tcase_add_test(c, forfeit);
+	tcase_add_test(c, badInput);
+	tcase_add_test(c, hash);
+	tcase_set_timeout(c, 30);
+	suite_add_tcase(s, c);
+
+	return s;
+}
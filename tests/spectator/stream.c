@@ -0,0 +1,261 @@
+/*
+ * Copyright (c) 2023 McEndu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <check.h>
+
+#include "game.h"
+#include "mockgen.h"
+#include <quadus.h>
+#include <quadus/calls.h>
+#include <quadus/piece.h>
+#include <quadus/ruleset.h>
+#include <quadus/ruleset/utils.h>
+#include <quadus/spectator.h>
+#include <quadus/ui.h>
+#include <quadus/versus.h>
+#include <stdlib.h>
+#include <string.h>
+
+static qdsGame *game;
+static qdsSpectator encoder;
+static qdsSpectatorView view;
+static size_t streamSize;
+
+static void setup(void)
+{
+	game = qdsNewGame();
+	if (!game) abort();
+	qdsSetRuleset(game, &qdsRulesetStandard);
+	qdsSetMode(game, &qdsModeMarathon);
+	qdsInitSpectator(&encoder);
+	qdsSetUi(game, &qdsSpectatorUi, &encoder);
+	qdsInitSpectatorView(&view);
+	streamSize = 0;
+}
+
+static void teardown(void)
+{
+	qdsDestroyGame(game);
+}
+
+static unsigned int stat(qdsGame *game, unsigned long req)
+{
+	unsigned int value = 0;
+	qdsCall(game, req, &value);
+	return value;
+}
+
+static void checkView(qdsGame *game, const qdsSpectatorView *view)
+{
+	int height = qdsGetFieldHeight(game);
+	ck_assert_int_eq(view->height, height);
+	for (int y = 0; y < 48; ++y) {
+		for (int x = 0; x < 10; ++x)
+			ck_assert_int_eq(view->playfield[y][x], qdsGetTile(game, x, y));
+	}
+
+	int piece = qdsGetActivePieceType(game);
+	ck_assert_int_eq(view->piece, piece);
+	if (piece) {
+		ck_assert_int_eq(view->orientation, qdsGetActiveOrientation(game));
+		ck_assert_int_eq(view->x, qdsGetActiveX(game));
+		ck_assert_int_eq(view->y, qdsGetActiveY(game));
+	}
+	ck_assert_int_eq(view->hold, qdsGetHeldPiece(game));
+	for (int i = 0; i < view->queueLength; ++i)
+		ck_assert_int_eq(view->queue[i], qdsGetNextPiece(game, i));
+
+	ck_assert_uint_eq(view->lines, stat(game, QDS_GETLINES));
+	ck_assert_uint_eq(view->score, stat(game, QDS_GETSCORE));
+	ck_assert_int_eq(view->level, (int)stat(game, QDS_GETLEVEL));
+}
+
+/* run a cycle, then pass its frame through the stream */
+static void step(unsigned int input)
+{
+	unsigned char buf[QDS_SPECTATOR_MAX_FRAME];
+	qdsRunCycle(game, input);
+	size_t size = qdsEncodeSpectatorFrame(&encoder, game, buf);
+	ck_assert_uint_le(size, QDS_SPECTATOR_MAX_FRAME);
+	ck_assert_int_eq(qdsDecodeSpectatorFrame(&view, buf, size), size);
+	streamSize += size;
+	checkView(game, &view);
+}
+
+static unsigned int randomInput(unsigned int *seed)
+{
+	static const unsigned int inputs[] = {
+		0,
+		QDS_INPUT_LEFT,
+		QDS_INPUT_RIGHT,
+		QDS_INPUT_ROTATE_C,
+		QDS_INPUT_ROTATE_CC,
+		QDS_INPUT_SOFT_DROP,
+		QDS_INPUT_HARD_DROP,
+		QDS_INPUT_HOLD,
+	};
+	*seed = *seed * 1103515245 + 12345;
+	return inputs[(*seed >> 16) % 8];
+}
+
+START_TEST(randomPlay)
+{
+	unsigned int seed = 1;
+	for (int i = 0; i < 3000; ++i) step(randomInput(&seed));
+
+	/* most frames carry little more than the piece moving */
+	ck_assert_uint_lt(streamSize, 3000 * 8);
+}
+END_TEST
+
+START_TEST(idleFrames)
+{
+	unsigned char buf[QDS_SPECTATOR_MAX_FRAME];
+	step(0);
+	for (int i = 0; i < 3; ++i) step(0);
+	/* nothing happens between the piece falling a row */
+	ck_assert_uint_eq(qdsEncodeSpectatorFrame(&encoder, game, buf), 1);
+	ck_assert_int_eq(buf[0], 0);
+}
+END_TEST
+
+START_TEST(lineClears)
+{
+	static const int sequence[] = { QDS_PIECE_O };
+	qdsSetMode(game, &mockGenMode);
+	setMockSequence(game, sequence, 1);
+
+	/* two lines to clear under a line that falls in their place */
+	qdsLine lines[3] = { 0 };
+	for (int y = 0; y < 2; ++y) {
+		for (int x = 0; x < 10; ++x)
+			lines[y][x] = (x == 4 || x == 5) ? 0 : QDS_PIECE_GARBAGE;
+	}
+	lines[2][0] = QDS_PIECE_GARBAGE;
+	qdsAddLines(game, lines, 3);
+
+	while (!qdsGetActivePieceType(game)) step(0);
+	step(QDS_INPUT_HARD_DROP);
+	for (int i = 0; i < 60; ++i) step(0);
+	ck_assert_int_eq(qdsGetTile(game, 0, 0), QDS_PIECE_GARBAGE);
+	ck_assert_uint_eq(stat(game, QDS_GETLINES), 2);
+}
+END_TEST
+
+START_TEST(outsideChanges)
+{
+	unsigned int seed = 7;
+	for (int i = 0; i < 1000; ++i) {
+		if (i % 100 == 50) {
+			qdsLine line = { 0 };
+			for (int x = 0; x < 10; ++x)
+				line[x] = x == i / 100 ? 0 : QDS_PIECE_GARBAGE;
+			qdsAddLines(game, &line, 1);
+		}
+		if (i == 500) qdsClearPlayfield(game);
+		step(randomInput(&seed));
+	}
+}
+END_TEST
+
+START_TEST(garbage)
+{
+	qdsGame *opponent = qdsNewGame();
+	if (!opponent) abort();
+	qdsSetRuleset(opponent, &qdsRulesetStandard);
+	qdsSetMode(opponent, &qdsModeVersus);
+	qdsSetMode(game, &qdsModeVersus);
+	ck_assert(qdsVersusPair(game, opponent, 3));
+
+	unsigned int seed = 3;
+	int risen = 0;
+	for (int i = 0; i < 1000; ++i) {
+		if (i % 100 == 0) {
+			/* pretend the opponent has just cleared four lines */
+			qdsRulesetState *state = qdsGetRulesetData(opponent);
+			state->clearType = QDS_LINECLEAR_QUADUS;
+			opponent->mode->events.postLock(opponent);
+		}
+		int height = qdsGetFieldHeight(game);
+		step(randomInput(&seed));
+		if (qdsGetFieldHeight(game) > height + 2) risen += 1;
+	}
+	ck_assert_int_gt(risen, 0);
+	qdsDestroyGame(opponent);
+}
+END_TEST
+
+START_TEST(keyframe)
+{
+	unsigned char buf[QDS_SPECTATOR_MAX_FRAME];
+	unsigned int seed = 5;
+	for (int i = 0; i < 500; ++i) step(randomInput(&seed));
+
+	qdsSpectatorView late;
+	qdsInitSpectatorView(&late);
+	size_t size = qdsEncodeSpectatorKeyframe(&encoder, game, buf);
+	ck_assert_int_eq(qdsDecodeSpectatorFrame(&late, buf, size), size);
+	checkView(game, &late);
+
+	for (int i = 0; i < 500; ++i) {
+		qdsRunCycle(game, randomInput(&seed));
+		size = qdsEncodeSpectatorFrame(&encoder, game, buf);
+		ck_assert_int_eq(qdsDecodeSpectatorFrame(&late, buf, size), size);
+		checkView(game, &late);
+	}
+}
+END_TEST
+
+START_TEST(malformed)
+{
+	unsigned char buf[QDS_SPECTATOR_MAX_FRAME];
+	size_t size = qdsEncodeSpectatorFrame(&encoder, game, buf);
+	for (size_t i = 0; i < size; ++i)
+		ck_assert_int_eq(qdsDecodeSpectatorFrame(&view, buf, i), -1);
+
+	static const unsigned char badRow[] = { 3, 48, 0, 0, 0, 0, 0, 0 };
+	ck_assert_int_eq(qdsDecodeSpectatorFrame(&view, badRow, 8), -1);
+	static const unsigned char badTag[] = { 0xff, 0 };
+	ck_assert_int_eq(qdsDecodeSpectatorFrame(&view, badTag, 2), -1);
+	static const unsigned char badVarint[] = { 9, 0xff, 0xff, 0xff, 0xff,
+											   0xff, 0xff, 0 };
+	ck_assert_int_eq(qdsDecodeSpectatorFrame(&view, badVarint, 8), -1);
+}
+END_TEST
+
+Suite *createSuite(void)
+{
+	Suite *s = suite_create("Spectator stream");
+
+	TCase *c = tcase_create("base");
+	tcase_add_checked_fixture(c, setup, teardown);
+	tcase_add_test(c, randomPlay);
+	tcase_add_test(c, idleFrames);
+	tcase_add_test(c, lineClears);
+	tcase_add_test(c, outsideChanges);
+	tcase_add_test(c, garbage);
+	tcase_add_test(c, keyframe);
+	tcase_add_test(c, malformed);
+	suite_add_tcase(s, c);
+
+	return s;
+}
@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2023 McEndu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "play.h"
+
+#include <quadus.h>
+
+#include <stdlib.h>
+
+static const unsigned int inputs[] = {
+	0,
+	QDS_INPUT_LEFT,
+	QDS_INPUT_ROTATE_C,
+	QDS_INPUT_HARD_DROP,
+	QDS_INPUT_RIGHT,
+	QDS_INPUT_HOLD,
+	QDS_INPUT_SOFT_DROP,
+	QDS_INPUT_ROTATE_CC,
+	QDS_INPUT_HARD_DROP,
+};
+
+unsigned int playInput(int cycle)
+{
+	return inputs[cycle / 3 % (sizeof(inputs) / sizeof(*inputs))];
+}
+
+qdsGame *newPlayGame(const qdsRuleset *rs,
+					 const qdsGamemode *mode,
+					 int width,
+					 int height)
+{
+	qdsGame *game = qdsNewGameSized(width, height);
+	if (!game) abort();
+	qdsSetRuleset(game, rs);
+	qdsSetMode(game, mode);
+	return game;
+}
@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) 2023 McEndu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef PLAY_H
+#define PLAY_H
+
+#include <quadus.h>
+
+/**
+ * Input for the given cycle of scripted play: moves, rotations, holds
+ * and drops in a short loop, each held for three cycles.
+ */
+extern unsigned int playInput(int cycle);
+
+/**
+ * Create a game with a ruleset and gamemode, on a playfield of the
+ * given width and visible height. Aborts if the game cannot be
+ * created.
+ */
+extern qdsGame *newPlayGame(const qdsRuleset *rs,
+							const qdsGamemode *mode,
+							int width,
+							int height);
+
+#endif /* !PLAY_H */
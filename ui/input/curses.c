@@ -25,11 +25,16 @@
 #include <curses.h>
 #include <quadus.h>
 #include <signal.h>
+#include <time.h>
+#include <unistd.h>
 
-static unsigned int readCursesInput(unsigned int *last, void *_)
+static unsigned int readCursesInput(unsigned int *last,
+									void *_,
+									struct timespec *time)
 {
 	unsigned int input = 0;
 	unsigned int ch;
+	lockCurses();
 	while ((ch = getch()) != ERR) {
 		switch (ch) {
 			case KEY_LEFT:
@@ -71,14 +76,33 @@ static unsigned int readCursesInput(unsigned int *last, void *_)
 				break;
 			case 'q':
 			case 'Q':
-				raise(SIGINT);
+				/* may run on an input thread; signal the whole process */
+				kill(getpid(), SIGINT);
 				break;
 		}
 	}
+	unlockCurses();
+
+	/* terminals carry no timestamps; the read is as close as it gets */
+	if (input) clock_gettime(CLOCK_MONOTONIC, time);
+
 	*last = input;
 	return input;
 }
 
+static int getStdin(void *_)
+{
+	return STDIN_FILENO;
+}
+
+static const char *getName(void *_)
+{
+	return "terminal";
+}
+
 const struct inputHandler cursesInput = {
 	.read = readCursesInput,
+	.getFd = getStdin,
+	.getName = getName,
+	.threaded = true,
 };
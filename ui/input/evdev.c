@@ -27,10 +27,12 @@
 #include "quadustui.h"
 
 #include <bits/time.h>
+#include <errno.h>
 #include <fcntl.h>
 #include <limits.h>
 #include <signal.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/ioctl.h>
 #include <time.h>
 #include <unistd.h>
@@ -41,49 +43,73 @@ struct inputData
 {
 	int fd;
 	int oldStdinMode;
+	struct evdevState state;
+	char name[64];
 };
 
-unsigned int mapEvdevInput(int key)
+/*
+ * Translate a key or button to input flags, without side effects.
+ */
+static unsigned int keyFlags(int key)
 {
-	unsigned int flag = 0;
 	switch (key) {
 		case KEY_LEFT:
-			flag = QDS_INPUT_LEFT | INPUT_UI_LEFT;
-			break;
+		case BTN_DPAD_LEFT:
+			return QDS_INPUT_LEFT | INPUT_UI_LEFT;
 		case KEY_RIGHT:
-			flag = QDS_INPUT_RIGHT | INPUT_UI_RIGHT;
-			break;
+		case BTN_DPAD_RIGHT:
+			return QDS_INPUT_RIGHT | INPUT_UI_RIGHT;
 		case KEY_DOWN:
-			flag = QDS_INPUT_SOFT_DROP | INPUT_UI_DOWN;
-			break;
+		case BTN_DPAD_DOWN:
+			return QDS_INPUT_SOFT_DROP | INPUT_UI_DOWN;
 		case KEY_UP:
-			flag = QDS_INPUT_HARD_DROP | INPUT_UI_UP;
-			break;
+		case BTN_DPAD_UP:
+			return QDS_INPUT_HARD_DROP | INPUT_UI_UP;
 		case KEY_SPACE:
-			flag = QDS_INPUT_HARD_DROP | INPUT_UI_CONFIRM;
-			break;
+			return QDS_INPUT_HARD_DROP | INPUT_UI_CONFIRM;
 		case KEY_ENTER:
-			flag = INPUT_UI_CONFIRM;
-			break;
+		case BTN_START:
+			return INPUT_UI_CONFIRM;
 		case KEY_X:
-			flag = QDS_INPUT_ROTATE_C;
-			break;
+		case BTN_EAST:
+			return QDS_INPUT_ROTATE_C;
 		case KEY_Z:
 		case KEY_C:
-			flag = QDS_INPUT_ROTATE_CC;
-			break;
+		case BTN_SOUTH:
+		case BTN_WEST:
+			return QDS_INPUT_ROTATE_CC;
 		case KEY_LEFTSHIFT:
-			flag = QDS_INPUT_HOLD;
-			break;
+		case BTN_TL:
+		case BTN_TR:
+			return QDS_INPUT_HOLD;
 		case KEY_ESC:
-			flag = INPUT_UI_BACK | INPUT_UI_MENU;
-			break;
-		case KEY_Q:
-			raise(SIGINT);
-			break;
+		case BTN_SELECT:
+			return INPUT_UI_BACK | INPUT_UI_MENU;
 	}
 
-	return flag;
+	return 0;
+}
+
+unsigned int mapEvdevInput(int key)
+{
+	/* may run on an input thread; signal the whole process */
+	if (key == KEY_Q) kill(getpid(), SIGINT);
+	return keyFlags(key);
+}
+
+/*
+ * Translate the position of a gamepad hat to input flags.
+ */
+static unsigned int hatFlags(int axis, int value)
+{
+	if (axis == ABS_HAT0X) {
+		if (value < 0) return QDS_INPUT_LEFT | INPUT_UI_LEFT;
+		if (value > 0) return QDS_INPUT_RIGHT | INPUT_UI_RIGHT;
+	} else if (axis == ABS_HAT0Y) {
+		if (value < 0) return QDS_INPUT_HARD_DROP | INPUT_UI_UP;
+		if (value > 0) return QDS_INPUT_SOFT_DROP | INPUT_UI_DOWN;
+	}
+	return 0;
 }
 
 static unsigned int syncInput(int fd)
@@ -91,66 +117,99 @@ static unsigned int syncInput(int fd)
 	unsigned char keys[KEY_CNT / CHAR_BIT];
 	unsigned int input = 0;
 
-	ioctl(fd, EVIOCGKEY(sizeof(keys)), keys);
-
-	if (BIT_GET(keys, KEY_LEFT)) input |= QDS_INPUT_LEFT | INPUT_UI_LEFT;
-	if (BIT_GET(keys, KEY_RIGHT)) input |= QDS_INPUT_RIGHT | INPUT_UI_RIGHT;
-	if (BIT_GET(keys, KEY_DOWN)) input |= QDS_INPUT_SOFT_DROP | INPUT_UI_DOWN;
-	if (BIT_GET(keys, KEY_UP)) input |= QDS_INPUT_HARD_DROP | INPUT_UI_UP;
-	if (BIT_GET(keys, KEY_SPACE))
-		input |= QDS_INPUT_HARD_DROP | INPUT_UI_CONFIRM;
-	if (BIT_GET(keys, KEY_ENTER)) input |= INPUT_UI_CONFIRM;
-	if (BIT_GET(keys, KEY_X)) input |= QDS_INPUT_ROTATE_C;
-	if (BIT_GET(keys, KEY_Z) || BIT_GET(keys, KEY_C))
-		input |= QDS_INPUT_ROTATE_CC;
-	if (BIT_GET(keys, KEY_LEFTSHIFT)) input |= QDS_INPUT_HOLD;
-	if (BIT_GET(keys, KEY_ESC)) input |= INPUT_UI_BACK | INPUT_UI_MENU;
+	if (ioctl(fd, EVIOCGKEY(sizeof(keys)), keys) >= 0) {
+		for (int key = 0; key < KEY_CNT; ++key)
+			if (BIT_GET(keys, key)) input |= keyFlags(key);
+	}
+
+	struct input_absinfo abs;
+	if (ioctl(fd, EVIOCGABS(ABS_HAT0X), &abs) >= 0)
+		input |= hatFlags(ABS_HAT0X, abs.value);
+	if (ioctl(fd, EVIOCGABS(ABS_HAT0Y), &abs) >= 0)
+		input |= hatFlags(ABS_HAT0Y, abs.value);
 
 	return input;
 }
 
-static unsigned int readInput(unsigned int *prev, void *st)
+void initEvdevState(struct evdevState *state, int fd)
+{
+	state->input = syncInput(fd);
+	state->dropped = false;
+}
+
+int readEvdevEvents(int fd, struct evdevState *state, struct timespec *time)
 {
 	struct input_event ev;
-	struct inputData *state = st;
-	unsigned int input = *prev;
-	struct
-	{
-		bool dropped : 1;
-	} flags = { 0 };
+	ssize_t count;
 
-	input &= QDS_INPUT_LEFT | QDS_INPUT_RIGHT | QDS_INPUT_SOFT_DROP
-			 | QDS_INPUT_HARD_DROP;
+	state->input &= EVDEV_HELD_INPUT;
 
-	while (read(state->fd, &ev, sizeof(struct input_event)) > 0) {
-		/* ignore everything if events are dropped */
-		if (flags.dropped) continue;
+	while ((count = read(fd, &ev, sizeof(struct input_event))) > 0) {
+		if (state->dropped) {
+			/*
+			 * Events up to the next report are incomplete; throw them
+			 * away and query the device state directly.
+			 */
+			if (ev.type == EV_SYN && ev.code == SYN_REPORT) {
+				state->input = syncInput(fd);
+				state->dropped = false;
+			}
+			continue;
+		}
 
 		if (ev.type == EV_SYN) {
-			if (ev.code == SYN_DROPPED) {
-				input = syncInput(state->fd);
-				flags.dropped = true;
+			if (ev.code == SYN_DROPPED) state->dropped = true;
+			continue;
+		} else if (ev.type == EV_ABS) {
+			unsigned int all = hatFlags(ev.code, -1) | hatFlags(ev.code, 1);
+			unsigned int now = hatFlags(ev.code, ev.value);
+			state->input = (state->input & ~all) | now;
+			if (!now) continue;
+		} else if (ev.type == EV_KEY) {
+			unsigned int flags = mapEvdevInput(ev.code);
+			if (ev.value == 0) {
+				state->input &= ~flags;
+				continue;
+			} else if (ev.value != 1 || !flags) {
+				continue; /* autorepeat or unmapped */
 			}
+			state->input |= flags;
+		} else {
 			continue;
-		} else if (ev.type != EV_KEY) {
-			continue; /* no support for non-button inputs */
 		}
 
-		unsigned int flags = mapEvdevInput(ev.code);
-		if (ev.value == 0) {
-			input &= ~flags;
-		} else if (ev.value == 1) {
-			input |= flags;
-		}
+		/* a press; timestamps are on CLOCK_MONOTONIC */
+		struct timespec t = {
+			.tv_sec = ev.input_event_sec,
+			.tv_nsec = ev.input_event_usec * 1000,
+		};
+		if (time->tv_sec < 0 || t.tv_sec < time->tv_sec
+			|| (t.tv_sec == time->tv_sec && t.tv_nsec < time->tv_nsec))
+			*time = t;
 	}
 
-	/* clear out stdin */
+	if (count < 0 && errno != EAGAIN && errno != EINTR) return -1;
+	return 0;
+}
 
-	while (read(STDIN_FILENO, &ev, sizeof(struct input_event)) > 0)
-		;
+static unsigned int readInput(unsigned int *prev,
+							  void *st,
+							  struct timespec *time)
+{
+	struct inputData *data = st;
 
-	*prev = input;
-	return input;
+	readEvdevEvents(data->fd, &data->state, time);
+	drainStdin();
+
+	*prev = data->state.input;
+	return data->state.input;
+}
+
+void drainStdin(void)
+{
+	char buf[64];
+	while (read(STDIN_FILENO, buf, sizeof(buf)) > 0)
+		;
 }
 
 static void *initInput(int fd)
@@ -161,9 +220,13 @@ static void *initInput(int fd)
 	struct inputData *data = malloc(sizeof(struct inputData));
 	if (!data) return NULL;
 	data->fd = fd;
+	if (ioctl(fd, EVIOCGNAME(sizeof(data->name)), data->name) < 0)
+		strcpy(data->name, "evdev");
+	data->name[sizeof(data->name) - 1] = 0;
 
 	int clockMonotonic = CLOCK_MONOTONIC;
 	ioctl(fd, EVIOCSCLOCKID, &clockMonotonic);
+	initEvdevState(&data->state, fd);
 
 	int fileflags;
 	if ((fileflags = fcntl(fd, F_GETFL)) < 0) {
@@ -193,8 +256,23 @@ static void cleanup(void *state)
 	free(data);
 }
 
+static int getFd(void *state)
+{
+	struct inputData *data = state;
+	return data->fd;
+}
+
+static const char *getName(void *state)
+{
+	struct inputData *data = state;
+	return data->name;
+}
+
 const struct inputHandler evdevInput = {
 	.read = readInput,
 	.init = initInput,
 	.cleanup = cleanup,
+	.getFd = getFd,
+	.getName = getName,
+	.threaded = true,
 };
@@ -23,8 +23,43 @@
 #ifndef INPUT_EVDEV_H
 #define INPUT_EVDEV_H
 
+#include <stdbool.h>
+#include <time.h>
+
+#include <quadus.h>
+
+/* inputs that stay on while their key is held down */
+#define EVDEV_HELD_INPUT                                    \
+	(QDS_INPUT_LEFT | QDS_INPUT_RIGHT | QDS_INPUT_SOFT_DROP \
+	 | QDS_INPUT_HARD_DROP)
+
+/*
+ * Input state of one evdev device.
+ */
+struct evdevState
+{
+	unsigned int input;
+	/* events were lost; waiting for the next report to resync */
+	bool dropped;
+};
+
 unsigned int mapEvdevInput(int key);
 
+/*
+ * Query the device for its current state.
+ */
+void initEvdevState(struct evdevState *state, int fd);
+/*
+ * Apply all pending events of a device to its state. *time is moved
+ * back to the earliest key press read. Returns -1 if the device can no
+ * longer be read, e.g. because it was unplugged.
+ */
+int readEvdevEvents(int fd, struct evdevState *state, struct timespec *time);
+/*
+ * Throw away anything typed into the terminal while evdev is in use.
+ */
+void drainStdin(void);
+
 #define BIT_GET(bitset, bit) \
 	((bitset)[(bit) / CHAR_BIT] & (1 << (bit) % CHAR_BIT))
 
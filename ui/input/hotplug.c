@@ -0,0 +1,253 @@
+/*
+ * Copyright (c) 2023 McEndu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "config.h"
+#include "evdev.h"
+#include "input.h"
+#include "quadustui.h"
+
+#include <fcntl.h>
+#include <libudev.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <linux/input.h>
+
+#define MAX_DEVICES 16
+#define MONITOR UINT32_MAX
+
+struct device
+{
+	int fd; /* -1 if the slot is free */
+	dev_t devnum;
+	struct evdevState state;
+};
+
+struct hotplugData
+{
+	/* every device and the udev monitor, in one epoll set */
+	int epoll;
+	struct udev *udev;
+	struct udev_monitor *monitor;
+	struct device devices[MAX_DEVICES];
+	int oldStdinMode;
+	char name[32];
+};
+
+static void addDevice(struct hotplugData *data, struct udev_device *dev)
+{
+	const char *filename = udev_device_get_devnode(dev);
+	dev_t devnum = udev_device_get_devnum(dev);
+	if (!filename) return;
+
+	struct device *slot = NULL;
+	for (int i = 0; i < MAX_DEVICES; ++i) {
+		struct device *d = &data->devices[i];
+		if (d->fd >= 0 && d->devnum == devnum) return; /* already open */
+		if (d->fd < 0 && !slot) slot = d;
+	}
+	if (!slot) return; /* no room */
+
+	int fd = open(filename, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+	if (fd < 0) return;
+	if (!isGameInputDevice(fd)) {
+		close(fd);
+		return;
+	}
+
+	int clockMonotonic = CLOCK_MONOTONIC;
+	ioctl(fd, EVIOCSCLOCKID, &clockMonotonic);
+
+	struct epoll_event ev = {
+		.events = EPOLLIN,
+		.data.u32 = slot - data->devices,
+	};
+	if (epoll_ctl(data->epoll, EPOLL_CTL_ADD, fd, &ev) < 0) {
+		close(fd);
+		return;
+	}
+
+	slot->fd = fd;
+	slot->devnum = devnum;
+	initEvdevState(&slot->state, fd);
+}
+
+static void removeDevice(struct hotplugData *data, struct device *d)
+{
+	epoll_ctl(data->epoll, EPOLL_CTL_DEL, d->fd, NULL);
+	close(d->fd);
+	d->fd = -1;
+}
+
+static void handleHotplug(struct hotplugData *data)
+{
+	struct udev_device *dev;
+	while ((dev = udev_monitor_receive_device(data->monitor))) {
+		const char *action = udev_device_get_action(dev);
+		dev_t devnum = udev_device_get_devnum(dev);
+
+		if (action && !strcmp(action, "add")) {
+			addDevice(data, dev);
+		} else if (action && !strcmp(action, "remove")) {
+			for (int i = 0; i < MAX_DEVICES; ++i) {
+				struct device *d = &data->devices[i];
+				if (d->fd >= 0 && d->devnum == devnum) removeDevice(data, d);
+			}
+		}
+
+		udev_device_unref(dev);
+	}
+}
+
+static unsigned int readInput(unsigned int *prev,
+							  void *st,
+							  struct timespec *time)
+{
+	struct hotplugData *data = st;
+
+	/* inputs not held down are only reported once */
+	for (int i = 0; i < MAX_DEVICES; ++i)
+		data->devices[i].state.input &= EVDEV_HELD_INPUT;
+
+	struct epoll_event events[MAX_DEVICES + 1];
+	int count = epoll_wait(data->epoll, events, MAX_DEVICES + 1, 0);
+	for (int i = 0; i < count; ++i) {
+		uint32_t slot = events[i].data.u32;
+		if (slot == MONITOR) {
+			handleHotplug(data);
+			continue;
+		}
+
+		struct device *d = &data->devices[slot];
+		if (d->fd < 0) continue; /* removed by an earlier event */
+		if (readEvdevEvents(d->fd, &d->state, time) < 0)
+			removeDevice(data, d); /* unplugged */
+	}
+
+	drainStdin();
+
+	/* merge all devices */
+	unsigned int input = 0;
+	for (int i = 0; i < MAX_DEVICES; ++i)
+		if (data->devices[i].fd >= 0) input |= data->devices[i].state.input;
+
+	*prev = input;
+	return input;
+}
+
+static void cleanup(void *st)
+{
+	struct hotplugData *data = st;
+	for (int i = 0; i < MAX_DEVICES; ++i)
+		if (data->devices[i].fd >= 0) close(data->devices[i].fd);
+	if (data->monitor) udev_monitor_unref(data->monitor);
+	if (data->udev) udev_unref(data->udev);
+	if (data->epoll >= 0) close(data->epoll);
+	if (data->oldStdinMode >= 0)
+		fcntl(STDIN_FILENO, F_SETFL, data->oldStdinMode);
+	free(data);
+}
+
+static void *initInput(int fd)
+{
+	struct hotplugData *data = calloc(1, sizeof(struct hotplugData));
+	if (!data) return NULL;
+	for (int i = 0; i < MAX_DEVICES; ++i) data->devices[i].fd = -1;
+	data->oldStdinMode = -1;
+
+	data->epoll = epoll_create1(EPOLL_CLOEXEC);
+	data->udev = udev_new();
+	if (data->epoll < 0 || !data->udev) goto fail;
+
+	/* watch for devices coming and going... */
+	data->monitor = udev_monitor_new_from_netlink(data->udev, "udev");
+	if (!data->monitor) goto fail;
+	udev_monitor_filter_add_match_subsystem_devtype(
+		data->monitor, "input", NULL);
+	if (udev_monitor_enable_receiving(data->monitor) < 0) goto fail;
+
+	int monitorFd = udev_monitor_get_fd(data->monitor);
+	fcntl(monitorFd, F_SETFL, fcntl(monitorFd, F_GETFL) | O_NONBLOCK);
+	struct epoll_event ev = { .events = EPOLLIN, .data.u32 = MONITOR };
+	if (epoll_ctl(data->epoll, EPOLL_CTL_ADD, monitorFd, &ev) < 0) goto fail;
+
+	/* ...then open everything already present */
+	struct udev_enumerate *enumerate = udev_enumerate_new(data->udev);
+	udev_enumerate_add_match_subsystem(enumerate, "input");
+	udev_enumerate_scan_devices(enumerate);
+
+	struct udev_list_entry *l;
+	udev_list_entry_foreach(l, udev_enumerate_get_list_entry(enumerate))
+	{
+		const char *syspath = udev_list_entry_get_name(l);
+		struct udev_device *dev
+			= udev_device_new_from_syspath(data->udev, syspath);
+		if (!dev) continue;
+		addDevice(data, dev);
+		udev_device_unref(dev);
+	}
+	udev_enumerate_unref(enumerate);
+
+	/* the terminal still receives keystrokes; keep it from blocking */
+	data->oldStdinMode = fcntl(STDIN_FILENO, F_GETFL);
+	if (data->oldStdinMode >= 0)
+		fcntl(STDIN_FILENO, F_SETFL, data->oldStdinMode | O_NONBLOCK);
+
+	return data;
+
+fail:
+	cleanup(data);
+	return NULL;
+}
+
+static int getFd(void *st)
+{
+	struct hotplugData *data = st;
+	return data->epoll;
+}
+
+static const char *getName(void *st)
+{
+	struct hotplugData *data = st;
+	int count = 0;
+	for (int i = 0; i < MAX_DEVICES; ++i)
+		if (data->devices[i].fd >= 0) ++count;
+
+	snprintf(data->name, sizeof(data->name), "evdev (%d devices)", count);
+	return data->name;
+}
+
+const struct inputHandler hotplugInput = {
+	.read = readInput,
+	.init = initInput,
+	.cleanup = cleanup,
+	.getFd = getFd,
+	.getName = getName,
+	.threaded = true,
+};
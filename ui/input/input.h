@@ -23,15 +23,38 @@
 #ifndef INPUT_H
 #define INPUT_H
 
+#include <stdbool.h>
+#include <time.h>
+
 struct inputHandler
 {
-	unsigned int (*read)(unsigned int *prev, void *inputState);
+	/*
+	 * Read pending input. If a key press is consumed, *time is set to
+	 * when the earliest one happened on CLOCK_MONOTONIC; otherwise it is
+	 * left untouched.
+	 */
+	unsigned int (*read)(unsigned int *prev,
+						 void *inputState,
+						 struct timespec *time);
 	void *(*init)(int fd);
 	void (*cleanup)(void *inputState);
+	/* file descriptor to wait on for new input */
+	int (*getFd)(void *inputState);
+	/* human readable device name, for diagnostics; asked before the
+	   input thread of a threaded handler starts */
+	const char *(*getName)(void *inputState);
+	/* read may be called from a thread other than the main one */
+	bool threaded;
+	/*
+	 * The handler takes the keyboard away from the terminal; without a
+	 * watchdog there is no rescue if the app hangs.
+	 */
+	bool watchdog;
 };
 
 extern const struct inputHandler cursesInput;
 extern const struct inputHandler evdevInput;
+extern const struct inputHandler hotplugInput;
 extern const struct inputHandler linuxConsoleInput;
 
 #endif /* !INPUT_H */
@@ -36,6 +36,7 @@
 #include <string.h>
 #include <sys/ioctl.h>
 #include <termios.h>
+#include <time.h>
 #include <unistd.h>
 
 #include <linux/input-event-codes.h>
@@ -73,13 +74,15 @@ static bool isConsole(int fd)
 	return true;
 }
 
-static unsigned int readInput(unsigned int *old, void *d)
+static unsigned int readInput(unsigned int *old,
+							  void *d,
+							  struct timespec *time)
 {
-	alarm(5); // without an alarm there is no rescue if the app hang
 	struct linuxInputData *data = d;
 	unsigned int input = *old;
 	unsigned char rawinput[24];
 	int count;
+	bool stamped = false;
 
 	input &= QDS_INPUT_LEFT | QDS_INPUT_RIGHT | QDS_INPUT_SOFT_DROP
 			 | QDS_INPUT_HARD_DROP;
@@ -104,6 +107,12 @@ static unsigned int readInput(unsigned int *old, void *d)
 
 			flag = mapEvdevInput(key);
 
+			/* the console has no timestamps; take the time of the read */
+			if (!release && flag && !stamped) {
+				clock_gettime(CLOCK_MONOTONIC, time);
+				stamped = true;
+			}
+
 			if (release)
 				input &= ~flag;
 			else
@@ -155,8 +164,23 @@ static void restoreConsole(void *d)
 	free(data);
 }
 
+static int getFd(void *d)
+{
+	struct linuxInputData *data = d;
+	return data->fd;
+}
+
+static const char *getName(void *d)
+{
+	return "console";
+}
+
 const struct inputHandler linuxConsoleInput = {
 	.read = readInput,
 	.init = initConsole,
 	.cleanup = restoreConsole,
+	.getFd = getFd,
+	.getName = getName,
+	.threaded = true,
+	.watchdog = true,
 };
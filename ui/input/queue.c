@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2023 McEndu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "queue.h"
+
+void initInputQueue(struct inputQueue *q)
+{
+	atomic_init(&q->head, 0);
+	atomic_init(&q->tail, 0);
+}
+
+bool pushInputEvent(struct inputQueue *q, const struct inputEvent *ev)
+{
+	size_t head = atomic_load_explicit(&q->head, memory_order_relaxed);
+	size_t tail = atomic_load_explicit(&q->tail, memory_order_acquire);
+	if (head - tail >= INPUT_QUEUE_SIZE) return false;
+
+	q->events[head % INPUT_QUEUE_SIZE] = *ev;
+	atomic_store_explicit(&q->head, head + 1, memory_order_release);
+	return true;
+}
+
+bool popInputEvent(struct inputQueue *q, struct inputEvent *ev)
+{
+	size_t tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+	size_t head = atomic_load_explicit(&q->head, memory_order_acquire);
+	if (head == tail) return false;
+
+	*ev = q->events[tail % INPUT_QUEUE_SIZE];
+	atomic_store_explicit(&q->tail, tail + 1, memory_order_release);
+	return true;
+}
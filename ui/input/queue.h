@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2023 McEndu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef INPUT_QUEUE_H
+#define INPUT_QUEUE_H
+
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <time.h>
+
+/* must be a power of 2 */
+#define INPUT_QUEUE_SIZE 256
+
+/*
+ * Input state reported by one read of an input device.
+ */
+struct inputEvent
+{
+	unsigned int input;
+	/* time of the earliest key press read; tv_sec is -1 if none */
+	struct timespec time;
+};
+
+/*
+ * Lock-free queue with exactly one producer and one consumer. The
+ * indices only ever grow; each is written by one side only and kept on
+ * its own cache line.
+ */
+struct inputQueue
+{
+	alignas(64) atomic_size_t head; /* written by the producer */
+	alignas(64) atomic_size_t tail; /* written by the consumer */
+	struct inputEvent events[INPUT_QUEUE_SIZE];
+};
+
+extern void initInputQueue(struct inputQueue *q);
+/* Returns false if the queue is full. */
+extern bool pushInputEvent(struct inputQueue *q, const struct inputEvent *ev);
+/* Returns false if the queue is empty. */
+extern bool popInputEvent(struct inputQueue *q, struct inputEvent *ev);
+
+#endif /* !INPUT_QUEUE_H */
@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2023 McEndu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "thread.h"
+#include "config.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdalign.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+struct inputThread
+{
+	struct inputQueue queue;
+
+	pthread_t thread;
+	int fd;
+	int stopFd; /* eventfd signalled to stop the thread */
+	const struct inputHandler *handler;
+	void *inputData;
+};
+
+static bool stopping(struct inputThread *t)
+{
+	struct pollfd p = { .fd = t->stopFd, .events = POLLIN };
+	return poll(&p, 1, 0) > 0;
+}
+
+static void push(struct inputThread *t, const struct inputEvent *ev)
+{
+	/* the game loop drains the queue every frame; wait for it */
+	while (!pushInputEvent(&t->queue, ev)) {
+		if (stopping(t)) return;
+		nanosleep(&(const struct timespec){ .tv_nsec = 1000000 }, NULL);
+	}
+}
+
+static void *run(void *arg)
+{
+	struct inputThread *t = arg;
+	unsigned int held = 0;
+	struct pollfd fds[2] = {
+		{ .fd = t->fd, .events = POLLIN },
+		{ .fd = t->stopFd, .events = POLLIN },
+	};
+
+	while (1) {
+		if (poll(fds, 2, -1) < 0) {
+			if (errno == EINTR) continue;
+			break;
+		}
+		if (fds[1].revents) break;
+		if (fds[0].revents & (POLLERR | POLLHUP | POLLNVAL)) break;
+
+		/*
+		 * Handlers drop one-shot inputs like rotation on the read after
+		 * reporting them. Read until the state settles so the queue ends
+		 * with what is still held down.
+		 */
+		struct inputEvent ev;
+		ev.time.tv_sec = -1;
+		ev.input = t->handler->read(&held, t->inputData, &ev.time);
+		while (1) {
+			push(t, &ev);
+			unsigned int last = ev.input;
+
+			ev.time.tv_sec = -1;
+			ev.input = t->handler->read(&held, t->inputData, &ev.time);
+			if (ev.input == last && ev.time.tv_sec < 0) break;
+		}
+	}
+
+	return NULL;
+}
+
+struct inputThread *startInputThread(const struct inputHandler *handler,
+									 void *inputData)
+{
+	if (!handler->getFd) return NULL;
+
+	struct inputThread *t = aligned_alloc(alignof(struct inputThread),
+										  sizeof(struct inputThread));
+	if (!t) return NULL;
+	initInputQueue(&t->queue);
+	t->handler = handler;
+	t->inputData = inputData;
+	t->fd = handler->getFd(inputData);
+	t->stopFd = eventfd(0, EFD_CLOEXEC);
+	if (t->fd < 0 || t->stopFd < 0) goto fail;
+
+	/* signals are for the main thread to handle */
+	sigset_t all, old;
+	sigfillset(&all);
+	pthread_sigmask(SIG_SETMASK, &all, &old);
+	int err = pthread_create(&t->thread, NULL, run, t);
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+	if (err) goto fail;
+
+	return t;
+
+fail:
+	if (t->stopFd >= 0) close(t->stopFd);
+	free(t);
+	return NULL;
+}
+
+void stopInputThread(struct inputThread *t)
+{
+	uint64_t one = 1;
+	write(t->stopFd, &one, sizeof(one));
+	pthread_join(t->thread, NULL);
+	close(t->stopFd);
+	free(t);
+}
+
+bool nextInputEvent(struct inputThread *t, struct inputEvent *ev)
+{
+	return popInputEvent(&t->queue, ev);
+}
@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) 2023 McEndu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef INPUT_THREAD_H
+#define INPUT_THREAD_H
+
+#include "input.h"
+#include "queue.h"
+
+struct inputThread;
+
+/*
+ * Read an input device on a thread of its own. Everything read is
+ * passed on through the returned thread's queue. Returns NULL on
+ * failure.
+ */
+extern struct inputThread *startInputThread(const struct inputHandler *handler,
+											void *inputData);
+/*
+ * Stop the thread and wait for it to finish. The input handler is not
+ * cleaned up.
+ */
+extern void stopInputThread(struct inputThread *thread);
+/*
+ * Take the oldest unprocessed event. Must only be called from one
+ * thread.
+ */
+extern bool nextInputEvent(struct inputThread *thread, struct inputEvent *ev);
+
+#endif /* !INPUT_THREAD_H */
@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2023 McEndu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "latency.h"
+#include <inttypes.h>
+#include <string.h>
+
+uint64_t timespecDiff(const struct timespec *end, const struct timespec *start)
+{
+	int64_t ns = (int64_t)(end->tv_sec - start->tv_sec) * 1000000000
+				 + (end->tv_nsec - start->tv_nsec);
+	return ns > 0 ? ns : 0;
+}
+
+void resetLatency(struct latencyStats *stats, const char *device)
+{
+	memset(stats, 0, sizeof(*stats));
+	strncpy(stats->device, device, sizeof(stats->device) - 1);
+}
+
+void recordLatency(struct latencyHistogram *h, uint64_t ns)
+{
+	uint64_t us = ns / 1000;
+	int bucket = 0;
+	while (us >= 2 && bucket < LATENCY_BUCKETS - 1) {
+		us >>= 1;
+		bucket++;
+	}
+
+	h->buckets[bucket]++;
+	h->count++;
+	h->total += ns;
+	if (ns > h->max) h->max = ns;
+}
+
+static void reportHistogram(FILE *f,
+							const char *name,
+							const struct latencyHistogram *h)
+{
+	if (h->count == 0) {
+		fprintf(f, "  %s: no samples\n", name);
+		return;
+	}
+
+	fprintf(f,
+			"  %s: %lu samples, mean %" PRIu64 "us, max %" PRIu64 "us\n",
+			name,
+			h->count,
+			h->total / h->count / 1000,
+			h->max / 1000);
+	for (int i = 0; i < LATENCY_BUCKETS; ++i) {
+		if (!h->buckets[i]) continue;
+		if (i == LATENCY_BUCKETS - 1)
+			fprintf(f, "   >= %8luus: %lu\n", 1ul << i, h->buckets[i]);
+		else
+			fprintf(f, "    < %8luus: %lu\n", 2ul << i, h->buckets[i]);
+	}
+}
+
+void reportLatency(FILE *f, const struct latencyStats *stats)
+{
+	fprintf(f, "latency for %s:\n", stats->device);
+	reportHistogram(f, "input to process", &stats->inputToProcess);
+	reportHistogram(f, "process to display", &stats->processToDisplay);
+}
@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2023 McEndu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+/*
+ * Bucket i counts samples between 2^i and 2^(i+1) microseconds; the
+ * first bucket also takes anything shorter, the last anything longer.
+ */
+#define LATENCY_BUCKETS 24
+
+struct latencyHistogram
+{
+	unsigned long buckets[LATENCY_BUCKETS];
+	unsigned long count;
+	uint64_t total; /* in nanoseconds */
+	uint64_t max;	/* in nanoseconds */
+};
+
+/*
+ * Latency measurements for one input device.
+ */
+struct latencyStats
+{
+	char device[64];
+	/* from the device reporting a key press to the frame using it */
+	struct latencyHistogram inputToProcess;
+	/* from the start of that frame to the screen being updated */
+	struct latencyHistogram processToDisplay;
+};
+
+extern uint64_t timespecDiff(const struct timespec *end,
+							 const struct timespec *start);
+
+extern void resetLatency(struct latencyStats *stats, const char *device);
+extern void recordLatency(struct latencyHistogram *h, uint64_t ns);
+extern void reportLatency(FILE *f, const struct latencyStats *stats);
+
+#endif /* !LATENCY_H */
@@ -23,21 +23,28 @@
 #include <config.h>
 
 #include "input/input.h"
+#include "input/thread.h"
+#include "latency.h"
+#include "pacing.h"
 #include "quadustui.h"
 #include "screen.h"
 #include <curses.h>
+#include <errno.h>
 #include <quadus.h>
+#include <quadus/modedef.h>
 #include <setjmp.h>
 #include <signal.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
 #include <time.h>
 #include <unistd.h>
 
-#define SIGVBLANK SIGRTMIN
-
 #ifdef NCURSES_VERSION
 #define COLOR_BG -1
 #else
@@ -46,32 +53,91 @@
 
 jmp_buf cleanupJump;
 
-static void loop(struct uiState *state);
+/*
+ * Everything the main loop waits on. The frame timer, signals asking
+ * the game to quit and the current input device are all watched with a
+ * single epoll instance.
+ */
+struct eventLoop
+{
+	int epoll;
+	int timer;
+	int signal;
+
+	/* input device currently in the epoll set */
+	int inputFd;
+	const struct inputHandler *inputHandler;
+	void *inputData;
+
+	/* where to write latency reports, if anywhere */
+	FILE *latencyLog;
+	struct latencyStats latency;
+
+	struct framePacer pacer;
+};
+
+static int run(struct eventLoop *l, struct uiState *state);
+static void loop(struct eventLoop *l, struct uiState *state, bool render);
 static void cleanup(int signo);
 
-int main(int argc, char **argv)
+/*
+ * Set the frame timer to go off when the next frame is due.
+ */
+static void armTimer(struct eventLoop *l)
 {
-	sigaction(
-		SIGVBLANK, &(const struct sigaction){ .sa_handler = SIG_IGN }, NULL);
+	struct itimerspec spec = { 0 };
+	nextDeadline(&l->pacer, &spec.it_value);
+	timerfd_settime(l->timer, TFD_TIMER_ABSTIME, &spec, NULL);
+}
 
-	sigset_t vblankWaitSet;
-	sigemptyset(&vblankWaitSet);
-	sigaddset(&vblankWaitSet, SIGVBLANK);
-	sigprocmask(SIG_BLOCK, &vblankWaitSet, NULL);
+static bool watch(struct eventLoop *l, int fd)
+{
+	struct epoll_event ev = { .events = EPOLLIN, .data.fd = fd };
+	return epoll_ctl(l->epoll, EPOLL_CTL_ADD, fd, &ev) == 0;
+}
 
+int main(int argc, char **argv)
+{
 	struct uiState state;
 	initUiData(&state);
 
 	state.ruleset = &qdsRulesetStandard;
 	state.mode = &qdsModeMarathon;
 
-	timer_t frameTimer;
-	struct sigevent frameTimerSigev = {
-		.sigev_notify = SIGEV_SIGNAL,
-		.sigev_signo = SIGVBLANK,
-		.sigev_value = { .sival_ptr = &state },
-	};
-	if (timer_create(CLOCK_MONOTONIC, &frameTimerSigev, &frameTimer) < 0) {
+	/* signals that end the game are received through the event loop */
+	sigset_t exitSignals;
+	sigemptyset(&exitSignals);
+	sigaddset(&exitSignals, SIGINT);
+	sigaddset(&exitSignals, SIGHUP);
+	sigaddset(&exitSignals, SIGQUIT);
+	sigaddset(&exitSignals, SIGTERM);
+	sigprocmask(SIG_BLOCK, &exitSignals, NULL);
+
+	qdsModeDef *customMode = NULL;
+	const char *modeFile = getenv("QUADUS_MODE");
+	if (modeFile) {
+		int line = 0;
+		customMode = qdsLoadModeDef(modeFile, &line);
+		if (!customMode && errno == EINVAL) {
+			fprintf(stderr, "%s:%d: Invalid mode definition\n", modeFile, line);
+			exit(1);
+		} else if (!customMode) {
+			fprintf(stderr, "%s: %s\n", modeFile, strerror(errno));
+			exit(1);
+		}
+		addCustomMode(customMode);
+	}
+
+	struct eventLoop l = { .inputFd = -1 };
+	const char *latencyLog = getenv("QUADUS_LATENCY_LOG");
+	if (latencyLog) l.latencyLog = fopen(latencyLog, "a");
+	resetLatency(&l.latency, "none");
+	state.latency = &l.latency;
+	l.epoll = epoll_create1(EPOLL_CLOEXEC);
+	l.timer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	l.signal = signalfd(-1, &exitSignals, SFD_NONBLOCK | SFD_CLOEXEC);
+	if (l.epoll < 0 || l.timer < 0 || l.signal < 0 || !watch(&l, l.timer)
+		|| !watch(&l, l.signal)) {
 		fprintf(
 			stderr, "%s:%d: Failed to create game timer\n", __FILE__, __LINE__);
 		exit(1);
@@ -99,71 +165,231 @@ int main(int argc, char **argv)
 
 	state.input = 0;
 
-	timer_settime(frameTimer, 0, &(const struct itimerspec){
-        .it_value = {
-            .tv_sec = 0,
-            .tv_nsec = 16666667,
-        },
-        .it_interval = {
-            .tv_sec = 0,
-            .tv_nsec = 16666667,
-        }
-    }, NULL);
+	initPacer(&l.pacer);
+	armTimer(&l);
 
 	int jmpval;
-	if ((jmpval = setjmp(cleanupJump))) {
-		endwin();
-		if (state.inputHandler && state.inputHandler->cleanup)
-			state.inputHandler->cleanup(state.inputData);
-		timer_delete(frameTimer);
+	if ((jmpval = setjmp(cleanupJump)) == 0) {
+		/* crashes still need the terminal restored from a handler */
+		signal(SIGABRT, cleanup);
+		signal(SIGALRM, cleanup);
+		signal(SIGBUS, cleanup);
+		signal(SIGFPE, cleanup);
+		signal(SIGILL, cleanup);
+		signal(SIGPIPE, cleanup);
+		signal(SIGPOLL, cleanup);
+		signal(SIGPROF, cleanup);
+		signal(SIGSEGV, cleanup);
+		signal(SIGSYS, cleanup);
+		signal(SIGTRAP, cleanup);
+		signal(SIGTTIN, cleanup);
+		signal(SIGTTOU, cleanup);
+		signal(SIGVTALRM, cleanup);
+		signal(SIGXCPU, cleanup);
+		signal(SIGXFSZ, cleanup);
+
+		changeScreen(&state, &screenMainMenu);
+		jmpval = run(&l, &state);
+	}
+
+	/* stop every thread before giving the terminal back */
+	changeScreen(&state, NULL);
+	releaseInput(&state);
+	endwin();
+	if (l.latencyLog) {
+		if (l.latency.inputToProcess.count)
+			reportLatency(l.latencyLog, &l.latency);
+		reportPacing(l.latencyLog, &l.pacer);
+		fclose(l.latencyLog);
+	}
+	close(l.signal);
+	close(l.timer);
+	close(l.epoll);
+	if (customMode) qdsFreeModeDef(customMode);
+
+	if (jmpval != SIGINT) fprintf(stderr, "%s\n", strsignal(jmpval));
+
+	exit(jmpval == SIGINT ? 0 : -jmpval);
+}
+
+/*
+ * Keep the epoll set in sync with the input handler chosen by the
+ * current screen. Handlers that allow it are instead read on a thread
+ * of their own, and never stall the game loop.
+ */
+static void watchInput(struct eventLoop *l, struct uiState *state)
+{
+	if (state->inputHandler == l->inputHandler
+		&& state->inputData == l->inputData)
+		return;
+
+	/* the old fd may already be closed, which removes it implicitly */
+	if (l->inputFd >= 0) epoll_ctl(l->epoll, EPOLL_CTL_DEL, l->inputFd, NULL);
+	l->inputFd = -1;
+	l->inputHandler = state->inputHandler;
+	l->inputData = state->inputData;
+
+	/* latency is measured per device */
+	if (l->latencyLog && l->latency.inputToProcess.count)
+		reportLatency(l->latencyLog, &l->latency);
+	/* named now, as the input state belongs to its thread once started */
+	const char *name = "unknown";
+	if (state->inputHandler && state->inputHandler->getName)
+		name = state->inputHandler->getName(state->inputData);
+	resetLatency(&l->latency, name);
+
+	if (state->inputHandler && state->inputHandler->threaded)
+		state->inputThread
+			= startInputThread(state->inputHandler, state->inputData);
+	if (!state->inputThread && state->inputHandler
+		&& state->inputHandler->getFd) {
+		int fd = state->inputHandler->getFd(state->inputData);
+		if (fd >= 0 && watch(l, fd)) l->inputFd = fd;
+	}
+}
 
-		if (jmpval != SIGINT) fprintf(stderr, "%s\n", strsignal(jmpval));
+/*
+ * Inputs are latched until the next frame, so presses released before
+ * the frame timer expires are not lost. The time of the earliest key
+ * press is kept for latency measurement.
+ */
+static void latchInput(struct uiState *state,
+					   unsigned int input,
+					   const struct timespec *time)
+{
+	state->inputLatch |= input;
 
-		exit(jmpval == SIGINT ? 0 : -jmpval);
+	if (time->tv_sec < 0) return;
+	if (!state->inputStamped || timespecDiff(&state->inputTime, time) > 0) {
+		state->inputTime = *time;
+		state->inputStamped = true;
 	}
+}
 
-	signal(SIGABRT, cleanup);
-	signal(SIGALRM, cleanup);
-	signal(SIGBUS, cleanup);
-	signal(SIGFPE, cleanup);
-	signal(SIGHUP, cleanup);
-	signal(SIGILL, cleanup);
-	signal(SIGINT, cleanup);
-	signal(SIGPIPE, cleanup);
-	signal(SIGPOLL, cleanup);
-	signal(SIGPROF, cleanup);
-	signal(SIGQUIT, cleanup);
-	signal(SIGSEGV, cleanup);
-	signal(SIGSYS, cleanup);
-	signal(SIGTERM, cleanup);
-	signal(SIGTRAP, cleanup);
-	signal(SIGTTIN, cleanup);
-	signal(SIGTTOU, cleanup);
-	signal(SIGVTALRM, cleanup);
-	signal(SIGXCPU, cleanup);
-	signal(SIGXFSZ, cleanup);
-
-	sigset_t waitedSignals = vblankWaitSet;
-	sigaddset(&waitedSignals, SIGINT);
-	sigprocmask(SIG_BLOCK, &waitedSignals, NULL);
-
-	changeScreen(&state, &screenMainMenu);
+/*
+ * Consume whatever the input device has to offer.
+ */
+static void readInput(struct uiState *state)
+{
+	if (!state->inputHandler || state->inputThread) return;
+
+	struct timespec time;
+	time.tv_sec = -1;
+	unsigned int input = state->inputHandler->read(
+		&state->inputHeld, state->inputData, &time);
+	latchInput(state, input, &time);
+}
+
+/*
+ * Take everything the input thread has read since the last frame.
+ */
+static void drainInput(struct uiState *state)
+{
+	struct inputEvent ev;
+	while (nextInputEvent(state->inputThread, &ev)) {
+		latchInput(state, ev.input, &ev.time);
+		state->inputHeld = ev.input;
+	}
+}
 
+/*
+ * Wait for events until a signal asks the game to quit. Returns the
+ * signal received.
+ */
+static int run(struct eventLoop *l, struct uiState *state)
+{
 	while (1) {
-		int sig;
-		sigwait(&waitedSignals, &sig);
-		if (sig == SIGINT) longjmp(cleanupJump, sig);
-		loop(&state);
+		watchInput(l, state);
+
+		struct epoll_event events[4];
+		int count = epoll_wait(l->epoll, events, 4, -1);
+		if (count < 0) {
+			if (errno == EINTR) continue;
+			return SIGABRT;
+		}
+
+		bool frame = false;
+		for (int i = 0; i < count; ++i) {
+			int fd = events[i].data.fd;
+			if (fd == l->signal) {
+				struct signalfd_siginfo info;
+				if (read(fd, &info, sizeof(info)) == sizeof(info))
+					return info.ssi_signo;
+			} else if (fd == l->timer) {
+				uint64_t expirations;
+				if (read(fd, &expirations, sizeof(expirations)) > 0)
+					frame = true;
+			} else if (fd == l->inputFd) {
+				readInput(state);
+			}
+		}
+
+		/*
+		 * Run frames after input that arrived alongside the timer. If
+		 * the loop fell behind, simulate every frame missed but only
+		 * draw the last one.
+		 */
+		if (frame) {
+			unsigned int due = framesDue(&l->pacer);
+			for (unsigned int i = 0; i < due; ++i)
+				loop(l, state, i == due - 1);
+			armTimer(l);
+		}
 	}
 }
 
-static void loop(struct uiState *state)
+static void loop(struct eventLoop *l, struct uiState *state, bool render)
 {
-	if (state->inputHandler)
-		state->inputHandler->read(&state->input, state->inputData);
-	wnoutrefresh(stdscr);
+	if (state->inputHandler && state->inputHandler->watchdog) alarm(5);
+
+	if (state->inputThread) {
+		drainInput(state);
+		/* the thread only reports changes; keys held stay latched */
+		state->input = state->inputLatch;
+		state->inputLatch = state->inputHeld;
+	} else {
+		readInput(state);
+		state->input = state->inputLatch;
+		state->inputLatch = 0;
+	}
+
+	struct timespec start, end;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	if (state->inputStamped) {
+		recordLatency(&l->latency.inputToProcess,
+					  timespecDiff(&start, &state->inputTime));
+		state->inputStamped = false;
+		if (!state->displayPending) state->processStart = start;
+		state->displayPending = true;
+	}
+
+	/* the screen can change during the update */
+	bool locked = !state->currentScreen->renderThread;
+	if (locked) lockCurses();
+
 	state->currentScreen->update(stdscr, state);
-	doupdate();
+	if (render) {
+		const screen *screen = state->currentScreen;
+		if (!screen->renderThread && !locked) {
+			lockCurses();
+			locked = true;
+		}
+
+		if (screen->draw) screen->draw(stdscr, state);
+		if (!screen->renderThread) {
+			wnoutrefresh(stdscr);
+			doupdate();
+
+			if (state->displayPending) {
+				clock_gettime(CLOCK_MONOTONIC, &end);
+				recordLatency(&l->latency.processToDisplay,
+							  timespecDiff(&end, &state->processStart));
+				state->displayPending = false;
+			}
+		}
+	}
+
+	if (locked) unlockCurses();
 
 	state->time++;
 }
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2023 McEndu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "pacing.h"
+#include "latency.h"
+#include <inttypes.h>
+
+void initPacer(struct framePacer *p)
+{
+	clock_gettime(CLOCK_MONOTONIC, &p->start);
+	p->frames = 0;
+	p->late = 0;
+	p->caughtUp = 0;
+	p->dropped = 0;
+}
+
+unsigned int framesDue(struct framePacer *p)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	uint64_t due = timespecDiff(&now, &p->start) * FRAME_RATE / 1000000000;
+	if (due <= p->frames) return 0; /* woke up early */
+
+	uint64_t behind = due - p->frames;
+	if (behind > MAX_CATCH_UP) {
+		p->dropped += behind - MAX_CATCH_UP;
+		p->frames += behind - MAX_CATCH_UP;
+		behind = MAX_CATCH_UP;
+	}
+	if (behind > 1) {
+		p->late++;
+		p->caughtUp += behind - 1;
+	}
+
+	p->frames += behind;
+	return behind;
+}
+
+void nextDeadline(const struct framePacer *p, struct timespec *t)
+{
+	uint64_t next = p->frames + 1;
+	t->tv_sec = p->start.tv_sec + next / FRAME_RATE;
+	t->tv_nsec = p->start.tv_nsec + next % FRAME_RATE * 1000000000 / FRAME_RATE;
+	if (t->tv_nsec >= 1000000000) {
+		t->tv_sec++;
+		t->tv_nsec -= 1000000000;
+	}
+}
+
+void reportPacing(FILE *f, const struct framePacer *p)
+{
+	fprintf(f,
+			"frames: %" PRIu64 " due, %lu late wakeups, %lu caught up, "
+			"%lu dropped\n",
+			p->frames,
+			p->late,
+			p->caughtUp,
+			p->dropped);
+}
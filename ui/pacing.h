@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2023 McEndu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef PACING_H
+#define PACING_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#define FRAME_RATE 60
+/* frames simulated at most in one go before frames are dropped */
+#define MAX_CATCH_UP 8
+
+/*
+ * Fixed timestep frame scheduler. Frame n is due at n / FRAME_RATE
+ * seconds after the pacer started, however late earlier frames were.
+ */
+struct framePacer
+{
+	struct timespec start;
+	/* frames simulated or dropped so far */
+	uint64_t frames;
+
+	/* times the loop woke up more than a frame late */
+	unsigned long late;
+	/* frames simulated without being drawn to catch up */
+	unsigned long caughtUp;
+	/* frames skipped entirely for being too far behind */
+	unsigned long dropped;
+};
+
+extern void initPacer(struct framePacer *p);
+/*
+ * Count the frames that are due now, and mark them as run. Frames are
+ * dropped if there are more than MAX_CATCH_UP.
+ */
+extern unsigned int framesDue(struct framePacer *p);
+/*
+ * Get the time on CLOCK_MONOTONIC when the next frame is due.
+ */
+extern void nextDeadline(const struct framePacer *p, struct timespec *t);
+extern void reportPacing(FILE *f, const struct framePacer *p);
+
+#endif /* !PACING_H */
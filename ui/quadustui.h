@@ -27,10 +27,12 @@
 
 #include <curses.h>
 #include <quadus.h>
+#include <quadus/modedef.h>
 #include <quadus/ruleset/linequeue.h>
 #include <quadus/ui.h>
 #include <setjmp.h>
 #include <stdalign.h>
+#include <time.h>
 
 #define PAIR_ACCENT 8
 
@@ -51,6 +53,7 @@ typedef struct rect
 } rect;
 
 typedef struct screen screen;
+struct latencyStats;
 
 typedef struct uiState
 {
@@ -62,12 +65,26 @@ typedef struct uiState
 
 	const struct inputHandler *inputHandler;
 	void *inputData;
+	/* reads inputHandler in the background if the handler allows */
+	struct inputThread *inputThread;
+	/* input for the current frame */
 	unsigned int input;
+	/* last state reported by the input handler */
+	unsigned int inputHeld;
+	/* inputs seen since the last frame */
+	unsigned int inputLatch;
+	/* when the earliest key press since the last frame happened */
+	struct timespec inputTime;
+	/* start of the earliest frame with input not yet displayed */
+	struct timespec processStart;
+	struct latencyStats *latency;
 	unsigned int time;
 
 	qdsLine displayPlayfield[22];
 	bool useDisplayPlayfield : 1;
 	bool topOut : 1;
+	bool inputStamped : 1;
+	bool displayPending : 1;
 	struct qdsPendingLines lines;
 
 	unsigned int topOutTime;
@@ -75,10 +92,19 @@ typedef struct uiState
 
 extern void initUiData(uiState *data);
 extern void changeScreen(uiState *, const screen *screen);
+extern void releaseInput(uiState *data);
+
+/*
+ * Curses is not thread-safe. Anything touching the terminal outside of
+ * setup and teardown must hold this lock; it may be taken recursively.
+ */
+extern void lockCurses(void);
+extern void unlockCurses(void);
 
 #ifdef HAVE_UDEV
 #include <libudev.h>
 #include <poll.h>
+extern bool isGameInputDevice(int fd);
 extern int searchKeyboards(struct pollfd *fds,
 						   size_t capacity,
 						   struct udev *udev);
@@ -91,4 +117,7 @@ extern const screen screenMainMenu;
 extern const screen screenGame;
 extern const screen screenModeSelect;
 
+/* offer a mode loaded from a definition file in mode selection */
+extern void addCustomMode(const qdsModeDef *def);
+
 #endif /* UI_H */
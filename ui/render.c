@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2023 McEndu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "render.h"
+#include "quadustui.h"
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+/* set in the middle slot index when it holds a frame not yet drawn */
+#define FRESH 4u
+#define SLOT(x) ((x) & 3u)
+
+struct renderer
+{
+	/* slot between the simulation and the render thread */
+	alignas(64) atomic_uint middle;
+	/* owned by the simulation */
+	alignas(64) unsigned int back;
+	/* owned by the render thread */
+	alignas(64) unsigned int front;
+
+	void *slots[3];
+	renderCallback *draw;
+	void *arg;
+
+	pthread_t thread;
+	int wake; /* eventfd written on every published frame */
+	atomic_bool stop;
+};
+
+static void *run(void *arg)
+{
+	struct renderer *r = arg;
+
+	while (1) {
+		uint64_t count;
+		if (read(r->wake, &count, sizeof(count)) < 0) continue;
+		if (atomic_load_explicit(&r->stop, memory_order_acquire)) break;
+
+		if (!(atomic_load_explicit(&r->middle, memory_order_acquire) & FRESH))
+			continue;
+		r->front = SLOT(atomic_exchange_explicit(
+			&r->middle, r->front, memory_order_acq_rel));
+
+		lockCurses();
+		r->draw(r->slots[r->front], r->arg);
+		unlockCurses();
+	}
+
+	return NULL;
+}
+
+struct renderer *startRenderer(size_t frameSize,
+							   renderCallback *draw,
+							   void *arg)
+{
+	struct renderer *r = aligned_alloc(alignof(struct renderer),
+									   sizeof(struct renderer));
+	if (!r) return NULL;
+	memset(r, 0, sizeof(struct renderer));
+
+	for (int i = 0; i < 3; ++i) {
+		r->slots[i] = calloc(1, frameSize);
+		if (!r->slots[i]) goto fail;
+	}
+	r->back = 0;
+	atomic_init(&r->middle, 1);
+	r->front = 2;
+	r->draw = draw;
+	r->arg = arg;
+	atomic_init(&r->stop, false);
+
+	r->wake = eventfd(0, EFD_CLOEXEC);
+	if (r->wake < 0) goto fail;
+
+	/* signals are for the main thread to handle */
+	sigset_t all, old;
+	sigfillset(&all);
+	pthread_sigmask(SIG_SETMASK, &all, &old);
+	int err = pthread_create(&r->thread, NULL, run, r);
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+	if (err) {
+		close(r->wake);
+		goto fail;
+	}
+
+	return r;
+
+fail:
+	for (int i = 0; i < 3; ++i) free(r->slots[i]);
+	free(r);
+	return NULL;
+}
+
+void stopRenderer(struct renderer *r)
+{
+	uint64_t one = 1;
+	atomic_store_explicit(&r->stop, true, memory_order_release);
+	write(r->wake, &one, sizeof(one));
+	pthread_join(r->thread, NULL);
+
+	close(r->wake);
+	for (int i = 0; i < 3; ++i) free(r->slots[i]);
+	free(r);
+}
+
+void *renderTarget(struct renderer *r)
+{
+	return r->slots[r->back];
+}
+
+void publishFrame(struct renderer *r)
+{
+	r->back = SLOT(atomic_exchange_explicit(
+		&r->middle, r->back | FRESH, memory_order_acq_rel));
+
+	uint64_t one = 1;
+	write(r->wake, &one, sizeof(one));
+}
@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2023 McEndu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef RENDER_H
+#define RENDER_H
+
+#include <stddef.h>
+
+/*
+ * Draws frames published by the simulation on a thread of its own, so
+ * a slow terminal never holds up the game.
+ *
+ * Frames go through a triple buffer: the simulation fills one slot, the
+ * render thread draws from another, and the third holds the newest
+ * complete frame. Neither side ever waits for the other; frames the
+ * render thread could not keep up with are skipped.
+ */
+struct renderer;
+
+/*
+ * Called on the render thread with the curses lock held. The frame
+ * must be treated as read-only.
+ */
+typedef void renderCallback(const void *frame, void *arg);
+
+/*
+ * Start a render thread for frames of the given size. Returns NULL on
+ * failure.
+ */
+extern struct renderer *startRenderer(size_t frameSize,
+									  renderCallback *draw,
+									  void *arg);
+/*
+ * Stop the render thread and wait for it to finish.
+ */
+extern void stopRenderer(struct renderer *r);
+/*
+ * Get the slot the next frame should be written to.
+ */
+extern void *renderTarget(struct renderer *r);
+/*
+ * Hand the frame written to the render target to the render thread.
+ */
+extern void publishFrame(struct renderer *r);
+
+#endif /* !RENDER_H */
@@ -30,7 +30,17 @@ struct screen
 {
 	void (*enter)(WINDOW *w, uiState *state);
 	void (*update)(WINDOW *w, uiState *state);
+	/*
+	 * Optional. If present, update only advances the screen's state and
+	 * drawing is left to this, so frames can be skipped to catch up.
+	 */
+	void (*draw)(WINDOW *w, uiState *state);
 	void (*exit)(WINDOW *w, uiState *state);
+	/*
+	 * The screen draws on a render thread of its own; the main loop
+	 * leaves the terminal alone while it is shown.
+	 */
+	bool renderThread;
 };
 
 #endif /* !SCREEN_H */
@@ -21,7 +21,9 @@
  * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
+#include "latency.h"
 #include "quadustui.h"
+#include "render.h"
 #include "screen.h"
 #include <quadus.h>
 #include <quadus/calls.h>
@@ -30,6 +32,7 @@
 
 #include <curses.h>
 #include <stdarg.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -89,37 +92,245 @@ static void gameOverBanner(WINDOW *w, int top, int left)
 
 #define min(x, y) ((x) < (y) ? (x) : (y))
 
-static void topOutAnimation(WINDOW *w, int top, int left, qdsGame *game)
+#define CELL_COLOR 0x07
+#define CELL_FILLED 0x08
+#define CELL_GHOST 0x10
+#define CELL_ACTIVE 0x20
+
+/*
+ * Everything the game view shows, captured from the game after each
+ * cycle. Frames are drawn on the render thread, which must not touch
+ * the game itself.
+ */
+struct gameFrame
+{
+	/* one byte per playfield tile; see CELL_* above */
+	unsigned char cells[22][10];
+	int activeX;
+	int activeY;
+	bool banner;
+
+	int hold;
+	const qdsCoords *holdShape;
+	bool canHold;
+	int nextCount;
+	int next[5];
+	const qdsCoords *nextShapes[5];
+
+	unsigned int clearType;
+	int combo;
+	int score;
+	int time;
+	int level;
+	int target;
+	int speed;
+	bool hasGrade;
+	char grade[9];
+	char message[21];
+
+	/* start of the frame that first processed input shown here */
+	bool measured;
+	struct timespec processStart;
+};
+
+/*
+ * Contents of the game view as of the last frame drawn. Each part of
+ * the view is redrawn only when what it would show differs from what
+ * is already on the terminal, keeping output small on slow links.
+ */
+struct viewCache
+{
+	bool valid : 1;
+	bool banner : 1;
+
+	unsigned char cells[22][10];
+
+	int hold;
+	bool canHold;
+	int nextCount;
+	int next[5];
+
+	unsigned int clearType;
+	int combo;
+	int score;
+	int time;
+	int level;
+	int target;
+	int speed;
+	char grade[9];
+	char message[21];
+};
+
+struct screenState
+{
+	qdsGame *game;
+	struct renderer *renderer;
+
+	/* only touched on the render thread */
+	struct viewCache drawn;
+	struct latencyStats *latency;
+};
+
+static void copyString(char *dest, size_t size, const char *s)
+{
+	snprintf(dest, size, "%s", s);
+}
+
+/*
+ * Compare a string against its cached copy, updating the cache.
+ * Returns true if the string changed.
+ */
+static bool cacheString(char *cache, size_t size, const char *s)
 {
+	if (!strncmp(cache, s, size - 1)) return false;
+	copyString(cache, size, s);
+	return true;
+}
+
+static void pieceCells(unsigned char cells[22][10],
+					   const qdsGame *game,
+					   int y,
+					   unsigned char cell)
+{
+	int type = qdsGetActivePieceType(game);
+	const qdsCoords *shape = qdsGetShape(game, type, -1);
+	int x = qdsGetActiveX(game);
+
+	cell |= type % 8;
+	QDS_SHAPE_FOREACH (i, shape) {
+		int cx = x + i->x, cy = y + i->y;
+		if (cx < 0 || cx >= 10 || cy < 0 || cy >= 22) continue;
+		cells[cy][cx] = cell;
+	}
+}
+
+/*
+ * Work out what each tile of the playfield should look like this
+ * frame.
+ */
+static void playfieldCells(unsigned char cells[22][10], qdsGame *game)
+{
+	const qdsLine *playfield;
 	uiState *data = qdsGetUiData(game);
-	const qdsLine *playfield = qdsGetPlayfield(game);
+	if (data->useDisplayPlayfield)
+		playfield = data->displayPlayfield;
+	else
+		playfield = qdsGetPlayfield(game);
 
-	const int playfieldBaseY = 21;
-	int animationTime = data->time - data->topOutTime;
+	/* rows uncovered so far by the top out animation */
+	int revealed = 0;
+	if (data->topOut) revealed = min(22, data->time - data->topOutTime);
 
-	for (unsigned y = 0; y < min(22, animationTime); ++y) {
+	/* modes that hide tiles answer for the whole field at once */
+	uint_fast16_t visibility[QDS_MAX_ROWS];
+	if (qdsCall(game, QDS_GETFIELDVISIBILITY, visibility) < 0) {
+		for (int y = 0; y < 22; ++y)
+			visibility[y] = 0x03ff; /* all visible except walls */
+	}
+
+	for (int y = 0; y < 22; ++y) {
 		for (int x = 0; x < 10; ++x) {
-			wmove(w, top + playfieldBaseY - y, left + 2 * x + 1);
-			if (playfield[y][x]) waddstr(w, tileFilled);
+			int tile = playfield[y][x];
+			if (y < revealed && tile)
+				cells[y][x] = CELL_FILLED;
+			else if (tile && visibility[y] & (1 << x))
+				cells[y][x] = CELL_FILLED | tile % 8;
+			else
+				cells[y][x] = 0;
 		}
 	}
+
+	bool showGhost;
+	if (qdsCall(game, QDS_SHOWGHOST, &showGhost) < 0 || showGhost)
+		pieceCells(cells, game, qdsGetGhostY(game), CELL_GHOST);
+	pieceCells(cells, game, qdsGetActiveY(game), CELL_ACTIVE);
+}
+
+/*
+ * The width of the speed bar should be calculated as follows:
+ *
+ *      f(x) = \frac{\ln(x) - \ln(1092)}{\ln(1310720) - \ln(1092)}
+ *
+ * The TUI don't use it. instead, values are sampled evenly between
+ * 0.0 to 1.0 from the following exponential curve to remove the
+ * need for floating-point math:
+ *
+ *      f(x) = 1092e^{x(\ln(1310720) - \ln(1092))}
+ */
+static const int speedThresholds[]
+	= { 2649, 6428, 15594, 37833, 91786, 222684, 540255, 1310720 };
+
+/*
+ * Capture the state of the game for drawing.
+ */
+static void snapshot(struct gameFrame *f, qdsGame *game)
+{
+	uiState *data = qdsGetUiData(game);
+
+	playfieldCells(f->cells, game);
+	f->activeX = qdsGetActiveX(game);
+	f->activeY = qdsGetActiveY(game);
+	f->banner = data->topOut && data->time - data->topOutTime > 22;
+
+	f->hold = qdsGetHeldPiece(game);
+	f->holdShape = qdsGetShape(game, f->hold, 0);
+	f->canHold = qdsCall(game, QDS_CANHOLD, NULL) > 0;
+
+	int nextCount;
+	if (qdsCall(game, QDS_GETNEXTCOUNT, &nextCount) < 0) nextCount = 1;
+	if (nextCount > 5) nextCount = 5;
+	f->nextCount = nextCount;
+	for (int i = 0; i < nextCount; ++i) {
+		f->next[i] = qdsGetNextPiece(game, i);
+		f->nextShapes[i] = qdsGetShape(game, f->next[i], 0);
+	}
+
+	const char *grade, *message;
+	int gravity;
+	if (qdsCall(game, QDS_GETSCORE, &f->score) < 0) f->score = 0;
+	if (qdsCall(game, QDS_GETTIME, &f->time) < 0) f->time = 0;
+	if (qdsCall(game, QDS_GETSUBLEVEL, &f->level) < 0) f->level = 0;
+	if (qdsCall(game, QDS_GETLEVELTARGET, &f->target) < 0) f->target = 0;
+	if (qdsCall(game, QDS_GETGRADETEXT, &grade) < 0) grade = NULL;
+	if (qdsCall(game, QDS_GETCLEARTYPE, &f->clearType) < 0) f->clearType = 0;
+	if (qdsCall(game, QDS_GETCOMBO, &f->combo) < 0) f->combo = 0;
+	if (qdsCall(game, QDS_GETGRAVITY, &gravity) < 0) gravity = 0;
+	if (qdsCall(game, QDS_GETMESSAGE, &message) < 0) message = "";
+
+	f->hasGrade = grade != NULL;
+	if (grade) copyString(f->grade, sizeof(f->grade), grade);
+	copyString(f->message, sizeof(f->message), message);
+	for (f->speed = 0;
+		 f->speed < 8 && speedThresholds[f->speed] <= gravity;
+		 ++f->speed)
+		;
+
+	f->measured = data->displayPending;
+	f->processStart = data->processStart;
+	data->displayPending = false;
 }
 
 inline static void playfieldLine(WINDOW *w,
-								 const qdsTile *line,
-								 uint_fast16_t visibility,
+								 const unsigned char *cells,
 								 chtype boundary,
-								 const char *tileFilled,
 								 const char *tileEmpty)
 {
 	wattr_set(w, 0, 0, NULL);
 	waddch(w, boundary);
 	for (int x = 0; x < 10; ++x) {
-		int tile = line[x];
-		if (!(visibility & (1 << x))) tile = 0;
+		unsigned char cell = cells[x];
+		const char *presented = tileEmpty;
+		attr_t attr = 0;
+		if (cell & CELL_ACTIVE) {
+			presented = tileFilled;
+			attr = A_BOLD;
+		} else if (cell & CELL_GHOST) {
+			presented = tileGhost;
+		} else if (cell & CELL_FILLED) {
+			presented = tileFilled;
+		}
 
-		const char *presented = tile ? tileFilled : tileEmpty;
-		wattr_set(w, 0, tile % 8, NULL);
+		wattr_set(w, attr, cell & CELL_COLOR, NULL);
 		waddstr(w, presented);
 	}
 	wattr_set(w, 0, 0, NULL);
@@ -129,15 +340,11 @@ inline static void playfieldLine(WINDOW *w,
 static void piece(WINDOW *w,
 				  int cy,
 				  int cx,
-				  const qdsGame *game,
+				  const qdsCoords *shape,
 				  int type,
-				  int orientation,
 				  attr_t attr,
 				  const char *tile)
 {
-	if (type < 0) type = qdsGetActivePieceType(game);
-	const qdsCoords *shape = qdsGetShape(game, type, orientation);
-
 	wattr_set(w, attr, type % 8, NULL);
 	QDS_SHAPE_FOREACH (i, shape) {
 		int x = cx + 2 * i->x;
@@ -147,72 +354,58 @@ static void piece(WINDOW *w,
 	wattr_set(w, 0, 0, NULL);
 }
 
-static void playfield(WINDOW *w, int top, int left, qdsGame *game)
+static void playfield(WINDOW *w,
+					  int top,
+					  int left,
+					  const struct gameFrame *f,
+					  struct viewCache *drawn)
 {
 	const int playfieldBaseY = 21;
 
 	/* playfield base */
-	wmove(w, top + playfieldBaseY + 1, left);
-	waddchstr(
-		w, ((const chtype[]){ ACS_LLCORNER, ACS_HLINE,	  ACS_HLINE, ACS_HLINE,
-							  ACS_HLINE,	ACS_HLINE,	  ACS_HLINE, ACS_HLINE,
-							  ACS_HLINE,	ACS_HLINE,	  ACS_HLINE, ACS_HLINE,
-							  ACS_HLINE,	ACS_HLINE,	  ACS_HLINE, ACS_HLINE,
-							  ACS_HLINE,	ACS_HLINE,	  ACS_HLINE, ACS_HLINE,
-							  ACS_HLINE,	ACS_LRCORNER, 0 }));
-
-	/* playfield proper */
-	const qdsLine *playfield;
-	uiState *data = qdsGetUiData(game);
-	if (data->useDisplayPlayfield)
-		playfield = data->displayPlayfield;
-	else
-		playfield = qdsGetPlayfield(game);
-
-	for (int y = 0; y < 20; ++y) {
-		/* same pointer for both input and output: input is y, output is
-		 * visibility */
-		uint_fast16_t visibility = y;
-		if (qdsCall(game, QDS_GETVISIBILITY, &visibility) < 0)
-			visibility = 0x03ff; /* all visible except walls */
-		wmove(w, top + playfieldBaseY - y, left);
-		playfieldLine(
-			w, playfield[y], visibility, ACS_VLINE, tileFilled, tileEmpty);
+	if (!drawn->valid) {
+		wmove(w, top + playfieldBaseY + 1, left);
+		waddchstr(w,
+				  ((const chtype[]){
+					  ACS_LLCORNER, ACS_HLINE, ACS_HLINE, ACS_HLINE,
+					  ACS_HLINE,	ACS_HLINE, ACS_HLINE, ACS_HLINE,
+					  ACS_HLINE,	ACS_HLINE, ACS_HLINE, ACS_HLINE,
+					  ACS_HLINE,	ACS_HLINE, ACS_HLINE, ACS_HLINE,
+					  ACS_HLINE,	ACS_HLINE, ACS_HLINE, ACS_HLINE,
+					  ACS_HLINE,	ACS_LRCORNER, 0 }));
 	}
-	for (int y = 20; y < 22; ++y) {
-		uint_fast16_t visibility = y;
-		if (qdsCall(game, QDS_GETVISIBILITY, &visibility) < 0)
-			visibility = 0x03ff;
-		wmove(w, top + playfieldBaseY - y, left);
-		playfieldLine(
-			w, playfield[y], visibility, ' ', tileFilled, tileEmptyOverflow);
-	}
-
-	if (data->topOut) topOutAnimation(w, top, left, game);
 
-	int x, y;
-	x = left + 1 + 2 * qdsGetActiveX(game);
+	/* playfield proper; only rows that changed are sent out */
+	bool changed = false;
+	for (int y = 0; y < 22; ++y) {
+		if (drawn->valid && !memcmp(f->cells[y], drawn->cells[y], 10))
+			continue;
+		changed = true;
 
-	/* ghost piece */
-	bool showGhost;
-	if (qdsCall(game, QDS_SHOWGHOST, &showGhost) < 0 || showGhost) {
-		y = top + playfieldBaseY - qdsGetGhostY(game);
-		piece(w, y, x, game, -1, -1, 0, tileGhost);
+		wmove(w, top + playfieldBaseY - y, left);
+		if (y < 20)
+			playfieldLine(w, f->cells[y], ACS_VLINE, tileEmpty);
+		else
+			playfieldLine(w, f->cells[y], ' ', tileEmptyOverflow);
 	}
+	memcpy(drawn->cells, f->cells, sizeof(f->cells));
 
-	/* active piece */
-	y = top + playfieldBaseY - qdsGetActiveY(game);
-	piece(w, y, x, game, -1, -1, A_BOLD, tileFilled);
+	int x = left + 1 + 2 * f->activeX;
+	int y = top + playfieldBaseY - f->activeY;
 	wmove(w, y, x);
 
-	if (data->topOut && data->time - data->topOutTime > 22)
-		return gameOverBanner(w, top + 8, left);
+	if (f->banner) {
+		/* the banner covers some rows; put it back if any was redrawn */
+		if (!drawn->banner || changed) gameOverBanner(w, top + 8, left);
+		wmove(w, top + 11, left + 19);
+		drawn->banner = true;
+	}
 }
 
 static void queuedPiece(WINDOW *w,
 						int top,
 						int left,
-						qdsGame *game,
+						const qdsCoords *shape,
 						int type,
 						int attr)
 {
@@ -221,24 +414,43 @@ static void queuedPiece(WINDOW *w,
 
 	int cx = left + 2;
 	int cy = top + 1;
-	piece(w, cy, cx, game, type, 0, attr, tileFilled);
+	piece(w, cy, cx, shape, type, attr, tileFilled);
 }
 
-static void hold(WINDOW *w, int top, int left, qdsGame *game)
+static void hold(WINDOW *w,
+				 int top,
+				 int left,
+				 const struct gameFrame *f,
+				 struct viewCache *drawn)
 {
-	attr_t attrs = 0;
-	if (qdsCall(game, QDS_CANHOLD, NULL) > 0) attrs |= A_BOLD;
-	queuedPiece(w, top, left, game, qdsGetHeldPiece(game), attrs);
+	if (drawn->valid && f->hold == drawn->hold
+		&& f->canHold == drawn->canHold)
+		return;
+	drawn->hold = f->hold;
+	drawn->canHold = f->canHold;
+
+	queuedPiece(
+		w, top, left, f->holdShape, f->hold, f->canHold ? A_BOLD : 0);
 }
 
-static void next(WINDOW *w, int top, int left, qdsGame *game)
+static void next(WINDOW *w,
+				 int top,
+				 int left,
+				 const struct gameFrame *f,
+				 struct viewCache *drawn)
 {
-	int nextCount;
-	if (qdsCall(game, QDS_GETNEXTCOUNT, &nextCount) < 0) nextCount = 1;
-	if (nextCount > 5) nextCount = 5;
-	for (int i = 0; i < nextCount; ++i) {
+	if (!drawn->valid || f->nextCount != drawn->nextCount) {
+		drawn->nextCount = f->nextCount;
+		for (int i = 0; i < 5; ++i) drawn->next[i] = -1;
+	}
+
+	for (int i = 0; i < f->nextCount; ++i) {
+		if (f->next[i] == drawn->next[i]) continue;
+		drawn->next[i] = f->next[i];
+
 		attr_t attr = i == 0 ? A_BOLD : 0;
-		queuedPiece(w, top + 3 * i, left, game, qdsGetNextPiece(game, i), attr);
+		queuedPiece(
+			w, top + 3 * i, left, f->nextShapes[i], f->next[i], attr);
 	}
 }
 
@@ -266,98 +478,145 @@ static void statTime(WINDOW *w, int top, int left, const char *name, int time)
 	stat(w, top, left, name, "%02d:%02d.%02d", timem, times, timef);
 }
 
-/*
- * The width of the speed bar should be calculated as follows:
- *
- *      f(x) = \frac{\ln(x) - \ln(1092)}{\ln(1310720) - \ln(1092)}
- *
- * The TUI don't use it. instead, values are sampled evenly between
- * 0.0 to 1.0 from the following exponential curve to remove the
- * need for floating-point math:
- *
- *      f(x) = 1092e^{x(\ln(1310720) - \ln(1092))}
- */
-static const int speedThresholds[]
-	= { 2649, 6428, 15594, 37833, 91786, 222684, 540255, 1310720 };
-
-static void speedBar(WINDOW *w, int top, int left, qdsGame *game)
+static void speedBar(WINDOW *w,
+					 int top,
+					 int left,
+					 const struct gameFrame *f,
+					 struct viewCache *drawn)
 {
-	int gravity;
-	if (qdsCall(game, QDS_GETGRAVITY, &gravity) < 0) gravity = 0;
+	if (drawn->valid && f->speed == drawn->speed) return;
+	drawn->speed = f->speed;
 
 	int i;
 	wmove(w, top, left);
 	wattr_set(w, 0, 8, NULL);
-	for (i = 0; i < 8 && speedThresholds[i] <= gravity; ++i)
-		waddch(w, ACS_HLINE);
+	for (i = 0; i < f->speed; ++i) waddch(w, ACS_HLINE);
 	wattr_set(w, 0, 0, NULL);
 	for (; i < 8; ++i) waddch(w, ACS_HLINE);
 }
 
-static void message(WINDOW *w, int top, int left, qdsGame *game)
+static void message(WINDOW *w,
+					int top,
+					int left,
+					const struct gameFrame *f,
+					struct viewCache *drawn)
 {
-	const char *message;
-	if (qdsCall(game, QDS_GETMESSAGE, &message) < 0) message = "";
-	int len = strlen(message);
+	if (!cacheString(drawn->message, sizeof(drawn->message), f->message)
+		&& drawn->valid)
+		return;
+	int len = strlen(f->message);
 
 	int i = 0, start = (20 - len) / 2;
 	wmove(w, top, left);
 	for (i = 0; i < 20; ++i) waddch(w, ' ');
-	mvwaddstr(w, top, left + start, message);
+	mvwaddstr(w, top, left + start, f->message);
 }
 
-static void gameView(WINDOW *w, int top, int left, qdsGame *game)
+static void gameView(WINDOW *w,
+					 int top,
+					 int left,
+					 const struct gameFrame *f,
+					 struct viewCache *drawn)
 {
-	const char *grade;
-	int score, time, level, target, combo;
-	unsigned int clearType;
-	if (qdsCall(game, QDS_GETSCORE, &score) < 0) score = 0;
-	if (qdsCall(game, QDS_GETTIME, &time) < 0) time = 0;
-	if (qdsCall(game, QDS_GETSUBLEVEL, &level) < 0) level = 0;
-	if (qdsCall(game, QDS_GETLEVELTARGET, &target) < 0) target = 0;
-	if (qdsCall(game, QDS_GETGRADETEXT, &grade) < 0) grade = NULL;
-	if (qdsCall(game, QDS_GETCLEARTYPE, &clearType) < 0) clearType = 0;
-	if (qdsCall(game, QDS_GETCOMBO, &combo) < 0) combo = 0;
-
-	hold(w, top + 3, left + 2, game);
-	clearTicker(w, top + 6, left + 2, clearType, combo);
-	if (grade) stat(w, top + 13, left + 2, "GRADE", "%s", grade);
-	stat(w, top + 16, left + 2, "SCORE", "%8d", score);
-	statTime(w, top + 19, left + 2, "TIME", time);
-
-	next(w, top + 3, left + 34, game);
-	mvwprintw(w, top + 18, left + 34, "%6d", level);
-	speedBar(w, top + 19, left + 34, game);
-	if (target != 0) mvwprintw(w, top + 20, left + 34, "%6d", target);
-
-	message(w, top + 23, left + 12, game);
-	playfield(w, top, left + 11, game);
+	bool valid = drawn->valid;
+
+	hold(w, top + 3, left + 2, f, drawn);
+	if (!valid || f->clearType != drawn->clearType
+		|| f->combo != drawn->combo) {
+		clearTicker(w, top + 6, left + 2, f->clearType, f->combo);
+		drawn->clearType = f->clearType;
+		drawn->combo = f->combo;
+	}
+	if (f->hasGrade
+		&& (cacheString(drawn->grade, sizeof(drawn->grade), f->grade)
+			|| !valid))
+		stat(w, top + 13, left + 2, "GRADE", "%s", f->grade);
+	if (!valid || f->score != drawn->score)
+		stat(w, top + 16, left + 2, "SCORE", "%8d", drawn->score = f->score);
+	if (!valid || f->time != drawn->time)
+		statTime(w, top + 19, left + 2, "TIME", drawn->time = f->time);
+
+	next(w, top + 3, left + 34, f, drawn);
+	if (!valid || f->level != drawn->level)
+		mvwprintw(w, top + 18, left + 34, "%6d", drawn->level = f->level);
+	speedBar(w, top + 19, left + 34, f, drawn);
+	if (f->target != 0 && (!valid || f->target != drawn->target))
+		mvwprintw(w, top + 20, left + 34, "%6d", drawn->target = f->target);
+
+	message(w, top + 23, left + 12, f, drawn);
+	playfield(w, top, left + 11, f, drawn);
+
+	drawn->valid = true;
 }
 
-static void screenEnter(WINDOW *w, uiState *state)
+/*
+ * Runs on the render thread.
+ */
+static void drawFrame(const void *frame, void *arg)
+{
+	const struct gameFrame *f = frame;
+	struct screenState *state = arg;
+
+	gameView(stdscr, 0, 0, f, &state->drawn);
+	wnoutrefresh(stdscr);
+	doupdate();
+
+	if (f->measured && state->latency) {
+		struct timespec end;
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		recordLatency(&state->latency->processToDisplay,
+					  timespecDiff(&end, &f->processStart));
+	}
+}
+
+static void screenEnter(WINDOW *w, uiState *uiState)
 {
 	werase(w);
-	qdsGame *game = state->screenData = qdsNewGame();
+	struct screenState *state = uiState->screenData
+		= malloc(sizeof(struct screenState));
+	if (!state) abort();
+
+	qdsGame *game = state->game = qdsNewGame();
 	if (!game) abort();
 
-	qdsSetRuleset(game, state->ruleset);
-	qdsSetMode(game, state->mode);
-	qdsSetUi(game, &ui, state);
+	/* first frame draws everything */
+	memset(&state->drawn, 0, sizeof(state->drawn));
+	state->latency = uiState->latency;
+
+	qdsSetRuleset(game, uiState->ruleset);
+	qdsSetMode(game, uiState->mode);
+	qdsSetUi(game, &ui, uiState);
+
+	state->renderer
+		= startRenderer(sizeof(struct gameFrame), drawFrame, state);
+	if (!state->renderer) abort();
+}
+
+static void screenUpdate(WINDOW *w, uiState *uiState)
+{
+	struct screenState *state = uiState->screenData;
+	qdsRunCycle(state->game, uiState->input);
 }
 
-static void screenUpdate(WINDOW *w, uiState *state)
+static void screenDraw(WINDOW *w, uiState *uiState)
 {
-	qdsRunCycle(state->screenData, state->input);
-	gameView(stdscr, 0, 0, state->screenData);
+	struct screenState *state = uiState->screenData;
+	snapshot(renderTarget(state->renderer), state->game);
+	publishFrame(state->renderer);
 }
 
-static void screenExit(WINDOW *w, uiState *state)
+static void screenExit(WINDOW *w, uiState *uiState)
 {
-	qdsDestroyGame(state->screenData);
+	struct screenState *state = uiState->screenData;
+	stopRenderer(state->renderer);
+	qdsDestroyGame(state->game);
+	free(state);
 }
 
 const screen screenGame = {
 	.enter = screenEnter,
 	.update = screenUpdate,
+	.draw = screenDraw,
 	.exit = screenExit,
+	.renderThread = true,
 };
@@ -51,9 +51,7 @@ static void screenEnter(WINDOW *w, uiState *uiState)
 	if (!state) return;
 
 	/* tear down any previously existing input handler */
-	if (uiState->inputHandler && uiState->inputHandler->cleanup)
-		uiState->inputHandler->cleanup(uiState->inputData);
-	uiState->inputHandler = NULL;
+	releaseInput(uiState);
 
 	state->devCount = 0;
 
@@ -87,7 +85,8 @@ static void gotoModeSelect(uiState *uiState)
 {
 	/* clear out all events to prevent ghost input */
 	unsigned int input;
-	uiState->inputHandler->read(&input, uiState->inputData);
+	struct timespec time;
+	uiState->inputHandler->read(&input, uiState->inputData, &time);
 
 	return changeScreen(uiState, &screenModeSelect);
 }
@@ -105,7 +104,12 @@ static void screenUpdate(WINDOW *w, uiState *uiState)
 		for (int i = 0; i < state->devCount - 1; ++i) {
 			struct pollfd *pollfd = state->devices + i;
 			if (pollfd->revents & POLLIN) {
+				/* take every device, including ones plugged in later */
+				if (initInput(uiState, &hotplugInput, pollfd->fd)) {
+					return gotoModeSelect(uiState);
+				}
 				if (initInput(uiState, &evdevInput, pollfd->fd)) {
+					pollfd->fd = -1; /* now owned by the input handler */
 					return gotoModeSelect(uiState);
 				}
 			}
@@ -137,6 +141,8 @@ static void screenExit(WINDOW *w, uiState *uiState)
 {
 	struct screenState *state = uiState->screenData;
 #if defined(HAVE_EVDEV) && defined(HAVE_UDEV)
+	for (int i = 0; i < state->devCount - 1; ++i)
+		if (state->devices[i].fd >= 0) close(state->devices[i].fd);
 	udev_unref(state->udev);
 #endif
 	free(state);
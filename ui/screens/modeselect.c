@@ -25,6 +25,7 @@
 #include "screen.h"
 #include "widgets.h"
 #include <quadus.h>
+#include <quadus/modedef.h>
 #include <signal.h>
 #include <stdbool.h>
 #include <stdlib.h>
@@ -42,17 +43,27 @@ struct modeSelection
 static const menuItem rulesets[] = {
 	{ "Standard", &qdsRulesetStandard },
 	{ "Arcade", &qdsRulesetArcade },
+	{ "TGM", &qdsRulesetTgm },
 	{ NULL, NULL },
 };
 
-static const menuItem gamemodes[] = {
+/* the next to last entry is left for a custom mode */
+static menuItem gamemodes[] = {
 	{ "Marathon", &qdsModeMarathon },
 	{ "Sprint", &qdsModeSprint },
 	{ "Master", &qdsModeMaster },
 	{ "Invisible Marathon", &qdsModeInvisible },
 	{ NULL, NULL },
+	{ NULL, NULL },
 };
 
+void addCustomMode(const qdsModeDef *def)
+{
+	size_t slot = sizeof(gamemodes) / sizeof(*gamemodes) - 2;
+	gamemodes[slot].name = qdsGetModeDefName(def);
+	gamemodes[slot].data = qdsGetModeDefMode(def);
+}
+
 static const menuItem *menus[] = {
 	[LEVEL_MODE] = gamemodes,
 	[LEVEL_RULESET] = rulesets,
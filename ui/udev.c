@@ -30,16 +30,19 @@
 #include <sys/ioctl.h>
 #include <unistd.h>
 
-static bool isEventKeyboard(int fd)
+bool isGameInputDevice(int fd)
 {
 	int evVersion;
 	if (ioctl(fd, EVIOCGVERSION, &evVersion) < 0)
 		return false; /* not event device */
 
-	/* assume everything with KEY_SPACE present is a keyboard */
-	unsigned char buttons[KEY_CNT / CHAR_BIT];
+	/*
+	 * assume everything with KEY_SPACE present is a keyboard, and
+	 * everything with a south face button a gamepad
+	 */
+	unsigned char buttons[KEY_CNT / CHAR_BIT] = { 0 };
 	ioctl(fd, EVIOCGBIT(EV_KEY, sizeof(buttons)), buttons);
-	if (BIT_GET(buttons, KEY_SPACE)) {
+	if (BIT_GET(buttons, KEY_SPACE) || BIT_GET(buttons, BTN_SOUTH)) {
 		return true;
 	} else {
 		return false;
@@ -72,7 +75,7 @@ int searchKeyboards(struct pollfd *fds, size_t capacity, struct udev *udev)
 		if (devFd < 0) continue; /* can't open */
 
 		/* check device */
-		if (isEventKeyboard(devFd)) {
+		if (isGameInputDevice(devFd)) {
 			/* add file to poll set */
 			struct pollfd *pollfd = &fds[count++];
 			pollfd->fd = devFd;
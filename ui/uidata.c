@@ -21,13 +21,48 @@
  * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 #include "quadustui.h"
+#include "input/input.h"
+#include "input/thread.h"
 #include "screen.h"
 #include <curses.h>
+#include <pthread.h>
+
+static pthread_mutex_t cursesLock;
+static pthread_once_t cursesLockOnce = PTHREAD_ONCE_INIT;
+
+static void initCursesLock(void)
+{
+	/* recursive, as input may be read while a screen is drawn */
+	pthread_mutexattr_t attr;
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+	pthread_mutex_init(&cursesLock, &attr);
+	pthread_mutexattr_destroy(&attr);
+}
+
+void lockCurses(void)
+{
+	pthread_once(&cursesLockOnce, initCursesLock);
+	pthread_mutex_lock(&cursesLock);
+}
+
+void unlockCurses(void)
+{
+	pthread_mutex_unlock(&cursesLock);
+}
 
 void initUiData(uiState *data)
 {
 	data->time = 0;
 	data->currentScreen = NULL;
+	data->inputHandler = NULL;
+	data->inputData = NULL;
+	data->inputThread = NULL;
+	data->inputHeld = 0;
+	data->inputLatch = 0;
+	data->inputStamped = false;
+	data->displayPending = false;
+	data->latency = NULL;
 	data->useDisplayPlayfield = false;
 	data->topOut = false;
 	data->lines.lines = 0;
@@ -43,3 +78,15 @@ void changeScreen(uiState *data, const screen *screen)
 		screen->enter(stdscr, data);
 	}
 }
+
+void releaseInput(uiState *data)
+{
+	if (data->inputThread) stopInputThread(data->inputThread);
+	data->inputThread = NULL;
+	if (data->inputHandler && data->inputHandler->cleanup)
+		data->inputHandler->cleanup(data->inputData);
+	data->inputHandler = NULL;
+	data->inputData = NULL;
+	data->inputHeld = 0;
+	data->inputLatch = 0;
+}